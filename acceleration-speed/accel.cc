@@ -0,0 +1,1052 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "accel.h"
+#include "libde265/acceleration.h"
+#include "libde265/decctx.h"
+#include "libde265/util.h"
+
+#include <string.h>
+#include <vector>
+#include <map>
+
+
+// pixels around the input planes, enough for the interpolation filters
+#define MC_MARGIN 8
+
+
+template <class T> class aligned_plane
+{
+public:
+  aligned_plane() : width(0), height(0), stride(0), origin(NULL) { }
+
+  void alloc(int w,int h, int margin=0) {
+    if (w==width && h==height && origin) { return; }
+
+    width  = w;
+    height = h;
+    stride = (w+2*margin+31) & ~31;
+
+    mem.resize(stride*(h+2*margin) + 64/sizeof(T));
+
+    uintptr_t base = ((uintptr_t)&mem[0] + 63) & ~(uintptr_t)63;
+    origin = (T*)base + margin*stride + margin;
+  }
+
+  T* at(int x,int y) { return origin + x + y*stride; }
+
+  int width, height;
+  ptrdiff_t stride;
+
+private:
+  std::vector<T> mem;
+  T* origin;
+};
+
+
+/* Input data for the kernels, derived from the current and the previous input image.
+   When there is no previous image, the horizontally mirrored current image is used.
+
+   Coefficients and int32 residuals are stored in block order: the nT x nT block
+   at (x,y) is contiguous at offset block_offset(x,y,nT,nT).
+
+   The MC intermediates are also stored in block order, but with a stride of
+   block_stride(w), because the SIMD functions use aligned loads and stores
+   (as for the prediction buffers in the decoder) and write up to 8 values
+   beyond the block width.
+
+   Kernel outputs are written into separate buffers for the implementation under
+   test and for its reference implementation.
+ */
+class accel_test_data
+{
+public:
+  void set_image(std::shared_ptr<const de265_image> img);
+
+  int width, height;
+
+  aligned_plane<uint8_t>  pixels8 [2 /* curr,prev */];
+  aligned_plane<uint16_t> pixels10[2 /* curr,prev */];
+
+  aligned_plane<int16_t>  residuals16;  // 8 bit, input to forward transforms
+
+  aligned_plane<int16_t>  coeffs[4 /* log2 nT - 2 */];
+  aligned_plane<int16_t>  sparseCoeffs[4 /* log2 nT - 2 */]; // non-zero only in top-left sparse_size()
+  aligned_plane<int32_t>  residuals32[2 /* 8,10 bit */][4 /* log2 nT - 2 */];
+  aligned_plane<int16_t>  levels[4 /* log2 nT - 2 */]; // dequantization input, with the int16 extremes
+
+  int16_t dequantPos[4 /* log2 nT - 2 */][32*32]; // coefficient positions of the dequantization list
+  uint8_t scalingFactors[32*32];                  // scaling list for all block sizes
+
+  aligned_plane<int16_t>  mcbuffer;
+
+  aligned_plane<uint8_t>  deblkFlags[2 /* q,p */]; // random deblocking flags of 4x4 units
+
+  // outputs, indexed with the role (0: implementation, 1: reference)
+
+  aligned_plane<uint8_t>  out8 [2];
+  aligned_plane<uint16_t> out10[2];
+  aligned_plane<int16_t>  out16s[2];  // MC output (with block_stride()) or coefficients
+  aligned_plane<int32_t>  out32[2];
+
+  void reset_pixel_output(int role);
+
+  // MC intermediates for w x h blocks, 14 bit
+  const int16_t* pred(int bitDepth, int frame, int x,int y, int w,int h);
+
+  int block_offset(int x,int y, int w,int h) const {
+    return ((y/h)*(width/w) + x/w) * w*h;
+  }
+
+  static int block_stride(int w) { return (w+15) & ~15; }
+
+  // size of the non-zero area in sparseCoeffs (typical low-frequency blocks)
+  static int sparse_size(int nT) { return nT>=8 ? nT/4 : 1; }
+
+  int block_start(int x,int y, int w,int h) const {
+    return ((y/h)*(width/w) + x/w) * block_stride(w)*h;
+  }
+
+private:
+  std::shared_ptr<const de265_image> curr, prev;
+
+  std::map<int, aligned_plane<int16_t> > predBlocks;
+};
+
+static accel_test_data testdata;
+
+
+void accel_test_data::set_image(std::shared_ptr<const de265_image> img)
+{
+  if (img == curr) {
+    return;
+  }
+
+  if (curr &&
+      curr->get_width(0)  == img->get_width(0) &&
+      curr->get_height(0) == img->get_height(0)) {
+    prev = curr;
+  }
+  else {
+    prev.reset();
+  }
+
+  curr = img;
+
+  width  = img->get_width(0);
+  height = img->get_height(0);
+
+
+  // --- pixels ---
+
+  for (int i=0;i<2;i++) {
+    pixels8[i] .alloc(width,height, MC_MARGIN);
+    pixels10[i].alloc(width,height, MC_MARGIN);
+
+    const de265_image* src = (i==0 || !prev) ? curr.get() : prev.get();
+    const bool mirror = (i==1 && !prev);
+
+    int srcStride = src->get_luma_stride();
+    const uint8_t* p = src->get_image_plane_at_pos(0,0,0);
+
+    for (int y=-MC_MARGIN;y<height+MC_MARGIN;y++)
+      for (int x=-MC_MARGIN;x<width+MC_MARGIN;x++) {
+        int xs = Clip3(0,width-1,  x);
+        int ys = Clip3(0,height-1, y);
+        if (mirror) { xs = width-1-xs; }
+
+        uint8_t v = p[xs+ys*srcStride];
+        *pixels8[i].at(x,y)  = v;
+        *pixels10[i].at(x,y) = (v<<2) | (v>>6);
+      }
+  }
+
+
+  predBlocks.clear();
+
+
+  // --- residuals ---
+
+  residuals16.alloc(width,height);
+
+  for (int y=0;y<height;y++)
+    for (int x=0;x<width;x++) {
+      *residuals16.at(x,y) = *pixels8[0].at(x,y) - *pixels8[1].at(x,y);
+    }
+
+  for (int log2nT=2;log2nT<=5;log2nT++) {
+    int nT = 1<<log2nT;
+
+    coeffs[log2nT-2].alloc(width*height, 1);
+    sparseCoeffs[log2nT-2].alloc(width*height, 1);
+    residuals32[0][log2nT-2].alloc(width*height, 1);
+    residuals32[1][log2nT-2].alloc(width*height, 1);
+    levels[log2nT-2].alloc(width*height, 1);
+
+    for (int y=0;y<=height-nT;y+=nT)
+      for (int x=0;x<=width-nT;x+=nT) {
+        int offset = block_offset(x,y,nT,nT);
+
+        int16_t* c   = coeffs[log2nT-2].at(offset,0);
+        int16_t* cs  = sparseCoeffs[log2nT-2].at(offset,0);
+        int32_t* r8  = residuals32[0][log2nT-2].at(offset,0);
+        int32_t* r10 = residuals32[1][log2nT-2].at(offset,0);
+        int16_t* l   = levels[log2nT-2].at(offset,0);
+
+        for (int yy=0;yy<nT;yy++)
+          for (int xx=0;xx<nT;xx++) {
+            c  [xx+yy*nT] = *residuals16.at(x+xx,y+yy) * 8;
+            cs [xx+yy*nT] = (xx<sparse_size(nT) && yy<sparse_size(nT)) ? c[xx+yy*nT] : 0;
+            r8 [xx+yy*nT] = *residuals16.at(x+xx,y+yy);
+            r10[xx+yy*nT] = *pixels10[0].at(x+xx,y+yy) - *pixels10[1].at(x+xx,y+yy);
+
+            // coefficient levels may use the full int16 range (7.4.9.11)
+            int i = xx+yy*nT;
+            l[i] = (i%13==0 ? -32768 :
+                    i%13==6 ?  32767 :
+                    i%7==3  ? Clip3(-32768,32767, c[i]*16) : c[i]);
+          }
+      }
+  }
+
+  // the coefficient list visits all positions in a scattered order, like a diagonal scan
+  for (int log2nT=2;log2nT<=5;log2nT++) {
+    int n = 1<<(2*log2nT);
+    for (int i=0;i<n;i++) {
+      dequantPos[log2nT-2][i] = (i*(n/2+5)) % n;
+    }
+  }
+
+  // scaling factors over the whole range 1-255 (7.4.5)
+  for (int i=0;i<32*32;i++) {
+    scalingFactors[i] = (i%11==0 ? 255 : 1 + (i*37)%255);
+  }
+
+  mcbuffer.alloc(64*(64+7), 1);
+
+
+  // --- deblocking flags ---
+
+  /* Random flags, each with a probability such that all boundary strength cases
+     appear: intra 1/8, coefficients 1/4, transform and PB edges 1/2 each.
+     The bS bits are also set, they have to be overwritten. */
+
+  uint32_t random = 12345;
+
+  for (int i=0;i<2;i++) {
+    deblkFlags[i].alloc(width,height);
+
+    for (int y=0;y<height;y++)
+      for (int x=0;x<width;x++) {
+        random = random*1103515245 + 12345;
+        uint32_t r = random>>8;
+
+        uint8_t flags = r & DEBLOCK_BS_MASK;
+        if ((r & 0x001C) == 0) flags |= DEBLOCK_FLAG_INTRA;
+        if ((r & 0x0060) == 0) flags |= DEBLOCK_FLAG_NONZERO_COEFF;
+        if  (r & 0x0080)       flags |= DEBLOCK_FLAG_VERTI;
+        if  (r & 0x0100)       flags |= DEBLOCK_FLAG_HORIZ;
+        if  (r & 0x0200)       flags |= DEBLOCK_PB_EDGE_VERTI;
+        if  (r & 0x0400)       flags |= DEBLOCK_PB_EDGE_HORIZ;
+
+        *deblkFlags[i].at(x,y) = flags;
+      }
+  }
+
+  for (int r=0;r<2;r++) {
+    out8[r] .alloc(width,height);
+    out10[r].alloc(width,height);
+    out16s[r].alloc(width*height*8, 1);  // block_stride(2) = 8*2
+    out32[r].alloc(width*height, 1);
+  }
+}
+
+
+const int16_t* accel_test_data::pred(int bitDepth, int frame, int x,int y, int w,int h)
+{
+  const int key = (bitDepth<<24) | (frame<<16) | (w<<8) | h;
+  const int stride = block_stride(w);
+
+  std::map<int, aligned_plane<int16_t> >::iterator iter = predBlocks.find(key);
+  if (iter == predBlocks.end()) {
+    aligned_plane<int16_t>& blocks = predBlocks[key];
+    blocks.alloc((width/w)*(height/h) * stride*h, 1);
+
+    // The intermediates are the pixels scaled to 14 bit, with some deviation,
+    // such that they also leave the nominal range.
+
+    for (int by=0;by<=height-h;by+=h)
+      for (int bx=0;bx<=width-w;bx+=w) {
+        int16_t* out = blocks.at(block_start(bx,by,w,h),0);
+
+        for (int yy=0;yy<h;yy++)
+          for (int xx=0;xx<w;xx++) {
+            int p,q;
+            if (bitDepth>8) { p = *pixels10[frame].at(bx+xx,by+yy); q = *pixels10[1-frame].at(bx+xx,by+yy); }
+            else            { p = *pixels8 [frame].at(bx+xx,by+yy); q = *pixels8 [1-frame].at(bx+xx,by+yy); }
+
+            out[xx+yy*stride] = (p << (14-bitDepth)) + (p-q)*4;
+          }
+      }
+
+    iter = predBlocks.find(key);
+  }
+
+  return iter->second.at(block_start(x,y,w,h),0);
+}
+
+
+void accel_test_data::reset_pixel_output(int role)
+{
+  for (int y=0;y<height;y++) {
+    memcpy(out8 [role].at(0,y), pixels8 [0].at(0,y), width*sizeof(uint8_t));
+    memcpy(out10[role].at(0,y), pixels10[0].at(0,y), width*sizeof(uint16_t));
+  }
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+enum accel_kernel_type
+{
+  // motion compensation
+  Kernel_QPEL,
+  Kernel_EPEL_Copy,
+  Kernel_EPEL_H,
+  Kernel_EPEL_V,
+  Kernel_EPEL_HV,
+  Kernel_QPEL_Bi,
+  Kernel_EPEL_Bi,
+
+  // weighted prediction
+  Kernel_Pred_Unweighted,
+  Kernel_Pred_Weighted,
+  Kernel_Pred_Avg,
+  Kernel_Pred_WeightedBi,
+
+  // reconstruction, adding to the prediction
+  Kernel_TransformAdd,
+  Kernel_TransformAddPartial,
+  Kernel_TransformDCAdd,
+  Kernel_DSTAdd,
+  Kernel_TransformSkipRDPCM_V,
+  Kernel_TransformSkipRDPCM_H,
+  Kernel_AddResidual,
+
+  // reconstruction of the residual
+  Kernel_IDCT,
+  Kernel_IDCTPartial,
+  Kernel_IDST,
+  Kernel_TransformBypass,
+  Kernel_TransformBypassRDPCM_V,
+  Kernel_TransformBypassRDPCM_H,
+  Kernel_RDPCM_V,
+  Kernel_RDPCM_H,
+  Kernel_TransformSkipResidual,
+  Kernel_RotateCoefficients,
+
+  // inverse quantization
+  Kernel_Dequant,
+  Kernel_DequantScalingList,
+  Kernel_DequantBlock,
+
+  // forward transforms
+  Kernel_FDCT,
+  Kernel_FDST,
+  Kernel_Hadamard,
+
+  // distortion measures
+  Kernel_SAD,
+  Kernel_SSD,
+  Kernel_SATD,
+
+  // deblocking (width: number of 4x4 units in the run)
+  Kernel_DeblockBoundaryStrength
+};
+
+
+enum accel_output_type
+{
+  Output_Pixels,      // out8 / out10
+  Output_Int16,       // out16s, in picture layout
+  Output_Coeffs,      // out16s, in block order
+  Output_Residual,    // out32, in block order
+  Output_Value,
+  Output_Flags        // out8 and value (deblocking flags and motion mask)
+};
+
+
+struct accel_kernel
+{
+  accel_kernel_type type;
+  int width, height;
+  int bitDepth;
+  int dx,dy;  // QPEL fractional position
+
+  accel_output_type output_type() const;
+  const void* function_address(const acceleration_functions* accel) const;
+  std::string name(const char* implName) const;
+};
+
+
+accel_output_type accel_kernel::output_type() const
+{
+  switch (type) {
+  case Kernel_QPEL:
+  case Kernel_EPEL_Copy:
+  case Kernel_EPEL_H:
+  case Kernel_EPEL_V:
+  case Kernel_EPEL_HV:
+    return Output_Int16;
+
+  case Kernel_QPEL_Bi:
+  case Kernel_EPEL_Bi:
+  case Kernel_Pred_Unweighted:
+  case Kernel_Pred_Weighted:
+  case Kernel_Pred_Avg:
+  case Kernel_Pred_WeightedBi:
+  case Kernel_TransformAdd:
+  case Kernel_TransformAddPartial:
+  case Kernel_TransformDCAdd:
+  case Kernel_DSTAdd:
+  case Kernel_TransformSkipRDPCM_V:
+  case Kernel_TransformSkipRDPCM_H:
+  case Kernel_AddResidual:
+    return Output_Pixels;
+
+  case Kernel_RotateCoefficients:
+  case Kernel_Dequant:
+  case Kernel_DequantScalingList:
+  case Kernel_DequantBlock:
+  case Kernel_FDCT:
+  case Kernel_FDST:
+  case Kernel_Hadamard:
+    return Output_Coeffs;
+
+  case Kernel_SAD:
+  case Kernel_SSD:
+  case Kernel_SATD:
+    return Output_Value;
+
+  case Kernel_DeblockBoundaryStrength:
+    return Output_Flags;
+
+  default:
+    return Output_Residual;
+  }
+}
+
+
+/* Used to find out which functions are replaced by an acceleration level. */
+const void* accel_kernel::function_address(const acceleration_functions* a) const
+{
+  const bool hbd = (bitDepth>8);
+  const int log2Size = Log2(width);
+
+  switch (type) {
+  case Kernel_QPEL: return hbd ? (const void*)a->put_hevc_qpel_16[dx][dy] : (const void*)a->put_hevc_qpel_8[dx][dy];
+  case Kernel_EPEL_Copy: return hbd ? (const void*)a->put_hevc_epel_16    : (const void*)a->put_hevc_epel_8;
+  case Kernel_EPEL_H:    return hbd ? (const void*)a->put_hevc_epel_h_16  : (const void*)a->put_hevc_epel_h_8;
+  case Kernel_EPEL_V:    return hbd ? (const void*)a->put_hevc_epel_v_16  : (const void*)a->put_hevc_epel_v_8;
+  case Kernel_EPEL_HV:   return hbd ? (const void*)a->put_hevc_epel_hv_16 : (const void*)a->put_hevc_epel_hv_8;
+  case Kernel_QPEL_Bi:   return hbd ? (const void*)a->put_hevc_qpel_bi_16 : (const void*)a->put_hevc_qpel_bi_8;
+  case Kernel_EPEL_Bi:   return hbd ? (const void*)a->put_hevc_epel_bi_16 : (const void*)a->put_hevc_epel_bi_8;
+
+  case Kernel_Pred_Unweighted: return hbd ? (const void*)a->put_unweighted_pred_16   : (const void*)a->put_unweighted_pred_8;
+  case Kernel_Pred_Weighted:   return hbd ? (const void*)a->put_weighted_pred_16     : (const void*)a->put_weighted_pred_8;
+  case Kernel_Pred_Avg:        return hbd ? (const void*)a->put_weighted_pred_avg_16 : (const void*)a->put_weighted_pred_avg_8;
+  case Kernel_Pred_WeightedBi: return hbd ? (const void*)a->put_weighted_bipred_16   : (const void*)a->put_weighted_bipred_8;
+
+  case Kernel_TransformAdd: return hbd ? (const void*)a->transform_add_16[log2Size-2] : (const void*)a->transform_add_8[log2Size-2];
+  case Kernel_TransformAddPartial: return hbd ? (const void*)a->transform_add_partial_16[log2Size-2] : (const void*)a->transform_add_partial_8[log2Size-2];
+  case Kernel_TransformDCAdd: return hbd ? (const void*)a->transform_dc_add_16 : (const void*)a->transform_dc_add_8;
+  case Kernel_DSTAdd:       return hbd ? (const void*)a->transform_4x4_dst_add_16 : (const void*)a->transform_4x4_dst_add_8;
+  case Kernel_TransformSkipRDPCM_V: return (const void*)a->transform_skip_rdpcm_v_8;
+  case Kernel_TransformSkipRDPCM_H: return (const void*)a->transform_skip_rdpcm_h_8;
+  case Kernel_AddResidual:  return hbd ? (const void*)a->add_residual_16 : (const void*)a->add_residual_8;
+
+  case Kernel_IDCT:
+    switch (log2Size) {
+    case 2:  return (const void*)a->transform_idct_4x4;
+    case 3:  return (const void*)a->transform_idct_8x8;
+    case 4:  return (const void*)a->transform_idct_16x16;
+    default: return (const void*)a->transform_idct_32x32;
+    }
+  case Kernel_IDCTPartial:            return (const void*)a->transform_idct_partial[log2Size-2];
+  case Kernel_IDST:                   return (const void*)a->transform_idst_4x4;
+  case Kernel_TransformBypass:        return (const void*)a->transform_bypass;
+  case Kernel_TransformBypassRDPCM_V: return (const void*)a->transform_bypass_rdpcm_v;
+  case Kernel_TransformBypassRDPCM_H: return (const void*)a->transform_bypass_rdpcm_h;
+  case Kernel_RDPCM_V:                return (const void*)a->rdpcm_v;
+  case Kernel_RDPCM_H:                return (const void*)a->rdpcm_h;
+  case Kernel_TransformSkipResidual:  return (const void*)a->transform_skip_residual;
+  case Kernel_RotateCoefficients:     return (const void*)a->rotate_coefficients;
+
+  case Kernel_Dequant:
+  case Kernel_DequantScalingList: return (const void*)a->dequant_coefficients;
+  case Kernel_DequantBlock:       return (const void*)a->dequant_block;
+
+  case Kernel_FDCT:     return (const void*)a->fwd_transform_8[log2Size-2];
+  case Kernel_FDST:     return (const void*)a->fwd_transform_4x4_dst_8;
+  case Kernel_Hadamard: return (const void*)a->hadamard_transform_8[log2Size-2];
+
+  case Kernel_SAD:  return hbd ? (const void*)a->sad_16 : (const void*)a->sad_8;
+  case Kernel_SSD:  return hbd ? (const void*)a->ssd_16 : (const void*)a->ssd_8;
+  case Kernel_SATD: return hbd ? (const void*)a->satd_16[log2Size-2] : (const void*)a->satd_8[log2Size-2];
+
+  case Kernel_DeblockBoundaryStrength: return (const void*)a->deblock_boundary_strength;
+  }
+
+  return NULL;
+}
+
+
+std::string accel_kernel::name(const char* implName) const
+{
+  static const char* names[] = {
+    "QPEL", "EPEL-Copy", "EPEL-H", "EPEL-V", "EPEL-HV", "QPEL-Bi", "EPEL-Bi",
+    "Pred-Unweighted", "Pred-Weighted", "Pred-Avg", "Pred-WeightedBi",
+    "TransformAdd", "TransformAddPartial", "TransformDCAdd", "DSTAdd",
+    "TransformSkipRDPCM-V", "TransformSkipRDPCM-H", "AddResidual",
+    "IDCT", "IDCTPartial", "IDST", "TransformBypass", "TransformBypassRDPCM-V", "TransformBypassRDPCM-H",
+    "RDPCM-V", "RDPCM-H", "TransformSkipResidual", "RotateCoefficients",
+    "Dequant", "DequantScalingList", "DequantBlock",
+    "FDCT", "FDST", "Hadamard",
+    "SAD", "SSD", "SATD",
+    "DeblockBS"
+  };
+
+  char buf[100];
+  if (type==Kernel_QPEL) {
+    sprintf(buf,"QPEL-H%dV%d-%s-%dbit-%dx%d", dx,dy, implName, bitDepth, width,height);
+  }
+  else {
+    sprintf(buf,"%s-%s-%dbit-%dx%d", names[type], implName, bitDepth, width,height);
+  }
+
+  return buf;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+class DSPFunc_Accel : public DSPFunc
+{
+public:
+  DSPFunc_Accel(const acceleration_functions* accel, const char* implName,
+                const accel_kernel& kernel, DSPFunc_Accel* reference)
+    : mAccel(accel), mKernel(kernel), mReference(reference), mValue(0)
+  {
+    mName = kernel.name(implName);
+    mRole = (reference ? 0 : 1);
+  }
+
+  virtual const char* name() const { return mName.c_str(); }
+
+  virtual int getBlkWidth()  const { return mKernel.width; }
+  virtual int getBlkHeight() const { return mKernel.height; }
+
+  virtual void runOnBlock(int x,int y);
+  virtual DSPFunc* referenceImplementation() const { return mReference; }
+
+  virtual bool prepareNextImage(std::shared_ptr<const de265_image> img);
+  virtual bool compareToReferenceImplementation();
+
+private:
+  const acceleration_functions* mAccel;
+  accel_kernel   mKernel;
+  DSPFunc_Accel* mReference;
+  std::string    mName;
+
+  int mRole;  // index of the output buffers in 'testdata'
+
+  int mLastX, mLastY; // last processed block
+  uint64_t mValue;    // distortion result
+};
+
+
+bool DSPFunc_Accel::prepareNextImage(std::shared_ptr<const de265_image> img)
+{
+  testdata.set_image(img);
+
+  // some functions add to the prediction in the output buffer
+
+  if (mKernel.output_type() == Output_Pixels) {
+    testdata.reset_pixel_output(mRole);
+  }
+
+  return true;
+}
+
+
+void DSPFunc_Accel::runOnBlock(int x,int y)
+{
+  accel_test_data& d = testdata;
+
+  const int w = mKernel.width;
+  const int h = mKernel.height;
+  const int bitDepth = mKernel.bitDepth;
+  const bool hbd = (bitDepth>8);
+  const int log2Size = Log2(w);
+
+  mLastX = x;
+  mLastY = y;
+
+  // varying parameters for the different blocks
+  const int blkIdx = d.block_offset(x,y,w,h) / (w*h);
+
+  const void* src  = hbd ? (const void*)d.pixels10[0].at(x,y) : (const void*)d.pixels8[0].at(x,y);
+  const void* ref  = hbd ? (const void*)d.pixels10[1].at(x,y) : (const void*)d.pixels8[1].at(x,y);
+  ptrdiff_t srcStride = hbd ? d.pixels10[0].stride : d.pixels8[0].stride;
+
+  void* dst = hbd ? (void*)d.out10[mRole].at(x,y) : (void*)d.out8[mRole].at(x,y);
+  ptrdiff_t dstStride = hbd ? d.out10[mRole].stride : d.out8[mRole].stride;
+
+  int16_t* mcOut = d.out16s[mRole].at(d.block_start(x,y,w,h),0);
+  ptrdiff_t mcStride = d.block_stride(w);
+
+  const bool isPred = (mKernel.type >= Kernel_Pred_Unweighted && mKernel.type <= Kernel_Pred_WeightedBi);
+  const int16_t* pred0 = (isPred ? d.pred(bitDepth,0, x,y,w,h) : NULL);
+  const int16_t* pred1 = (isPred ? d.pred(bitDepth,1, x,y,w,h) : NULL);
+  ptrdiff_t predStride = d.block_stride(w);
+
+  const int blkOffset = d.block_offset(x,y,w,h);
+  const int16_t* coeffs   = (w>=4 && w<=32 ? d.coeffs[log2Size-2].at(blkOffset,0) : NULL);
+  const int16_t* sparseCoeffs = (w>=4 && w<=32 ? d.sparseCoeffs[log2Size-2].at(blkOffset,0) : NULL);
+  const int nz = d.sparse_size(w);
+  const int32_t* residual = (w>=4 && w<=32 ? d.residuals32[hbd][log2Size-2].at(blkOffset,0) : NULL);
+  int16_t* coeffsOut   = d.out16s[mRole].at(blkOffset,0);
+  int32_t* residualOut = d.out32[mRole].at(blkOffset,0);
+
+  // weighted prediction parameters (see motion.cc)
+  const int log2WD = (blkIdx%8) + 14-bitDepth;
+  const int w0 = (1<<(blkIdx%8)) + (blkIdx%33)-16;
+  const int w1 = (1<<(blkIdx%8)) - (blkIdx%17)+8;
+  const int o0 = ((blkIdx*5)%41 - 20) * (1<<(bitDepth-8));
+  const int o1 = ((blkIdx*3)%31 - 15) * (1<<(bitDepth-8));
+
+  // EPEL fractional positions
+  const int mx = 1 + blkIdx%7;
+  const int my = 1 + (blkIdx/7)%7;
+
+  // fractional positions of both lists for bi-prediction, including full-sample positions
+  const int qpel0 = blkIdx%16,  qpel1 = (blkIdx*7+3)%16;
+  const int epel0 = blkIdx%64,  epel1 = (blkIdx*11+5)%64;
+
+  const int bdShift = 20 - bitDepth;
+  const int tsShift = 5 + log2Size;
+
+  // inverse quantization, all QPs 0 to 51+QpBdOffset
+  const int levelScale[] = { 40,45,51,57,64,72 };
+  const int qP = blkIdx % (52 + 6*(bitDepth-8));
+  const int16_t* levels = (w>=4 && w<=32 ? d.levels[log2Size-2].at(blkOffset,0) : NULL);
+  const int dequantShift = bitDepth + log2Size - 5;
+
+  switch (mKernel.type) {
+  case Kernel_QPEL:
+    mAccel->put_hevc_qpel(mcOut,mcStride, src,srcStride, w,h, d.mcbuffer.at(0,0),
+                          mKernel.dx,mKernel.dy, bitDepth);
+    break;
+  case Kernel_EPEL_Copy:
+    mAccel->put_hevc_epel(mcOut,mcStride, src,srcStride, w,h, 0,0, d.mcbuffer.at(0,0), bitDepth);
+    break;
+  case Kernel_EPEL_H:
+    mAccel->put_hevc_epel_h(mcOut,mcStride, src,srcStride, w,h, mx,0, d.mcbuffer.at(0,0), bitDepth);
+    break;
+  case Kernel_EPEL_V:
+    mAccel->put_hevc_epel_v(mcOut,mcStride, src,srcStride, w,h, 0,my, d.mcbuffer.at(0,0), bitDepth);
+    break;
+  case Kernel_EPEL_HV:
+    mAccel->put_hevc_epel_hv(mcOut,mcStride, src,srcStride, w,h, mx,my, d.mcbuffer.at(0,0), bitDepth);
+    break;
+  case Kernel_QPEL_Bi:
+    mAccel->put_hevc_qpel_bi(dst,dstStride, src,srcStride, qpel0%4,qpel0/4,
+                             ref,srcStride, qpel1%4,qpel1/4, w,h, bitDepth);
+    break;
+  case Kernel_EPEL_Bi:
+    mAccel->put_hevc_epel_bi(dst,dstStride, src,srcStride, epel0%8,epel0/8,
+                             ref,srcStride, epel1%8,epel1/8, w,h, bitDepth);
+    break;
+
+  case Kernel_Pred_Unweighted:
+    mAccel->put_unweighted_pred(dst,dstStride, pred0,predStride, w,h, bitDepth);
+    break;
+  case Kernel_Pred_Weighted:
+    mAccel->put_weighted_pred(dst,dstStride, pred0,predStride, w,h, w0,o0,log2WD, bitDepth);
+    break;
+  case Kernel_Pred_Avg:
+    mAccel->put_weighted_pred_avg(dst,dstStride, pred0,pred1,predStride, w,h, bitDepth);
+    break;
+  case Kernel_Pred_WeightedBi:
+    mAccel->put_weighted_bipred(dst,dstStride, pred0,pred1,predStride, w,h,
+                                w0,o0, w1,o1, log2WD, bitDepth);
+    break;
+
+  case Kernel_TransformAdd:
+    if (hbd) mAccel->transform_add_16[log2Size-2]((uint16_t*)dst, coeffs, dstStride, bitDepth);
+    else     mAccel->transform_add_8 [log2Size-2]((uint8_t*) dst, coeffs, dstStride);
+    break;
+  case Kernel_TransformAddPartial:
+    if (hbd) mAccel->transform_add_partial_16[log2Size-2]((uint16_t*)dst, sparseCoeffs, dstStride, bitDepth, nz,nz);
+    else     mAccel->transform_add_partial_8 [log2Size-2]((uint8_t*) dst, sparseCoeffs, dstStride, nz,nz);
+    break;
+  case Kernel_TransformDCAdd:
+    if (hbd) mAccel->transform_dc_add_16((uint16_t*)dst, coeffs, w, dstStride, bitDepth);
+    else     mAccel->transform_dc_add_8 ((uint8_t*) dst, coeffs, w, dstStride);
+    break;
+  case Kernel_DSTAdd:
+    if (hbd) mAccel->transform_4x4_dst_add_16((uint16_t*)dst, coeffs, dstStride, bitDepth);
+    else     mAccel->transform_4x4_dst_add_8 ((uint8_t*) dst, coeffs, dstStride);
+    break;
+  case Kernel_TransformSkipRDPCM_V:
+    mAccel->transform_skip_rdpcm_v_8((uint8_t*)dst, coeffs, log2Size, dstStride);
+    break;
+  case Kernel_TransformSkipRDPCM_H:
+    mAccel->transform_skip_rdpcm_h_8((uint8_t*)dst, coeffs, log2Size, dstStride);
+    break;
+  case Kernel_AddResidual:
+    if (hbd) mAccel->add_residual_16((uint16_t*)dst, dstStride, residual, w, bitDepth);
+    else     mAccel->add_residual_8 ((uint8_t*) dst, dstStride, residual, w, bitDepth);
+    break;
+
+  case Kernel_IDCT:
+    switch (log2Size) {
+    case 2: mAccel->transform_idct_4x4  (residualOut, coeffs, bdShift, 15); break;
+    case 3: mAccel->transform_idct_8x8  (residualOut, coeffs, bdShift, 15); break;
+    case 4: mAccel->transform_idct_16x16(residualOut, coeffs, bdShift, 15); break;
+    case 5: mAccel->transform_idct_32x32(residualOut, coeffs, bdShift, 15); break;
+    }
+    break;
+  case Kernel_IDCTPartial:
+    mAccel->transform_idct_partial[log2Size-2](residualOut, sparseCoeffs, bdShift, 15, nz,nz);
+    break;
+  case Kernel_IDST:
+    mAccel->transform_idst_4x4(residualOut, coeffs, bdShift, 15);
+    break;
+  case Kernel_TransformBypass:
+    mAccel->transform_bypass(residualOut, coeffs, w);
+    break;
+  case Kernel_TransformBypassRDPCM_V:
+    mAccel->transform_bypass_rdpcm_v(residualOut, coeffs, w);
+    break;
+  case Kernel_TransformBypassRDPCM_H:
+    mAccel->transform_bypass_rdpcm_h(residualOut, coeffs, w);
+    break;
+  case Kernel_RDPCM_V:
+    mAccel->rdpcm_v(residualOut, coeffs, w, tsShift, bdShift);
+    break;
+  case Kernel_RDPCM_H:
+    mAccel->rdpcm_h(residualOut, coeffs, w, tsShift, bdShift);
+    break;
+  case Kernel_TransformSkipResidual:
+    mAccel->transform_skip_residual(residualOut, coeffs, w, tsShift, bdShift);
+    break;
+  case Kernel_RotateCoefficients:
+    // works in place, the copy is included in the time measurement
+    memcpy(coeffsOut, coeffs, w*h*sizeof(int16_t));
+    mAccel->rotate_coefficients(coeffsOut, w);
+    break;
+
+  case Kernel_Dequant:
+  case Kernel_DequantScalingList:
+    // the coefficient buffer has to be cleared, this is included in the time measurement
+    memset(coeffsOut, 0, w*h*sizeof(int16_t));
+    mAccel->dequant_coefficients(coeffsOut, levels, d.dequantPos[log2Size-2], w*h,
+                                 mKernel.type==Kernel_DequantScalingList ? d.scalingFactors : NULL,
+                                 levelScale[qP%6], qP/6, dequantShift);
+    break;
+  case Kernel_DequantBlock:
+    memcpy(coeffsOut, levels, w*h*sizeof(int16_t));
+    mAccel->dequant_block(coeffsOut, w*h, d.scalingFactors, levelScale[qP%6], qP/6, dequantShift);
+    break;
+
+  case Kernel_FDCT:
+    mAccel->fwd_transform_8[log2Size-2](coeffsOut, d.residuals16.at(x,y), d.residuals16.stride);
+    break;
+  case Kernel_FDST:
+    mAccel->fwd_transform_4x4_dst_8(coeffsOut, d.residuals16.at(x,y), d.residuals16.stride);
+    break;
+  case Kernel_Hadamard:
+    mAccel->hadamard_transform_8[log2Size-2](coeffsOut, d.residuals16.at(x,y), d.residuals16.stride);
+    break;
+
+  case Kernel_SAD:
+    mValue = mAccel->sad(src,srcStride, ref,srcStride, w,h, bitDepth);
+    break;
+  case Kernel_SSD:
+    mValue = mAccel->ssd(src,srcStride, ref,srcStride, w,h, bitDepth);
+    break;
+  case Kernel_SATD:
+    mValue = mAccel->satd(log2Size, src,srcStride, ref,srcStride, bitDepth);
+    break;
+
+  case Kernel_DeblockBoundaryStrength:
+    {
+      // works in place, the copy is included in the time measurement
+      uint8_t* q = d.out8[mRole].at(x,y);
+      memcpy(q, d.deblkFlags[0].at(x,y), w);
+
+      const bool vertical = (blkIdx & 1);
+      const uint8_t edgeMask = vertical ?
+        (DEBLOCK_FLAG_VERTI | DEBLOCK_PB_EDGE_VERTI) :
+        (DEBLOCK_FLAG_HORIZ | DEBLOCK_PB_EDGE_HORIZ);
+      const uint8_t transformEdgeMask = vertical ? DEBLOCK_FLAG_VERTI : DEBLOCK_FLAG_HORIZ;
+
+      // all positions, the 8x8 grid (as for vertical edges), or scattered positions
+      // (with bits above n set, which have to be ignored)
+      uint32_t posMask;
+      switch (blkIdx%4) {
+      case 0:  posMask = 0xFFFF; break;
+      case 1:  posMask = (blkIdx & 2) ? 0xAAAA : 0x5555; break;
+      default: posMask = (blkIdx * 2654435761u) >> 12; break;
+      }
+
+      mValue = mAccel->deblock_boundary_strength(q, d.deblkFlags[1].at(x,y), w, posMask,
+                                                 edgeMask, transformEdgeMask);
+    }
+    break;
+  }
+}
+
+
+template <class T> static bool equal_blocks(aligned_plane<T>& a, aligned_plane<T>& b,
+                                            int x,int y,int w,int h)
+{
+  for (int yy=0;yy<h;yy++) {
+    if (memcmp(a.at(x,y+yy), b.at(x,y+yy), w*sizeof(T)) != 0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+bool DSPFunc_Accel::compareToReferenceImplementation()
+{
+  accel_test_data& d = testdata;
+
+  const int x = mLastX;
+  const int y = mLastY;
+  const int w = mKernel.width;
+  const int h = mKernel.height;
+  const int blkOffset = d.block_offset(x,y,w,h);
+
+  switch (mKernel.output_type()) {
+  case Output_Pixels:
+    if (mKernel.bitDepth>8) return equal_blocks(d.out10[0], d.out10[1], x,y,w,h);
+    else                    return equal_blocks(d.out8[0],  d.out8[1],  x,y,w,h);
+
+  case Output_Int16:
+    {
+      const int16_t* a = d.out16s[0].at(d.block_start(x,y,w,h),0);
+      const int16_t* b = d.out16s[1].at(d.block_start(x,y,w,h),0);
+      const int stride = d.block_stride(w);
+
+      for (int yy=0;yy<h;yy++) {
+        if (memcmp(a+yy*stride, b+yy*stride, w*sizeof(int16_t)) != 0) {
+          return false;
+        }
+      }
+    }
+    return true;
+
+  case Output_Coeffs:
+    return memcmp(d.out16s[0].at(blkOffset,0), d.out16s[1].at(blkOffset,0), w*h*sizeof(int16_t))==0;
+
+  case Output_Residual:
+    return memcmp(d.out32[0].at(blkOffset,0), d.out32[1].at(blkOffset,0), w*h*sizeof(int32_t))==0;
+
+  case Output_Value:
+    return mValue == mReference->mValue;
+
+  case Output_Flags:
+    return (mValue == mReference->mValue &&
+            memcmp(d.out8[0].at(x,y), d.out8[1].at(x,y), w) == 0);
+  }
+
+  return false;
+}
+
+
+// ---------------------------------------------------------------------------
+
+
+struct accel_level
+{
+  enum de265_acceleration level;
+  const char* name;
+  acceleration_functions functions;
+};
+
+static acceleration_functions accel_scalar;
+static std::vector<accel_level*> accel_levels;
+
+
+/* Register the fallback function and all optimized variants that differ from it.
+   A variant is only registered for the acceleration level that introduces it. */
+static void register_kernel(const accel_kernel& kernel)
+{
+  DSPFunc_Accel* reference = new DSPFunc_Accel(&accel_scalar, "Scalar", kernel, NULL);
+
+  const void* prevFunction = kernel.function_address(&accel_scalar);
+
+  for (size_t i=0;i<accel_levels.size();i++) {
+    const void* function = kernel.function_address(&accel_levels[i]->functions);
+    if (function != prevFunction) {
+      new DSPFunc_Accel(&accel_levels[i]->functions, accel_levels[i]->name, kernel, reference);
+    }
+
+    prevFunction = function;
+  }
+}
+
+
+static void register_kernel(accel_kernel_type type, int w,int h, int bitDepth, int dx=0,int dy=0)
+{
+  accel_kernel kernel;
+  kernel.type = type;
+  kernel.width = w;
+  kernel.height = h;
+  kernel.bitDepth = bitDepth;
+  kernel.dx = dx;
+  kernel.dy = dy;
+
+  register_kernel(kernel);
+}
+
+
+static void add_acceleration_level(enum de265_acceleration level, const char* name)
+{
+  accel_level* l = new accel_level;
+  l->level = level;
+  l->name  = name;
+  init_acceleration_functions(&l->functions, level);
+
+  accel_levels.push_back(l);
+}
+
+
+void register_acceleration_functions()
+{
+  init_acceleration_functions(&accel_scalar, de265_acceleration_SCALAR);
+
+#ifdef HAVE_SSE4_1
+  add_acceleration_level(de265_acceleration_SSE4, "SSE");
+#endif
+#ifdef HAVE_AVX2
+  add_acceleration_level(de265_acceleration_AVX2, "AVX2");
+#endif
+#ifdef HAVE_ARM
+  add_acceleration_level(de265_acceleration_ARM,  "ARM");
+#endif
+
+
+  // prediction block sizes (luma and chroma)
+
+  static const int lumaPB[][2]   = { {4,8}, {8,8}, {12,16}, {16,16}, {24,32}, {32,32}, {48,64}, {64,64} };
+  static const int chromaPB[][2] = { {2,4}, {4,4}, {6,8},   {8,8},   {12,16}, {16,16}, {24,32}, {32,32} };
+  static const int predPB[][2]   = { {2,4}, {4,8}, {6,8}, {8,8}, {12,16}, {16,16},
+                                     {24,32}, {32,32}, {48,64}, {64,64} };
+
+  for (int bitDepth=8; bitDepth<=10; bitDepth+=2) {
+    for (int dx=0;dx<4;dx++)
+      for (int dy=0;dy<4;dy++)
+        for (int s=0;s<8;s++) {
+          register_kernel(Kernel_QPEL, lumaPB[s][0],lumaPB[s][1], bitDepth, dx,dy);
+        }
+
+    for (int type=Kernel_EPEL_Copy; type<=Kernel_EPEL_HV; type++)
+      for (int s=0;s<8;s++) {
+        register_kernel((accel_kernel_type)type, chromaPB[s][0],chromaPB[s][1], bitDepth);
+      }
+
+    for (int s=0;s<8;s++) {
+      register_kernel(Kernel_QPEL_Bi, lumaPB[s][0],lumaPB[s][1], bitDepth);
+      register_kernel(Kernel_EPEL_Bi, chromaPB[s][0],chromaPB[s][1], bitDepth);
+    }
+
+    for (int type=Kernel_Pred_Unweighted; type<=Kernel_Pred_WeightedBi; type++)
+      for (int s=0;s<10;s++) {
+        register_kernel((accel_kernel_type)type, predPB[s][0],predPB[s][1], bitDepth);
+      }
+  }
+
+
+  // transforms
+
+  for (int nT=4;nT<=32;nT*=2) {
+    register_kernel(Kernel_TransformAdd, nT,nT, 8);
+    register_kernel(Kernel_TransformAdd, nT,nT, 10);
+    register_kernel(Kernel_TransformAddPartial, nT,nT, 8);
+    register_kernel(Kernel_TransformAddPartial, nT,nT, 10);
+    register_kernel(Kernel_TransformDCAdd, nT,nT, 8);
+    register_kernel(Kernel_TransformDCAdd, nT,nT, 10);
+    register_kernel(Kernel_TransformSkipRDPCM_V, nT,nT, 8);
+    register_kernel(Kernel_TransformSkipRDPCM_H, nT,nT, 8);
+    register_kernel(Kernel_AddResidual, nT,nT, 8);
+    register_kernel(Kernel_AddResidual, nT,nT, 10);
+
+    register_kernel(Kernel_IDCT, nT,nT, 8);
+    register_kernel(Kernel_IDCTPartial, nT,nT, 8);
+    register_kernel(Kernel_TransformBypass, nT,nT, 8);
+    register_kernel(Kernel_TransformBypassRDPCM_V, nT,nT, 8);
+    register_kernel(Kernel_TransformBypassRDPCM_H, nT,nT, 8);
+    register_kernel(Kernel_RDPCM_V, nT,nT, 8);
+    register_kernel(Kernel_RDPCM_H, nT,nT, 8);
+    register_kernel(Kernel_TransformSkipResidual, nT,nT, 8);
+    register_kernel(Kernel_RotateCoefficients, nT,nT, 8);
+    for (int bitDepth=8; bitDepth<=10; bitDepth+=2) {
+      register_kernel(Kernel_Dequant, nT,nT, bitDepth);
+      register_kernel(Kernel_DequantScalingList, nT,nT, bitDepth);
+      register_kernel(Kernel_DequantBlock, nT,nT, bitDepth);
+    }
+
+    register_kernel(Kernel_FDCT, nT,nT, 8);
+    register_kernel(Kernel_Hadamard, nT,nT, 8);
+  }
+
+  register_kernel(Kernel_DSTAdd, 4,4, 8);
+  register_kernel(Kernel_DSTAdd, 4,4, 10);
+  register_kernel(Kernel_IDST, 4,4, 8);
+  register_kernel(Kernel_FDST, 4,4, 8);
+
+  // transform_skip_8/16 are not registered, they are deprecated (fixed to 4x4)
+
+
+  // distortion measures
+
+  for (int size=4;size<=64;size*=2)
+    for (int bitDepth=8; bitDepth<=10; bitDepth+=2) {
+      register_kernel(Kernel_SAD,  size,size, bitDepth);
+      register_kernel(Kernel_SSD,  size,size, bitDepth);
+      register_kernel(Kernel_SATD, size,size, bitDepth);
+    }
+
+
+  // deblocking, runs of 4x4 units (a full CTB row has 4, 8 or 16 units)
+
+  static const int deblockRuns[] = { 1,3,4,5,8,11,16 };
+  for (int i=0;i<7;i++) {
+    register_kernel(Kernel_DeblockBoundaryStrength, deblockRuns[i],1, 8);
+  }
+}
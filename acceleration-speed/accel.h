@@ -0,0 +1,37 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2015 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ACCELERATION_SPEED_ACCEL_H
+#define ACCELERATION_SPEED_ACCEL_H
+
+#include "acceleration-speed.h"
+
+
+/* DSPFuncs for the members of acceleration_functions.
+
+   All fallback functions are registered with the implementation name "Scalar".
+   For each optimized acceleration level (SSE, AVX2, ARM), the functions that
+   this level replaces are registered with the fallback function as reference
+   implementation. Motion compensation and weighted prediction are registered
+   for all prediction block sizes, at 8 and 10 bit.
+ */
+void register_acceleration_functions();
+
+#endif
@@ -36,6 +36,17 @@
 #include "libde265/image-io.h"
 
 #include "acceleration-speed.h"
+#include "accel.h"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#define HAVE_RDTSC 1
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define HAVE_RDTSC 1
+#else
+#include <chrono>
+#endif
 
 
 /* TODO: for more realistic input to IDCTs, we could save the real coefficients in
@@ -47,9 +58,11 @@ bool show_help=false;
 bool do_check=false;
 bool do_time=false;
 bool do_eval=false;
+bool do_all=false;
+bool json_output=false;
 int  img_width=352;
 int  img_height=288;
-int  nframes=1000;
+int  nframes=-1;  // default: 1000 frames from an input file, 2 generated frames
 int  repeat=10;
 std::string function;
 std::string input_file;
@@ -65,6 +78,8 @@ static struct option long_options[] = {
   {"time",    no_argument,       0, 't' },
   {"eval",    no_argument,       0, 'e' },
   {"repeat",  required_argument, 0, 'r' },
+  {"all",     no_argument,       0, 'a' },
+  {"json",    no_argument,       0, 'j' },
   {0,            0,              0,  0  }
 };
 
@@ -98,12 +113,164 @@ bool DSPFunc::runOnImage(std::shared_ptr<const de265_image> img, bool compareToR
 
 
 
+// CPU cycles on x86, nanoseconds on other platforms
+static uint64_t time_counter()
+{
+#if HAVE_RDTSC
+  return __rdtsc();
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+#if HAVE_RDTSC
+static const char* time_unit = "cycles";
+#else
+static const char* time_unit = "ns";
+#endif
+
+
+/* Test image when no input file is given: smooth gradients with some texture,
+   moving by a few pixels from frame to frame. */
+static std::shared_ptr<de265_image> generate_image(int frame)
+{
+  std::shared_ptr<de265_image> img = std::make_shared<de265_image>();
+  img->alloc_image(img_width,img_height,de265_chroma_420, NULL, false,
+                   NULL, 0, NULL, false);
+
+  uint32_t random = 12345;
+
+  for (int c=0;c<3;c++) {
+    uint8_t* p = img->get_image_plane(c);
+    int stride = img->get_image_stride(c);
+
+    for (int y=0;y<img->get_height(c);y++)
+      for (int x=0;x<img->get_width(c);x++) {
+        random = random*1103515245 + 12345;
+
+        int xm = x + 3*frame;
+        int ym = y + frame;
+        int v = 128 + (xm*ym/16)%64 - 32 + ((xm/8+ym/8)%2 ? 20 : -20) + (int)((random>>16)%16) - 8;
+
+        p[x+y*stride] = Clip3(0,255, v);
+      }
+  }
+
+  return img;
+}
+
+
+struct function_result
+{
+  bool checked;
+  bool match;
+  uint64_t time;
+  uint64_t pixels;
+};
+
+
+static function_result run_function(DSPFunc* algo)
+{
+  function_result result;
+  result.checked = false;
+  result.match = true;
+  result.time = 0;
+  result.pixels = 0;
+
+  ImageSource_YUV image_source;
+  if (!input_file.empty()) {
+    image_source.set_input_file(input_file.c_str(), img_width, img_height);
+  }
+
+  int img_counter=0;
+
+  for (int f=0; f<nframes ; f++)
+    {
+      std::shared_ptr<de265_image> image;
+      if (input_file.empty()) { image = generate_image(f); }
+      else                    { image.reset(image_source.get_image()); }
+
+      if (!image) {
+        break;
+      }
+
+      img_counter++;
+
+      if (algo->referenceImplementation()) {
+        algo->referenceImplementation()->prepareNextImage(image);
+      }
+
+      if (algo->prepareNextImage(image)) {
+        if (!do_all && !json_output) {
+          printf("run %d times on image %d\n",repeat,img_counter);
+        }
+
+        if (do_check) {
+          result.checked = true;
+          result.match &= algo->runOnImage(image, true);
+        }
+
+        if (!do_check || do_time) {
+          int blkWidth  = algo->getBlkWidth();
+          int blkHeight = algo->getBlkHeight();
+          int nBlocks   = (image->get_width(0)/blkWidth) * (image->get_height(0)/blkHeight);
+
+          for (int r=0;r<repeat;r++) {
+            uint64_t start = time_counter();
+            algo->runOnImage(image, false);
+            result.time += time_counter() - start;
+            result.pixels += nBlocks*blkWidth*blkHeight;
+          }
+        }
+      }
+    }
+
+  return result;
+}
+
+
+static void print_result(DSPFunc* algo, const function_result& result, bool first)
+{
+  double timePerPixel = (result.pixels ? result.time / (double)result.pixels : 0.0);
+
+  const char* check = "none";
+  if (result.checked) { check = (result.match ? "ok" : "mismatch"); }
+
+  if (json_output) {
+    printf("%s    {\"name\":\"%s\", \"reference\":\"%s\", \"width\":%d, \"height\":%d,"
+           " \"check\":\"%s\"",
+           first ? "" : ",\n",
+           algo->name(),
+           algo->referenceImplementation() ? algo->referenceImplementation()->name() : "",
+           algo->getBlkWidth(), algo->getBlkHeight(),
+           check);
+
+    if (do_time) {
+      printf(", \"%s_per_pixel\":%.4f", time_unit, timePerPixel);
+    }
+
+    printf("}");
+  }
+  else {
+    printf("%-40s  check: %-8s", algo->name(), check);
+    if (do_time) {
+      printf("  %8.3f %s/pixel", timePerPixel, time_unit);
+    }
+    printf("\n");
+  }
+}
+
+
+
 int main(int argc, char** argv)
 {
+  register_acceleration_functions();
+
   while (1) {
     int option_index = 0;
 
-    int c = getopt_long(argc, argv, "Hci:w:h:n:f:ter:", long_options, &option_index);
+    int c = getopt_long(argc, argv, "Hci:w:h:n:f:ter:aj", long_options, &option_index);
     if (c == -1)
       break;
 
@@ -118,6 +285,8 @@ int main(int argc, char** argv)
     case 't': do_time=true; break;
     case 'e': do_eval=true; break;
     case 'r': repeat=atoi(optarg); break;
+    case 'a': do_all=true; break;
+    case 'j': json_output=true; break;
     }
   }
 
@@ -127,16 +296,19 @@ int main(int argc, char** argv)
             "acceleration-speed  SIMD DSP function testing tool\n"
             "--------------------------------------------------\n"
             "      --help           show help\n"
-            "  -i, --input NAME     input YUV file\n"
+            "  -i, --input NAME     input YUV file (default: generated test images)\n"
             "  -w, --width #        input width (default: 352)\n"
             "  -h, --height #       input height (default: 288)\n"
-            "  -n, --nframes #      number of frames to process (default: 1000)\n"
+            "  -n, --nframes #      number of frames to process (default: 1000, 2 generated images)\n"
             "  -f, --function NAME  which function to test (see below)\n"
+            "  -a, --all            test all functions\n"
             "  -r, --repeat #       number of repetitions for each image (default: 10)\n"
             "  -c, --check          compare function result against its reference code\n"
+            "  -t, --time           measure the time per pixel (%s)\n"
+            "  -j, --json           machine-readable output\n"
             "\n"
-            "these functions are known:\n"
-            );
+            "these functions are known:\n",
+            time_unit);
 
     std::stack<const char*> funcnames;
 
@@ -156,6 +328,46 @@ int main(int argc, char** argv)
   }
 
 
+  if (nframes<0) {
+    nframes = (input_file.empty() ? 2 : 1000);
+  }
+
+
+  // --- run all functions ---
+
+  if (do_all) {
+    // in registration order
+
+    std::vector<DSPFunc*> funcs;
+    for (DSPFunc* f = DSPFunc::first; f ; f=f->next) {
+      funcs.push_back(f);
+    }
+
+    if (json_output) {
+      printf("{\n  \"time_unit\":\"%s\",\n  \"functions\":[\n", time_unit);
+    }
+
+    bool success = true;
+
+    for (int i=funcs.size()-1; i>=0; i--) {
+      bool check = do_check;
+      if (!funcs[i]->referenceImplementation()) { do_check=false; }
+
+      function_result result = run_function(funcs[i]);
+      print_result(funcs[i], result, i==(int)funcs.size()-1);
+      success &= result.match;
+
+      do_check = check;
+    }
+
+    if (json_output) {
+      printf("\n  ]\n}\n");
+    }
+
+    return success ? 0 : 10;
+  }
+
+
   // --- find DSP function with the given name ---
 
   if (function.empty()) {
@@ -182,38 +394,24 @@ int main(int argc, char** argv)
   }
 
 
-  ImageSource_YUV image_source;
-  image_source.set_input_file(input_file.c_str(), img_width, img_height);
-
-  int img_counter=0;
+  function_result result = run_function(algo);
 
-  bool eof = false;
-  for (int f=0; f<nframes ; f++)
-    {
-      std::shared_ptr<de265_image> image(image_source.get_image());
-      if (!image) {
-        eof=true;
-        break;
-      }
-
-      img_counter++;
+  if (!result.match) {
+    fprintf(stderr, "computation mismatch to reference implementation...\n");
+    exit(10);
+  }
 
-      if (algo->referenceImplementation()) {
-        algo->referenceImplementation()->prepareNextImage(image);
-      }
+  if (do_time || json_output) {
+    if (json_output) {
+      printf("{\n  \"time_unit\":\"%s\",\n  \"functions\":[\n", time_unit);
+    }
 
-      if (algo->prepareNextImage(image)) {
-        printf("run %d times on image %d\n",repeat,img_counter);
+    print_result(algo, result, true);
 
-        for (int r=0;r<repeat;r++) {
-          bool success = algo->runOnImage(image, do_check);
-          if (!success) {
-            fprintf(stderr, "computation mismatch to reference implementation...\n");
-            exit(10);
-          }
-        }
-      }
+    if (json_output) {
+      printf("\n  ]\n}\n");
     }
+  }
 
   return 0;
 }
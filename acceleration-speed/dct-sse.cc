@@ -88,90 +88,3 @@ DSPFunc_IDCT_SSE_4x4   idct_sse_4x4;
 DSPFunc_IDCT_SSE_8x8   idct_sse_8x8;
 DSPFunc_IDCT_SSE_16x16 idct_sse_16x16;
 DSPFunc_IDCT_SSE_32x32 idct_sse_32x32;
-
-
-
-
-
-class DSPFunc_FDCT_SSE_4x4 : public DSPFunc_FDCT_Base
-{
-public:
-  DSPFunc_FDCT_SSE_4x4() : DSPFunc_FDCT_Base(4) { }
-
-  virtual const char* name() const { return "FDCT-SSE-4x4-to-be-implemented"; }
-
-  virtual DSPFunc* referenceImplementation() const { return &fdct_scalar_4x4; }
-
-  virtual void runOnBlock(int x,int y) {
-    // <<< function to be implemented >>>
-
-    // fdct_4x4_8_fallback(coeffs, residuals+x+y*stride, stride);
-
-    bool D = false;
-    if (D) { dump(x,y); }
-  }
-};
-
-
-class DSPFunc_FDCT_SSE_8x8 : public DSPFunc_FDCT_Base
-{
-public:
-  DSPFunc_FDCT_SSE_8x8() : DSPFunc_FDCT_Base(8) { }
-
-  virtual const char* name() const { return "FDCT-SSE-8x8-to-be-implemented"; }
-
-  virtual DSPFunc* referenceImplementation() const { return &fdct_scalar_8x8; }
-
-  virtual void runOnBlock(int x,int y) {
-    // <<< function to be implemented >>>
-
-    // fdct_8x8_8_fallback(coeffs, residuals+x+y*stride, stride);
-
-    bool D = false;
-    if (D) { dump(x,y); }
-  }
-};
-
-
-class DSPFunc_FDCT_SSE_16x16 : public DSPFunc_FDCT_Base
-{
-public:
-  DSPFunc_FDCT_SSE_16x16() : DSPFunc_FDCT_Base(16) { }
-
-  virtual const char* name() const { return "FDCT-SSE-16x16-to-be-implemented"; }
-
-  virtual DSPFunc* referenceImplementation() const { return &fdct_scalar_16x16; }
-
-  virtual void runOnBlock(int x,int y) {
-    // <<< function to be implemented >>>
-
-    // fdct_16x16_8_fallback(coeffs, residuals+x+y*stride, stride);
-
-    bool D = false;
-    if (D) { dump(x,y); }
-  }
-};
-
-class DSPFunc_FDCT_SSE_32x32 : public DSPFunc_FDCT_Base
-{
-public:
-  DSPFunc_FDCT_SSE_32x32() : DSPFunc_FDCT_Base(32) { }
-
-  virtual const char* name() const { return "FDCT-SSE-32x32-to-be-implemented"; }
-
-  virtual DSPFunc* referenceImplementation() const { return &fdct_scalar_32x32; }
-
-  virtual void runOnBlock(int x,int y) {
-    // <<< function to be implemented >>>
-
-    // fdct_32x32_8_fallback(coeffs, residuals+x+y*stride, stride);
-
-    bool D = false;
-    if (D) { dump(x,y); }
-  }
-};
-
-DSPFunc_FDCT_SSE_4x4   fdct_sse_4x4;
-DSPFunc_FDCT_SSE_8x8   fdct_sse_8x8;
-DSPFunc_FDCT_SSE_16x16 fdct_sse_16x16;
-DSPFunc_FDCT_SSE_32x32 fdct_sse_32x32;
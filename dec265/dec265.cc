@@ -34,6 +34,9 @@
 #include <stdlib.h>
 #include <limits>
 #include <getopt.h>
+#include <vector>
+#include <string>
+#include <algorithm>
 #ifdef HAVE_MALLOC_H
 #include <malloc.h>
 #endif
@@ -41,6 +44,7 @@
 
 #ifndef _MSC_VER
 #include <sys/time.h>
+#include <sys/resource.h>
 #include <unistd.h>
 #endif
 
@@ -82,6 +86,12 @@ int highestTID = 100;
 int verbosity=0;
 int disable_deblocking=0;
 int disable_sao=0;
+int keyframes_only=0;
+int skip_non_reference=0;
+int show_statistics=0;
+int batch_mc=0;
+int deferred_reconstruction=0;
+const char* trace_filename=NULL;
 
 static struct option long_options[] = {
   {"quiet",      no_argument,       0, 'q' },
@@ -104,11 +114,58 @@ static struct option long_options[] = {
   {"verbose",    no_argument,       0, 'v' },
   {"disable-deblocking", no_argument, &disable_deblocking, 1 },
   {"disable-sao",        no_argument, &disable_sao, 1 },
+  {"keyframes-only",     no_argument, &keyframes_only, 1 },
+  {"skip-non-reference", no_argument, &skip_non_reference, 1 },
+  {"statistics",         no_argument, &show_statistics, 1 },
+  {"batch-mc",           no_argument, &batch_mc, 1 },
+  {"deferred-reconstruction", no_argument, &deferred_reconstruction, 1 },
+  {"trace",              required_argument, 0, 'R' },
+  {"benchmark",          required_argument, 0, 'b' },
+  {"bench-threads",      required_argument, 0, 'P' },
+  {"bench-accel",        required_argument, 0, 'A' },
   {0,         0,                 0,  0 }
 };
 
 
 
+static void print_statistics(de265_decoder_context* ctx)
+{
+  struct de265_statistics stats;
+  if (!de265_get_statistics(ctx, &stats)) {
+    fprintf(stderr,"statistics not available (libde265 compiled without DE265_STATISTICS)\n");
+    return;
+  }
+
+  uint64_t total = (stats.parsing_cycles + stats.inter_prediction_cycles +
+                    stats.residual_cycles + stats.intra_prediction_cycles +
+                    stats.deblocking_cycles + stats.sao_cycles + stats.hash_check_cycles);
+  if (total==0) { total=1; }
+
+  struct { const char* name; uint64_t cycles; } stages[] = {
+    { "parsing",          stats.parsing_cycles },
+    { "inter prediction", stats.inter_prediction_cycles },
+    { "residual",         stats.residual_cycles },
+    { "intra prediction", stats.intra_prediction_cycles },
+    { "deblocking",       stats.deblocking_cycles },
+    { "SAO",              stats.sao_cycles },
+    { "hash check",       stats.hash_check_cycles },
+    { "waiting",          stats.wait_cycles }
+  };
+
+  for (int i=0;i<8;i++) {
+    fprintf(stderr,"%-17s %14llu cycles (%5.1f%%)\n", stages[i].name,
+            (unsigned long long)stages[i].cycles, stages[i].cycles*100.0/total);
+  }
+
+  fprintf(stderr,"pictures: %llu  CTBs: %llu  bins: %llu  tasks: %llu (blocked: %llu)\n",
+          (unsigned long long)stats.pictures,
+          (unsigned long long)stats.ctbs,
+          (unsigned long long)stats.bins,
+          (unsigned long long)stats.tasks_run,
+          (unsigned long long)stats.tasks_blocked);
+}
+
+
 static void write_picture(const de265_image* img)
 {
   static FILE* fh = NULL;
@@ -558,6 +615,339 @@ void (*volatile __malloc_initialize_hook)(void) = init_my_hooks;
 #endif
 
 
+// --- benchmark mode ---
+
+static double get_time_ms()
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec*1000.0 + tv.tv_usec*0.001;
+}
+
+static double get_cpu_time_ms()
+{
+#ifndef _MSC_VER
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec)*1000.0 +
+         (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec)*0.001;
+#else
+  return 0;
+#endif
+}
+
+static long get_peak_rss_kb()
+{
+#ifndef _MSC_VER
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss/1024; // bytes on macOS
+#else
+  return usage.ru_maxrss;
+#endif
+#else
+  return -1;
+#endif
+}
+
+
+struct benchmark_acceleration {
+  const char* name;
+  enum de265_acceleration level;
+};
+
+static const benchmark_acceleration benchmark_accelerations[] = {
+  { "scalar", de265_acceleration_SCALAR },
+  { "sse",    de265_acceleration_SSE4 },
+  { "avx2",   de265_acceleration_AVX2 },
+  { "arm",    de265_acceleration_ARM },
+  { "auto",   de265_acceleration_AUTO },
+  { NULL,     de265_acceleration_AUTO }
+};
+
+int benchmark_runs=0;
+const char* benchmark_threads="";      // comma separated list, default: '-t' value
+const char* benchmark_accel="";        // comma separated list, default: auto (scalar with '-0')
+
+
+static std::vector<std::string> split_list(const char* list)
+{
+  std::vector<std::string> items;
+  std::string item;
+
+  for (const char* p=list; ; p++) {
+    if (*p==',' || *p==0) {
+      if (!item.empty()) { items.push_back(item); }
+      item.clear();
+      if (*p==0) break;
+    }
+    else {
+      item += *p;
+    }
+  }
+
+  return items;
+}
+
+
+/* One decoder run over the in-memory bitstream. The frame latency is the time
+   between two consecutive output pictures (for the first picture: since the
+   start of the run), i.e. it includes the pipeline fill at the start. */
+static bool benchmark_decode(const std::vector<uint8_t>& stream, int threads,
+                             enum de265_acceleration accel,
+                             std::vector<double>& frameTimes, int& nFrames)
+{
+  de265_decoder_context* ctx = de265_new_decoder();
+
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_BOOL_SEI_CHECK_HASH, check_hash);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_SUPPRESS_FAULTY_PICTURES, false);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DISABLE_DEBLOCKING, disable_deblocking);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DISABLE_SAO, disable_sao);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_BATCH_MC, batch_mc);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DEFERRED_RECONSTRUCTION, deferred_reconstruction);
+  de265_set_parameter_int (ctx, DE265_DECODER_PARAM_ACCELERATION_CODE, accel);
+
+  if (threads>0) {
+    de265_start_worker_threads(ctx, threads);
+  }
+
+  de265_set_limit_TID(ctx, highestTID);
+
+  bool ok=true;
+  nFrames=0;
+
+  double lastTime = get_time_ms();
+
+  size_t pos=0;
+  bool stop=false;
+
+  while (!stop) {
+    de265_error err = DE265_OK;
+
+    if (nal_input) {
+      if (pos+4 <= stream.size()) {
+        const uint8_t* len = &stream[pos];
+        size_t length = (len[0]<<24) + (len[1]<<16) + (len[2]<<8) + len[3];
+        pos += 4;
+
+        length = std::min(length, stream.size()-pos);
+        err = de265_push_NAL(ctx, &stream[pos], length, pos, NULL);
+        pos += length;
+      }
+    }
+    else {
+      size_t n = std::min((size_t)BUFFER_SIZE, stream.size()-pos);
+      if (n) {
+        err = de265_push_data(ctx, &stream[pos], n, pos, NULL);
+      }
+
+      pos += n;
+    }
+
+    if (err != DE265_OK) {
+      ok=false;
+      break;
+    }
+
+    if (pos >= stream.size()) {
+      de265_flush_data(ctx);
+      stop = true;
+    }
+
+    int more=1;
+    while (more) {
+      more = 0;
+
+      err = de265_decode(ctx, &more);
+      if (err != DE265_OK) {
+        if (err != DE265_ERROR_WAITING_FOR_INPUT_DATA) {
+          ok=false;
+          stop=true;
+        }
+        break;
+      }
+
+      const de265_image* img = de265_get_next_picture(ctx);
+      if (img) {
+        double now = get_time_ms();
+        frameTimes.push_back(now - lastTime);
+        lastTime = now;
+
+        de265_release_next_picture(ctx);
+
+        nFrames++;
+        if ((uint32_t)nFrames >= max_frames) {
+          stop=true;
+          break;
+        }
+
+        more=1;
+      }
+
+      while (de265_get_warning(ctx) != DE265_OK) { }
+    }
+  }
+
+  de265_free_decoder(ctx);
+
+  return ok;
+}
+
+
+static double percentile(std::vector<double> values, double p)
+{
+  if (values.empty()) {
+    return 0;
+  }
+
+  std::sort(values.begin(), values.end());
+
+  size_t idx = (size_t)(p/100.0*(values.size()-1) + 0.5);
+  return values[idx];
+}
+
+
+static void print_json_string(const char* str)
+{
+  putchar('"');
+
+  for (const char* p=str; *p; p++) {
+    unsigned char c = *p;
+    switch (c) {
+    case '"':  printf("\\\""); break;
+    case '\\': printf("\\\\"); break;
+    case '\n': printf("\\n"); break;
+    case '\r': printf("\\r"); break;
+    case '\t': printf("\\t"); break;
+    default:
+      if (c < 0x20) { printf("\\u%04x", c); }
+      else          { putchar(c); }
+    }
+  }
+
+  putchar('"');
+}
+
+
+/* Decode the bitstream 'benchmark_runs' times for each combination of thread
+   count and acceleration level and write the results as JSON to stdout.
+   The whole input is loaded into memory first and the decoded pictures are
+   discarded, such that only the decoder itself is measured. */
+static int run_benchmark(const char* filename)
+{
+  FILE* fh = fopen(filename, "rb");
+  if (fh==NULL) {
+    fprintf(stderr,"cannot open file %s!\n", filename);
+    return 10;
+  }
+
+  std::vector<uint8_t> stream;
+  uint8_t buf[BUFFER_SIZE];
+  size_t n;
+  while ((n = fread(buf,1,BUFFER_SIZE,fh)) > 0) {
+    stream.insert(stream.end(), buf, buf+n);
+  }
+
+  fclose(fh);
+
+
+  std::vector<int> threadCounts;
+  std::vector<std::string> threadList = split_list(benchmark_threads);
+  for (size_t i=0;i<threadList.size();i++) {
+    threadCounts.push_back(atoi(threadList[i].c_str()));
+  }
+  if (threadCounts.empty()) {
+    threadCounts.push_back(nThreads);
+  }
+
+  std::vector<const benchmark_acceleration*> accels;
+  std::vector<std::string> accelList = split_list(benchmark_accel);
+  if (accelList.empty()) {
+    accelList.push_back(no_acceleration ? "scalar" : "auto");
+  }
+
+  for (size_t i=0;i<accelList.size();i++) {
+    const benchmark_acceleration* a;
+    for (a=benchmark_accelerations; a->name; a++) {
+      if (accelList[i] == a->name) break;
+    }
+
+    if (a->name==NULL) {
+      fprintf(stderr,"unknown acceleration level '%s' (known: scalar, sse, avx2, arm, auto)\n",
+              accelList[i].c_str());
+      return 5;
+    }
+
+    accels.push_back(a);
+  }
+
+
+  bool allOk = true;
+
+  printf("{\n");
+  printf("  \"file\": ");
+  print_json_string(filename);
+  printf(",\n");
+  printf("  \"bytes\": %zu,\n", stream.size());
+  printf("  \"runs\": %d,\n", benchmark_runs);
+  printf("  \"results\": [");
+
+  bool first=true;
+  for (size_t a=0;a<accels.size();a++)
+    for (size_t t=0;t<threadCounts.size();t++) {
+      std::vector<double> frameTimes;
+      std::vector<double> runFPS;
+      int totalFrames=0;
+      bool ok=true;
+
+      double startTime = get_time_ms();
+      double startCPU  = get_cpu_time_ms();
+
+      for (int r=0;r<benchmark_runs;r++) {
+        double runStart = get_time_ms();
+
+        int nFrames;
+        ok &= benchmark_decode(stream, threadCounts[t], accels[a]->level, frameTimes, nFrames);
+
+        double runTime = get_time_ms() - runStart;
+        runFPS.push_back(runTime>0 ? nFrames*1000.0/runTime : 0);
+        totalFrames += nFrames;
+      }
+
+      double wallTime = get_time_ms() - startTime;
+      double cpuTime  = get_cpu_time_ms() - startCPU;
+
+      allOk &= ok;
+
+      printf("%s\n    {\n", first ? "" : ",");
+      printf("      \"threads\": %d,\n", threadCounts[t]);
+      printf("      \"acceleration\": \"%s\",\n", accels[a]->name);
+      printf("      \"ok\": %s,\n", ok ? "true" : "false");
+      printf("      \"frames\": %d,\n", totalFrames/benchmark_runs);
+      printf("      \"fps\": %.2f,\n", wallTime>0 ? totalFrames*1000.0/wallTime : 0);
+      printf("      \"fps_min\": %.2f,\n", *std::min_element(runFPS.begin(), runFPS.end()));
+      printf("      \"fps_max\": %.2f,\n", *std::max_element(runFPS.begin(), runFPS.end()));
+      printf("      \"latency_ms_p50\": %.3f,\n", percentile(frameTimes, 50));
+      printf("      \"latency_ms_p99\": %.3f,\n", percentile(frameTimes, 99));
+      printf("      \"cpu_utilization\": %.3f\n", wallTime>0 ? cpuTime/wallTime : 0);
+      printf("    }");
+
+      fflush(stdout);
+      first=false;
+    }
+
+  printf("\n  ],\n");
+
+  // The OS only tracks the maximum over the whole process lifetime,
+  // hence this cannot be broken down to the single configurations.
+  printf("  \"process_peak_rss_kb\": %ld\n", get_peak_rss_kb());
+  printf("}\n");
+
+  return allOk ? 0 : 10;
+}
+
+
 int main(int argc, char** argv)
 {
   while (1) {
@@ -589,6 +979,10 @@ int main(int argc, char** argv)
     case 'e': show_psnr_map=true; break;
     case 'T': highestTID=atoi(optarg); break;
     case 'v': verbosity++; break;
+    case 'R': trace_filename=optarg; break;
+    case 'b': benchmark_runs=atoi(optarg); break;
+    case 'P': benchmark_threads=optarg; break;
+    case 'A': benchmark_accel=optarg; break;
     }
   }
 
@@ -621,11 +1015,30 @@ int main(int argc, char** argv)
     fprintf(stderr,"  -T, --highest-TID select highest temporal sublayer to decode\n");
     fprintf(stderr,"      --disable-deblocking   disable deblocking filter\n");
     fprintf(stderr,"      --disable-sao          disable sample-adaptive offset filter\n");
+    fprintf(stderr,"      --keyframes-only       decode only IRAP pictures\n");
+    fprintf(stderr,"      --skip-non-reference   skip non-reference pictures\n");
+    fprintf(stderr,"      --statistics           show decoder performance statistics\n");
+    fprintf(stderr,"      --batch-mc             do the motion compensation per CTB, with reference prefetching\n");
+    fprintf(stderr,"      --deferred-reconstruction  reconstruct CTBs after parsing, in parallel to parsing when possible\n");
+    fprintf(stderr,"      --trace FILENAME       write a timeline of the decoding threads (Chrome trace JSON)\n");
+    fprintf(stderr,"      --benchmark N          decode the input N times from memory and print timings as JSON\n");
+    fprintf(stderr,"      --bench-threads LIST   thread counts to benchmark (e.g. 0,2,4), default: -t value\n");
+    fprintf(stderr,"      --bench-accel LIST     acceleration levels to benchmark (scalar,sse,avx2,arm,auto)\n");
     fprintf(stderr,"  -h, --help        show help\n");
 
     exit(show_help ? 0 : 5);
   }
 
+  if (benchmark_runs>0) {
+    if (!logging) {
+      de265_disable_logging();
+    }
+
+    de265_set_verbosity(verbosity);
+
+    return run_benchmark(argv[optind]);
+  }
+
 
   de265_error err =DE265_OK;
 
@@ -636,6 +1049,19 @@ int main(int argc, char** argv)
 
   de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DISABLE_DEBLOCKING, disable_deblocking);
   de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DISABLE_SAO, disable_sao);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_BATCH_MC, batch_mc);
+  de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_DEFERRED_RECONSTRUCTION, deferred_reconstruction);
+
+  if (keyframes_only) {
+    de265_set_parameter_int(ctx, DE265_DECODER_PARAM_SKIP_PICTURES, de265_skip_pictures_NON_IRAP);
+  }
+  else if (skip_non_reference) {
+    de265_set_parameter_int(ctx, DE265_DECODER_PARAM_SKIP_PICTURES, de265_skip_pictures_NON_REFERENCE);
+  }
+
+  if (trace_filename) {
+    de265_set_parameter_bool(ctx, DE265_DECODER_PARAM_TRACE, true);
+  }
 
   if (dump_headers) {
     de265_set_parameter_int(ctx, DE265_DECODER_PARAM_DUMP_SPS_HEADERS, 1);
@@ -813,6 +1239,16 @@ int main(int argc, char** argv)
     fclose(reference_file);
   }
 
+  if (show_statistics) {
+    print_statistics(ctx);
+  }
+
+  if (trace_filename) {
+    if (de265_write_trace(ctx, trace_filename) != DE265_OK) {
+      fprintf(stderr,"cannot write trace to %s\n", trace_filename);
+    }
+  }
+
   de265_free_decoder(ctx);
 
   struct timeval tv_end;
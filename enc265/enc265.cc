@@ -314,11 +314,16 @@ int main(int argc, char** argv)
   }
 
   bool eof = false;
-  for (int poc=0; poc<maxPoc && !eof ;poc++)
+  for (int poc=0; !eof ;poc++)
     {
-      // push one image into the encoder
+      // push one image into the encoder (or signal the end of the stream,
+      // so that the frames still held back for the lookahead are encoded)
+
+      de265_image* input_image = NULL;
+      if (poc<maxPoc) {
+        input_image = image_source->get_image();
+      }
 
-      de265_image* input_image = image_source->get_image();
       if (input_image==NULL) {
         en265_push_eof(ectx);
         eof=true;
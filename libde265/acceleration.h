@@ -138,6 +138,57 @@ struct acceleration_functions
                      int16_t* mcbuffer, int dX,int dY, int bit_depth) const;
 
 
+  // --- bi-prediction with default weights (8.5.3.3.4.2) ---
+
+  /* Interpolate the L0 and L1 predictions and write their rounded average directly
+     into 'dst', without going through intermediate 14-bit prediction blocks.
+     src0/src1 point to the integer sample positions, (mx,my) are the fractional
+     positions in 1/4 (qpel) or 1/8 (epel) sample units. Max. block size is 64x64. */
+
+  void (*put_hevc_qpel_bi_8)(uint8_t *dst, ptrdiff_t dststride,
+                             const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                             const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                             int width, int height);
+  void (*put_hevc_epel_bi_8)(uint8_t *dst, ptrdiff_t dststride,
+                             const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                             const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                             int width, int height);
+
+  void (*put_hevc_qpel_bi_16)(uint16_t *dst, ptrdiff_t dststride,
+                              const uint16_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                              const uint16_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                              int width, int height, int bit_depth);
+  void (*put_hevc_epel_bi_16)(uint16_t *dst, ptrdiff_t dststride,
+                              const uint16_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                              const uint16_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                              int width, int height, int bit_depth);
+
+  void put_hevc_qpel_bi(void *dst, ptrdiff_t dststride,
+                        const void *src0, ptrdiff_t src0stride, int mx0, int my0,
+                        const void *src1, ptrdiff_t src1stride, int mx1, int my1,
+                        int width, int height, int bit_depth) const;
+  void put_hevc_epel_bi(void *dst, ptrdiff_t dststride,
+                        const void *src0, ptrdiff_t src0stride, int mx0, int my0,
+                        const void *src1, ptrdiff_t src1stride, int mx1, int my1,
+                        int width, int height, int bit_depth) const;
+
+
+  // --- inverse quantization (8.6.3) ---
+
+  /* m_x_y is taken from the nT x nT scaling factor matrix 'sclist' (indexed like the
+     coefficients), or is 16 if 'sclist' is NULL. levelScale is levelScale[qP%6]
+     and qPper is qP/6. */
+
+  // dequantize the coefficient list and scatter it into the zero-initialized coeffBuf
+  void (*dequant_coefficients)(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                               int nCoeff, const uint8_t* sclist,
+                               int levelScale, int qPper, int bdShift);
+
+  // dequantize the n coefficients in place (dense blocks)
+  void (*dequant_block)(int16_t* coeffs, int n, const uint8_t* sclist,
+                        int levelScale, int qPper, int bdShift);
+
+
   // --- inverse transforms ---
 
   void (*transform_bypass)(int32_t *residual, const int16_t *coeffs, int nT);
@@ -151,12 +202,18 @@ struct acceleration_functions
   void (*transform_skip_rdpcm_h_8)(uint8_t *_dst, const int16_t *coeffs, int nT, ptrdiff_t _stride);
   void (*transform_4x4_dst_add_8)(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride); // iDST
   void (*transform_add_8[4])(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride); // iDCT
+  void (*transform_add_partial_8[4])(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                     int nzW, int nzH); // iDCT, non-zero coeffs in top-left nzW x nzH
+  void (*transform_dc_add_8)(uint8_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride); // iDCT, DC only
 
   // 9-16 bit
 
   void (*transform_skip_16)(uint16_t *_dst, const int16_t *coeffs, ptrdiff_t _stride, int bit_depth); // no transform
   void (*transform_4x4_dst_add_16)(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth); // iDST
   void (*transform_add_16[4])(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth); // iDCT
+  void (*transform_add_partial_16[4])(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth,
+                                      int nzW, int nzH); // iDCT, non-zero coeffs in top-left nzW x nzH
+  void (*transform_dc_add_16)(uint16_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth); // iDCT, DC only
 
 
   void (*rotate_coefficients)(int16_t *coeff, int nT);
@@ -166,6 +223,9 @@ struct acceleration_functions
   void (*transform_idct_8x8)(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits);
   void (*transform_idct_16x16)(int32_t *dst,const int16_t *coeffs,int bdShift, int max_coeff_bits);
   void (*transform_idct_32x32)(int32_t *dst,const int16_t *coeffs,int bdShift, int max_coeff_bits);
+  // (4x4,8x8,16x16,32x32) indexed with (log2TbSize-2), non-zero coeffs in top-left nzW x nzH
+  void (*transform_idct_partial[4])(int32_t *dst,const int16_t *coeffs,int bdShift, int max_coeff_bits,
+                                    int nzW, int nzH);
   void (*add_residual_8)(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth);
   void (*add_residual_16)(uint16_t *dst,ptrdiff_t stride,const int32_t* r, int nT, int bit_depth);
 
@@ -184,6 +244,8 @@ struct acceleration_functions
   template <class pixel_t> void transform_skip_rdpcm_h(pixel_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth) const;
   template <class pixel_t> void transform_4x4_dst_add(pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const;
   template <class pixel_t> void transform_add(int sizeIdx, pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const;
+  template <class pixel_t> void transform_add_partial(int sizeIdx, pixel_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH) const;
+  template <class pixel_t> void transform_dc_add(pixel_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth) const;
 
 
 
@@ -198,6 +260,54 @@ struct acceleration_functions
   // forward Hadamard transform (without scaling factor)
   // (4x4,8x8,16x16,32x32) indexed with (log2TbSize-2)
   void (*hadamard_transform_8[4])     (int16_t *coeffs, const int16_t *src, ptrdiff_t stride);
+
+
+
+  // --- block distortion measures ---
+
+  // sum of absolute / squared differences over a width x height block
+
+  uint32_t (*sad_8) (const uint8_t* img, ptrdiff_t imgStride,
+                     const uint8_t* ref, ptrdiff_t refStride, int width, int height);
+  uint64_t (*ssd_8) (const uint8_t* img, ptrdiff_t imgStride,
+                     const uint8_t* ref, ptrdiff_t refStride, int width, int height);
+
+  uint32_t (*sad_16)(const uint16_t* img, ptrdiff_t imgStride,
+                     const uint16_t* ref, ptrdiff_t refStride, int width, int height);
+  uint64_t (*ssd_16)(const uint16_t* img, ptrdiff_t imgStride,
+                     const uint16_t* ref, ptrdiff_t refStride, int width, int height);
+
+  // sum of absolute Hadamard transformed differences (SATD) over a square block
+  // (4x4,8x8,16x16,32x32,64x64) indexed with (log2BlkSize-2)
+  // 64x64 is computed as four 32x32 transforms.
+
+  uint32_t (*satd_8[5]) (const uint8_t* img, ptrdiff_t imgStride,
+                         const uint8_t* ref, ptrdiff_t refStride);
+  uint32_t (*satd_16[5])(const uint16_t* img, ptrdiff_t imgStride,
+                         const uint16_t* ref, ptrdiff_t refStride);
+
+  uint32_t sad(const void* img, ptrdiff_t imgStride,
+               const void* ref, ptrdiff_t refStride,
+               int width, int height, int bit_depth) const;
+  uint64_t ssd(const void* img, ptrdiff_t imgStride,
+               const void* ref, ptrdiff_t refStride,
+               int width, int height, int bit_depth) const;
+  uint32_t satd(int log2BlkSize,
+                const void* img, ptrdiff_t imgStride,
+                const void* ref, ptrdiff_t refStride, int bit_depth) const;
+
+
+
+  // --- deblocking ---
+
+  // Boundary strength (8.7.2.4) for a run of n<=16 4x4 units, from the deblocking flags
+  // of the units at the edge (q) and on the opposite side of the edge (p). Only the
+  // positions in posMask are processed, their bS is written into q (DEBLOCK_BS_MASK).
+  // Returns the positions where the bS depends on the motion. They are set to bS=0
+  // and have to be completed by the caller.
+
+  uint32_t (*deblock_boundary_strength)(uint8_t* q, const uint8_t* p, int n, uint32_t posMask,
+                                        uint8_t edgeMask, uint8_t transformEdgeMask);
 };
 
 
@@ -338,6 +448,65 @@ inline void acceleration_functions::put_hevc_qpel(int16_t *dst, ptrdiff_t dststr
     put_hevc_qpel_16[dX][dY](dst,dststride,(const uint16_t*)src,srcstride,width,height,mcbuffer, bit_depth);
 }
 
+inline void acceleration_functions::put_hevc_qpel_bi(void *dst, ptrdiff_t dststride,
+                                                     const void *src0, ptrdiff_t src0stride, int mx0, int my0,
+                                                     const void *src1, ptrdiff_t src1stride, int mx1, int my1,
+                                                     int width, int height, int bit_depth) const
+{
+  if (bit_depth <= 8)
+    put_hevc_qpel_bi_8((uint8_t*)dst,dststride, (const uint8_t*)src0,src0stride,mx0,my0,
+                       (const uint8_t*)src1,src1stride,mx1,my1, width,height);
+  else
+    put_hevc_qpel_bi_16((uint16_t*)dst,dststride, (const uint16_t*)src0,src0stride,mx0,my0,
+                        (const uint16_t*)src1,src1stride,mx1,my1, width,height, bit_depth);
+}
+
+inline void acceleration_functions::put_hevc_epel_bi(void *dst, ptrdiff_t dststride,
+                                                     const void *src0, ptrdiff_t src0stride, int mx0, int my0,
+                                                     const void *src1, ptrdiff_t src1stride, int mx1, int my1,
+                                                     int width, int height, int bit_depth) const
+{
+  if (bit_depth <= 8)
+    put_hevc_epel_bi_8((uint8_t*)dst,dststride, (const uint8_t*)src0,src0stride,mx0,my0,
+                       (const uint8_t*)src1,src1stride,mx1,my1, width,height);
+  else
+    put_hevc_epel_bi_16((uint16_t*)dst,dststride, (const uint16_t*)src0,src0stride,mx0,my0,
+                        (const uint16_t*)src1,src1stride,mx1,my1, width,height, bit_depth);
+}
+
+inline uint32_t acceleration_functions::sad(const void* img, ptrdiff_t imgStride,
+                                            const void* ref, ptrdiff_t refStride,
+                                            int width, int height, int bit_depth) const
+{
+  if (bit_depth <= 8)
+    return sad_8((const uint8_t*)img,imgStride,(const uint8_t*)ref,refStride,width,height);
+  else
+    return sad_16((const uint16_t*)img,imgStride,(const uint16_t*)ref,refStride,width,height);
+}
+
+inline uint64_t acceleration_functions::ssd(const void* img, ptrdiff_t imgStride,
+                                            const void* ref, ptrdiff_t refStride,
+                                            int width, int height, int bit_depth) const
+{
+  if (bit_depth <= 8)
+    return ssd_8((const uint8_t*)img,imgStride,(const uint8_t*)ref,refStride,width,height);
+  else
+    return ssd_16((const uint16_t*)img,imgStride,(const uint16_t*)ref,refStride,width,height);
+}
+
+inline uint32_t acceleration_functions::satd(int log2BlkSize,
+                                             const void* img, ptrdiff_t imgStride,
+                                             const void* ref, ptrdiff_t refStride,
+                                             int bit_depth) const
+{
+  assert(log2BlkSize>=2 && log2BlkSize<=6);
+
+  if (bit_depth <= 8)
+    return satd_8[log2BlkSize-2]((const uint8_t*)img,imgStride,(const uint8_t*)ref,refStride);
+  else
+    return satd_16[log2BlkSize-2]((const uint16_t*)img,imgStride,(const uint16_t*)ref,refStride);
+}
+
 template <> inline void acceleration_functions::transform_skip<uint8_t>(uint8_t *dst, const int16_t *coeffs,ptrdiff_t stride, int bit_depth) const { transform_skip_8(dst,coeffs,stride); }
 template <> inline void acceleration_functions::transform_skip<uint16_t>(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const { transform_skip_16(dst,coeffs,stride, bit_depth); }
 
@@ -353,6 +522,12 @@ template <> inline void acceleration_functions::transform_4x4_dst_add<uint16_t>(
 template <> inline void acceleration_functions::transform_add<uint8_t>(int sizeIdx, uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const { transform_add_8[sizeIdx](dst,coeffs,stride); }
 template <> inline void acceleration_functions::transform_add<uint16_t>(int sizeIdx, uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth) const { transform_add_16[sizeIdx](dst,coeffs,stride,bit_depth); }
 
+template <> inline void acceleration_functions::transform_add_partial<uint8_t>(int sizeIdx, uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH) const { transform_add_partial_8[sizeIdx](dst,coeffs,stride,nzW,nzH); }
+template <> inline void acceleration_functions::transform_add_partial<uint16_t>(int sizeIdx, uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH) const { transform_add_partial_16[sizeIdx](dst,coeffs,stride,bit_depth,nzW,nzH); }
+
+template <> inline void acceleration_functions::transform_dc_add<uint8_t>(uint8_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth) const { transform_dc_add_8(dst,coeffs,nT,stride); }
+template <> inline void acceleration_functions::transform_dc_add<uint16_t>(uint16_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth) const { transform_dc_add_16(dst,coeffs,nT,stride,bit_depth); }
+
 template <> inline void acceleration_functions::add_residual(uint8_t *dst,  ptrdiff_t stride, const int32_t* r, int nT, int bit_depth) const { add_residual_8(dst,stride,r,nT,bit_depth); }
 template <> inline void acceleration_functions::add_residual(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth) const { add_residual_16(dst,stride,r,nT,bit_depth); }
 
@@ -24,6 +24,10 @@
 
 #include "arm.h"
 
+#ifdef HAVE_NEON
+#include "neon-distortion.h"
+#endif
+
 #ifdef HAVE_NEON
 
 #define QPEL_FUNC(name) \
@@ -118,6 +122,9 @@ void init_acceleration_functions_arm(struct acceleration_functions* accel)
     accel->put_hevc_qpel_8[3][1] = libde265_hevc_put_qpel_h3v1_neon_8;
     accel->put_hevc_qpel_8[3][2] = libde265_hevc_put_qpel_h3v2_neon_8;
     accel->put_hevc_qpel_8[3][3] = libde265_hevc_put_qpel_h3v3_neon_8;
+
+    accel->sad_8 = libde265_sad_8_neon;
+    accel->ssd_8 = libde265_ssd_8_neon;
   }
 #endif  // #ifdef HAVE_NEON
 }
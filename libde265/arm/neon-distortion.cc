@@ -0,0 +1,106 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "neon-distortion.h"
+
+#include <arm_neon.h>
+
+
+uint32_t libde265_sad_8_neon(const uint8_t* img, ptrdiff_t imgStride,
+                             const uint8_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  uint32x4_t sum = vdupq_n_u32(0);
+  uint32_t tail = 0;
+
+  for (int y=0;y<height;y++) {
+    // Process the line in chunks of 2048 pixels. With at most 2x255 per
+    // lane and iteration, the 16 bit partial sums cannot overflow.
+
+    for (int x0=0;x0<width;x0+=2048) {
+      int xEnd = (width-x0 > 2048) ? x0+2048 : width;
+      uint16x8_t chunkSum = vdupq_n_u16(0);
+      int x=x0;
+
+      for (;x+16<=xEnd;x+=16) {
+        uint8x16_t a = vld1q_u8(img+x);
+        uint8x16_t b = vld1q_u8(ref+x);
+        chunkSum = vpadalq_u8(chunkSum, vabdq_u8(a,b));
+      }
+
+      for (;x+8<=xEnd;x+=8) {
+        uint8x8_t a = vld1_u8(img+x);
+        uint8x8_t b = vld1_u8(ref+x);
+        chunkSum = vabal_u8(chunkSum, a,b);
+      }
+
+      for (;x<xEnd;x++) {
+        int diff = img[x] - ref[x];
+        tail += (diff<0 ? -diff : diff);
+      }
+
+      sum = vpadalq_u16(sum, chunkSum);
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  uint64x2_t s = vpaddlq_u32(sum);
+  return (uint32_t)(vgetq_lane_u64(s,0) + vgetq_lane_u64(s,1)) + tail;
+}
+
+
+uint64_t libde265_ssd_8_neon(const uint8_t* img, ptrdiff_t imgStride,
+                             const uint8_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  uint64x2_t sum = vdupq_n_u64(0);
+  uint64_t tail = 0;
+
+  for (int y=0;y<height;y++) {
+    // 8 lanes of up to 65025 per iteration: no overflow for lines up to 2^17 pixels
+
+    uint32x4_t lineSum = vdupq_n_u32(0);
+    int x=0;
+
+    for (;x+8<=width;x+=8) {
+      uint8x8_t a = vld1_u8(img+x);
+      uint8x8_t b = vld1_u8(ref+x);
+      uint8x8_t d = vabd_u8(a,b);
+      uint16x8_t d2 = vmull_u8(d,d);
+      lineSum = vpadalq_u16(lineSum, d2);
+    }
+
+    for (;x<width;x++) {
+      int diff = img[x] - ref[x];
+      tail += diff*diff;
+    }
+
+    sum = vpadalq_u32(sum, lineSum);
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return vgetq_lane_u64(sum,0) + vgetq_lane_u64(sum,1) + tail;
+}
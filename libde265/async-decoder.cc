@@ -0,0 +1,324 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "async-decoder.h"
+#include "decctx.h"
+
+#include <assert.h>
+
+
+async_decoder::async_decoder(decoder_context* ctx)
+{
+  mCtx = ctx;
+
+  mCallback = NULL;
+  mCallbackData = NULL;
+
+  mQueuedBytes = 0;
+  mMaxQueuedBytes = 0;
+  mEndOfStream = false;
+
+  mDecoding = false;
+  mFinished = false;
+  mError = DE265_OK;
+
+  mThreadRunning = false;
+  mStopThread = false;
+
+  de265_mutex_init(&mMutex);
+  de265_cond_init(&mInputAvailable);
+  de265_cond_init(&mInputConsumed);
+}
+
+
+async_decoder::~async_decoder()
+{
+  stop();
+
+  de265_mutex_destroy(&mMutex);
+  de265_cond_destroy(&mInputAvailable);
+  de265_cond_destroy(&mInputConsumed);
+}
+
+
+#ifndef _WIN32
+static void* decode_thread(void* decoder_ptr)
+#else
+static DWORD WINAPI decode_thread(LPVOID decoder_ptr)
+#endif
+{
+  async_decoder* decoder = (async_decoder*)decoder_ptr;
+  decoder->decode_thread_main();
+  return 0;
+}
+
+
+de265_error async_decoder::start(int maxQueuedBytes,
+                                 de265_picture_ready_callback callback, void* callback_data)
+{
+  if (mThreadRunning) {
+    return DE265_ERROR_ASYNC_DECODING_ALREADY_ACTIVE;
+  }
+
+  mCallback = callback;
+  mCallbackData = callback_data;
+  mMaxQueuedBytes = maxQueuedBytes;
+
+  mEndOfStream = false;
+  mDecoding = false;
+  mFinished = false;
+  mError = DE265_OK;
+  mStopThread = false;
+
+  if (de265_thread_create(&mThread, decode_thread, this) != 0) {
+    return DE265_ERROR_CANNOT_START_THREADPOOL;
+  }
+
+  mThreadRunning = true;
+  return DE265_OK;
+}
+
+
+void async_decoder::stop()
+{
+  if (!mThreadRunning) {
+    return;
+  }
+
+  de265_mutex_lock(&mMutex);
+  mStopThread = true;
+  de265_cond_broadcast(&mInputAvailable, &mMutex);
+  de265_cond_broadcast(&mInputConsumed, &mMutex);
+  de265_mutex_unlock(&mMutex);
+
+  de265_thread_join(mThread);
+  de265_thread_destroy(&mThread);
+
+  mThreadRunning = false;
+
+  while (!mInputQueue.empty()) {
+    delete mInputQueue.front();
+    mInputQueue.pop_front();
+  }
+
+  mQueuedBytes = 0;
+}
+
+
+de265_error async_decoder::push_data(const void* data, int len, de265_PTS pts, void* user_data,
+                                     bool isNAL)
+{
+  if (!mThreadRunning) {
+    return DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE;
+  }
+
+  input_chunk* chunk = new input_chunk;
+  chunk->data.assign((const uint8_t*)data, (const uint8_t*)data + len);
+  chunk->pts = pts;
+  chunk->user_data = user_data;
+  chunk->isNAL = isNAL;
+
+  de265_mutex_lock(&mMutex);
+
+  // backpressure: wait until the decoder has consumed enough of the queue
+  // (a chunk that is larger than the whole queue is accepted when the queue is empty)
+
+  while (!mStopThread &&
+         mQueuedBytes > 0 && mQueuedBytes + len > mMaxQueuedBytes) {
+    de265_cond_wait(&mInputConsumed, &mMutex);
+  }
+
+  if (mStopThread) {
+    de265_mutex_unlock(&mMutex);
+    delete chunk;
+    return DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE;
+  }
+
+  mInputQueue.push_back(chunk);
+  mQueuedBytes += len;
+
+  de265_cond_broadcast(&mInputAvailable, &mMutex);
+  de265_mutex_unlock(&mMutex);
+
+  return DE265_OK;
+}
+
+
+void async_decoder::flush_data()
+{
+  if (!mThreadRunning) {
+    return;
+  }
+
+  de265_mutex_lock(&mMutex);
+  mEndOfStream = true;
+  de265_cond_broadcast(&mInputAvailable, &mMutex);
+  de265_mutex_unlock(&mMutex);
+}
+
+
+de265_error async_decoder::wait()
+{
+  if (!mThreadRunning) {
+    return DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE;
+  }
+
+  de265_mutex_lock(&mMutex);
+
+  while (!mStopThread &&
+         (!mInputQueue.empty() || mDecoding || (mEndOfStream && !mFinished))) {
+    de265_cond_wait(&mInputConsumed, &mMutex);
+  }
+
+  de265_error err = mError;
+
+  de265_mutex_unlock(&mMutex);
+
+  return err;
+}
+
+
+void async_decoder::decode_thread_main()
+{
+  de265_mutex_lock(&mMutex);
+
+  for (;;) {
+    while (!mStopThread &&
+           mInputQueue.empty() && (!mEndOfStream || mFinished)) {
+      de265_cond_wait(&mInputAvailable, &mMutex);
+    }
+
+    if (mStopThread) {
+      break;
+    }
+
+    // Take one chunk at a time. The decoder only asks for more input when it has
+    // decoded all NALs, hence the amount of buffered data stays bounded.
+
+    input_chunk* chunk = NULL;
+    if (!mInputQueue.empty()) {
+      chunk = mInputQueue.front();
+      mInputQueue.pop_front();
+      mQueuedBytes -= chunk->data.size();
+    }
+
+    bool endOfStream = (mInputQueue.empty() && mEndOfStream);
+
+    mDecoding = true;
+    de265_cond_broadcast(&mInputConsumed, &mMutex);
+
+    de265_mutex_unlock(&mMutex);
+
+
+    de265_error err = DE265_OK;
+
+    if (chunk) {
+      if (chunk->isNAL) {
+        err = mCtx->nal_parser.push_NAL(chunk->data.data(), chunk->data.size(),
+                                        chunk->pts, chunk->user_data);
+      }
+      else {
+        err = mCtx->nal_parser.push_data(chunk->data.data(), chunk->data.size(),
+                                         chunk->pts, chunk->user_data);
+      }
+
+      delete chunk;
+    }
+
+    if (endOfStream) {
+      mCtx->nal_parser.flush_data();
+      mCtx->nal_parser.mark_end_of_stream();
+    }
+
+    if (err == DE265_OK) {
+      err = decode_available_data();
+    }
+
+
+    de265_mutex_lock(&mMutex);
+
+    if (!de265_isOK(err) && mError == DE265_OK) {
+      mError = err;
+    }
+
+    if (endOfStream) {
+      mFinished = true;
+    }
+
+    mDecoding = false;
+    de265_cond_broadcast(&mInputConsumed, &mMutex);
+  }
+
+  de265_mutex_unlock(&mMutex);
+}
+
+
+de265_error async_decoder::decode_available_data()
+{
+  de265_error firstError = DE265_OK;
+
+  for (;;) {
+    int more = 0;
+    de265_error err = mCtx->decode(&more);
+
+    int nOutput = output_pictures();
+
+    if (err == DE265_ERROR_WAITING_FOR_INPUT_DATA ||
+        !more) {
+      break;
+    }
+
+    // When the DPB is full, decoding continues after the output pictures have been
+    // released. If there are none, the decoder cannot continue.
+
+    if (err == DE265_ERROR_IMAGE_BUFFER_FULL && nOutput>0) {
+      continue;
+    }
+
+    if (!de265_isOK(err)) {
+      if (firstError == DE265_OK) { firstError = err; }
+
+      if (err == DE265_ERROR_IMAGE_BUFFER_FULL) {
+        break;
+      }
+    }
+  }
+
+  return firstError;
+}
+
+
+int async_decoder::output_pictures()
+{
+  de265_decoder_context* ctx = (de265_decoder_context*)mCtx;
+  int nOutput = 0;
+
+  const de265_image* img;
+  while ((img = de265_peek_next_picture(ctx)) != NULL) {
+    if (mCallback) {
+      mCallback(mCallbackData, img);
+    }
+
+    de265_release_next_picture(ctx);
+    nOutput++;
+  }
+
+  return nOutput;
+}
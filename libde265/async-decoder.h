@@ -0,0 +1,95 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DE265_ASYNC_DECODER_H
+#define DE265_ASYNC_DECODER_H
+
+#include "libde265/de265.h"
+#include "libde265/threads.h"
+
+#include <deque>
+#include <vector>
+
+class decoder_context;
+
+
+/* Runs the decoder_context on its own thread.
+
+   The input data is queued and consumed by the decode thread one chunk at a
+   time, whenever the decoder runs out of NALs. Decoded pictures are passed
+   to the callback and released directly afterwards.
+
+   The callback runs on the decode thread. It must not call push_data(), wait()
+   or stop(): these block until the decode thread makes progress, which it
+   cannot do while it is inside the callback.
+ */
+class async_decoder
+{
+ public:
+  async_decoder(decoder_context* ctx);
+  ~async_decoder();
+
+  de265_error start(int maxQueuedBytes, de265_picture_ready_callback callback, void* callback_data);
+  void stop();  // discards pending input
+
+  de265_error push_data(const void* data, int len, de265_PTS pts, void* user_data, bool isNAL);
+  void        flush_data();
+
+  de265_error wait();
+
+  void decode_thread_main(); // internal, runs on the decode thread
+
+ private:
+  decoder_context* mCtx;
+
+  de265_picture_ready_callback mCallback;
+  void* mCallbackData;
+
+  struct input_chunk {
+    std::vector<uint8_t> data;
+    de265_PTS pts;
+    void* user_data;
+    bool  isNAL;
+  };
+
+  std::deque<input_chunk*> mInputQueue;
+  int  mQueuedBytes;
+  int  mMaxQueuedBytes;
+  bool mEndOfStream;   // no more input after the queued data
+
+  bool mDecoding;      // decode thread is working on a chunk (not waiting for input)
+  bool mFinished;      // end of stream reached and all pictures output
+  de265_error mError;  // first decoding error
+
+  // --- decode thread ---
+
+  bool mThreadRunning;
+  bool mStopThread;
+
+  de265_thread mThread;
+  de265_mutex  mMutex;
+  de265_cond   mInputAvailable;
+  de265_cond   mInputConsumed;   // queue space available or decoder idle
+
+  de265_error decode_available_data();
+  int  output_pictures(); // returns the number of pictures passed to the callback
+};
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "border.h"
+
+
+class thread_task_extend_borders : public thread_task
+{
+public:
+  int  ctb_y;
+  de265_image* img;       // progress and SPS
+  de265_image* outputImg; // image whose border is filled
+  int inputProgress;
+
+  virtual void work();
+  virtual std::string name() const {
+    char buf[100];
+    sprintf(buf,"border-%d",ctb_y);
+    return buf;
+  }
+};
+
+
+void thread_task_extend_borders::work()
+{
+  state = Running;
+  img->thread_run(this);
+
+  STATISTICS_COUNT(img->decctx, tasks_run, 1);
+
+  const seq_parameter_set& sps = img->get_sps();
+
+  const int rightCtb = sps.PicWidthInCtbsY-1;
+  const int ctbSize  = (1<<sps.Log2CtbSizeY);
+
+  img->wait_for_progress(this, rightCtb,ctb_y, inputProgress);
+
+  // horizontal deblocking of the next row still modifies the last lines of this row
+
+  if (inputProgress==CTB_PROGRESS_DEBLK_H && ctb_y+1<sps.PicHeightInCtbsY) {
+    img->wait_for_progress(this, rightCtb,ctb_y+1, inputProgress);
+  }
+
+  outputImg->extend_borders(ctb_y * ctbSize, (ctb_y+1) * ctbSize);
+
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
+bool add_border_extension_tasks(image_unit* imgunit, de265_image* outputImg,
+                                int inputProgress)
+{
+  de265_image* img = imgunit->img;
+  decoder_context* ctx = img->decctx;
+
+  if (outputImg->get_border(0)==0) {
+    return false;
+  }
+
+  int nRows = img->get_sps().PicHeightInCtbsY;
+
+  img->thread_start(nRows);
+
+  for (int y=0;y<nRows;y++)
+    {
+      thread_task_extend_borders* task = new thread_task_extend_borders;
+
+      task->img = img;
+      task->outputImg = outputImg;
+      task->ctb_y = y;
+      task->inputProgress = inputProgress;
+
+      imgunit->tasks.push_back(task);
+      ctx->add_task(task);
+    }
+
+  return true;
+}
@@ -0,0 +1,34 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DE265_BORDER_H
+#define DE265_BORDER_H
+
+#include "libde265/decctx.h"
+
+/* Fill the picture border of 'outputImg' CTB-row by CTB-row once the rows have
+   reached 'inputProgress' in imgunit->img. Motion compensation in later pictures
+   can then read reference blocks that lie partly outside the picture directly.
+   Returns 'true' if any tasks have been added.
+ */
+bool add_border_extension_tasks(image_unit* imgunit, de265_image* outputImg,
+                                int inputProgress);
+
+#endif
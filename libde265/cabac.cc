@@ -133,6 +133,12 @@ static const uint8_t next_state_LPS[64] =
 int logcnt=1;
 #endif
 
+#ifdef DE265_STATISTICS
+#define COUNT_BINS(decoder,n) (decoder)->num_bins += (n)
+#else
+#define COUNT_BINS(decoder,n)
+#endif
+
 void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length)
 {
   assert(length >= 0);
@@ -140,6 +146,10 @@ void init_CABAC_decoder(CABAC_decoder* decoder, uint8_t* bitstream, int length)
   decoder->bitstream_start = bitstream;
   decoder->bitstream_curr  = bitstream;
   decoder->bitstream_end   = bitstream+length;
+
+#ifdef DE265_STATISTICS
+  decoder->num_bins = 0;
+#endif
 }
 
 void init_CABAC_decoder_2(CABAC_decoder* decoder)
@@ -162,6 +172,8 @@ int  decode_CABAC_bit(CABAC_decoder* decoder, context_model* model)
 {
   logtrace(LogCABAC,"[%3d] decodeBin r:%x v:%x state:%d\n",logcnt,decoder->range, decoder->value, model->state);
 
+  COUNT_BINS(decoder,1);
+
   int decoded_bit;
   int LPS = LPS_table[model->state][ ( decoder->range >> 6 ) - 4 ];
   decoder->range -= LPS;
@@ -242,6 +254,8 @@ int  decode_CABAC_term_bit(CABAC_decoder* decoder)
 {
   logtrace(LogCABAC,"CABAC term: range=%x\n", decoder->range);
 
+  COUNT_BINS(decoder,1);
+
   decoder->range -= 2;
   uint32_t scaledRange = decoder->range << 7;
 
@@ -279,6 +293,8 @@ int  decode_CABAC_bypass(CABAC_decoder* decoder)
 {
   logtrace(LogCABAC,"[%3d] bypass r:%x v:%x\n",logcnt,decoder->range, decoder->value);
 
+  COUNT_BINS(decoder,1);
+
   decoder->value <<= 1;
   decoder->bits_needed++;
 
@@ -341,6 +357,8 @@ int  decode_CABAC_FL_bypass_parallel(CABAC_decoder* decoder, int nBits)
   logtrace(LogCABAC,"[%3d] bypass group r:%x v:%x (nBits=%d)\n",logcnt,
            decoder->range, decoder->value, nBits);
 
+  COUNT_BINS(decoder,nBits);
+
   decoder->value <<= nBits;
   decoder->bits_needed+=nBits;
 
@@ -836,7 +854,7 @@ void CABAC_encoder_bitstream::write_CABAC_term_bit(int bit)
 
 
 
-static const uint32_t entropy_table[128] = {
+const uint32_t CABAC_entropy_table[128] = {
   // -------------------- 200 --------------------
   /* state= 0 */  0x07d13 /* 0.977164 */,  0x08255 /* 1.018237 */,
   /* state= 1 */  0x07738 /* 0.931417 */,  0x086ef /* 1.054179 */,
@@ -955,9 +973,9 @@ void CABAC_encoder_estim::write_CABAC_bit(int modelIdx, int bit)
     model->state = next_state_LPS[model->state];
   }
 
-  mFracBits += entropy_table[idx];
+  mFracBits += CABAC_entropy_table[idx];
 
-  //printf("-> %08lx %f\n",entropy_table[idx], entropy_table[idx] / float(1<<15));
+  //printf("-> %08lx %f\n",CABAC_entropy_table[idx], CABAC_entropy_table[idx] / float(1<<15));
 }
 
 
@@ -970,7 +988,7 @@ float CABAC_encoder::RDBits_for_CABAC_bin(int modelIdx, int bit)
     idx++;
   }
 
-  return entropy_table[idx] / float(1<<15);
+  return CABAC_entropy_table[idx] / float(1<<15);
 }
 
 
@@ -1001,7 +1019,7 @@ void CABAC_encoder_estim_constant::write_CABAC_bit(int modelIdx, int bit)
     idx++;
   }
 
-  mFracBits += entropy_table[idx];
+  mFracBits += CABAC_entropy_table[idx];
 }
 
 
@@ -1010,7 +1028,7 @@ void CABAC_encoder_estim_constant::write_CABAC_bit(int modelIdx, int bit)
 void printtab(int idx,int s)
 {
   printf("%d %f %f %f\n", s,
-         double(entropy_table[idx])/0x8000,
+         double(CABAC_entropy_table[idx])/0x8000,
          double(entropy_table_orig[idx])/0x8000,
          double(entropy_table_f265[idx])/0x8000);
 }
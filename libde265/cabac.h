@@ -33,6 +33,10 @@ typedef struct {
   uint32_t range;
   uint32_t value;
   int16_t  bits_needed;
+
+#ifdef DE265_STATISTICS
+  uint32_t num_bins;  // collected into the decoder statistics after each CTB
+#endif
 } CABAC_decoder;
 
 
@@ -208,4 +212,15 @@ class CABAC_encoder_estim_constant : public CABAC_encoder_estim
   virtual bool modifies_context() const { return false; }
 };
 
+
+/* Fractional bits (in units of 1/32768 bit) for coding a bin in the given context state.
+   Index is state*2 + (bin != MPS).
+ */
+extern const uint32_t CABAC_entropy_table[128];
+
+inline uint32_t CABAC_frac_bits(const context_model& model, int bit)
+{
+  return CABAC_entropy_table[(model.state<<1) + (bit != model.MPSbit)];
+}
+
 #endif
@@ -27,6 +27,8 @@
 #include "scan.h"
 #include "image.h"
 #include "sei.h"
+#include "stream-index.h"
+#include "async-decoder.h"
 
 #include <assert.h>
 #include <string.h>
@@ -102,6 +104,12 @@ LIBDE265_API const char* de265_get_error_text(de265_error err)
     return "premature end of slice data";
   case DE265_ERROR_UNSPECIFIED_DECODING_ERROR:
     return "unspecified decoding error";
+  case DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE:
+    return "asynchronous decoding has not been started";
+  case DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED:
+    return "decoder is already attached to a thread pool";
+  case DE265_ERROR_ASYNC_DECODING_ALREADY_ACTIVE:
+    return "asynchronous decoding has already been started";
 
   case DE265_WARNING_NO_WPP_CANNOT_USE_MULTITHREADING:
     return "Cannot run decoder multi-threaded because stream does not support WPP";
@@ -238,6 +246,10 @@ LIBDE265_API de265_error de265_free_decoder(de265_decoder_context* de265ctx)
 {
   decoder_context* ctx = (decoder_context*)de265ctx;
 
+  if (ctx->async) {
+    ctx->async->stop();
+  }
+
   ctx->stop_thread_pool();
 
   delete ctx;
@@ -267,6 +279,48 @@ LIBDE265_API de265_error de265_start_worker_threads(de265_decoder_context* de265
 }
 
 
+LIBDE265_API de265_thread_pool* de265_new_thread_pool(int number_of_threads)
+{
+  if (number_of_threads < 1) {
+    return NULL;
+  }
+
+  thread_pool* pool = new thread_pool;
+
+  de265_error err = start_thread_pool(pool, number_of_threads);
+  if (!de265_isOK(err)) {
+    stop_thread_pool(pool);
+    delete pool;
+    return NULL;
+  }
+
+  return (de265_thread_pool*)pool;
+}
+
+
+LIBDE265_API void de265_free_thread_pool(de265_thread_pool* de265pool)
+{
+  thread_pool* pool = (thread_pool*)de265pool;
+  if (pool == NULL) {
+    return;
+  }
+
+  stop_thread_pool(pool);
+  delete pool;
+}
+
+
+LIBDE265_API de265_error de265_attach_thread_pool(de265_decoder_context* de265ctx,
+                                                  de265_thread_pool* de265pool,
+                                                  int max_parallel_tasks)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+  thread_pool* pool = (thread_pool*)de265pool;
+
+  return ctx->attach_thread_pool(pool, max_parallel_tasks);
+}
+
+
 #ifndef LIBDE265_DISABLE_DEPRECATED
 LIBDE265_API de265_error de265_decode_data(de265_decoder_context* de265ctx,
                                            const void* data8, int len)
@@ -387,6 +441,96 @@ LIBDE265_API void de265_reset(de265_decoder_context* de265ctx)
 }
 
 
+LIBDE265_API de265_stream_index* de265_new_stream_index(void)
+{
+  return (de265_stream_index*)new stream_index;
+}
+
+
+LIBDE265_API void de265_free_stream_index(de265_stream_index* de265index)
+{
+  delete (stream_index*)de265index;
+}
+
+
+LIBDE265_API void de265_index_data(de265_stream_index* de265index, const void* data, int length,
+                                   de265_PTS pts)
+{
+  stream_index* index = (stream_index*)de265index;
+
+  index->push_data((const unsigned char*)data, length, pts);
+}
+
+
+LIBDE265_API void de265_index_end_of_stream(de265_stream_index* de265index)
+{
+  stream_index* index = (stream_index*)de265index;
+
+  index->flush_data();
+}
+
+
+LIBDE265_API int de265_get_number_of_random_access_points(const de265_stream_index* de265index)
+{
+  const stream_index* index = (const stream_index*)de265index;
+
+  return index->num_random_access_points();
+}
+
+
+LIBDE265_API const struct de265_random_access_point*
+de265_get_random_access_point(const de265_stream_index* de265index, int idx)
+{
+  const stream_index* index = (const stream_index*)de265index;
+
+  if (idx<0 || idx>=index->num_random_access_points()) {
+    return NULL;
+  }
+
+  return &index->get_random_access_point(idx);
+}
+
+
+LIBDE265_API int de265_find_random_access_point(const de265_stream_index* de265index, de265_PTS pts)
+{
+  const stream_index* index = (const stream_index*)de265index;
+
+  return index->find_random_access_point(pts);
+}
+
+
+LIBDE265_API de265_error de265_seek(de265_decoder_context* de265ctx,
+                                    const de265_stream_index* de265index,
+                                    de265_PTS pts, int64_t* out_byte_offset)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+  const stream_index* index = (const stream_index*)de265index;
+
+  ctx->reset();
+
+  int rapIdx = index->find_random_access_point(pts);
+  if (rapIdx<0) {
+    *out_byte_offset = 0;
+    return DE265_OK;
+  }
+
+  const de265_random_access_point& rap = index->get_random_access_point(rapIdx);
+
+  std::vector<const std::vector<unsigned char>*> paramsets = index->get_parameter_sets(rapIdx);
+  for (size_t i=0;i<paramsets.size();i++) {
+    de265_error err = ctx->nal_parser.push_NAL(paramsets[i]->data(), paramsets[i]->size(),
+                                               rap.pts, NULL);
+    if (err != DE265_OK) {
+      return err;
+    }
+  }
+
+  *out_byte_offset = rap.byte_offset;
+
+  return DE265_OK;
+}
+
+
 LIBDE265_API const struct de265_image* de265_get_next_picture(de265_decoder_context* de265ctx)
 {
   const struct de265_image* img = de265_peek_next_picture(de265ctx);
@@ -476,6 +620,123 @@ LIBDE265_API de265_error de265_get_warning(de265_decoder_context* de265ctx)
   return ctx->get_warning();
 }
 
+
+LIBDE265_API int de265_get_statistics(de265_decoder_context* de265ctx,
+                                      struct de265_statistics* stats)
+{
+#ifdef DE265_STATISTICS
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  ctx->statistics.get(stats);
+  return 1;
+#else
+  memset(stats, 0, sizeof(struct de265_statistics));
+  return 0;
+#endif
+}
+
+
+LIBDE265_API void de265_reset_statistics(de265_decoder_context* de265ctx)
+{
+#ifdef DE265_STATISTICS
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  ctx->statistics.reset();
+#endif
+}
+
+
+LIBDE265_API de265_error de265_write_trace(de265_decoder_context* de265ctx, const char* filename)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  bool success;
+  if (ctx->trace) {
+    success = ctx->trace->write(filename);
+  }
+  else {
+    task_trace emptyTrace;
+    success = emptyTrace.write(filename);
+  }
+
+  return success ? DE265_OK : DE265_ERROR_NO_SUCH_FILE;
+}
+
+
+LIBDE265_API de265_error de265_start_async_decoding(de265_decoder_context* de265ctx,
+                                                    int max_queued_bytes,
+                                                    de265_picture_ready_callback callback,
+                                                    void* callback_data)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  if (ctx->async == NULL) {
+    ctx->async = new async_decoder(ctx);
+  }
+
+  return ctx->async->start(max_queued_bytes, callback, callback_data);
+}
+
+
+LIBDE265_API de265_error de265_async_push_data(de265_decoder_context* de265ctx,
+                                               const void* data, int length,
+                                               de265_PTS pts, void* user_data)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  if (ctx->async == NULL) {
+    return DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE;
+  }
+
+  return ctx->async->push_data(data, length, pts, user_data, false);
+}
+
+
+LIBDE265_API de265_error de265_async_push_NAL(de265_decoder_context* de265ctx,
+                                              const void* data, int length,
+                                              de265_PTS pts, void* user_data)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  if (ctx->async == NULL) {
+    return DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE;
+  }
+
+  return ctx->async->push_data(data, length, pts, user_data, true);
+}
+
+
+LIBDE265_API void de265_async_flush_data(de265_decoder_context* de265ctx)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  if (ctx->async) {
+    ctx->async->flush_data();
+  }
+}
+
+
+LIBDE265_API de265_error de265_async_wait(de265_decoder_context* de265ctx)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  if (ctx->async == NULL) {
+    return DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE;
+  }
+
+  return ctx->async->wait();
+}
+
+
+LIBDE265_API void de265_stop_async_decoding(de265_decoder_context* de265ctx)
+{
+  decoder_context* ctx = (decoder_context*)de265ctx;
+
+  if (ctx->async) {
+    ctx->async->stop();
+  }
+}
+
 LIBDE265_API void de265_set_parameter_bool(de265_decoder_context* de265ctx, enum de265_param param, int value)
 {
   decoder_context* ctx = (decoder_context*)de265ctx;
@@ -498,6 +759,25 @@ LIBDE265_API void de265_set_parameter_bool(de265_decoder_context* de265ctx, enum
       ctx->param_disable_sao = !!value;
       break;
 
+    case DE265_DECODER_PARAM_PARSE_ONLY:
+      ctx->param_parse_only = !!value;
+      break;
+
+    case DE265_DECODER_PARAM_TRACE:
+      if (value && ctx->trace==NULL) {
+        ctx->trace = new task_trace;
+      }
+      ctx->param_trace = !!value;
+      break;
+
+    case DE265_DECODER_PARAM_BATCH_MC:
+      ctx->param_batch_mc = !!value;
+      break;
+
+    case DE265_DECODER_PARAM_DEFERRED_RECONSTRUCTION:
+      ctx->param_deferred_reconstruction = !!value;
+      break;
+
       /*
     case DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT:
       ctx->param_disable_mc_residual_idct = !!value;
@@ -541,6 +821,10 @@ LIBDE265_API void de265_set_parameter_int(de265_decoder_context* de265ctx, enum
       ctx->set_acceleration_functions((enum de265_acceleration)value);
       break;
 
+    case DE265_DECODER_PARAM_SKIP_PICTURES:
+      ctx->param_skip_pictures = (enum de265_skip_pictures)value;
+      break;
+
     default:
       assert(false);
       break;
@@ -568,6 +852,18 @@ LIBDE265_API int de265_get_parameter_bool(de265_decoder_context* de265ctx, enum
     case DE265_DECODER_PARAM_DISABLE_SAO:
       return ctx->param_disable_sao;
 
+    case DE265_DECODER_PARAM_PARSE_ONLY:
+      return ctx->param_parse_only;
+
+    case DE265_DECODER_PARAM_TRACE:
+      return ctx->param_trace;
+
+    case DE265_DECODER_PARAM_BATCH_MC:
+      return ctx->param_batch_mc;
+
+    case DE265_DECODER_PARAM_DEFERRED_RECONSTRUCTION:
+      return ctx->param_deferred_reconstruction;
+
       /*
     case DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT:
       return ctx->param_disable_mc_residual_idct;
@@ -708,4 +1004,51 @@ LIBDE265_API void de265_get_image_NAL_header(const struct de265_image* img,
   if (nuh_layer_id)    *nuh_layer_id    = img->nal_hdr.nuh_layer_id;
   if (nuh_temporal_id) *nuh_temporal_id = img->nal_hdr.nuh_temporal_id;
 }
+
+
+LIBDE265_API int de265_get_image_metadata(const struct de265_image* img,
+                                          enum de265_metadata_type type,
+                                          struct de265_metadata_array* out_array)
+{
+  return img->get_metadata(type, out_array);
+}
+
+LIBDE265_API int de265_get_metadata_index(const struct de265_metadata_array* array, int x,int y)
+{
+  const int unitX = x >> array->log2_unit_size;
+  const int unitY = y >> array->log2_unit_size;
+
+  const int log2TileSize = array->log2_tile_size;
+  const int tileMask = (1<<log2TileSize)-1;
+  const int widthInTiles = (array->width_in_units + tileMask) >> log2TileSize;
+
+  return ((((unitY>>log2TileSize)*widthInTiles + (unitX>>log2TileSize)) << (2*log2TileSize)) +
+          ((unitY & tileMask) << log2TileSize) + (unitX & tileMask));
+}
+
+LIBDE265_API int de265_get_image_reference_POC(const struct de265_image* img, int x,int y,
+                                               int list, int refIdx, int* out_poc)
+{
+  if (x<0 || y<0 || x>=img->get_width() || y>=img->get_height() ||
+      list<0 || list>1 || img->number_of_ctbs()==0) {
+    return 0;
+  }
+
+  const slice_segment_header* shdr = img->get_SliceHeader(x,y);
+  if (shdr==NULL) {
+    return 0;
+  }
+
+  // P slices keep the PPS default for num_ref_idx_l1_active, but have no list 1
+  int numRefIdx;
+  if (list==0) numRefIdx = shdr->num_ref_idx_l0_active;
+  else numRefIdx = (shdr->slice_type==SLICE_TYPE_B ? shdr->num_ref_idx_l1_active : 0);
+
+  if (refIdx<0 || refIdx>=numRefIdx) {
+    return 0;
+  }
+
+  *out_poc = shdr->RefPicList_POC[list][refIdx];
+  return 1;
+}
 }
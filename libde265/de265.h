@@ -99,6 +99,9 @@ typedef enum {
   DE265_ERROR_NO_INITIAL_SLICE_HEADER=16,
   DE265_ERROR_PREMATURE_END_OF_SLICE=17,
   DE265_ERROR_UNSPECIFIED_DECODING_ERROR=18,
+  DE265_ERROR_ASYNC_DECODING_NOT_ACTIVE=19,
+  DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED=20,
+  DE265_ERROR_ASYNC_DECODING_ALREADY_ACTIVE=21,
 
   // --- errors that should become obsolete in later libde265 versions ---
 
@@ -187,6 +190,64 @@ LIBDE265_API void de265_get_image_NAL_header(const struct de265_image*,
                                              int* nuh_temporal_id);
 
 
+/* --- block metadata ---
+
+   Direct access to the coding metadata that the decoder stores for each picture.
+   The arrays are not copied, they stay valid until the picture is released.
+   Each array covers the picture with (1<<log2_unit_size) square blocks.
+   The blocks are grouped into square tiles of (1<<log2_tile_size) units per side
+   (one CTB), which are stored one after another in raster order. Within each tile,
+   the units are again in raster order. Use de265_get_metadata_index() to find
+   the entry for a luma position.
+ */
+
+enum de265_metadata_type {
+  de265_metadata_coding_blocks = 0,   // struct de265_cb_info per minimum CB
+  de265_metadata_motion = 1,          // struct de265_motion_info per 4x4 block
+  de265_metadata_intra_pred_mode = 2, // uint8_t per minimum PU, luma intra mode [0;34]
+  de265_metadata_intra_pred_mode_chroma = 3, // uint8_t per minimum PU
+  de265_metadata_transform_tree = 4   // uint8_t per minimum TB, bit d: split_transform_flag at depth d,
+                                      //                         bit 7: TB has coefficients (luma)
+};
+
+struct de265_metadata_array {
+  const void* data;
+  int width_in_units;   // picture width in units
+  int height_in_units;
+  int log2_unit_size;
+  int log2_tile_size;   // in units, 0 for a plain raster
+};
+
+struct de265_cb_info {
+  uint8_t log2CbSize;     // only set in the top-left unit of the CB, zero elsewhere
+  uint8_t PartMode;       // enum PartMode: 2Nx2N,2NxN,Nx2N,NxN,2NxnU,2NxnD,nLx2N,nRx2N
+  uint8_t ctDepth;
+  uint8_t PredMode;       // 0: intra, 1: inter, 2: skip
+  uint8_t pcm_flag;
+  uint8_t cu_transquant_bypass;
+  int8_t  QP_Y;
+};
+
+struct de265_motion_info {
+  uint8_t predFlag[2];    // whether the L0 / L1 vector is used
+  int8_t  refIdx[2];      // index into the reference picture list of the slice
+  int16_t mv[2][2];       // [L0/L1][x/y] in quarter luma samples
+};
+
+/* Returns 0 if the metadata is not available for this picture. */
+LIBDE265_API int de265_get_image_metadata(const struct de265_image*, enum de265_metadata_type,
+                                          struct de265_metadata_array* out_array);
+
+/* Index of the entry for luma position (x,y) in the metadata array. */
+LIBDE265_API int de265_get_metadata_index(const struct de265_metadata_array*, int x,int y);
+
+/* POC of the picture that the motion vector at luma position (x,y) refers to.
+   Returns 0 and leaves 'out_poc' unchanged if the position is outside of the picture,
+   not yet decoded, or if 'list' or 'refIdx' is invalid for the slice at this position. */
+LIBDE265_API int de265_get_image_reference_POC(const struct de265_image*, int x,int y,
+                                               int list, int refIdx, int* out_poc);
+
+
 /* === decoder === */
 
 typedef void de265_decoder_context; // private structure
@@ -203,6 +264,29 @@ LIBDE265_API de265_error de265_start_worker_threads(de265_decoder_context*, int
 /* Free decoder context. May only be called once on a context. */
 LIBDE265_API de265_error de265_free_decoder(de265_decoder_context*);
 
+
+/* --- shared worker threads --- */
+
+typedef void de265_thread_pool; // private structure
+
+/* Create a pool of worker threads that can be shared by many decoder contexts.
+   Use this instead of de265_start_worker_threads() when decoding many streams in
+   parallel, such that the total number of threads stays independent of the number
+   of streams. Returns NULL if the threads could not be started. */
+LIBDE265_API de265_thread_pool* de265_new_thread_pool(int number_of_threads);
+
+/* Stop the threads and free the pool. All decoders that use the pool have to be
+   freed before. */
+LIBDE265_API void de265_free_thread_pool(de265_thread_pool*);
+
+/* Let the decoder use the threads of the shared pool. The pool serves its decoders
+   round-robin. At most 'max_parallel_tasks' tasks of this decoder are processed at
+   the same time (0 = no limit).
+   Cannot be combined with de265_start_worker_threads() on the same decoder.
+   Returns DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED if the decoder already uses a pool. */
+LIBDE265_API de265_error de265_attach_thread_pool(de265_decoder_context*, de265_thread_pool*,
+                                                  int max_parallel_tasks);
+
 #ifndef LIBDE265_DISABLE_DEPRECATED
 /* Push more data into the decoder, must be raw h265.
    All complete images in the data will be decoded, hence, do not push
@@ -297,6 +381,141 @@ LIBDE265_API void de265_release_next_picture(de265_decoder_context*);
 LIBDE265_API de265_error de265_get_warning(de265_decoder_context*);
 
 
+/* --- performance statistics ---
+
+   Only available when libde265 is compiled with DE265_STATISTICS
+   (configure --enable-statistics, cmake -DENABLE_STATISTICS=ON).
+   Times are in CPU time-stamp counter cycles on x86 and in nanoseconds on
+   other platforms, summed over all threads.
+ */
+
+struct de265_statistics
+{
+  uint64_t parsing_cycles;           // slice decoding without the prediction and residual stages
+                                     // (includes waiting for WPP dependencies)
+  uint64_t inter_prediction_cycles;  // motion compensation
+  uint64_t residual_cycles;          // dequantization, inverse transform, adding the residual
+  uint64_t intra_prediction_cycles;
+  uint64_t deblocking_cycles;
+  uint64_t sao_cycles;
+  uint64_t hash_check_cycles;        // SEI decoded picture hash
+  uint64_t wait_cycles;              // threads waiting for the decoding progress of other CTBs
+
+  uint64_t bins;           // decoded CABAC bins
+  uint64_t ctbs;           // decoded CTBs
+  uint64_t pictures;       // pictures started
+  uint64_t tasks_run;      // thread-pool tasks executed
+  uint64_t tasks_blocked;  // number of times that a task had to wait for another CTB
+};
+
+/* Returns 0 if libde265 was compiled without statistics support. */
+LIBDE265_API int  de265_get_statistics(de265_decoder_context*, struct de265_statistics*);
+LIBDE265_API void de265_reset_statistics(de265_decoder_context*);
+
+
+/* --- task trace ---
+
+   When DE265_DECODER_PARAM_TRACE is switched on, the decoder records when
+   each thread-pool task runs, when it waits for the progress of other CTBs,
+   and the time between the first slice of each picture and its output.
+   The timeline is written as Chrome trace_event JSON (chrome://tracing, Perfetto).
+   The trace is limited to one million events. Later events are dropped, their
+   number is written as "dropped_events".
+ */
+
+/* Write the events recorded so far. Should be called when the decoder is idle. */
+LIBDE265_API de265_error de265_write_trace(de265_decoder_context*, const char* filename);
+
+
+/* --- asynchronous decoding ---
+
+   Instead of calling de265_decode() in a loop, decoding can run on an internal
+   decode thread. Input data is queued with de265_async_push_data() or
+   de265_async_push_NAL() and each decoded picture is handed to the callback in
+   output order. The callback is called on the decode thread. The picture is
+   released after the callback returns.
+   While asynchronous decoding is active, the synchronous input, decoding and
+   output functions must not be used.
+   The callback must not push data into the decoder, wait for it or stop it:
+   these functions wait for the decode thread, which is blocked in the callback,
+   and would deadlock.
+ */
+
+typedef void (*de265_picture_ready_callback)(void* callback_data, const struct de265_image*);
+
+/* Start the decode thread. At most 'max_queued_bytes' of input data are queued.
+   When the queue is full, de265_async_push_data() blocks until the decoder has
+   consumed enough data.
+   Returns DE265_ERROR_ASYNC_DECODING_ALREADY_ACTIVE if the decode thread is
+   already running. */
+LIBDE265_API de265_error de265_start_async_decoding(de265_decoder_context*, int max_queued_bytes,
+                                                    de265_picture_ready_callback callback,
+                                                    void* callback_data);
+
+/* The data is copied into the input queue. */
+LIBDE265_API de265_error de265_async_push_data(de265_decoder_context*, const void* data, int length,
+                                               de265_PTS pts, void* user_data);
+LIBDE265_API de265_error de265_async_push_NAL(de265_decoder_context*, const void* data, int length,
+                                              de265_PTS pts, void* user_data);
+
+/* Indicate the end-of-stream. The remaining pictures are decoded and output. */
+LIBDE265_API void de265_async_flush_data(de265_decoder_context*);
+
+/* Wait until all queued data has been decoded. After de265_async_flush_data(),
+   this also waits until all pictures have been passed to the callback.
+   Returns the first decoding error (or DE265_OK). */
+LIBDE265_API de265_error de265_async_wait(de265_decoder_context*);
+
+/* Stop the decode thread. Input data that is still queued is discarded.
+   Afterwards, the decoder can be used synchronously again (call de265_reset()
+   to discard the decoder state). */
+LIBDE265_API void de265_stop_async_decoding(de265_decoder_context*);
+
+
+/* --- random access --- */
+
+typedef void de265_stream_index; // private structure
+
+struct de265_random_access_point
+{
+  int64_t   byte_offset;    // start of the access unit (including its parameter sets) in the byte stream
+  de265_PTS pts;            // PTS of the data that contained the IRAP picture
+  int       poc;            // POC of the IRAP picture when decoding starts there
+  int       nal_unit_type;  // IDR, CRA or BLA
+  int       picture_number; // index of the picture in decoding order
+};
+
+/* Create an index of the random access points (IRAP pictures) in a raw h265 bytestream.
+   Must be freed with de265_free_stream_index(). */
+LIBDE265_API de265_stream_index* de265_new_stream_index(void);
+LIBDE265_API void de265_free_stream_index(de265_stream_index*);
+
+/* Scan the next part of the bytestream. Only NAL headers, parameter sets and the
+   beginning of slice headers are parsed, slices are not decoded.
+   As in de265_push_data(), the PTS is assigned to all NALs whose start-code is
+   contained in the data. Call de265_index_end_of_stream() after the last data.
+ */
+LIBDE265_API void de265_index_data(de265_stream_index*, const void* data, int length,
+                                   de265_PTS pts);
+LIBDE265_API void de265_index_end_of_stream(de265_stream_index*);
+
+LIBDE265_API int de265_get_number_of_random_access_points(const de265_stream_index*);
+LIBDE265_API const struct de265_random_access_point*
+                 de265_get_random_access_point(const de265_stream_index*, int idx);
+
+/* Index of the last random access point with a PTS <= 'pts', -1 if there is none. */
+LIBDE265_API int de265_find_random_access_point(const de265_stream_index*, de265_PTS pts);
+
+/* Prepare the decoder to continue decoding at the random access point preceding 'pts'.
+   The decoder is reset and the parameter sets that are active at this point are pushed
+   into the decoder. Leading RASL pictures of the IRAP picture are skipped.
+   Continue with pushing the bytestream from 'out_byte_offset' on.
+   If there is no random access point before 'pts', decoding restarts at offset 0.
+ */
+LIBDE265_API de265_error de265_seek(de265_decoder_context*, const de265_stream_index*,
+                                    de265_PTS pts, int64_t* out_byte_offset);
+
+
 enum de265_image_format {
   de265_image_format_mono8    = 1,
   de265_image_format_YUV420P8 = 2,
@@ -382,9 +601,27 @@ enum de265_param {
   DE265_DECODER_PARAM_SUPPRESS_FAULTY_PICTURES=6, // (bool)  do not output frames with decoding errors, default: no (output all images)
 
   DE265_DECODER_PARAM_DISABLE_DEBLOCKING=7,   // (bool)  disable deblocking
-  DE265_DECODER_PARAM_DISABLE_SAO=8           // (bool)  disable SAO filter
+  DE265_DECODER_PARAM_DISABLE_SAO=8,          // (bool)  disable SAO filter
   //DE265_DECODER_PARAM_DISABLE_MC_RESIDUAL_IDCT=9,     // (bool)  disable decoding of IDCT residuals in MC blocks
   //DE265_DECODER_PARAM_DISABLE_INTRA_RESIDUAL_IDCT=10  // (bool)  disable decoding of IDCT residuals in MC blocks
+
+  DE265_DECODER_PARAM_SKIP_PICTURES=11,       // (int)  enum de265_skip_pictures, default: NONE
+  DE265_DECODER_PARAM_PARSE_ONLY=12,          // (bool) only parse the bitstream and derive the motion vectors,
+                                              //        the block metadata is available, but no pixels are reconstructed
+  DE265_DECODER_PARAM_TRACE=13,               // (bool) record a timeline of the decoding tasks (see de265_write_trace())
+  DE265_DECODER_PARAM_BATCH_MC=14,            // (bool) do the motion compensation of all PBs of a CTB in one batch,
+                                              //        sorted by reference picture and with prefetching, default: no
+  DE265_DECODER_PARAM_DEFERRED_RECONSTRUCTION=15 // (bool) parse a CTB completely before reconstructing it. Without WPP/tiles,
+                                              //        the reconstruction runs in parallel to parsing on the worker threads.
+};
+
+/* Pictures that are dropped before their slice data is parsed.
+   Can be changed at any time, e.g. to skip non-reference pictures under load.
+ */
+enum de265_skip_pictures {
+  de265_skip_pictures_NONE = 0,          // decode all pictures
+  de265_skip_pictures_NON_REFERENCE = 1, // skip sub-layer non-reference pictures of the highest sub-layer
+  de265_skip_pictures_NON_IRAP = 2       // decode only IRAP pictures (keyframes), e.g. for thumbnails
 };
 
 // sorted such that a large ID includes all optimizations from lower IDs
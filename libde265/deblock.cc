@@ -24,6 +24,7 @@
 #include "de265.h"
 
 #include <assert.h>
+#include <string.h>
 
 
 
@@ -46,16 +47,26 @@ void markTransformBlockBoundary(de265_image* img, int x0,int y0,
     markTransformBlockBoundary(img,x1,y1,log2TrafoSize-1,trafoDepth+1, DEBLOCK_FLAG_VERTI, DEBLOCK_FLAG_HORIZ);
   }
   else {
+    // TBs lie within the picture and within one CTB, write the flags directly
+
+    uint8_t* flags = img->get_deblk_flags_ptr(x0>>2,y0>>2);
+    const int stride = img->get_deblk_tile_size();
+    const int n = 1<<(log2TrafoSize-2);
+
     // VER
 
-    for (int k=0;k<(1<<log2TrafoSize);k+=4) {
-      img->set_deblk_flags(x0,y0+k, filterLeftCbEdge);
+    if (filterLeftCbEdge) {
+      for (int k=0;k<n;k++) {
+        flags[k*stride] |= filterLeftCbEdge;
+      }
     }
 
     // HOR
 
-    for (int k=0;k<(1<<log2TrafoSize);k+=4) {
-      img->set_deblk_flags(x0+k,y0, filterTopCbEdge);
+    if (filterTopCbEdge) {
+      for (int k=0;k<n;k++) {
+        flags[k] |= filterTopCbEdge;
+      }
     }
   }
 }
@@ -78,44 +89,44 @@ void markPredictionBlockBoundary(de265_image* img, int x0,int y0,
 
   switch (partMode) {
   case PART_NxN:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+cbSize2,y0+k, DEBLOCK_PB_EDGE_VERTI);
       img->set_deblk_flags(x0+k,y0+cbSize2, DEBLOCK_PB_EDGE_HORIZ);
     }
     break;
 
   case PART_Nx2N:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+cbSize2,y0+k, DEBLOCK_PB_EDGE_VERTI);
     }
     break;
 
   case PART_2NxN:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+k,y0+cbSize2, DEBLOCK_PB_EDGE_HORIZ);
     }
     break;
 
   case PART_nLx2N:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+cbSize4,y0+k, DEBLOCK_PB_EDGE_VERTI);
     }
     break;
 
   case PART_nRx2N:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+cbSize2+cbSize4,y0+k, DEBLOCK_PB_EDGE_VERTI);
     }
     break;
 
   case PART_2NxnU:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+k,y0+cbSize4, DEBLOCK_PB_EDGE_HORIZ);
     }
     break;
 
   case PART_2NxnD:
-    for (int k=0;k<cbSize;k++) {
+    for (int k=0;k<cbSize;k+=4) {
       img->set_deblk_flags(x0+k,y0+cbSize2+cbSize4, DEBLOCK_PB_EDGE_HORIZ);
     }
     break;
@@ -237,140 +248,150 @@ bool derive_edgeFlags(de265_image* img)
 }
 
 
+// 8.7.2.4, bS of an edge between two inter blocks without coded residual at the edge
+static int derive_motion_boundaryStrength(de265_image* img, int xDiOpp,int yDiOpp, int xDi,int yDi)
+{
+  int bS = 0;
+
+  const PBMotion& mviP = img->get_mv_info(xDiOpp,yDiOpp);
+  const PBMotion& mviQ = img->get_mv_info(xDi   ,yDi);
+
+  slice_segment_header* shdrP = img->get_SliceHeader(xDiOpp,yDiOpp);
+  slice_segment_header* shdrQ = img->get_SliceHeader(xDi   ,yDi);
+
+  // shortcut for edges inside a region with the same motion (e.g. transform edges within a PB)
+
+  if (shdrP == shdrQ && mviP == mviQ) {
+    return 0;
+  }
+
+  int refPicP0 = mviP.predFlag[0] ? shdrP->RefPicList[0][ mviP.refIdx[0] ] : -1;
+  int refPicP1 = mviP.predFlag[1] ? shdrP->RefPicList[1][ mviP.refIdx[1] ] : -1;
+  int refPicQ0 = mviQ.predFlag[0] ? shdrQ->RefPicList[0][ mviQ.refIdx[0] ] : -1;
+  int refPicQ1 = mviQ.predFlag[1] ? shdrQ->RefPicList[1][ mviQ.refIdx[1] ] : -1;
+
+  bool samePics = ((refPicP0==refPicQ0 && refPicP1==refPicQ1) ||
+                   (refPicP0==refPicQ1 && refPicP1==refPicQ0));
+
+  if (!samePics) {
+    bS = 1;
+  }
+  else {
+    MotionVector mvP0 = mviP.mv[0]; if (!mviP.predFlag[0]) { mvP0.x=mvP0.y=0; }
+    MotionVector mvP1 = mviP.mv[1]; if (!mviP.predFlag[1]) { mvP1.x=mvP1.y=0; }
+    MotionVector mvQ0 = mviQ.mv[0]; if (!mviQ.predFlag[0]) { mvQ0.x=mvQ0.y=0; }
+    MotionVector mvQ1 = mviQ.mv[1]; if (!mviQ.predFlag[1]) { mvQ1.x=mvQ1.y=0; }
+
+    int numMV_P = mviP.predFlag[0] + mviP.predFlag[1];
+    int numMV_Q = mviQ.predFlag[0] + mviQ.predFlag[1];
+
+    if (numMV_P!=numMV_Q) {
+      img->decctx->add_warning(DE265_WARNING_NUMMVP_NOT_EQUAL_TO_NUMMVQ, false);
+      img->integrity = INTEGRITY_DECODING_ERRORS;
+    }
+
+    // two different reference pictures or only one reference picture
+    if (refPicP0 != refPicP1) {
+
+      if (refPicP0 == refPicQ0) {
+        if (abs_value(mvP0.x-mvQ0.x) >= 4 ||
+            abs_value(mvP0.y-mvQ0.y) >= 4 ||
+            abs_value(mvP1.x-mvQ1.x) >= 4 ||
+            abs_value(mvP1.y-mvQ1.y) >= 4) {
+          bS = 1;
+        }
+      }
+      else {
+        if (abs_value(mvP0.x-mvQ1.x) >= 4 ||
+            abs_value(mvP0.y-mvQ1.y) >= 4 ||
+            abs_value(mvP1.x-mvQ0.x) >= 4 ||
+            abs_value(mvP1.y-mvQ0.y) >= 4) {
+          bS = 1;
+        }
+      }
+    }
+    else {
+      assert(refPicQ0==refPicQ1);
+
+      if ((abs_value(mvP0.x-mvQ0.x) >= 4 ||
+           abs_value(mvP0.y-mvQ0.y) >= 4 ||
+           abs_value(mvP1.x-mvQ1.x) >= 4 ||
+           abs_value(mvP1.y-mvQ1.y) >= 4)
+          &&
+          (abs_value(mvP0.x-mvQ1.x) >= 4 ||
+           abs_value(mvP0.y-mvQ1.y) >= 4 ||
+           abs_value(mvP1.x-mvQ0.x) >= 4 ||
+           abs_value(mvP1.y-mvQ0.y) >= 4)) {
+        bS = 1;
+      }
+    }
+  }
+
+  return bS;
+}
+
+
 // 8.7.2.3 (both, EDGE_VER and EDGE_HOR)
 void derive_boundaryStrength(de265_image* img, bool vertical, int yStart,int yEnd,
                              int xStart,int xEnd)
 {
-  int xIncr = vertical ? 2 : 1;
   int yIncr = vertical ? 1 : 2;
   int xOffs = vertical ? 1 : 0;
   int yOffs = vertical ? 0 : 1;
-  int edgeMask = vertical ?
+  uint8_t edgeMask = vertical ?
     (DEBLOCK_FLAG_VERTI | DEBLOCK_PB_EDGE_VERTI) :
     (DEBLOCK_FLAG_HORIZ | DEBLOCK_PB_EDGE_HORIZ);
-  int transformEdgeMask = vertical ? DEBLOCK_FLAG_VERTI : DEBLOCK_FLAG_HORIZ;
+  uint8_t transformEdgeMask = vertical ? DEBLOCK_FLAG_VERTI : DEBLOCK_FLAG_HORIZ;
 
   xEnd = libde265_min(xEnd,img->get_deblk_width());
   yEnd = libde265_min(yEnd,img->get_deblk_height());
 
-  int TUShift = img->get_sps().Log2MinTrafoSize;
-  int TUStride= img->get_sps().PicWidthInTbsY;
+  const acceleration_functions& accel = img->decctx->acceleration;
 
-  for (int y=yStart;y<yEnd;y+=yIncr)
-    for (int x=xStart;x<xEnd;x+=xIncr) {
-      int xDi = x<<2;
-      int yDi = y<<2;
-
-      logtrace(LogDeblock,"%d %d %s = %s\n",xDi,yDi, vertical?"Vertical":"Horizontal",
-               (img->get_deblk_flags(xDi,yDi) & edgeMask) ? "edge" : "...");
-
-      uint8_t edgeFlags = img->get_deblk_flags(xDi,yDi);
-
-      if (edgeFlags & edgeMask) {
-        bool p_is_intra_pred = (img->get_pred_mode(xDi-xOffs, yDi-yOffs) == MODE_INTRA);
-        bool q_is_intra_pred = (img->get_pred_mode(xDi,       yDi      ) == MODE_INTRA);
-
-        int bS;
+  // The flags of a row of units within a CTB are stored contiguously.
+  // Process them in runs up to the CTB border.
 
-        if (p_is_intra_pred || q_is_intra_pred) {
-          bS = 2;
-        }
-        else {
-          // opposing site
-          int xDiOpp = xDi-xOffs;
-          int yDiOpp = yDi-yOffs;
-
-          if ((edgeFlags & transformEdgeMask) &&
-              (img->get_nonzero_coefficient(xDi   ,yDi) ||
-               img->get_nonzero_coefficient(xDiOpp,yDiOpp))) {
-            bS = 1;
-          }
-          else {
+  const int runMask = img->get_deblk_tile_size()-1;
+  assert(runMask < 16);
 
-            bS = 0;
-
-            const PBMotion& mviP = img->get_mv_info(xDiOpp,yDiOpp);
-            const PBMotion& mviQ = img->get_mv_info(xDi   ,yDi);
-
-            slice_segment_header* shdrP = img->get_SliceHeader(xDiOpp,yDiOpp);
-            slice_segment_header* shdrQ = img->get_SliceHeader(xDi   ,yDi);
+  for (int y=yStart;y<yEnd;y+=yIncr)
+    for (int x=xStart;x<xEnd; ) {
+      const int n = libde265_min((x | runMask) + 1, xEnd) - x;
 
-            int refPicP0 = mviP.predFlag[0] ? shdrP->RefPicList[0][ mviP.refIdx[0] ] : -1;
-            int refPicP1 = mviP.predFlag[1] ? shdrP->RefPicList[1][ mviP.refIdx[1] ] : -1;
-            int refPicQ0 = mviQ.predFlag[0] ? shdrQ->RefPicList[0][ mviQ.refIdx[0] ] : -1;
-            int refPicQ1 = mviQ.predFlag[1] ? shdrQ->RefPicList[1][ mviQ.refIdx[1] ] : -1;
+      uint8_t* q = img->get_deblk_flags_ptr(x,y);
+      const uint8_t* p;
+      uint8_t pLeft[16];
 
-            bool samePics = ((refPicP0==refPicQ0 && refPicP1==refPicQ1) ||
-                             (refPicP0==refPicQ1 && refPicP1==refPicQ0));
+      uint32_t posMask = (1<<n)-1;
 
-            if (!samePics) {
-              bS = 1;
-            }
-            else {
-              MotionVector mvP0 = mviP.mv[0]; if (!mviP.predFlag[0]) { mvP0.x=mvP0.y=0; }
-              MotionVector mvP1 = mviP.mv[1]; if (!mviP.predFlag[1]) { mvP1.x=mvP1.y=0; }
-              MotionVector mvQ0 = mviQ.mv[0]; if (!mviQ.predFlag[0]) { mvQ0.x=mvQ0.y=0; }
-              MotionVector mvQ1 = mviQ.mv[1]; if (!mviQ.predFlag[1]) { mvQ1.x=mvQ1.y=0; }
+      if (vertical) {
+        // the opposite units are the ones to the left, the first one is in the previous CTB
 
-              int numMV_P = mviP.predFlag[0] + mviP.predFlag[1];
-              int numMV_Q = mviQ.predFlag[0] + mviQ.predFlag[1];
+        pLeft[0] = (x>0 ? *img->get_deblk_flags_ptr(x-1,y) : 0);
+        memcpy(pLeft+1, q, n-1);
+        p = pLeft;
 
-              if (numMV_P!=numMV_Q) {
-                img->decctx->add_warning(DE265_WARNING_NUMMVP_NOT_EQUAL_TO_NUMMVQ, false);
-                img->integrity = INTEGRITY_DECODING_ERRORS;
-              }
+        // vertical edges are on the 8x8 grid, i.e. every second unit
 
-              // two different reference pictures or only one reference picture
-              if (refPicP0 != refPicP1) {
+        posMask &= (x & 1) ? 0xAAAA : 0x5555;
+      }
+      else {
+        p = (y>0 ? img->get_deblk_flags_ptr(x,y-1) : q);
+      }
 
-                if (refPicP0 == refPicQ0) {
-                  if (abs_value(mvP0.x-mvQ0.x) >= 4 ||
-                      abs_value(mvP0.y-mvQ0.y) >= 4 ||
-                      abs_value(mvP1.x-mvQ1.x) >= 4 ||
-                      abs_value(mvP1.y-mvQ1.y) >= 4) {
-                    bS = 1;
-                  }
-                }
-                else {
-                  if (abs_value(mvP0.x-mvQ1.x) >= 4 ||
-                      abs_value(mvP0.y-mvQ1.y) >= 4 ||
-                      abs_value(mvP1.x-mvQ0.x) >= 4 ||
-                      abs_value(mvP1.y-mvQ0.y) >= 4) {
-                    bS = 1;
-                  }
-                }
-              }
-              else {
-                assert(refPicQ0==refPicQ1);
-
-                if ((abs_value(mvP0.x-mvQ0.x) >= 4 ||
-                     abs_value(mvP0.y-mvQ0.y) >= 4 ||
-                     abs_value(mvP1.x-mvQ1.x) >= 4 ||
-                     abs_value(mvP1.y-mvQ1.y) >= 4)
-                    &&
-                    (abs_value(mvP0.x-mvQ1.x) >= 4 ||
-                     abs_value(mvP0.y-mvQ1.y) >= 4 ||
-                     abs_value(mvP1.x-mvQ0.x) >= 4 ||
-                     abs_value(mvP1.y-mvQ0.y) >= 4)) {
-                  bS = 1;
-                }
-              }
-            }
+      uint32_t motionMask = accel.deblock_boundary_strength(q,p,n, posMask,
+                                                            edgeMask, transformEdgeMask);
 
-            /*
-              printf("unimplemented deblocking code for CU at %d;%d\n",xDi,yDi);
+      for (int i=0; motionMask; i++, motionMask>>=1) {
+        if (motionMask & 1) {
+          const int xDi = (x+i)<<2;
+          const int yDi = y<<2;
 
-              logerror(LogDeblock, "unimplemented code reached (file %s, line %d)\n",
-              __FILE__, __LINE__);
-            */
-          }
+          q[i] |= derive_motion_boundaryStrength(img, xDi-xOffs,yDi-yOffs, xDi,yDi);
         }
-
-        img->set_deblk_bS(xDi,yDi, bS);
-      }
-      else {
-        img->set_deblk_bS(xDi,yDi, 0);
       }
+
+      x += n;
     }
 }
 
@@ -916,6 +937,8 @@ void thread_task_deblock_CTBRow::work()
   state = Running;
   img->thread_run(this);
 
+  STATISTICS_COUNT(img->decctx, tasks_run, 1);
+
   int xStart=0;
   int xEnd = img->get_deblk_width();
 
@@ -955,6 +978,8 @@ void thread_task_deblock_CTBRow::work()
 
   //printf("deblock %d to %d orientation: %d\n",first,last,vertical);
 
+  STATISTICS_TIMER(img->decctx, StageDeblocking);
+
   bool deblocking_enabled;
 
   // first pass: check edge flags and whether we have to deblock
@@ -981,7 +1006,7 @@ void thread_task_deblock_CTBRow::work()
 
   for (int x=0;x<=rightCtb;x++) {
     const int CtbWidth = img->get_sps().PicWidthInCtbsY;
-    img->ctb_progress[x+ctb_y*CtbWidth].set_progress(finalProgress);
+    img->ctb_progress.set_progress(x+ctb_y*CtbWidth, finalProgress);
   }
 
   state = Finished;
@@ -1010,7 +1035,7 @@ void add_deblocking_tasks(image_unit* imgunit)
           task->vertical = (pass==0);
 
           imgunit->tasks.push_back(task);
-          add_task(&ctx->thread_pool_, task);
+          ctx->add_task(task);
           n++;
         }
     }
@@ -1021,6 +1046,8 @@ void apply_deblocking_filter(de265_image* img) // decoder_context* ctx)
 {
   decoder_context* ctx = img->decctx;
 
+  STATISTICS_TIMER(ctx, StageDeblocking);
+
   char enabled_deblocking = derive_edgeFlags(img);
 
   if (enabled_deblocking)
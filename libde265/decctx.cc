@@ -19,10 +19,12 @@
  */
 
 #include "decctx.h"
+#include "async-decoder.h"
 #include "util.h"
 #include "sao.h"
 #include "sei.h"
 #include "deblock.h"
+#include "border.h"
 
 #include <string.h>
 #include <assert.h>
@@ -40,6 +42,10 @@
 #include "x86/sse.h"
 #endif
 
+#ifdef HAVE_AVX2
+#include "x86/avx2.h"
+#endif
+
 #ifdef HAVE_ARM
 #include "arm/arm.h"
 #endif
@@ -121,6 +127,10 @@ thread_context::thread_context()
   imgunit = NULL;
   sliceunit = NULL;
 
+  defer_reconstruction = false;
+  reconstruct_in_background = false;
+  recon_tctx = NULL;
+
 
   //memset(this,0,sizeof(thread_context));
 
@@ -142,6 +152,12 @@ thread_context::thread_context()
 }
 
 
+thread_context::~thread_context()
+{
+  delete recon_tctx;
+}
+
+
 slice_unit::slice_unit(decoder_context* decctx)
   : nal(NULL),
     shdr(NULL),
@@ -214,6 +230,11 @@ decoder_context::decoder_context()
 
   param_disable_deblocking = false;
   param_disable_sao = false;
+  param_skip_pictures = de265_skip_pictures_NONE;
+  param_parse_only = false;
+  param_trace = false;
+  param_batch_mc = false;
+  param_deferred_reconstruction = false;
   //param_disable_mc_residual_idct = false;
   //param_disable_intra_residual_idct = false;
 
@@ -240,6 +261,11 @@ decoder_context::decoder_context()
 
   //memset(&thread_pool,0,sizeof(struct thread_pool));
   num_worker_threads = 0;
+  shared_thread_pool = NULL;
+  shared_pool_max_tasks = 0;
+
+  async = NULL;
+  trace = NULL;
 
 
   // frame-rate
@@ -318,6 +344,9 @@ decoder_context::decoder_context()
 
 decoder_context::~decoder_context()
 {
+  delete async;
+  delete trace;
+
   while (!image_units.empty()) {
     delete image_units.back();
     image_units.pop_back();
@@ -343,7 +372,16 @@ void decoder_context::set_image_allocation_functions(de265_image_allocation* all
 
 de265_error decoder_context::start_thread_pool(int nThreads)
 {
+  if (shared_thread_pool) {
+    return DE265_ERROR_CANNOT_START_THREADPOOL;
+  }
+
+  if (task_queue_.pool != NULL) {
+    return DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED;
+  }
+
   ::start_thread_pool(&thread_pool_, nThreads);
+  attach_task_queue(&thread_pool_, &task_queue_, 0);
 
   num_worker_threads = nThreads;
 
@@ -351,21 +389,56 @@ de265_error decoder_context::start_thread_pool(int nThreads)
 }
 
 
+de265_error decoder_context::attach_thread_pool(thread_pool* pool, int maxParallelTasks)
+{
+  if (shared_thread_pool) {
+    return DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED;
+  }
+
+  if (num_worker_threads>0) {
+    return DE265_ERROR_CANNOT_START_THREADPOOL;
+  }
+
+  if (maxParallelTasks<0) {
+    maxParallelTasks=0;
+  }
+
+  de265_error err = attach_task_queue(pool, &task_queue_, maxParallelTasks);
+  if (err != DE265_OK) {
+    return err;
+  }
+
+  shared_thread_pool    = pool;
+  shared_pool_max_tasks = maxParallelTasks;
+
+  // The number of threads that can work for us.
+  // It is only used to decide whether to decode multi-threaded at all.
+
+  num_worker_threads = pool->num_threads;
+  if (maxParallelTasks>0 && maxParallelTasks<num_worker_threads) {
+    num_worker_threads = maxParallelTasks;
+  }
+
+  return DE265_OK;
+}
+
+
 void decoder_context::stop_thread_pool()
 {
   if (get_num_worker_threads()>0) {
     //flush_thread_pool(&ctx->thread_pool);
-    ::stop_thread_pool(&thread_pool_);
+    detach_task_queue(&task_queue_);
+
+    if (!shared_thread_pool) {
+      ::stop_thread_pool(&thread_pool_);
+    }
   }
 }
 
 
 void decoder_context::reset()
 {
-  if (num_worker_threads>0) {
-    //flush_thread_pool(&ctx->thread_pool);
-    ::stop_thread_pool(&thread_pool_);
-  }
+  stop_thread_pool();
 
   // --------------------------------------------------
 
@@ -424,34 +497,50 @@ void decoder_context::reset()
 
   // --- start threads again ---
 
-  if (num_worker_threads>0) {
+  if (shared_thread_pool) {
+    // cannot fail, the queue was detached in stop_thread_pool() above
+    attach_task_queue(shared_thread_pool, &task_queue_, shared_pool_max_tasks);
+  }
+  else if (num_worker_threads>0) {
     // TODO: need error checking
     start_thread_pool(num_worker_threads);
   }
 }
 
-void base_context::set_acceleration_functions(enum de265_acceleration l)
+void init_acceleration_functions(struct acceleration_functions* accel,
+                                 enum de265_acceleration l)
 {
   // fill scalar functions first (so that function table is completely filled)
 
-  init_acceleration_functions_fallback(&acceleration);
+  init_acceleration_functions_fallback(accel);
 
 
   // override functions with optimized variants
 
 #ifdef HAVE_SSE4_1
   if (l>=de265_acceleration_SSE) {
-    init_acceleration_functions_sse(&acceleration);
+    init_acceleration_functions_sse(accel);
+  }
+#endif
+#ifdef HAVE_AVX2
+  if (l>=de265_acceleration_AVX2) {
+    init_acceleration_functions_avx2(accel);
   }
 #endif
 #ifdef HAVE_ARM
   if (l>=de265_acceleration_ARM) {
-    init_acceleration_functions_arm(&acceleration);
+    init_acceleration_functions_arm(accel);
   }
 #endif
 }
 
 
+void base_context::set_acceleration_functions(enum de265_acceleration l)
+{
+  init_acceleration_functions(&acceleration, l);
+}
+
+
 void decoder_context::init_thread_context(thread_context* tctx)
 {
   // zero scrap memory for coefficient blocks
@@ -460,6 +549,10 @@ void decoder_context::init_thread_context(thread_context* tctx)
   tctx->currentQG_x = -1;
   tctx->currentQG_y = -1;
 
+  tctx->defer_reconstruction = (param_deferred_reconstruction && !param_parse_only);
+  tctx->reconstruct_in_background = false;
+  tctx->recon_queue.clear();
+
 
 
   // --- find QPY that was active at the end of the previous slice ---
@@ -504,7 +597,21 @@ void decoder_context::add_task_decode_CTB_row(thread_context* tctx,
   task->debug_startCtbRow = ctbRow;
   tctx->task = task;
 
-  add_task(&thread_pool_, task);
+  add_task(task);
+
+  tctx->imgunit->tasks.push_back(task);
+}
+
+
+void decoder_context::add_task_reconstruct_CTBs(thread_context* tctx, int ctbRow)
+{
+  thread_task_reconstruct_CTBs* task = new thread_task_reconstruct_CTBs;
+  task->img = tctx->img;
+  task->debug_ctbRow = ctbRow;
+  task->queue.swap(tctx->recon_queue);
+
+  tctx->img->thread_start(1);
+  add_task(task);
 
   tctx->imgunit->tasks.push_back(task);
 }
@@ -520,7 +627,7 @@ void decoder_context::add_task_decode_slice_segment(thread_context* tctx, bool f
   task->debug_startCtbY = ctby;
   tctx->task = task;
 
-  add_task(&thread_pool_, task);
+  add_task(task);
 
   tctx->imgunit->tasks.push_back(task);
 }
@@ -765,8 +872,14 @@ de265_error decoder_context::decode_some(bool* did_work)
 
     if (img->decctx->num_worker_threads)
       run_postprocessing_filters_parallel(imgunit);
-    else
+    else {
+      task_trace_scope traceScope(get_trace(), "postprocessing", "decoder");
       run_postprocessing_filters_sequential(imgunit->img);
+    }
+
+    // keep the 16x16 motion field for temporal MV prediction in later pictures
+
+    imgunit->img->compress_motion_field();
 
     // process suffix SEIs
 
@@ -779,6 +892,10 @@ de265_error decoder_context::decode_some(bool* did_work)
     }
 
 
+    if (get_trace()) {
+      get_trace()->async_end("picture", "picture", imgunit->img->get_ID());
+    }
+
     push_picture_to_output_queue(imgunit);
 
     // remove just decoded image unit from queue
@@ -797,6 +914,8 @@ de265_error decoder_context::decode_slice_unit_sequential(image_unit* imgunit,
 {
   de265_error err = DE265_OK;
 
+  task_trace_scope traceScope(get_trace(), "slice", "decoder");
+
   /*
   printf("decode slice POC=%d addr=%d, img=%p\n",
          sliceunit->shdr->slice_pic_order_cnt_lsb,
@@ -840,8 +959,25 @@ de265_error decoder_context::decode_slice_unit_sequential(image_unit* imgunit,
 
   sliceunit->nThreads=1;
 
+  // Without WPP or tiles, we can still reconstruct the previous CTB row
+  // in the background while parsing the next one.
+
+  tctx.reconstruct_in_background = (tctx.defer_reconstruction && num_worker_threads > 0);
+
   err=read_slice_segment_data(&tctx);
 
+  if (tctx.reconstruct_in_background) {
+    if (!tctx.recon_queue.empty()) {
+      add_task_reconstruct_CTBs(&tctx, tctx.CtbY);
+    }
+
+    imgunit->img->wait_for_completion();
+
+    for (size_t i=0;i<imgunit->tasks.size();i++)
+      delete imgunit->tasks[i];
+    imgunit->tasks.clear();
+  }
+
   sliceunit->finished_threads.set_progress(1);
 
   return err;
@@ -872,7 +1008,7 @@ void decoder_context::mark_whole_slice_as_processed(image_unit* imgunit,
         if (ctb >= imgunit->img->number_of_ctbs())
           break;
 
-        imgunit->img->ctb_progress[ctb].set_progress(progress);
+        imgunit->img->ctb_progress.set_progress(ctb, progress);
       }
   }
 }
@@ -906,6 +1042,7 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
 
   // TODO: remove this warning later when we do frame-parallel decoding
   if (img->decctx->num_worker_threads > 0 &&
+      !param_deferred_reconstruction &&
       pps.entropy_coding_sync_enabled_flag == false &&
       pps.tiles_enabled_flag == false) {
 
@@ -922,7 +1059,7 @@ de265_error decoder_context::decode_slice_unit_parallel(image_unit* imgunit,
 
     for (int ctb=0;ctb<firstCTB;ctb++) {
       //printf("mark pre progress %d\n",ctb);
-      img->ctb_progress[ctb].set_progress(CTB_PROGRESS_PREFILTER);
+      img->ctb_progress.set_progress(ctb, CTB_PROGRESS_PREFILTER);
     }
   }
 
@@ -1181,6 +1318,25 @@ de265_error decoder_context::decode_slice_unit_tiles(image_unit* imgunit,
 }
 
 
+bool decoder_context::skip_picture(const nal_header& nal_hdr) const
+{
+  switch (param_skip_pictures) {
+  case de265_skip_pictures_NON_IRAP:
+    return !isIRAP(nal_hdr.nal_unit_type);
+
+  case de265_skip_pictures_NON_REFERENCE:
+    // Sub-layer non-reference pictures may still be referenced by pictures of higher
+    // sub-layers. Only in the highest decoded sub-layer, nothing depends on them.
+
+    return (isSublayerNonReference(nal_hdr.nal_unit_type) &&
+            nal_hdr.nuh_temporal_id >= std::min(current_HighestTid, get_highest_TID()));
+
+  default:
+    return false;
+  }
+}
+
+
 de265_error decoder_context::decode_NAL(NAL_unit* nal)
 {
   //return decode_NAL_OLD(nal);
@@ -1226,6 +1382,19 @@ de265_error decoder_context::decode_NAL(NAL_unit* nal)
   }
 
 
+  // RASL pictures associated with an IRAP picture at which decoding started
+  // reference pictures that are not available. Skip them without decoding.
+
+  if (isRASL(nal_hdr.nal_unit_type) && NoRaslOutputFlag) {
+    nal_parser.free_NAL_unit(nal);
+    return DE265_OK;
+  }
+
+  if (nal_hdr.nal_unit_type<32 && skip_picture(nal_hdr)) {
+    nal_parser.free_NAL_unit(nal);
+    return DE265_OK;
+  }
+
   if (nal_hdr.nal_unit_type<32) {
     err = read_slice_NAL(reader, nal, nal_hdr);
   }
@@ -1425,7 +1594,11 @@ int decoder_context::generate_unavailable_reference_picture(const seq_parameter_
                   1<<(sps->BitDepth_C-1),
                   1<<(sps->BitDepth_C-1));
 
+  img->extend_borders(0, img->get_height());
+  img->set_borders_extended(true);
+
   img->fill_pred_mode(MODE_INTRA);
+  img->compress_motion_field();
 
   img->PicOrderCntVal = POC;
   img->picture_order_cnt_lsb = POC & (sps->MaxPicOrderCntLsb-1);
@@ -1876,6 +2049,10 @@ void decoder_context::run_postprocessing_filters_sequential(de265_image* img)
     write_picture_to_file(img, buf);
 #endif
 
+    if (img->decctx->param_parse_only) {
+      return;
+    }
+
     if (!img->decctx->param_disable_deblocking) {
       apply_deblocking_filter(img);
     }
@@ -1893,6 +2070,9 @@ void decoder_context::run_postprocessing_filters_sequential(de265_image* img)
     sprintf(buf,"sao-%05d.yuv", img->PicOrderCntVal);
     write_picture_to_file(img, buf);
 #endif
+
+    img->extend_borders(0, img->get_height());
+    img->set_borders_extended(true);
 }
 
 
@@ -1901,19 +2081,42 @@ void decoder_context::run_postprocessing_filters_parallel(image_unit* imgunit)
   de265_image* img = imgunit->img;
 
   int saoWaitsForProgress = CTB_PROGRESS_PREFILTER;
-  bool waitForCompletion = false;
+  bool saoTasksAdded = false;
+  bool borderTasksAdded = false;
 
-  if (!img->decctx->param_disable_deblocking) {
+  const bool parseOnly = img->decctx->param_parse_only;
+
+  if (!img->decctx->param_disable_deblocking && !parseOnly) {
     add_deblocking_tasks(imgunit);
     saoWaitsForProgress = CTB_PROGRESS_DEBLK_H;
   }
 
-  if (!img->decctx->param_disable_sao) {
-    waitForCompletion |= add_sao_tasks(imgunit, saoWaitsForProgress);
+  if (!img->decctx->param_disable_sao && !parseOnly) {
+    saoTasksAdded = add_sao_tasks(imgunit, saoWaitsForProgress);
     //apply_sample_adaptive_offset(img);
   }
 
+  // fill the picture border behind the last filter stage
+
+  if (!parseOnly) {
+    if (saoTasksAdded) {
+      borderTasksAdded = add_border_extension_tasks(imgunit, &imgunit->sao_output,
+                                                    CTB_PROGRESS_SAO);
+    }
+    else {
+      borderTasksAdded = add_border_extension_tasks(imgunit, img, saoWaitsForProgress);
+    }
+  }
+
   img->wait_for_completion();
+
+  if (saoTasksAdded) {
+    img->exchange_pixel_data_with(imgunit->sao_output);
+  }
+
+  if (borderTasksAdded) {
+    img->set_borders_extended(true);
+  }
 }
 
 /*
@@ -2008,7 +2211,8 @@ bool decoder_context::process_slice_segment_header(slice_segment_header* hdr,
     // --- find and allocate image buffer for decoding ---
 
     int image_buffer_idx;
-    bool isOutputImage = (!sps->sample_adaptive_offset_enabled_flag || param_disable_sao);
+    bool isOutputImage = (!sps->sample_adaptive_offset_enabled_flag || param_disable_sao ||
+                          param_parse_only);
     image_buffer_idx = dpb.new_image(current_sps, this, pts, user_data, isOutputImage);
     if (image_buffer_idx == -1) {
       *err = DE265_ERROR_IMAGE_BUFFER_FULL;
@@ -2024,6 +2228,14 @@ bool decoder_context::process_slice_segment_header(slice_segment_header* hdr,
 
     img->decctx = this;
 
+#ifdef DE265_STATISTICS
+    statistics.pictures.fetch_add(1, std::memory_order_relaxed);
+#endif
+
+    if (get_trace()) {
+      get_trace()->async_begin("picture", "picture", img->get_ID());
+    }
+
     img->clear_metadata();
 
 
@@ -2036,8 +2248,13 @@ bool decoder_context::process_slice_segment_header(slice_segment_header* hdr,
           NoRaslOutputFlag = true;
           FirstAfterEndOfSequenceNAL = false;
         }
-      else if (0) // TODO: set HandleCraAsBlaFlag by external means
+      else if (param_skip_pictures == de265_skip_pictures_NON_IRAP)
         {
+          // the leading pictures of the CRA are skipped and the pictures
+          // preceding it may not have been decoded
+
+          NoRaslOutputFlag   = true;
+          HandleCraAsBlaFlag = true;
         }
       else
         {
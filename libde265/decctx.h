@@ -32,6 +32,8 @@
 #include "libde265/dpb.h"
 #include "libde265/sei.h"
 #include "libde265/threads.h"
+#include "libde265/statistics.h"
+#include "libde265/trace.h"
 #include "libde265/acceleration.h"
 #include "libde265/nal-parser.h"
 
@@ -48,12 +50,95 @@ class slice_segment_header;
 class image_unit;
 class slice_unit;
 class decoder_context;
+class async_decoder;
+class thread_context;
+
+
+/* Intermediate data between parsing and reconstruction (param_deferred_reconstruction).
+   The parser records the PBs to predict and the transform blocks with their
+   coefficients and quantization parameters in decoding order. reconstruct()
+   replays them afterwards to generate the pixels, possibly in another thread.
+ */
+class reconstruction_queue
+{
+ public:
+  bool empty() const { return commands.empty(); }
+  void clear();
+  void swap(reconstruction_queue& q);
+
+  void add_prediction(const slice_segment_header* shdr,
+                      int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH,
+                      const PBMotion& vi);
+
+  void add_transform_block(const thread_context* tctx,
+                           int x0,int y0, int xCUBase,int yCUBase,
+                           int nT, int cIdx, enum PredMode cuPredMode, bool cbf);
+
+  void start_CTB(int ctbAddrRS);
+
+  /* Reconstruct all queued CTBs, using 'rtctx' for the scratch buffers.
+     With a 'task', wait for the neighboring CTBs and mark the progress of each CTB.
+   */
+  void reconstruct(thread_context* rtctx, thread_task* task);
+
+ private:
+  enum command_type { StartOfCTB, PredictPB, TransformBlock };
+
+  struct pb_command {
+    const slice_segment_header* shdr;
+    int16_t xC,yC;
+    uint8_t xB,yB;
+    uint8_t nCS, nPbW,nPbH;
+    PBMotion motion;
+  };
+
+  struct tb_command {
+    int16_t x0,y0;           // position of TB in frame (chroma adapted)
+    int16_t xCUBase,yCUBase; // position of CU in frame (chroma adapted)
+    uint8_t nT, cIdx, cuPredMode, cbf;
+    uint8_t transform_skip_flag;
+    uint8_t cu_transquant_bypass_flag;
+    uint8_t explicit_rdpcm_flag, explicit_rdpcm_dir;
+    int8_t  qP;
+    int8_t  ResScaleVal;
+    uint8_t coeffBoxW, coeffBoxH;
+    int16_t nCoeff;
+    int     firstCoeff;      // index into coeffList/coeffPos
+  };
+
+  struct command {
+    uint8_t type;
+
+    union {
+      pb_command pb;
+      tb_command tb;
+      int ctbAddrRS;
+    };
+  };
+
+  std::vector<command> commands;
+  std::vector<int16_t> coeffList;
+  std::vector<int16_t> coeffPos;
+};
+
+
+class thread_task_reconstruct_CTBs : public thread_task
+{
+public:
+  de265_image* img;
+  int    debug_ctbRow;
+  reconstruction_queue queue;
+
+  virtual void work();
+  virtual std::string name() const;
+};
 
 
 class thread_context
 {
 public:
   thread_context();
+  ~thread_context();
 
   int CtbAddrInRS;
   int CtbAddrInTS;
@@ -65,6 +150,16 @@ public:
 
   PBMotionCoding motion;
 
+  inter_prediction_batch mc_batch; // PBs whose MC is deferred (param_batch_mc)
+
+
+  // deferred reconstruction
+
+  bool defer_reconstruction;      // record into recon_queue instead of reconstructing
+  bool reconstruct_in_background; // reconstruct complete CTB rows in separate tasks
+  reconstruction_queue recon_queue;
+  thread_context* recon_tctx;     // scratch context for reconstructing recon_queue, allocated on first use
+
 
   // prediction
 
@@ -87,6 +182,8 @@ public:
   int16_t coeffList[3][32*32];
   int16_t coeffPos[3][32*32];
   int16_t nCoeff[3];
+  uint8_t coeffBoxW[3]; // all non-zero coefficients are within the top-left coeffBoxW x coeffBoxH area
+  uint8_t coeffBoxH[3];
 
   int32_t residual_luma[32*32]; // only used when cross-comp-prediction is enabled
 
@@ -270,6 +367,10 @@ public:
 };
 
 
+// Fill the function table with the fastest implementations available up to level 'l'.
+void init_acceleration_functions(struct acceleration_functions*, enum de265_acceleration l);
+
+
 class base_context : public error_queue
 {
  public:
@@ -294,6 +395,7 @@ class decoder_context : public base_context {
   ~decoder_context();
 
   de265_error start_thread_pool(int nThreads);
+  de265_error attach_thread_pool(thread_pool* pool, int maxParallelTasks); // use a shared pool
   void        stop_thread_pool();
 
   void reset();
@@ -330,6 +432,7 @@ class decoder_context : public base_context {
 
 
   void process_nal_hdr(nal_header*);
+  bool skip_picture(const nal_header&) const; // drop slice NAL according to param_skip_pictures
 
   bool process_slice_segment_header(slice_segment_header*,
                                     de265_error*, de265_PTS pts,
@@ -355,6 +458,12 @@ class decoder_context : public base_context {
   //bool param_disable_mc_residual_idct;  // not implemented yet
   //bool param_disable_intra_residual_idct;  // not implemented yet
 
+  enum de265_skip_pictures param_skip_pictures;
+  bool param_parse_only;  // no reconstruction of the pixels, only the metadata
+  bool param_trace;
+  bool param_batch_mc;    // motion compensation per CTB instead of per PB
+  bool param_deferred_reconstruction; // parse each CTB completely before reconstructing it
+
   void set_image_allocation_functions(de265_image_allocation* allocfunc, void* userdata);
 
   de265_image_allocation param_image_allocation_functions;
@@ -397,13 +506,34 @@ class decoder_context : public base_context {
   std::shared_ptr<pic_parameter_set>    current_pps;
 
  public:
-  thread_pool thread_pool_;
+  thread_task_queue task_queue_;  // our tasks, executed by the own or a shared thread pool
+
+  void add_task(thread_task* task) { ::add_task(&task_queue_, task); }
+
+  // reconstruct the CTBs queued in the thread context in a background task
+  void add_task_reconstruct_CTBs(thread_context* tctx, int ctbRow);
 
  private:
+  thread_pool  thread_pool_;         // own thread pool (de265_start_worker_threads)
+  thread_pool* shared_thread_pool;   // not owned, NULL if not attached to a shared pool
+  int          shared_pool_max_tasks;
+
   int num_worker_threads;
 
 
  public:
+  async_decoder* async;  // decode thread (de265_start_async_decoding), NULL if not used
+
+#ifdef DE265_STATISTICS
+  decoder_statistics statistics;
+#endif
+
+  task_trace* trace;  // allocated when tracing is switched on for the first time
+
+  bool        trace_enabled() const { return param_trace; }
+  task_trace* get_trace() const { return param_trace ? trace : NULL; }
+
+
   // --- frame dropping ---
 
   void set_limit_TID(int tid);
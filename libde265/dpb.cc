@@ -208,6 +208,16 @@ int decoded_picture_buffer::new_image(std::shared_ptr<const seq_parameter_set> s
   loginfo(LogHeaders,"DPB::new_image\n");
   log_dpb_content();
 
+  // --- reference pictures that have been output only need their compressed motion field ---
+
+  for (size_t i=0;i<dpb.size();i++) {
+    if (dpb[i]->PicOutputFlag==false &&
+        dpb[i]->PicState != UnusedForReference) {
+      dpb[i]->release_full_motion_field();
+    }
+  }
+
+
   // --- search for a free slot in the DPB ---
 
   int free_image_buffer_idx = -1;
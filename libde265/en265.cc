@@ -220,7 +220,7 @@ LIBDE265_API de265_error en265_push_image(en265_encoder_context* e,
   assert(e);
   encoder_context* ectx = (encoder_context*)e;
 
-  ectx->sop->insert_new_input_image(img);
+  ectx->push_input_image(img);
   return DE265_OK;
 }
 
@@ -230,7 +230,7 @@ LIBDE265_API de265_error en265_push_eof(en265_encoder_context* e)
   assert(e);
   encoder_context* ectx = (encoder_context*)e;
 
-  ectx->sop->insert_end_of_stream();
+  ectx->push_end_of_stream();
   return DE265_OK;
 }
 
@@ -260,7 +260,7 @@ LIBDE265_API de265_error en265_encode(en265_encoder_context* e)
   assert(e);
   encoder_context* ectx = (encoder_context*)e;
 
-  while (ectx->picbuf.have_more_frames_to_encode())
+  while (ectx->have_picture_ready_for_encoding())
     {
       de265_error result = ectx->encode_picture_from_input_buffer();
       if (result != DE265_OK) return result;
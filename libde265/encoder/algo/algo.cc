@@ -26,6 +26,9 @@
 #include <stdarg.h>
 
 
+const float split_rd_threshold_factor[4] = { 0.0f, 0.25f, 0.5f, 1.0f };
+
+
 
 #ifdef DE265_LOG_DEBUG
 static int descendLevel = 0;
@@ -42,6 +42,13 @@
    after running this algorithm.
  */
 
+/* Early termination of the CB and TB split decisions: splitting is not tested when
+   the RD cost of the unsplit block is below factor*lambda per pixel.
+   Indexed with the RDThreshold option (off, low, medium, high).
+ */
+extern const float split_rd_threshold_factor[4];
+
+
 class Algo
 {
  public:
@@ -80,6 +80,92 @@ enc_cb* Algo_CB_Split::encode_cb_split(encoder_context* ectx,
 }
 
 
+void Algo_CB_Split_BruteForce::restrict_by_neighbor_depths(const encoder_context* ectx,
+                                                           const enc_cb* cb,
+                                                           bool& can_split,
+                                                           bool& can_nosplit) const
+{
+  const de265_image* img = ectx->img;
+  const int x0 = cb->x;
+  const int y0 = cb->y;
+  const int size = 1<<cb->log2Size;
+  const int ctbMask = (1<<ectx->get_sps().Log2CtbSizeY)-1;
+
+  int xN[4] = { x0-1, x0,   x0-1, x0+size };
+  int yN[4] = { y0,   y0-1, y0-1, y0-1    };
+
+  // Above-right is only coded already when it lies in the CTB row above.
+  int nNeighbors = ((y0 & ctbMask)==0 && x0+size < img->get_width()) ? 4 : 3;
+
+  int minDepth = 4, maxDepth = -1;
+  int nAvailable = 0;
+
+  for (int i=0;i<nNeighbors;i++) {
+    if (!check_CTB_available(img, x0,y0, xN[i],yN[i])) {
+      continue;
+    }
+
+    const enc_cb* cbN = ectx->ctbs.getCB(xN[i],yN[i]);
+    if (cbN==NULL) {
+      continue;
+    }
+
+    minDepth = libde265_min(minDepth, (int)cbN->ctDepth);
+    maxDepth = libde265_max(maxDepth, (int)cbN->ctDepth);
+    nAvailable++;
+  }
+
+  // a single neighbor is not a reliable prediction
+  if (nAvailable<2) {
+    return;
+  }
+
+  if (mParams.depthRange() == ALGO_CB_Split_DepthRange_neighbors) {
+    minDepth--;
+    maxDepth++;
+  }
+
+  if (cb->ctDepth < minDepth) can_nosplit=false;
+  if (cb->ctDepth >= maxDepth) can_split=false;
+}
+
+
+void Algo_CB_Split_BruteForce::restrict_by_variance(const encoder_context* ectx,
+                                                    const enc_cb* cb,
+                                                    bool& can_split) const
+{
+  const de265_image* input = ectx->imgdata->input;
+  const int w = input->get_width();
+  const int h = input->get_height();
+
+  const int size = 1<<cb->log2Size;
+  const int bw = libde265_min(size, w - cb->x);
+  const int bh = libde265_min(size, h - cb->y);
+
+  const uint8_t* p = input->get_image_plane_at_pos(0, cb->x,cb->y);
+  const int stride = input->get_image_stride(0);
+
+  int64_t sum=0, sum2=0;
+  for (int y=0;y<bh;y++) {
+    for (int x=0;x<bw;x++) {
+      int v = p[y*stride+x];
+      sum  += v;
+      sum2 += v*v;
+    }
+  }
+
+  const int n = bw*bh;
+  const double variance = (sum2 - (double)sum*sum/n) / n;
+
+  /* The quantization noise energy per pixel is roughly lambda. Blocks that
+     are flatter than that cannot gain anything from a split. */
+
+  const double factor = (mParams.variance() == ALGO_CB_Split_Variance_aggressive ? 4.0 : 1.0);
+
+  if (variance < factor * ectx->lambda) {
+    can_split = false;
+  }
+}
 
 
 enc_cb* Algo_CB_Split_BruteForce::analyze(encoder_context* ectx,
@@ -101,6 +187,18 @@ enc_cb* Algo_CB_Split_BruteForce::analyze(encoder_context* ectx,
   //if (can_split_CB) { can_nosplit_CB=false; } // TODO TMP
   //if (can_nosplit_CB) { can_split_CB=false; } // TODO TMP
 
+  // --- fast decisions before coding ---
+
+  if (split_type == OptionalSplit &&
+      mParams.depthRange() != ALGO_CB_Split_DepthRange_off) {
+    restrict_by_neighbor_depths(ectx, cb_input, can_split_CB, can_nosplit_CB);
+  }
+
+  if (can_split_CB && can_nosplit_CB &&
+      mParams.variance() != ALGO_CB_Split_Variance_off) {
+    restrict_by_variance(ectx, cb_input, can_split_CB);
+  }
+
   CodingOptions<enc_cb> options(ectx, cb_input, ctxModel);
 
   CodingOption<enc_cb> option_no_split = options.new_option(can_nosplit_CB);
@@ -108,6 +206,8 @@ enc_cb* Algo_CB_Split_BruteForce::analyze(encoder_context* ectx,
 
   options.start();
 
+  bool test_split = can_split_CB;
+
   /*
   cb_input->writeSurroundingMetadata(ectx, ectx->img,
                                      enc_node::METADATA_CT_DEPTH, // for estimation cb-split bits
@@ -147,15 +247,32 @@ enc_cb* Algo_CB_Split_BruteForce::analyze(encoder_context* ectx,
 
     opt.set_node(cb);
     opt.end();
+
+
+    // --- early termination ---
+
+    if (mParams.earlySkip() == ALGO_CB_Split_EarlySkip_on &&
+        cb->PredMode == MODE_SKIP) {
+      test_split = false;
+    }
+
+    if (mParams.rdThreshold() != ALGO_CB_Split_RDThreshold_off) {
+      float rdCost = cb->distortion + ectx->lambda * cb->rate;
+      float area   = 1<<(2*cb->log2Size);
+
+      if (rdCost < split_rd_threshold_factor[mParams.rdThreshold()] * ectx->lambda * area) {
+        test_split = false;
+      }
+    }
   }
 
   // --- encode with splitting ---
 
-  if (option_split) {
+  if (option_split && test_split) {
     option_split.begin();
 
+    // cb_input may have been deleted by the no-split analysis. begin() has linked the node.
     enc_cb* cb = option_split.get_node();
-    *cb_input->downPtr = cb;
 
     cb = encode_cb_split(ectx, option_split.get_context(), cb);
 
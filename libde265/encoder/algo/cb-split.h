@@ -75,14 +75,125 @@ class Algo_CB_Split : public Algo_CB
 };
 
 
+/* Fast-decision variants. All of them are off by default, which gives the
+   full brute-force search. They can be combined freely.
+ */
+
+enum ALGO_CB_Split_RDThreshold {
+  // Do not test the split when the RD cost of the unsplit CB is below
+  // a threshold (relative to lambda, per pixel).
+  ALGO_CB_Split_RDThreshold_off,
+  ALGO_CB_Split_RDThreshold_low,
+  ALGO_CB_Split_RDThreshold_medium,
+  ALGO_CB_Split_RDThreshold_high
+};
+
+class option_ALGO_CB_Split_RDThreshold : public choice_option<enum ALGO_CB_Split_RDThreshold>
+{
+ public:
+  option_ALGO_CB_Split_RDThreshold() {
+    add_choice("off"    ,ALGO_CB_Split_RDThreshold_off, true);
+    add_choice("low"    ,ALGO_CB_Split_RDThreshold_low);
+    add_choice("medium" ,ALGO_CB_Split_RDThreshold_medium);
+    add_choice("high"   ,ALGO_CB_Split_RDThreshold_high);
+  }
+};
+
+
+enum ALGO_CB_Split_EarlySkip {
+  // Do not test the split when the unsplit CB is coded in SKIP mode.
+  ALGO_CB_Split_EarlySkip_off,
+  ALGO_CB_Split_EarlySkip_on
+};
+
+class option_ALGO_CB_Split_EarlySkip : public choice_option<enum ALGO_CB_Split_EarlySkip>
+{
+ public:
+  option_ALGO_CB_Split_EarlySkip() {
+    add_choice("off" ,ALGO_CB_Split_EarlySkip_off, true);
+    add_choice("on"  ,ALGO_CB_Split_EarlySkip_on);
+  }
+};
+
+
+enum ALGO_CB_Split_DepthRange {
+  // Restrict the tested CB depths to the range of depths of the already coded
+  // neighbors (left, above, above-left, above-right).
+  ALGO_CB_Split_DepthRange_off,
+  ALGO_CB_Split_DepthRange_neighbors,       // neighbor range extended by one level
+  ALGO_CB_Split_DepthRange_neighbors_strict // exactly the neighbor range
+};
+
+class option_ALGO_CB_Split_DepthRange : public choice_option<enum ALGO_CB_Split_DepthRange>
+{
+ public:
+  option_ALGO_CB_Split_DepthRange() {
+    add_choice("off"       ,ALGO_CB_Split_DepthRange_off, true);
+    add_choice("neighbors" ,ALGO_CB_Split_DepthRange_neighbors);
+    add_choice("strict"    ,ALGO_CB_Split_DepthRange_neighbors_strict);
+  }
+};
+
+
+enum ALGO_CB_Split_Variance {
+  // Do not test the split when the input luma block is flat (low variance
+  // compared to the quantization noise).
+  ALGO_CB_Split_Variance_off,
+  ALGO_CB_Split_Variance_conservative,
+  ALGO_CB_Split_Variance_aggressive
+};
+
+class option_ALGO_CB_Split_Variance : public choice_option<enum ALGO_CB_Split_Variance>
+{
+ public:
+  option_ALGO_CB_Split_Variance() {
+    add_choice("off"          ,ALGO_CB_Split_Variance_off, true);
+    add_choice("conservative" ,ALGO_CB_Split_Variance_conservative);
+    add_choice("aggressive"   ,ALGO_CB_Split_Variance_aggressive);
+  }
+};
+
+
 class Algo_CB_Split_BruteForce : public Algo_CB_Split
 {
  public:
+  struct params
+  {
+    params() {
+      rdThreshold.set_ID("CB-Split-RDThreshold");
+      earlySkip.set_ID("CB-Split-EarlySkip");
+      depthRange.set_ID("CB-Split-DepthRange");
+      variance.set_ID("CB-Split-Variance");
+    }
+
+    option_ALGO_CB_Split_RDThreshold rdThreshold;
+    option_ALGO_CB_Split_EarlySkip   earlySkip;
+    option_ALGO_CB_Split_DepthRange  depthRange;
+    option_ALGO_CB_Split_Variance    variance;
+  };
+
+  void setParams(const params& p) { mParams=p; }
+
+  void registerParams(config_parameters& config) {
+    config.add_option(&mParams.rdThreshold);
+    config.add_option(&mParams.earlySkip);
+    config.add_option(&mParams.depthRange);
+    config.add_option(&mParams.variance);
+  }
+
   virtual enc_cb* analyze(encoder_context*,
                           context_model_table&,
                           enc_cb* cb);
 
   const char* name() const { return "cb-split-bruteforce"; }
+
+ private:
+  params mParams;
+
+  void restrict_by_neighbor_depths(const encoder_context* ectx, const enc_cb* cb,
+                                   bool& can_split, bool& can_nosplit) const;
+  void restrict_by_variance(const encoder_context* ectx, const enc_cb* cb,
+                            bool& can_split) const;
 };
 
 #endif
@@ -156,6 +156,11 @@ node* CodingOptions<node>::return_best_rdo_node()
 
   *mContextModelInput = mOptions[bestRDO].context;
 
+  // relink the best node into the coding tree (it may not have been the last one evaluated)
+
+  node* bestNode = mOptions[bestRDO].mNode;
+  *(bestNode->downPtr) = bestNode;
+
 
   // delete all CBs except the best one
 
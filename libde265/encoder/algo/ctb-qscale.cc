@@ -31,9 +31,9 @@
 #define ENCODER_DEVELOPMENT 1
 
 
-enc_cb* Algo_CTB_QScale_Constant::analyze(encoder_context* ectx,
-                                          context_model_table& ctxModel,
-                                          int x,int y)
+enc_cb* Algo_CTB_QScale::analyze_with_qp(encoder_context* ectx,
+                                         context_model_table& ctxModel,
+                                         int x,int y, int qp)
 {
   enc_cb* cb = new enc_cb();
 
@@ -41,21 +41,402 @@ enc_cb* Algo_CTB_QScale_Constant::analyze(encoder_context* ectx,
   cb->ctDepth = 0;
   cb->x = x;
   cb->y = y;
-  cb->downPtr = ectx->ctbs.getCTBRootPointer(x,y);
+  enc_cb** rootPtr = ectx->ctbs.getCTBRootPointer(x,y);
+
+  cb->downPtr = rootPtr;
   *cb->downPtr = cb;
 
-  cb->qp = ectx->active_qp;
+  cb->qp = qp;
 
   // write currently unused coding options
   cb->cu_transquant_bypass_flag = false;
   cb->pcm_flag = false;
 
   assert(mChildAlgo);
-  descend(cb, "Q=%d",ectx->active_qp);
+  descend(cb, "Q=%d",qp);
   enc_cb* result_cb = mChildAlgo->analyze(ectx,ctxModel,cb);
   ascend();
 
-  *cb->downPtr = result_cb;
+  // 'cb' may have been replaced (and deleted) by the child algorithm
+  *rootPtr = result_cb;
 
   return result_cb;
 }
+
+
+enc_cb* Algo_CTB_QScale_Constant::analyze(encoder_context* ectx,
+                                          context_model_table& ctxModel,
+                                          int x,int y)
+{
+  return analyze_with_qp(ectx,ctxModel, x,y, ectx->active_qp);
+}
+
+
+
+// ========== rate control ==========
+
+/* The rate model follows the usual approach of relating the number of bits
+   of a frame to its (low-resolution SATD) cost and its quantizer scale:
+
+     bits = coeff * cost / qscale
+
+   The quantizer scale of a frame is chosen as  qscale = rceq(cost) / rateFactor,
+   with  rceq(cost) = cost^(1-qcomp). A qcomp<1 spends more bits on complex
+   frames, but less than would be required to keep the same QP.
+ */
+
+static const double RC_QCOMP = 0.6;
+static const double RC_IP_FACTOR = 1.4;       // qscale ratio between P and I frames
+static const double RC_PREDICTOR_DECAY = 0.5;
+static const double RC_PREDICTOR_INIT = 0.1;  // initial bits*qscale/cost (see end_picture())
+static const double RC_BASE_CPLX_PER_BLOCK = 320.0; // typical cost of a low-resolution 8x8 block
+
+static double qp2qscale(double qp) { return 0.85 * pow(2.0, (qp-12.0)/6.0); }
+static double qscale2qp(double qscale) { return 12.0 + 6.0 * log2(qscale/0.85); }
+
+
+void Algo_CTB_QScale_RateControl::predictor::update(double cost, double qscale, double bits)
+{
+  if (cost < 1) {
+    return;
+  }
+
+  double oldCoeff  = coeff  / count;
+  double oldOffset = offset / count;
+
+  /* Fit the coefficient, but do not let it jump too far. The rest goes into the offset.
+     This keeps the predictor sane for almost static frames, where most of the bits
+     are overhead that does not depend on the cost. */
+
+  double newCoeff = libde265_max((bits*qscale - oldOffset) / cost, 0.0);
+  double newCoeffClipped = Clip3(oldCoeff*0.5, oldCoeff*2.0, newCoeff);
+  double newOffset = bits*qscale - newCoeffClipped*cost;
+
+  if (newOffset >= 0) {
+    newCoeff = newCoeffClipped;
+  }
+  else {
+    newOffset = 0;
+  }
+
+  coeff  = coeff *RC_PREDICTOR_DECAY + newCoeff;
+  offset = offset*RC_PREDICTOR_DECAY + newOffset;
+  count  = count *RC_PREDICTOR_DECAY + 1;
+}
+
+
+Algo_CTB_QScale_RateControl::Algo_CTB_QScale_RateControl()
+{
+  mMethod = RateControlMethod_CRF;
+  mLookaheadLength = 0;
+  mInitialized = false;
+}
+
+
+int Algo_CTB_QScale_RateControl::getPPS_QP() const
+{
+  if (mMethod == RateControlMethod_CRF) {
+    return mParams.mCRF;
+  }
+  else {
+    return 26;
+  }
+}
+
+
+void Algo_CTB_QScale_RateControl::init(const encoder_context* ectx, const image_data* imgdata)
+{
+  const lookahead_frame* frame = ectx->lookahead.get_frame(imgdata->frame_number);
+  assert(frame);
+
+  double fps = mParams.mFrameRate;
+  double bitrate = mParams.mBitrate * 1000.0;
+
+  mBitsPerFrame = bitrate / fps;
+
+  mVBVMaxRate = (mParams.mMaxBitrate > 0 ? mParams.mMaxBitrate * 1000.0 : bitrate);
+  mVBVBufferSize = mParams.mBufferSize * 1000.0;
+
+  if (mMethod == RateControlMethod_CBR) {
+    // CBR is a VBV buffer that is filled at the target rate
+
+    mVBVMaxRate = bitrate;
+    if (mVBVBufferSize == 0) {
+      mVBVBufferSize = bitrate;
+    }
+  }
+
+  double baseCplx = frame->num_blocks * RC_BASE_CPLX_PER_BLOCK;
+  mRateFactorCRF = pow(baseCplx, 1.0-RC_QCOMP) / qp2qscale(mParams.mCRF);
+
+  for (int i=0;i<2;i++) {
+    mPredictor[i].coeff = RC_PREDICTOR_INIT;
+    mPredictor[i].offset = 0;
+    mPredictor[i].count = 1.0;
+    mLastQScale[i] = 0;
+  }
+
+  mBufferFill = mVBVBufferSize * mParams.mBufferInit / 100.0;
+  mTotalBits = 0;
+  mWantedBitsTotal = 0;
+  mCplxrSum = 0;
+  mWantedBitsWindow = 0;
+  mShortTermCplxSum = 0;
+  mShortTermCplxCount = 0;
+
+  mInitialized = true;
+}
+
+
+double Algo_CTB_QScale_RateControl::rceq(double cost, bool is_intra) const
+{
+  double q = pow(cost, 1.0-RC_QCOMP);
+  if (is_intra) {
+    q /= RC_IP_FACTOR;
+  }
+
+  return q;
+}
+
+
+static double get_frame_cost(const lookahead_frame* frame)
+{
+  // never let a frame have zero cost, the qscale would become zero as well
+  return libde265_max(frame->get_cost(), frame->num_blocks);
+}
+
+
+int Algo_CTB_QScale_RateControl::begin_picture(encoder_context* ectx, const image_data* imgdata)
+{
+  if (!mInitialized) {
+    init(ectx, imgdata);
+  }
+
+  std::vector<const lookahead_frame*> frames;
+  frames = ectx->lookahead.get_frames(imgdata->frame_number, mLookaheadLength+1);
+  assert(!frames.empty());
+  assert(frames[0]->frame_number == imgdata->frame_number);
+
+  const bool isIntra = frames[0]->is_intra;
+  const double cost  = get_frame_cost(frames[0]);
+
+  /* Almost static frames are mostly overhead. They should not drag down the
+     complexity estimate or the QP of the following frames. */
+  const bool isStatic = (frames[0]->get_cost() < 2*frames[0]->num_blocks);
+
+
+  // smooth the complexity of P frames over a few frames to avoid QP fluctuations
+
+  double blurredCost = cost;
+  if (!isIntra && !isStatic) {
+    mShortTermCplxSum   = mShortTermCplxSum*0.5   + cost;
+    mShortTermCplxCount = mShortTermCplxCount*0.5 + 1;
+    blurredCost = mShortTermCplxSum / mShortTermCplxCount;
+  }
+
+  const double rceqCurr = rceq(blurredCost, isIntra);
+
+
+  // --- rate factor ---
+
+  double rateFactor;
+  double overflow = 1.0;
+
+  if (mMethod == RateControlMethod_CRF) {
+    rateFactor = mRateFactorCRF;
+  }
+  else {
+    /* Distribute the bits over the already coded frames (decaying history)
+       and the frames in the lookahead window. */
+
+    double wantedBits = mWantedBitsWindow + frames.size() * mBitsPerFrame;
+    double cplx = mCplxrSum;
+
+    for (size_t i=0;i<frames.size();i++) {
+      double c = (i==0 ? blurredCost : get_frame_cost(frames[i]));
+      cplx += mPredictor[frames[i]->is_intra].predict(c, 1.0) / rceq(c, frames[i]->is_intra);
+    }
+
+    rateFactor = wantedBits / cplx;
+
+
+    /* Compensate for the deviation from the target bitrate so far.
+       CBR has to meet the rate within the VBV buffer and reacts faster. */
+
+    double abrBuffer = 2 * mParams.mBitrate * 1000.0;
+    if (mMethod == RateControlMethod_CBR) {
+      abrBuffer = libde265_min(abrBuffer, mVBVBufferSize * 0.5);
+    }
+
+    overflow = Clip3(0.5, 2.0, 1.0 + (mTotalBits - mWantedBitsTotal) / abrBuffer);
+  }
+
+  std::vector<double> plannedQScale(frames.size());
+  for (size_t i=0;i<frames.size();i++) {
+    double c = (i==0 ? blurredCost : get_frame_cost(frames[i]));
+    plannedQScale[i] = rceq(c, frames[i]->is_intra) / rateFactor * overflow;
+  }
+
+  double qscale = plannedQScale[0];
+
+
+  // limit the QP change to the last frame of the same type
+
+  double minQScale = 0;
+
+  if (mLastQScale[isIntra] > 0) {
+    double maxStep = pow(2.0, mParams.mQPStep / 6.0);
+    minQScale = mLastQScale[isIntra] / maxStep;
+    qscale = Clip3(minQScale, mLastQScale[isIntra] * maxStep, qscale);
+  }
+
+
+  /* Keep the VBV buffer from under- (and for CBR, over-) flowing.
+     Only avoiding an underflow may exceed the QP step limit. */
+
+  if (mVBVBufferSize > 0) {
+    qscale = clip_qscale_vbv(frames, qscale, plannedQScale);
+    qscale = libde265_max(qscale, minQScale);
+  }
+
+
+  int qp = (int)(qscale2qp(qscale) + 0.5);
+  qp = Clip3((int)mParams.mQPMin, (int)mParams.mQPMax, qp);
+
+  mCurrentQScale  = qp2qscale(qp);
+  mCurrentCost    = cost;
+  mCurrentRCEq    = rceqCurr;
+  mCurrentIsIntra = isIntra;
+  mCurrentIsStatic = isStatic;
+
+  loginfo(LogEncoder,"  rate-control: cost=%d qp=%d (buffer: %d/%d)\n",
+          (int)cost, qp, (int)mBufferFill, (int)mVBVBufferSize);
+
+  return qp;
+}
+
+
+double Algo_CTB_QScale_RateControl::clip_qscale_vbv(const std::vector<const lookahead_frame*>& frames,
+                                                    double qscale,
+                                                    const std::vector<double>& plannedQScale) const
+{
+  const double fps = mParams.mFrameRate;
+  const double inflow = mVBVMaxRate / fps;
+  const double qscaleMin = qp2qscale(mParams.mQPMin);
+  const double qscaleMax = qp2qscale(mParams.mQPMax);
+
+  if (frames.size()>1) {
+    /* Simulate the buffer over the lookahead window, assuming that the
+       following frames are scaled like the current one. */
+
+    const double duration = frames.size() / fps;
+    int terminate = 0;
+
+    for (int iter=0; iter<1000 && terminate!=3; iter++) {
+      double fill = mBufferFill;
+      double minFill = fill;
+
+      for (size_t i=0;i<frames.size();i++) {
+        double q = (i==0 ? qscale : plannedQScale[i] * qscale / plannedQScale[0]);
+        q = Clip3(qscaleMin, qscaleMax, q);
+
+        fill -= mPredictor[frames[i]->is_intra].predict(get_frame_cost(frames[i]), q);
+        minFill = libde265_min(minFill, fill);
+        fill = libde265_min(fill + inflow, mVBVBufferSize);
+      }
+
+      // avoid underflow, try to have the buffer at least half full at the end of the window
+
+      double targetFill = libde265_min(mBufferFill + duration * mVBVMaxRate * 0.5,
+                                       mVBVBufferSize * 0.5);
+
+      /* The buffer fullness above one half (initially vbv-init) may only be spent
+         gradually: at most 1/N of it within the N frames of the window. Otherwise,
+         a short clip would spend the whole initial buffer on top of the bitrate. */
+
+      double excess = mBufferFill - mVBVBufferSize * 0.5;
+      if (excess > 0) {
+        targetFill = libde265_max(targetFill, mBufferFill - excess / frames.size());
+      }
+
+      if ((fill < targetFill || minFill < 0) && qscale < qscaleMax) {
+        qscale *= 1.01;
+        terminate |= 1;
+        continue;
+      }
+
+      /* for CBR, do not let the buffer fill up (the bandwidth would be wasted),
+         but do not drain it below the current fullness for this either */
+
+      targetFill = Clip3(mVBVBufferSize * 0.8, mVBVBufferSize,
+                         mBufferFill - duration * mVBVMaxRate * 0.5);
+      targetFill = libde265_max(targetFill, mBufferFill);
+
+      if (mMethod == RateControlMethod_CBR && fill > targetFill && qscale > qscaleMin) {
+        qscale /= 1.01;
+        terminate |= 2;
+        continue;
+      }
+
+      break;
+    }
+  }
+
+
+  // hard limit: the frame must fit into the buffer
+
+  const int type = frames[0]->is_intra;
+  double bits = mPredictor[type].predict(get_frame_cost(frames[0]), qscale);
+
+  // small buffers may be completely used up by a single frame
+  double maxFillFactor = (mVBVBufferSize >= 5*inflow) ? 2 : 1;
+
+  double available = libde265_max(mBufferFill, 1.0) / maxFillFactor;
+
+  if (bits > available) {
+    qscale *= bits / available;
+  }
+
+  return qscale;
+}
+
+
+void Algo_CTB_QScale_RateControl::end_picture(encoder_context* ectx, const image_data* imgdata,
+                                              int nBits)
+{
+  const double fps = mParams.mFrameRate;
+
+  mPredictor[mCurrentIsIntra].update(mCurrentCost, mCurrentQScale, nBits);
+
+  mTotalBits       += nBits;
+  mWantedBitsTotal += mBitsPerFrame;
+
+  // history of the rate factor, with a half-life of two seconds
+
+  double decay = pow(0.5, 1.0/(2*fps));
+  mCplxrSum         = mCplxrSum        *decay + nBits*mCurrentQScale/mCurrentRCEq;
+  mWantedBitsWindow = mWantedBitsWindow*decay + mBitsPerFrame;
+
+  if (mVBVBufferSize > 0) {
+    mBufferFill -= nBits;
+    if (mBufferFill < 0) {
+      loginfo(LogEncoder,"  rate-control: VBV underflow (%d bits)\n", (int)mBufferFill);
+    }
+
+    mBufferFill = libde265_min(mBufferFill + mVBVMaxRate/fps, mVBVBufferSize);
+  }
+
+  if (!mCurrentIsStatic) {
+    mLastQScale[mCurrentIsIntra] = mCurrentQScale;
+  }
+}
+
+
+enc_cb* Algo_CTB_QScale_RateControl::analyze(encoder_context* ectx,
+                                             context_model_table& ctxModel,
+                                             int x,int y)
+{
+  // no cu_qp_delta yet: all CTBs use the slice QP
+
+  return analyze_with_qp(ectx,ctxModel, x,y, ectx->active_qp);
+}
@@ -36,6 +36,9 @@
 #include "libde265/configparam.h"
 
 #include "libde265/encoder/algo/cb-split.h"
+#include "libde265/encoder/encpicbuf.h"
+
+struct lookahead_frame;
 
 
 /*  Encoder search tree, bottom up:
@@ -64,10 +67,24 @@ class Algo_CTB_QScale : public Algo
                           context_model_table&,
                           int ctb_x,int ctb_y) = 0;
 
+  // QP written into the PPS (pic_init_qp)
+  virtual int getPPS_QP() const = 0;
+
+  /* Picture level control. begin_picture() is called before the slice header
+     is written and returns the slice QP. After the picture has been coded,
+     end_picture() is called with the number of bits that were spent on it.
+   */
+  virtual int  begin_picture(encoder_context*, const image_data*) { return getPPS_QP(); }
+  virtual void end_picture(encoder_context*, const image_data*, int nBits) { }
+
   void setChildAlgo(Algo_CB_Split* algo) { mChildAlgo = algo; }
 
  protected:
   Algo_CB_Split* mChildAlgo;
+
+  enc_cb* analyze_with_qp(encoder_context*,
+                          context_model_table&,
+                          int ctb_x,int ctb_y, int qp);
 };
 
 
@@ -99,6 +116,8 @@ class Algo_CTB_QScale_Constant : public Algo_CTB_QScale
 
   int getQP() const { return mParams.mQP; }
 
+  virtual int getPPS_QP() const { return getQP(); }
+
   const char* name() const { return "ctb-qscale-constant"; }
 
  private:
@@ -106,4 +125,181 @@ class Algo_CTB_QScale_Constant : public Algo_CTB_QScale
 };
 
 
+
+// ========== rate control ==========
+
+enum RateControlMethod
+  {
+    RateControlMethod_ConstantQP,
+    RateControlMethod_CBR,
+    RateControlMethod_VBR,
+    RateControlMethod_CRF
+  };
+
+class option_RateControlMethod : public choice_option<enum RateControlMethod>
+{
+ public:
+  option_RateControlMethod() {
+    add_choice("constant-qp", RateControlMethod_ConstantQP, true);
+    add_choice("cbr",         RateControlMethod_CBR);
+    add_choice("vbr",         RateControlMethod_VBR);
+    add_choice("crf",         RateControlMethod_CRF);
+  }
+};
+
+
+/* Picture-level rate control.
+
+   The QP of each picture is derived from its complexity as estimated by the
+   lookahead (see encoder_lookahead). CBR and VBR spend the target bitrate
+   over the frames in the lookahead window plus a decaying history of the
+   already coded frames. CRF uses a constant rate factor and therefore a
+   constant visual quality. When a VBV buffer is specified (always for CBR),
+   the QP is raised before the buffer would underflow within the lookahead
+   window (and, for CBR, lowered when it would overflow).
+
+   The part of the initial VBV fullness (vbv-init) above half of the buffer
+   is not planned to be spent at once, but at most 1/N of it within each
+   lookahead window of N frames. Apart from that, the frame sizes are
+   predicted from the lookahead cost, and prediction errors are corrected
+   over the following frames.
+
+   Since cu_qp_delta is not supported yet, all CTBs of a picture are coded
+   with the slice QP.
+ */
+class Algo_CTB_QScale_RateControl : public Algo_CTB_QScale
+{
+ public:
+  struct params
+  {
+    params() {
+      mBitrate.set_ID("bitrate");
+      mBitrate.set_description("target bitrate in kbit/s (CBR/VBR)");
+      mBitrate.set_minimum(1);
+      mBitrate.set_default(1000);
+
+      mMaxBitrate.set_ID("vbv-maxrate");
+      mMaxBitrate.set_description("maximum VBV input rate in kbit/s (0: same as bitrate)");
+      mMaxBitrate.set_minimum(0);
+      mMaxBitrate.set_default(0);
+
+      mBufferSize.set_ID("vbv-bufsize");
+      mBufferSize.set_description("VBV buffer size in kbit (0: no VBV, or one second for CBR)");
+      mBufferSize.set_minimum(0);
+      mBufferSize.set_default(0);
+
+      mBufferInit.set_ID("vbv-init");
+      mBufferInit.set_description("initial VBV buffer fullness in percent");
+      mBufferInit.set_range(0,100);
+      mBufferInit.set_default(90);
+
+      mCRF.set_ID("crf");
+      mCRF.set_range(0,51);
+      mCRF.set_default(28);
+
+      mFrameRate.set_ID("frame-rate");
+      mFrameRate.set_minimum(1);
+      mFrameRate.set_default(25);
+
+      mQPMin.set_ID("qp-min");
+      mQPMin.set_range(1,51);
+      mQPMin.set_default(10);
+
+      mQPMax.set_ID("qp-max");
+      mQPMax.set_range(1,51);
+      mQPMax.set_default(51);
+
+      mQPStep.set_ID("qp-step");
+      mQPStep.set_description("maximum QP change between frames of the same type");
+      mQPStep.set_range(1,51);
+      mQPStep.set_default(4);
+    }
+
+    option_int mBitrate;
+    option_int mMaxBitrate;
+    option_int mBufferSize;
+    option_int mBufferInit;
+    option_int mCRF;
+    option_int mFrameRate;
+    option_int mQPMin;
+    option_int mQPMax;
+    option_int mQPStep;
+  };
+
+  Algo_CTB_QScale_RateControl();
+
+  void setParams(const params& p) { mParams=p; }
+
+  void registerParams(config_parameters& config) {
+    config.add_option(&mParams.mBitrate);
+    config.add_option(&mParams.mMaxBitrate);
+    config.add_option(&mParams.mBufferSize);
+    config.add_option(&mParams.mBufferInit);
+    config.add_option(&mParams.mCRF);
+    config.add_option(&mParams.mFrameRate);
+    config.add_option(&mParams.mQPMin);
+    config.add_option(&mParams.mQPMax);
+    config.add_option(&mParams.mQPStep);
+  }
+
+  void setMethod(enum RateControlMethod method) { mMethod=method; }
+  void setLookaheadLength(int nFrames) { mLookaheadLength=nFrames; }
+
+  virtual enc_cb* analyze(encoder_context*,
+                          context_model_table&,
+                          int ctb_x,int ctb_y);
+
+  virtual int getPPS_QP() const;
+
+  virtual int  begin_picture(encoder_context*, const image_data*);
+  virtual void end_picture(encoder_context*, const image_data*, int nBits);
+
+  const char* name() const { return "ctb-qscale-ratecontrol"; }
+
+ private:
+  params mParams;
+
+  enum RateControlMethod mMethod;
+  int mLookaheadLength;
+
+  bool   mInitialized;
+  double mBitsPerFrame;
+  double mVBVMaxRate;     // bits per second
+  double mVBVBufferSize;  // bits, 0 if VBV is not used
+  double mRateFactorCRF;
+
+  // state
+
+  // bits = (coeff*cost + offset) / qscale, coeff and offset are decaying sums over 'count' frames
+  struct predictor {
+    double coeff;
+    double offset;
+    double count;
+
+    double predict(double cost, double qscale) const { return (coeff*cost + offset) / (count*qscale); }
+    void   update(double cost, double qscale, double bits);
+  } mPredictor[2]; // P, I
+
+  double mBufferFill;
+  double mTotalBits;
+  double mWantedBitsTotal;
+  double mCplxrSum;         // decaying sum of bits*qscale/rceq of the coded frames
+  double mWantedBitsWindow; // decaying sum of the target bits of the coded frames
+  double mShortTermCplxSum;
+  double mShortTermCplxCount;
+  double mLastQScale[2];
+
+  double mCurrentQScale;
+  double mCurrentCost;
+  double mCurrentRCEq;
+  bool   mCurrentIsIntra;
+  bool   mCurrentIsStatic;
+
+  void init(const encoder_context*, const image_data*);
+  double rceq(double cost, bool is_intra) const;
+  double clip_qscale_vbv(const std::vector<const lookahead_frame*>& frames,
+                         double qscale, const std::vector<double>& plannedQScale) const;
+};
+
+
 #endif
@@ -144,27 +144,6 @@ enc_cb* Algo_PB_MV_Test::analyze(encoder_context* ectx,
 
 
 
-int sad(const uint8_t* p1,int stride1,
-        const uint8_t* p2,int stride2,
-        int w,int h)
-{
-  int cost=0;
-
-  for (int y=0;y<h;y++) {
-    for (int x=0;x<w;x++) {
-      cost += abs_value(*p1 - *p2);
-      p1++;
-      p2++;
-    }
-
-    p1 += stride1-w;
-    p2 += stride2-w;
-  }
-
-  return cost;
-}
-
-
 enc_cb* Algo_PB_MV_Search::analyze(encoder_context* ectx,
                                    context_model_table& ctxModel,
                                    enc_cb* cb,
@@ -235,11 +214,11 @@ enc_cb* Algo_PB_MV_Search::analyze(encoder_context* ectx,
       {
         if (mx<0 || mx+pbW>w || my<0 || my+pbH>h) continue;
 
-        int cost = sad(refimg->get_image_plane_at_pos(0,mx,my),
-                       refimg->get_image_stride(0),
-                       inputimg->get_image_plane_at_pos(0,x,y),
-                       inputimg->get_image_stride(0),
-                       pbW,pbH);
+        int cost = ectx->acceleration.sad_8(refimg->get_image_plane_at_pos(0,mx,my),
+                                            refimg->get_image_stride(0),
+                                            inputimg->get_image_plane_at_pos(0,x,y),
+                                            inputimg->get_image_stride(0),
+                                            pbW,pbH);
 
         int bits = bits_h[mx-x+hrange] + bits_v[my-y+vrange];
 
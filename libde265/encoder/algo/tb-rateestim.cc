@@ -23,8 +23,11 @@
 
 #include "libde265/encoder/algo/tb-rateestim.h"
 #include "libde265/encoder/encoder-syntax.h"
+#include "libde265/encoder/encoder-context.h"
+#include "libde265/slice.h"
 #include <assert.h>
 #include <iostream>
+#include <string.h>
 
 
 float Algo_TB_RateEstimation_Exact::encode_transform_unit(encoder_context* ectx,
@@ -44,3 +47,315 @@ float Algo_TB_RateEstimation_Exact::encode_transform_unit(encoder_context* ectx,
 
   return estim.getRDBits();
 }
+
+
+// number of bypass bins for coeff_abs_level_remaining
+static inline int coeff_abs_level_remaining_bits(int level, int cRiceParam)
+{
+  int cTRMax = 4<<cRiceParam;
+
+  if (level < cTRMax) {
+    return (level>>cRiceParam) + 1 + cRiceParam;
+  }
+
+  // TU prefix (4 ones) + EGk suffix with k=cRiceParam+1
+
+  int prefix = (level-cTRMax) >> (cRiceParam+1);
+
+  int nBits=0;
+  while (prefix >= (2<<nBits)-1) {
+    nBits++;
+  }
+
+  return 4 + 2*nBits+1 + cRiceParam+1;
+}
+
+
+static inline uint32_t last_significant_coeff_prefix_bits(context_model_table& ctxModel,
+                                                         int log2TrafoSize, int cIdx,
+                                                         int lastSignificant,
+                                                         int context_model_index)
+{
+  int cMax = (log2TrafoSize<<1)-1;
+
+  int ctxOffset, ctxShift;
+  if (cIdx==0) {
+    ctxOffset = 3*(log2TrafoSize-2) + ((log2TrafoSize-1)>>2);
+    ctxShift  = (log2TrafoSize+1)>>2;
+  }
+  else {
+    ctxOffset = 15;
+    ctxShift  = log2TrafoSize-2;
+  }
+
+  context_model* model = &ctxModel[context_model_index + ctxOffset];
+
+  uint32_t bits=0;
+  for (int binIdx=0;binIdx<lastSignificant;binIdx++) {
+    bits += CABAC_frac_bits(model[binIdx >> ctxShift], 1);
+  }
+
+  if (lastSignificant != cMax) {
+    bits += CABAC_frac_bits(model[lastSignificant >> ctxShift], 0);
+  }
+
+  return bits;
+}
+
+
+/* Follows encode_residual() bin by bin, but accumulates the fractional bits
+   of the current context states instead of coding the bins.
+ */
+static uint32_t residual_coding_bits(encoder_context* ectx,
+                                     context_model_table& ctxModel,
+                                     const enc_tb* tb, const enc_cb* cb,
+                                     int log2TrafoSize, int cIdx)
+{
+  const seq_parameter_set& sps = ectx->img->get_sps();
+  const pic_parameter_set& pps = ectx->img->get_pps();
+
+  const int16_t* coeff = tb->coeff[cIdx];
+
+  int scanIdx = 0;
+  if (cb->PredMode == MODE_INTRA) {
+    scanIdx = get_intra_scan_idx(log2TrafoSize,
+                                 cIdx==0 ? tb->intra_mode : tb->intra_mode_chroma,
+                                 cIdx, &sps);
+  }
+
+  const position* ScanOrderSub = get_scan_order(log2TrafoSize-2, scanIdx);
+  const position* ScanOrderPos = get_scan_order(2, scanIdx);
+
+  int lastSignificantX, lastSignificantY;
+  int lastScanPos;
+  int lastSubBlock;
+  findLastSignificantCoeff(ScanOrderSub, ScanOrderPos,
+                           coeff, log2TrafoSize,
+                           &lastSignificantX, &lastSignificantY,
+                           &lastSubBlock, &lastScanPos);
+
+  int codedSignificantX = lastSignificantX;
+  int codedSignificantY = lastSignificantY;
+
+  if (scanIdx==2) {
+    std::swap(codedSignificantX, codedSignificantY);
+  }
+
+
+  // --- last significant coefficient position ---
+
+  int prefixX, suffixX, suffixBitsX;
+  int prefixY, suffixY, suffixBitsY;
+
+  split_last_significant_position(codedSignificantX, &prefixX,&suffixX,&suffixBitsX);
+  split_last_significant_position(codedSignificantY, &prefixY,&suffixY,&suffixBitsY);
+
+  uint32_t bits = 0;
+  int bypassBins = suffixBitsX + suffixBitsY;
+
+  bits += last_significant_coeff_prefix_bits(ctxModel, log2TrafoSize, cIdx, prefixX,
+                                             CONTEXT_MODEL_LAST_SIGNIFICANT_COEFFICIENT_X_PREFIX);
+  bits += last_significant_coeff_prefix_bits(ctxModel, log2TrafoSize, cIdx, prefixY,
+                                             CONTEXT_MODEL_LAST_SIGNIFICANT_COEFFICIENT_Y_PREFIX);
+
+
+  int sbWidth = 1<<(log2TrafoSize-2);
+  int CoeffStride = 1<<log2TrafoSize;
+
+  uint8_t coded_sub_block_neighbors[32/4*32/4];
+  memset(coded_sub_block_neighbors,0,sbWidth*sbWidth);
+
+  context_model* csbfModel = &ctxModel[CONTEXT_MODEL_CODED_SUB_BLOCK_FLAG + (cIdx ? 2 : 0)];
+  context_model* sigModel  = &ctxModel[CONTEXT_MODEL_SIGNIFICANT_COEFF_FLAG];
+  context_model* gt1Model  = &ctxModel[CONTEXT_MODEL_COEFF_ABS_LEVEL_GREATER1_FLAG + (cIdx ? 16 : 0)];
+  context_model* gt2Model  = &ctxModel[CONTEXT_MODEL_COEFF_ABS_LEVEL_GREATER2_FLAG + (cIdx ? 4 : 0)];
+
+  int c1 = 1;
+
+  for (int i=lastSubBlock;i>=0;i--) {
+    position S = ScanOrderSub[i];
+    int inferSbDcSigCoeffFlag=0;
+
+    int sub_block_is_coded = 0;
+
+    if ((i<lastSubBlock) && (i>0)) {
+      sub_block_is_coded = subblock_has_nonzero_coefficient(coeff, CoeffStride, S);
+
+      uint8_t neighbors = coded_sub_block_neighbors[S.x+S.y*sbWidth];
+      int csbfCtx = ((neighbors & 1) | (neighbors >> 1));
+      bits += CABAC_frac_bits(csbfModel[csbfCtx], sub_block_is_coded);
+
+      inferSbDcSigCoeffFlag=1;
+    }
+    else {
+      sub_block_is_coded = 1;
+    }
+
+    if (!sub_block_is_coded) {
+      continue;
+    }
+
+    if (S.x > 0) coded_sub_block_neighbors[S.x-1 + S.y  *sbWidth] |= 1;
+    if (S.y > 0) coded_sub_block_neighbors[S.x + (S.y-1)*sbWidth] |= 2;
+
+
+    // --- significant_coeff_flags ---
+
+    int16_t coeff_value[16];
+    int8_t  coeff_scan_pos[16];
+    int nCoefficients=0;
+
+    int x0 = S.x<<2;
+    int y0 = S.y<<2;
+
+    int prevCsbf = coded_sub_block_neighbors[S.x+S.y*sbWidth];
+    const uint8_t* ctxIdxMap = ctxIdxLookup[log2TrafoSize-2][!!cIdx][!!scanIdx][prevCsbf];
+
+    if (i==lastSubBlock) {
+      coeff_value[nCoefficients] = coeff[lastSignificantX+(lastSignificantY<<log2TrafoSize)];
+      coeff_scan_pos[nCoefficients] = lastScanPos;
+      nCoefficients++;
+    }
+
+    int last_coeff = (i==lastSubBlock) ? lastScanPos-1 : 15;
+
+    for (int n=last_coeff ; n>0 ; n--) {
+      int pos = x0 + ScanOrderPos[n].x + ((y0 + ScanOrderPos[n].y)<<log2TrafoSize);
+      int isSignificant = !!coeff[pos];
+
+      bits += CABAC_frac_bits(sigModel[ctxIdxMap[pos]], isSignificant);
+
+      if (isSignificant) {
+        coeff_value[nCoefficients] = coeff[pos];
+        coeff_scan_pos[nCoefficients] = n;
+        nCoefficients++;
+
+        inferSbDcSigCoeffFlag = 0;
+      }
+    }
+
+    if (last_coeff>=0) {
+      int pos = x0 + (y0<<log2TrafoSize);
+
+      if (inferSbDcSigCoeffFlag==0) {
+        int isSignificant = !!coeff[pos];
+        bits += CABAC_frac_bits(sigModel[ctxIdxMap[pos]], isSignificant);
+
+        if (isSignificant) {
+          coeff_value[nCoefficients] = coeff[pos];
+          coeff_scan_pos[nCoefficients] = 0;
+          nCoefficients++;
+        }
+      }
+      else {
+        coeff_value[nCoefficients] = coeff[pos];
+        coeff_scan_pos[nCoefficients] = 0;
+        nCoefficients++;
+      }
+    }
+
+    if (nCoefficients==0) {
+      continue;
+    }
+
+
+    // --- greater-1 / greater-2 flags ---
+
+    int ctxSet = (i==0 || cIdx>0) ? 0 : 2;
+    if (c1==0) { ctxSet++; }
+    c1=1;
+
+    int greater1Ctx = 1;
+    int firstGreater1 = -1;
+
+    int lastGreater1Coefficient = libde265_min(8,nCoefficients);
+    for (int c=0;c<lastGreater1Coefficient;c++) {
+      int greater1_flag = (abs_value(coeff_value[c])>1);
+
+      bits += CABAC_frac_bits(gt1Model[ctxSet*4 + greater1Ctx], greater1_flag);
+
+      if (greater1_flag) {
+        c1=0;
+        greater1Ctx=0;
+        if (firstGreater1 == -1) { firstGreater1=c; }
+      }
+      else {
+        if (c1<3 && c1>0) { c1++; }
+        if (greater1Ctx>0 && greater1Ctx<3) { greater1Ctx++; }
+      }
+    }
+
+    if (firstGreater1 != -1) {
+      bits += CABAC_frac_bits(gt2Model[ctxSet], abs_value(coeff_value[firstGreater1])>2);
+    }
+
+
+    // --- signs ---
+
+    int signHidden = (coeff_scan_pos[0]-coeff_scan_pos[nCoefficients-1] > 3 &&
+                      !cb->cu_transquant_bypass_flag);
+
+    bypassBins += nCoefficients;
+    if (pps.sign_data_hiding_flag && signHidden) {
+      bypassBins--;
+    }
+
+
+    // --- coeff_abs_level_remaining ---
+
+    int cRiceParam=0;
+
+    for (int n=0;n<nCoefficients;n++) {
+      int value = abs_value(coeff_value[n]);
+
+      int baseLevel;
+      if (n<8) {
+        baseLevel = (n==firstGreater1) ? 3 : 2;
+        if (value < baseLevel) continue; // coeff_has_max_base_level == 0
+      }
+      else {
+        baseLevel = 1;
+      }
+
+      bypassBins += coeff_abs_level_remaining_bits(value - baseLevel, cRiceParam);
+
+      if (value > 3*(1<<cRiceParam)) {
+        cRiceParam = libde265_min(cRiceParam+1, 4);
+      }
+    }
+  }
+
+  return bits + (bypassBins<<15);
+}
+
+
+float Algo_TB_RateEstimation_Fast::encode_transform_unit(encoder_context* ectx,
+                                                         context_model_table& ctxModel,
+                                                         const enc_tb* tb, const enc_cb* cb,
+                                                         int x0,int y0, int xBase,int yBase,
+                                                         int log2TrafoSize, int trafoDepth,
+                                                         int blkIdx)
+{
+  leaf(cb, NULL);
+
+  uint32_t bits = 0;
+
+  if (tb->cbf[0]) {
+    bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize, 0);
+  }
+
+  if (ectx->get_sps().chroma_format_idc == CHROMA_444) {
+    if (tb->cbf[1]) bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize, 1);
+    if (tb->cbf[2]) bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize, 2);
+  }
+  else if (log2TrafoSize>2) {
+    if (tb->cbf[1]) bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize-1, 1);
+    if (tb->cbf[2]) bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize-1, 2);
+  }
+  else if (blkIdx==3) {
+    if (tb->cbf[1]) bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize, 1);
+    if (tb->cbf[2]) bits += residual_coding_bits(ectx,ctxModel, tb,cb, log2TrafoSize, 2);
+  }
+
+  return bits / float(1<<15);
+}
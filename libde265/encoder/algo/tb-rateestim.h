@@ -39,7 +39,8 @@
 
 enum ALGO_TB_RateEstimation {
   ALGO_TB_RateEstimation_None,
-  ALGO_TB_RateEstimation_Exact
+  ALGO_TB_RateEstimation_Exact,
+  ALGO_TB_RateEstimation_Fast
 };
 
 class option_ALGO_TB_RateEstimation : public choice_option<enum ALGO_TB_RateEstimation>
@@ -48,6 +49,7 @@ class option_ALGO_TB_RateEstimation : public choice_option<enum ALGO_TB_RateEsti
   option_ALGO_TB_RateEstimation() {
     add_choice("none" ,ALGO_TB_RateEstimation_None);
     add_choice("exact",ALGO_TB_RateEstimation_Exact, true);
+    add_choice("fast" ,ALGO_TB_RateEstimation_Fast);
   }
 };
 
@@ -98,4 +100,24 @@ class Algo_TB_RateEstimation_Exact : public Algo_TB_RateEstimation
 };
 
 
+/* Table-driven estimation of the residual_coding() rate.
+   The bins are not run through a CABAC_encoder. Instead, each context-coded bin is
+   looked up in the fractional-bit table for the current context state and the bypass
+   bins of signs and remaining levels are counted directly. Context states are not
+   adapted during the estimation (like CABAC_encoder_estim_constant), hence the result
+   is slightly less precise than the exact estimation.
+ */
+class Algo_TB_RateEstimation_Fast : public Algo_TB_RateEstimation
+{
+ public:
+  virtual float encode_transform_unit(encoder_context* ectx,
+                                      context_model_table& ctxModel,
+                                      const enc_tb* tb, const enc_cb* cb,
+                                      int x0,int y0, int xBase,int yBase,
+                                      int log2TrafoSize, int trafoDepth, int blkIdx);
+
+  virtual const char* name() const { return "tb-rateestimation-fast"; }
+};
+
+
 #endif
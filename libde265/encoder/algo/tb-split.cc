@@ -229,6 +229,15 @@ Algo_TB_Split_BruteForce::analyze(encoder_context* ectx,
       else
         logging_tb_split.noskipTBSplit++;
     }
+
+    if (mParams.rdThreshold() != ALGO_TB_BruteForce_RDThreshold_off) {
+      float rdCost = tb_no_split->distortion + ectx->lambda * tb_no_split->rate;
+      float area   = 1<<(2*log2TbSize);
+
+      if (rdCost < split_rd_threshold_factor[mParams.rdThreshold()] * ectx->lambda * area) {
+        test_split = false;
+      }
+    }
   }
 
 
@@ -93,6 +93,28 @@ class option_ALGO_TB_Split_BruteForce_ZeroBlockPrune
 };
 
 
+enum ALGO_TB_Split_BruteForce_RDThreshold {
+  // Do not test the split when the RD cost of the unsplit TB is below
+  // a threshold (relative to lambda, per pixel).
+  ALGO_TB_BruteForce_RDThreshold_off,
+  ALGO_TB_BruteForce_RDThreshold_low,
+  ALGO_TB_BruteForce_RDThreshold_medium,
+  ALGO_TB_BruteForce_RDThreshold_high
+};
+
+class option_ALGO_TB_Split_BruteForce_RDThreshold
+: public choice_option<enum ALGO_TB_Split_BruteForce_RDThreshold>
+{
+ public:
+  option_ALGO_TB_Split_BruteForce_RDThreshold() {
+    add_choice("off"     ,ALGO_TB_BruteForce_RDThreshold_off, true);
+    add_choice("low"     ,ALGO_TB_BruteForce_RDThreshold_low);
+    add_choice("medium"  ,ALGO_TB_BruteForce_RDThreshold_medium);
+    add_choice("high"    ,ALGO_TB_BruteForce_RDThreshold_high);
+  }
+};
+
+
 class Algo_TB_Split_BruteForce : public Algo_TB_Split
 {
  public:
@@ -100,15 +122,18 @@ class Algo_TB_Split_BruteForce : public Algo_TB_Split
   {
     params() {
       zeroBlockPrune.set_ID("TB-Split-BruteForce-ZeroBlockPrune");
+      rdThreshold.set_ID("TB-Split-BruteForce-RDThreshold");
     }
 
     option_ALGO_TB_Split_BruteForce_ZeroBlockPrune zeroBlockPrune;
+    option_ALGO_TB_Split_BruteForce_RDThreshold    rdThreshold;
   };
 
   void setParams(const params& p) { mParams=p; }
 
   void registerParams(config_parameters& config) {
     config.add_option(&mParams.zeroBlockPrune);
+    config.add_option(&mParams.rdThreshold);
   }
 
   virtual enc_tb* analyze(encoder_context*,
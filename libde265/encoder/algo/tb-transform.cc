@@ -127,7 +127,12 @@ void compute_transform_coeffs(encoder_context* ectx,
 
   // --- quantization ---
 
-  quant_coefficients(tb->coeff[cIdx], tb->coeff[cIdx], log2TbSize,  cb->qp, true);
+  int qp = cb->qp;
+  if (cIdx>0) {
+    qp = chroma_qp_from_luma_qp(qp, ectx->get_sps().ChromaArrayType);
+  }
+
+  quant_coefficients(tb->coeff[cIdx], tb->coeff[cIdx], log2TbSize,  qp, true);
 
 
   // set CBF to 0 if there are no non-zero coefficients
@@ -245,10 +250,11 @@ enc_tb* Algo_TB_Transform::analyze(encoder_context* ectx,
   // measure distortion
 
   int tbSize = 1<<log2TbSize;
-  tb->distortion = SSD(input->get_image_plane_at_pos(0, x0,y0), input->get_image_stride(0),
-                       tb->reconstruction[0]->get_buffer_u8(),
-                       tb->reconstruction[0]->getStride(),
-                       tbSize, tbSize);
+  tb->distortion = ectx->acceleration.ssd_8(input->get_image_plane_at_pos(0, x0,y0),
+                                            input->get_image_stride(0),
+                                            tb->reconstruction[0]->get_buffer_u8(),
+                                            tb->reconstruction[0]->getStride(),
+                                            tbSize, tbSize);
 
   return tb;
 }
@@ -29,6 +29,7 @@
 encoder_context::encoder_context()
 {
   encoder_started=false;
+  input_end_of_stream=false;
 
   vps = std::make_shared<video_parameter_set>();
   sps = std::make_shared<seq_parameter_set>();
@@ -59,6 +60,13 @@ encoder_context::encoder_context()
 
 encoder_context::~encoder_context()
 {
+  lookahead.stop();
+
+  while (!lookahead_input.empty()) {
+    delete lookahead_input.front();
+    lookahead_input.pop_front();
+  }
+
   while (!output_packets.empty()) {
     en265_free_packet((en265_encoder_context*)this, output_packets.front());
     output_packets.pop_front();
@@ -85,11 +93,125 @@ void encoder_context::start_encoder()
   sop->set_encoder_context(this);
   sop->set_encoder_picture_buffer(&picbuf);
 
+  lookahead.set_acceleration_functions(&acceleration);
+
+  if (use_lookahead()) {
+    lookahead.start();
+  }
 
   encoder_started=true;
 }
 
 
+bool encoder_context::use_lookahead() const
+{
+  if (params.rateControlMethod() != RateControlMethod_ConstantQP) {
+    return true;
+  }
+
+  return (params.sop_structure() == SOP_LowDelay &&
+          params.mSOP_LowDelay.sceneCut > 0);
+}
+
+
+int encoder_context::lookahead_window() const
+{
+  if (params.rateControlMethod() == RateControlMethod_ConstantQP) {
+    return 0;
+  }
+
+  return params.lookahead_length;
+}
+
+
+void encoder_context::push_input_image(de265_image* img)
+{
+  if (!use_lookahead()) {
+    sop->insert_new_input_image(img);
+    return;
+  }
+
+  // The SOP creator gets the picture after the lookahead has analyzed it.
+
+  int frame_number = sop->get_frame_number() + lookahead_input.size();
+
+  lookahead_input.push_back(img);
+  lookahead.push_image(img, frame_number);
+}
+
+
+void encoder_context::push_end_of_stream()
+{
+  if (!use_lookahead()) {
+    sop->insert_end_of_stream();
+  }
+  else {
+    input_end_of_stream = true;
+  }
+}
+
+
+/* Pass the analyzed input pictures on to the SOP creator. If fewer than
+   'minFramesToEncode' frames are waiting for encoding, wait for the lookahead
+   to finish its analysis.
+ */
+void encoder_context::insert_analyzed_input_images(int minFramesToEncode)
+{
+  while (!lookahead_input.empty()) {
+    int frame_number = sop->get_frame_number();
+
+    if (!lookahead.is_analyzed(frame_number)) {
+      if (picbuf.number_of_frames_to_encode() >= minFramesToEncode) {
+        break;
+      }
+
+      lookahead.wait_until_analyzed(frame_number);
+    }
+
+    sop->insert_new_input_image(lookahead_input.front());
+    lookahead_input.pop_front();
+
+    const encoder_picture_buffer& buf = picbuf;
+    const image_data* imgdata = buf.get_picture(frame_number);
+    lookahead.set_frame_type(frame_number, imgdata->shdr.slice_type == SLICE_TYPE_I);
+  }
+
+  if (lookahead_input.empty() && input_end_of_stream && !picbuf.is_end_of_stream()) {
+    sop->insert_end_of_stream();
+  }
+}
+
+
+bool encoder_context::have_picture_ready_for_encoding()
+{
+  const int window = lookahead_window();
+
+  if (use_lookahead()) {
+    int numInputFrames = picbuf.number_of_frames_to_encode() + lookahead_input.size();
+
+    if (input_end_of_stream) {
+      insert_analyzed_input_images(numInputFrames);
+    }
+    else if (numInputFrames > window) {
+      insert_analyzed_input_images(window+1);
+    }
+    else {
+      insert_analyzed_input_images(0);
+    }
+  }
+
+  if (!picbuf.have_more_frames_to_encode()) {
+    return false;
+  }
+
+  if (picbuf.is_end_of_stream()) {
+    return true;
+  }
+
+  return picbuf.number_of_frames_to_encode() > window;
+}
+
+
 en265_packet* encoder_context::create_packet(en265_packet_content_type t)
 {
   en265_packet* pck = new en265_packet;
@@ -229,12 +351,6 @@ de265_error encoder_context::encode_picture_from_input_buffer()
     algo.setParams(params);
 
 
-    // TODO: must be <30, because Y->C mapping (tab8_22) is not implemented yet
-    int qp = algo.getPPS_QP();
-
-    //lambda = ectx->params.lambda;
-    lambda = 0.0242 * pow(1.27245, qp);
-
     parameters_have_been_set = true;
   }
 
@@ -259,6 +375,15 @@ de265_error encoder_context::encode_picture_from_input_buffer()
   }
 
 
+  // picture QP from the rate control
+
+  int qp = algo.getAlgoCTBQScale()->begin_picture(this, imgdata);
+
+  imgdata->shdr.slice_qp_delta = qp - pps->pic_init_qp;
+
+  lambda = 0.0242 * pow(1.27245, qp);
+
+
   // write slice header
 
   // slice
@@ -306,6 +431,9 @@ de265_error encoder_context::encode_picture_from_input_buffer()
   pck->nuh_temporal_id= imgdata->nal.nuh_temporal_id;
   output_packets.push_back(pck);
 
+  algo.getAlgoCTBQScale()->end_picture(this, imgdata, pck->length*8);
+  lookahead.release_frames_before(imgdata->frame_number+1);
+
 
   picbuf.mark_encoding_finished(imgdata->frame_number);
 
@@ -29,6 +29,7 @@
 #include "libde265/encoder/encoder-params.h"
 #include "libde265/encoder/encpicbuf.h"
 #include "libde265/encoder/sop.h"
+#include "libde265/encoder/lookahead.h"
 #include "libde265/en265.h"
 #include "libde265/util.h"
 
@@ -116,6 +117,15 @@ class encoder_context : public base_context
 
   float lambda;
 
+  encoder_lookahead lookahead;
+
+  /* Whether the input pictures are analyzed in the lookahead (required for
+     rate control and scene-cut detection). */
+  bool use_lookahead() const;
+
+  // number of frames after the current frame that rate control looks at
+  int  lookahead_window() const;
+
 
   // --- CABAC output and rate estimation ---
 
@@ -159,6 +169,13 @@ class encoder_context : public base_context
   de265_error encode_headers();
   de265_error encode_picture_from_input_buffer();
 
+  void push_input_image(de265_image*);
+  void push_end_of_stream();
+
+  /* There is a picture to encode and the lookahead window after it is filled
+     (or the end of the stream has been reached). */
+  bool have_picture_ready_for_encoding();
+
 
   // Input images can be released after encoding and when the output packet is released.
   // This is important to do as soon as possible, as the image might actually wrap
@@ -167,6 +184,13 @@ class encoder_context : public base_context
   void release_input_image(int frame_number) { picbuf.release_input_image(frame_number); }
 
   void mark_image_is_outputted(int frame_number) { picbuf.mark_image_is_outputted(frame_number); }
+
+ private:
+  // input pictures that are queued in the lookahead and not passed to the SOP creator yet
+  std::deque<de265_image*> lookahead_input;
+  bool input_end_of_stream;
+
+  void insert_analyzed_input_images(int minFramesToEncode);
 };
 
 
@@ -154,7 +154,7 @@ double encode_image(encoder_context* ectx,
   }
 #endif
 
-  ectx->active_qp = ectx->get_pps().pic_init_qp; // TODO take current qp from slice
+  ectx->active_qp = ectx->shdr->SliceQPY;
 
 
   ectx->cabac_ctx_models.init(ectx->shdr->initType, ectx->shdr->SliceQPY);
@@ -332,7 +332,20 @@ void EncoderCore_Custom::setParams(encoder_params& params)
 {
   // build algorithm tree
 
-  mAlgo_CTB_QScale_Constant.setChildAlgo(&mAlgo_CB_Split_BruteForce);
+  switch (params.rateControlMethod()) {
+  case RateControlMethod_ConstantQP:
+    mAlgo_CTB_QScale = &mAlgo_CTB_QScale_Constant;
+    break;
+  case RateControlMethod_CBR:
+  case RateControlMethod_VBR:
+  case RateControlMethod_CRF:
+    mAlgo_CTB_QScale_RateControl.setMethod(params.rateControlMethod());
+    mAlgo_CTB_QScale_RateControl.setLookaheadLength(params.lookahead_length);
+    mAlgo_CTB_QScale = &mAlgo_CTB_QScale_RateControl;
+    break;
+  }
+
+  mAlgo_CTB_QScale->setChildAlgo(&mAlgo_CB_Split_BruteForce);
   mAlgo_CB_Split_BruteForce.setChildAlgo(&mAlgo_CB_Skip_BruteForce);
 
   mAlgo_CB_Skip_BruteForce.setSkipAlgo(&mAlgo_CB_MergeIndex_Fixed);
@@ -390,6 +403,7 @@ void EncoderCore_Custom::setParams(encoder_params& params)
   switch (params.mAlgo_TB_RateEstimation()) {
   case ALGO_TB_RateEstimation_None:  algo_TB_RateEstimation = &mAlgo_TB_RateEstimation_None;  break;
   case ALGO_TB_RateEstimation_Exact: algo_TB_RateEstimation = &mAlgo_TB_RateEstimation_Exact; break;
+  case ALGO_TB_RateEstimation_Fast:  algo_TB_RateEstimation = &mAlgo_TB_RateEstimation_Fast;  break;
   }
   mAlgo_TB_Transform.setAlgo_TB_RateEstimation(algo_TB_RateEstimation);
   //mAlgo_TB_Split_BruteForce.setParams(params.TB_Split_BruteForce);
@@ -82,11 +82,14 @@ class EncoderCore
 class EncoderCore_Custom : public EncoderCore
 {
  public:
+  EncoderCore_Custom() : mAlgo_CTB_QScale(&mAlgo_CTB_QScale_Constant) { }
 
   void setParams(struct encoder_params& params);
 
   void registerParams(config_parameters& config) {
     mAlgo_CTB_QScale_Constant.registerParams(config);
+    mAlgo_CTB_QScale_RateControl.registerParams(config);
+    mAlgo_CB_Split_BruteForce.registerParams(config);
     mAlgo_CB_IntraPartMode_Fixed.registerParams(config);
     mAlgo_CB_InterPartMode_Fixed.registerParams(config);
     mAlgo_PB_MV_Test.registerParams(config);
@@ -96,12 +99,14 @@ class EncoderCore_Custom : public EncoderCore
     mAlgo_TB_Split_BruteForce.registerParams(config);
   }
 
-  virtual Algo_CTB_QScale* getAlgoCTBQScale() { return &mAlgo_CTB_QScale_Constant; }
+  virtual Algo_CTB_QScale* getAlgoCTBQScale() { return mAlgo_CTB_QScale; }
 
-  virtual int getPPS_QP() const { return mAlgo_CTB_QScale_Constant.getQP(); }
+  virtual int getPPS_QP() const { return mAlgo_CTB_QScale->getPPS_QP(); }
 
  private:
+  Algo_CTB_QScale*                 mAlgo_CTB_QScale; // selected algorithm
   Algo_CTB_QScale_Constant         mAlgo_CTB_QScale_Constant;
+  Algo_CTB_QScale_RateControl      mAlgo_CTB_QScale_RateControl;
 
   Algo_CB_Split_BruteForce         mAlgo_CB_Split_BruteForce;
   Algo_CB_Skip_BruteForce          mAlgo_CB_Skip_BruteForce;
@@ -125,6 +130,7 @@ class EncoderCore_Custom : public EncoderCore
   Algo_TB_Transform                 mAlgo_TB_Transform;
   Algo_TB_RateEstimation_None       mAlgo_TB_RateEstimation_None;
   Algo_TB_RateEstimation_Exact      mAlgo_TB_RateEstimation_Exact;
+  Algo_TB_RateEstimation_Fast       mAlgo_TB_RateEstimation_Fast;
 };
 
 
@@ -34,8 +34,6 @@ static std::vector<int> power2range(int low,int high)
 
 encoder_params::encoder_params()
 {
-  //rateControlMethod = RateControlMethod_ConstantQP;
-
   min_cb_size.set_ID("min-cb-size"); min_cb_size.set_valid_values(power2range(8,64)); min_cb_size.set_default(8);
   max_cb_size.set_ID("max-cb-size"); max_cb_size.set_valid_values(power2range(8,64)); max_cb_size.set_default(32);
   min_tb_size.set_ID("min-tb-size"); min_tb_size.set_valid_values(power2range(4,32)); min_tb_size.set_default(4);
@@ -58,6 +56,13 @@ encoder_params::encoder_params()
   mAlgo_TB_RateEstimation.set_ID("TB-RateEstimation");
 
   mAlgo_MEMode.set_ID("MEMode");
+
+  rateControlMethod.set_ID("rate-control");
+
+  lookahead_length.set_ID("lookahead");
+  lookahead_length.set_description("number of frames analyzed ahead of the current frame for rate control");
+  lookahead_length.set_range(0,250);
+  lookahead_length.set_default(20);
 }
 
 
@@ -79,5 +84,8 @@ void encoder_params::registerParams(config_parameters& config)
   config.add_option(&mAlgo_MEMode);
   config.add_option(&mAlgo_TB_RateEstimation);
 
+  config.add_option(&rateControlMethod);
+  config.add_option(&lookahead_length);
+
   mSOP_LowDelay.registerParams(config);
 }
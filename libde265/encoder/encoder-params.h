@@ -28,12 +28,6 @@
 #include "libde265/encoder/sop.h"
 
 
-enum RateControlMethod
-  {
-    RateControlMethod_ConstantQP,
-    RateControlMethod_ConstantLambda
-  };
-
 enum IntraPredSearch
   {
     IntraPredSearch_Complete
@@ -132,7 +126,8 @@ struct encoder_params
 
   // rate-control
 
-  enum RateControlMethod rateControlMethod;
+  option_RateControlMethod rateControlMethod;
+  option_int lookahead_length;
   option_ALGO_TB_RateEstimation mAlgo_TB_RateEstimation;
 
   //int constant_QP;
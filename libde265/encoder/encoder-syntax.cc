@@ -724,8 +724,6 @@ void split_last_significant_position(int pos, int* prefix, int* suffix, int* nSu
 }
 
 
-extern uint8_t* ctxIdxLookup[4 /* 4-log2-32 */][2 /* !!cIdx */][2 /* !!scanIdx */][4 /* prevCsbf */];
-
 /* These values are read from the image metadata:
    - intra prediction mode (x0;y0)
  */
@@ -25,6 +25,7 @@
 
 #include "libde265/image.h"
 #include "libde265/encoder/encoder-types.h"
+#include "libde265/scan.h"
 
 
 void encode_split_cu_flag(encoder_context* ectx,
@@ -90,6 +91,19 @@ void encode_transform_unit(encoder_context* ectx,
                            int log2TrafoSize, int trafoDepth, int blkIdx);
 
 
+// --- residual coding helpers, shared with the table-driven rate estimation ---
+
+void findLastSignificantCoeff(const position* sbScan, const position* cScan,
+                              const int16_t* coeff, int log2TrafoSize,
+                              int* lastSignificantX, int* lastSignificantY,
+                              int* lastSb, int* lastPos);
+
+bool subblock_has_nonzero_coefficient(const int16_t* coeff, int coeffStride,
+                                      const position& sbPos);
+
+void split_last_significant_position(int pos, int* prefix, int* suffix, int* nSuffixBits);
+
+
 void encode_quadtree(encoder_context* ectx,
                      CABAC_encoder* cabac,
                      const enc_cb* cb, int x0,int y0, int log2CbSize, int ctDepth,
@@ -186,7 +186,12 @@ void enc_tb::reconstruct_tb(encoder_context* ectx,
 
       ALIGNED_16(int16_t) dequant_coeff[32*32];
 
-      if (cbf[cIdx]) dequant_coefficients(dequant_coeff, coeff[cIdx], log2TbSize, cb->qp);
+      int qp = cb->qp;
+      if (cIdx>0) {
+        qp = chroma_qp_from_luma_qp(qp, ectx->get_sps().ChromaArrayType);
+      }
+
+      if (cbf[cIdx]) dequant_coefficients(dequant_coeff, coeff[cIdx], log2TbSize, qp);
 
       if (0 && cbf[cIdx]) {
         printf("--- quantized coeffs ---\n");
@@ -24,6 +24,7 @@
 
 encoder_picture_buffer::encoder_picture_buffer()
 {
+  mEndOfStream = false;
 }
 
 encoder_picture_buffer::~encoder_picture_buffer()
@@ -225,7 +226,9 @@ void encoder_picture_buffer::mark_encoding_finished(int frame_number)
   FOR_LOOP(image_data *, imgdata, mImages) {
 #endif
     if (imgdata->mark_used || imgdata->is_in_output_queue) {
-      imgdata->reconstruction->PicState = UsedForShortTermReference; // TODO: this is only a hack
+      if (imgdata->reconstruction) { // not for images that are still waiting to be encoded
+        imgdata->reconstruction->PicState = UsedForShortTermReference; // TODO: this is only a hack
+      }
 
       newImageSet.push_back(imgdata);
     }
@@ -255,6 +258,19 @@ bool encoder_picture_buffer::have_more_frames_to_encode() const
 }
 
 
+int encoder_picture_buffer::number_of_frames_to_encode() const
+{
+  int n=0;
+  for (int i=0;i<mImages.size();i++) {
+    if (mImages[i]->state < image_data::state_encoding) {
+      n++;
+    }
+  }
+
+  return n;
+}
+
+
 image_data* encoder_picture_buffer::get_next_picture_to_encode()
 {
   for (int i=0;i<mImages.size();i++) {
@@ -120,6 +120,8 @@ class encoder_picture_buffer
   // --- data access ---
 
   bool have_more_frames_to_encode() const;
+  int  number_of_frames_to_encode() const;
+  bool is_end_of_stream() const { return mEndOfStream; }
   image_data* get_next_picture_to_encode(); // or return NULL if no picture is available
   const image_data* get_picture(int frame_number) const;
   bool has_picture(int frame_number) const;
@@ -0,0 +1,520 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "libde265/encoder/lookahead.h"
+#include "libde265/util.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+// motion search range in low-resolution pixels
+#define LOOKAHEAD_SEARCH_RANGE 16
+
+
+lookahead_frame::lookahead_frame()
+{
+  frame_number = 0;
+  is_intra = true;
+  type_set = false;
+  width = height = stride = 0;
+  num_blocks = 0;
+  intra_cost = inter_cost = 0;
+}
+
+
+encoder_lookahead::encoder_lookahead()
+{
+  mAccel = NULL;
+
+  mThreadRunning = false;
+  mStopThread = false;
+
+  de265_mutex_init(&mMutex);
+  de265_cond_init(&mInputAvailable);
+  de265_cond_init(&mFrameAnalyzed);
+}
+
+
+encoder_lookahead::~encoder_lookahead()
+{
+  stop();
+  reset();
+
+  de265_mutex_destroy(&mMutex);
+  de265_cond_destroy(&mInputAvailable);
+  de265_cond_destroy(&mFrameAnalyzed);
+}
+
+
+#ifndef _WIN32
+static void* lookahead_thread(void* lookahead_ptr)
+#else
+static DWORD WINAPI lookahead_thread(LPVOID lookahead_ptr)
+#endif
+{
+  encoder_lookahead* lookahead = (encoder_lookahead*)lookahead_ptr;
+  lookahead->analysis_thread_main();
+  return 0;
+}
+
+
+void encoder_lookahead::start()
+{
+  assert(mAccel);
+
+  if (mThreadRunning) {
+    return;
+  }
+
+  mStopThread = false;
+
+  // Without a thread, the pictures are analyzed synchronously in push_image().
+  mThreadRunning = (de265_thread_create(&mThread, lookahead_thread, this) == 0);
+}
+
+
+void encoder_lookahead::stop()
+{
+  if (!mThreadRunning) {
+    return;
+  }
+
+  de265_mutex_lock(&mMutex);
+  mStopThread = true;
+  de265_cond_broadcast(&mInputAvailable, &mMutex);
+  de265_mutex_unlock(&mMutex);
+
+  de265_thread_join(mThread);
+  de265_thread_destroy(&mThread);
+
+  mThreadRunning = false;
+  mInputQueue.clear();
+}
+
+
+void encoder_lookahead::analysis_thread_main()
+{
+  de265_mutex_lock(&mMutex);
+
+  for (;;) {
+    while (mInputQueue.empty() && !mStopThread) {
+      de265_cond_wait(&mInputAvailable, &mMutex);
+    }
+
+    if (mStopThread) {
+      break;
+    }
+
+    /* The last analyzed frame is never released (see release_frames_before()),
+       hence we can access it without holding the lock. */
+
+    input_picture input = mInputQueue.front();
+    const lookahead_frame* prev = mFrames.empty() ? NULL : mFrames.back();
+
+    de265_mutex_unlock(&mMutex);
+
+    lookahead_frame* frame = analyze_image(input, prev);
+
+    de265_mutex_lock(&mMutex);
+
+    mFrames.push_back(frame);
+    mInputQueue.pop_front();
+
+    de265_cond_broadcast(&mFrameAnalyzed, &mMutex);
+  }
+
+  de265_mutex_unlock(&mMutex);
+}
+
+
+void encoder_lookahead::reset()
+{
+  assert(!mThreadRunning);
+
+  mInputQueue.clear();
+
+  while (!mFrames.empty()) {
+    delete mFrames.front();
+    mFrames.pop_front();
+  }
+}
+
+
+void encoder_lookahead::push_image(const de265_image* input, int frame_number)
+{
+  assert(mAccel);
+
+  input_picture pic;
+  pic.image = input;
+  pic.frame_number = frame_number;
+
+  if (!mThreadRunning) {
+    const lookahead_frame* prev = mFrames.empty() ? NULL : mFrames.back();
+    mFrames.push_back(analyze_image(pic, prev));
+    return;
+  }
+
+  de265_mutex_lock(&mMutex);
+  mInputQueue.push_back(pic);
+  de265_cond_broadcast(&mInputAvailable, &mMutex);
+  de265_mutex_unlock(&mMutex);
+}
+
+
+lookahead_frame* encoder_lookahead::analyze_image(const input_picture& input,
+                                                  const lookahead_frame* prev) const
+{
+  lookahead_frame* frame = new lookahead_frame;
+  frame->frame_number = input.frame_number;
+
+  downsample(frame, input.image);
+  compute_costs(frame, prev);
+
+  return frame;
+}
+
+
+lookahead_frame* encoder_lookahead::find_frame(int frame_number) const
+{
+  for (size_t i=0;i<mFrames.size();i++) {
+    if (mFrames[i]->frame_number == frame_number)
+      return mFrames[i];
+  }
+
+  return NULL;
+}
+
+
+bool encoder_lookahead::is_analyzed(int frame_number) const
+{
+  de265_mutex_lock(&mMutex);
+  bool analyzed = (!mFrames.empty() && mFrames.back()->frame_number >= frame_number);
+  de265_mutex_unlock(&mMutex);
+
+  return analyzed;
+}
+
+
+void encoder_lookahead::wait_until_analyzed(int frame_number) const
+{
+  de265_mutex_lock(&mMutex);
+
+  while (mFrames.empty() || mFrames.back()->frame_number < frame_number) {
+    assert(mThreadRunning);
+    de265_cond_wait(&mFrameAnalyzed, &mMutex);
+  }
+
+  de265_mutex_unlock(&mMutex);
+}
+
+
+void encoder_lookahead::set_frame_type(int frame_number, bool is_intra)
+{
+  de265_mutex_lock(&mMutex);
+
+  lookahead_frame* frame = find_frame(frame_number);
+  assert(frame);
+
+  frame->is_intra = is_intra;
+  frame->type_set = true;
+
+  de265_mutex_unlock(&mMutex);
+}
+
+
+const lookahead_frame* encoder_lookahead::get_frame(int frame_number) const
+{
+  de265_mutex_lock(&mMutex);
+  const lookahead_frame* frame = find_frame(frame_number);
+  de265_mutex_unlock(&mMutex);
+
+  return frame;
+}
+
+
+std::vector<const lookahead_frame*> encoder_lookahead::get_frames(int frame_number,
+                                                                  int maxFrames) const
+{
+  std::vector<const lookahead_frame*> frames;
+
+  de265_mutex_lock(&mMutex);
+
+  for (size_t i=0;i<mFrames.size() && (int)frames.size()<maxFrames;i++) {
+    if (!mFrames[i]->type_set) {
+      break;
+    }
+
+    if (mFrames[i]->frame_number >= frame_number) {
+      frames.push_back(mFrames[i]);
+    }
+  }
+
+  de265_mutex_unlock(&mMutex);
+
+  return frames;
+}
+
+
+void encoder_lookahead::release_frames_before(int frame_number)
+{
+  // always keep the last frame, it is the reference for the next input picture
+
+  de265_mutex_lock(&mMutex);
+
+  while (mFrames.size()>1 && mFrames.front()->frame_number < frame_number) {
+    delete mFrames.front();
+    mFrames.pop_front();
+  }
+
+  de265_mutex_unlock(&mMutex);
+}
+
+
+bool encoder_lookahead::is_scene_cut(int frame_number, int distanceToLastIntra,
+                                     int minIntraPeriod, int maxIntraPeriod, int threshold) const
+{
+  const lookahead_frame* frame = get_frame(frame_number);
+  assert(frame);
+
+  if (threshold <= 0 || frame->frame_number == 0) {
+    return false;
+  }
+
+  minIntraPeriod = libde265_max(1, libde265_min(minIntraPeriod, maxIntraPeriod));
+
+  double threshMax = threshold / 100.0;
+  double threshMin = threshMax * 0.25;
+  if (minIntraPeriod == maxIntraPeriod) {
+    threshMin = threshMax;
+  }
+
+  // Shortly after an intra frame, only very clear scene cuts start a new GOP.
+
+  double bias;
+  if (distanceToLastIntra <= minIntraPeriod/4) {
+    bias = threshMin / 4;
+  }
+  else if (distanceToLastIntra <= minIntraPeriod) {
+    bias = threshMin * distanceToLastIntra / minIntraPeriod;
+  }
+  else if (distanceToLastIntra >= maxIntraPeriod) {
+    bias = threshMax;
+  }
+  else {
+    bias = threshMin + ((threshMax - threshMin) *
+                        (distanceToLastIntra - minIntraPeriod) / (maxIntraPeriod - minIntraPeriod));
+  }
+
+  return frame->inter_cost >= (1.0 - bias) * frame->intra_cost;
+}
+
+
+void encoder_lookahead::downsample(lookahead_frame* frame, const de265_image* input) const
+{
+  int w = input->get_width(0);
+  int h = input->get_height(0);
+
+  int lw = (w+1)/2;
+  int lh = (h+1)/2;
+
+  frame->width  = (lw+7) & ~7;
+  frame->height = (lh+7) & ~7;
+  frame->stride = frame->width;
+  frame->lowres.resize(frame->stride * frame->height);
+
+  const uint8_t* src = input->get_image_plane(0);
+  int srcStride = input->get_image_stride(0);
+
+  for (int y=0;y<lh;y++) {
+    const uint8_t* row0 = src + 2*y*srcStride;
+    const uint8_t* row1 = (2*y+1<h) ? row0+srcStride : row0;
+    uint8_t* dst = &frame->lowres[y*frame->stride];
+
+    for (int x=0;x<lw;x++) {
+      int x1 = (2*x+1<w) ? 2*x+1 : 2*x;
+      dst[x] = (row0[2*x] + row0[x1] + row1[2*x] + row1[x1] + 2) >> 2;
+    }
+
+    // pad right border
+
+    for (int x=lw;x<frame->width;x++) {
+      dst[x] = dst[lw-1];
+    }
+  }
+
+  // pad bottom border
+
+  for (int y=lh;y<frame->height;y++) {
+    memcpy(&frame->lowres[y*frame->stride], &frame->lowres[(lh-1)*frame->stride], frame->width);
+  }
+}
+
+
+int encoder_lookahead::intra_block_cost(const lookahead_frame* frame, int bx,int by) const
+{
+  const int stride = frame->stride;
+  const uint8_t* blk = frame->get_block(bx,by);
+
+  uint8_t pred[8*8];
+
+  bool haveTop  = (by>0);
+  bool haveLeft = (bx>0);
+
+  // DC prediction
+
+  int dc = 128;
+  if (haveTop || haveLeft) {
+    int sum=0, n=0;
+    if (haveTop)  { for (int i=0;i<8;i++) sum += blk[i-stride];   n+=8; }
+    if (haveLeft) { for (int i=0;i<8;i++) sum += blk[i*stride-1]; n+=8; }
+    dc = (sum + n/2) / n;
+  }
+
+  memset(pred, dc, 8*8);
+  int cost = mAccel->satd_8[1](blk,stride, pred,8);
+
+  // vertical prediction
+
+  if (haveTop) {
+    for (int y=0;y<8;y++) {
+      memcpy(&pred[y*8], blk-stride, 8);
+    }
+
+    cost = libde265_min(cost, (int)mAccel->satd_8[1](blk,stride, pred,8));
+  }
+
+  // horizontal prediction
+
+  if (haveLeft) {
+    for (int y=0;y<8;y++) {
+      memset(&pred[y*8], blk[y*stride-1], 8);
+    }
+
+    cost = libde265_min(cost, (int)mAccel->satd_8[1](blk,stride, pred,8));
+  }
+
+  return cost;
+}
+
+
+int encoder_lookahead::inter_block_cost(const lookahead_frame* frame, const lookahead_frame* ref,
+                                        int bx,int by, int& mvx,int& mvy) const
+{
+  const int stride = frame->stride;
+  const uint8_t* blk = frame->get_block(bx,by);
+
+  const int x0 = bx*8;
+  const int y0 = by*8;
+
+  // limit the vectors such that the reference block is inside the picture
+
+  const int minX = libde265_max(-LOOKAHEAD_SEARCH_RANGE, -x0);
+  const int minY = libde265_max(-LOOKAHEAD_SEARCH_RANGE, -y0);
+  const int maxX = libde265_min( LOOKAHEAD_SEARCH_RANGE, frame->width -8 - x0);
+  const int maxY = libde265_min( LOOKAHEAD_SEARCH_RANGE, frame->height-8 - y0);
+
+  // start at the better one of the zero vector and the predicted vector
+
+  const int pmvx = Clip3(minX,maxX, mvx);
+  const int pmvy = Clip3(minY,maxY, mvy);
+
+  int bestX=0, bestY=0;
+  uint32_t bestSAD = mAccel->sad_8(blk,stride, &ref->lowres[y0*stride+x0],stride, 8,8);
+
+  if (pmvx!=0 || pmvy!=0) {
+    uint32_t sad = mAccel->sad_8(blk,stride, &ref->lowres[(y0+pmvy)*stride+x0+pmvx],stride, 8,8);
+    if (sad<bestSAD) { bestSAD=sad; bestX=pmvx; bestY=pmvy; }
+  }
+
+  // small diamond search
+
+  static const int dx[4] = { -1,1, 0,0 };
+  static const int dy[4] = {  0,0,-1,1 };
+
+  for (int iter=0; iter<2*LOOKAHEAD_SEARCH_RANGE; iter++) {
+    int centerX = bestX;
+    int centerY = bestY;
+
+    for (int i=0;i<4;i++) {
+      int x = centerX+dx[i];
+      int y = centerY+dy[i];
+      if (x<minX || x>maxX || y<minY || y>maxY) continue;
+
+      uint32_t sad = mAccel->sad_8(blk,stride, &ref->lowres[(y0+y)*stride+x0+x],stride, 8,8);
+      if (sad<bestSAD) { bestSAD=sad; bestX=x; bestY=y; }
+    }
+
+    if (bestX==centerX && bestY==centerY) {
+      break;
+    }
+  }
+
+  mvx = bestX;
+  mvy = bestY;
+
+  // rough estimate of the motion vector coding cost
+  int mvCost = 2*(abs_value(bestX-pmvx) + abs_value(bestY-pmvy));
+
+  return mAccel->satd_8[1](blk,stride, &ref->lowres[(y0+bestY)*stride+x0+bestX],stride) + mvCost;
+}
+
+
+void encoder_lookahead::compute_costs(lookahead_frame* frame, const lookahead_frame* prev) const
+{
+  const int wBlks = frame->width  / 8;
+  const int hBlks = frame->height / 8;
+
+  bool haveRef = (prev != NULL &&
+                  prev->width  == frame->width &&
+                  prev->height == frame->height);
+
+  std::vector<int> mvs(2*wBlks, 0); // vectors of the previous block row
+
+  frame->num_blocks = wBlks*hBlks;
+  frame->intra_cost = 0;
+  frame->inter_cost = 0;
+
+  for (int by=0;by<hBlks;by++) {
+    int leftMvX=0, leftMvY=0;
+
+    for (int bx=0;bx<wBlks;bx++) {
+      int intraCost = intra_block_cost(frame, bx,by);
+      int blkCost   = intraCost;
+
+      if (haveRef) {
+        // predict the vector from the left and top neighbors
+
+        int mvx = (bx>0) ? leftMvX : mvs[2*bx];
+        int mvy = (bx>0) ? leftMvY : mvs[2*bx+1];
+
+        int interCost = inter_block_cost(frame, prev, bx,by, mvx,mvy);
+        blkCost = libde265_min(intraCost, interCost);
+
+        leftMvX = mvs[2*bx  ] = mvx;
+        leftMvY = mvs[2*bx+1] = mvy;
+      }
+
+      frame->intra_cost += intraCost;
+      frame->inter_cost += blkCost;
+    }
+  }
+}
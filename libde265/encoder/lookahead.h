@@ -0,0 +1,143 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DE265_LOOKAHEAD_H
+#define DE265_LOOKAHEAD_H
+
+#include "libde265/image.h"
+#include "libde265/acceleration.h"
+#include "libde265/threads.h"
+
+#include <deque>
+#include <vector>
+
+
+/* Complexity analysis of the input pictures on a 2x downsampled luma plane.
+   The costs are SATD sums over 8x8 blocks of the low-resolution image, i.e.
+   one block corresponds to a 16x16 area in the original picture.
+
+   The analysis runs on its own thread ahead of the encoder. Input pictures
+   are analyzed in input order, before the SOP creator decides on their
+   picture type, such that scene cuts can be taken into account.
+ */
+
+struct lookahead_frame
+{
+  lookahead_frame();
+
+  int frame_number;
+  bool is_intra;   // picture type as decided by the SOP creator
+  bool type_set;   // is_intra is only valid after the SOP creator has seen the frame
+
+  // low-resolution luma, padded to a multiple of 8 pixels
+  int width, height;
+  int stride;
+  std::vector<uint8_t> lowres;
+
+  int num_blocks;
+
+  int64_t intra_cost;  // sum of the block intra costs
+  int64_t inter_cost;  // sum of min(intra,inter) block costs against the previous frame
+
+  // cost of the picture as it will be coded
+  int64_t get_cost() const { return is_intra ? intra_cost : inter_cost; }
+
+  const uint8_t* get_block(int bx,int by) const { return &lowres[(by*stride + bx)*8]; }
+};
+
+
+class encoder_lookahead
+{
+ public:
+  encoder_lookahead();
+  ~encoder_lookahead();
+
+  void set_acceleration_functions(const acceleration_functions* accel) { mAccel=accel; }
+
+  void start();  // start the analysis thread
+  void stop();   // stop the analysis thread (pending input pictures are dropped)
+
+  void analysis_thread_main(); // internal, runs on the analysis thread
+
+  void reset();
+
+  /* Queue the next input picture for analysis. The image has to stay valid
+     until the frame has been analyzed. */
+  void push_image(const de265_image* input, int frame_number);
+
+  bool is_analyzed(int frame_number) const;
+  void wait_until_analyzed(int frame_number) const;
+
+  // picture type decision of the SOP creator
+  void set_frame_type(int frame_number, bool is_intra);
+
+  const lookahead_frame* get_frame(int frame_number) const; // NULL if not (or no more) available
+
+  /* Costs of the frames starting at 'frame_number' that are already analyzed
+     and have their picture type assigned (at most 'maxFrames').
+     The first entry is the frame itself. */
+  std::vector<const lookahead_frame*> get_frames(int frame_number, int maxFrames) const;
+
+  // frames before this are not needed anymore (the last one is kept as inter reference)
+  void release_frames_before(int frame_number);
+
+  /* Scene-cut decision in the style of x264: the frame is a scene cut when
+     inter prediction saves less than a threshold over intra coding.
+     The threshold grows with the distance to the last intra frame, such that
+     the GOP length adapts between the minimum and maximum intra period. */
+  bool is_scene_cut(int frame_number, int distanceToLastIntra,
+                    int minIntraPeriod, int maxIntraPeriod, int threshold) const;
+
+ private:
+  const acceleration_functions* mAccel;
+
+  std::deque<lookahead_frame*> mFrames;    // analyzed frames
+
+  struct input_picture {
+    const de265_image* image;
+    int frame_number;
+  };
+
+  std::deque<input_picture> mInputQueue; // frames waiting for analysis
+
+  // --- analysis thread ---
+
+  bool mThreadRunning;
+  bool mStopThread;
+
+  de265_thread mThread;
+  mutable de265_mutex mMutex;
+  mutable de265_cond  mInputAvailable;
+  mutable de265_cond  mFrameAnalyzed;
+
+  lookahead_frame* find_frame(int frame_number) const;
+
+  lookahead_frame* analyze_image(const input_picture& input, const lookahead_frame* prev) const;
+
+  void downsample(lookahead_frame* frame, const de265_image* input) const;
+  void compute_costs(lookahead_frame* frame, const lookahead_frame* prev) const;
+
+  int intra_block_cost(const lookahead_frame* frame, int bx,int by) const;
+  int inter_block_cost(const lookahead_frame* frame, const lookahead_frame* ref,
+                       int bx,int by, int& mvx,int& mvy) const;
+};
+
+
+#endif
@@ -119,15 +119,30 @@ class sop_creator_trivial_low_delay : public sop_creator
   struct params {
     params() {
       intraPeriod.set_ID("sop-lowDelay-intraPeriod");
+      intraPeriod.set_description("maximum distance between intra frames");
       intraPeriod.set_minimum(1);
       intraPeriod.set_default(250);
+
+      minIntraPeriod.set_ID("sop-lowDelay-minIntraPeriod");
+      minIntraPeriod.set_description("distance after an intra frame in which scene cuts are less likely inserted");
+      minIntraPeriod.set_minimum(1);
+      minIntraPeriod.set_default(5);
+
+      sceneCut.set_ID("sop-lowDelay-sceneCut");
+      sceneCut.set_description("scene-cut detection threshold, e.g. 40 (0: no scene-cut detection)");
+      sceneCut.set_range(0,100);
+      sceneCut.set_default(0);
     }
 
     void registerParams(config_parameters& config) {
       config.add_option(&intraPeriod);
+      config.add_option(&minIntraPeriod);
+      config.add_option(&sceneCut);
     }
 
     option_int intraPeriod;
+    option_int minIntraPeriod;
+    option_int sceneCut;
   };
 
   sop_creator_trivial_low_delay();
@@ -137,10 +152,15 @@ class sop_creator_trivial_low_delay : public sop_creator
   virtual void set_SPS_header_values();
   virtual void insert_new_input_image(de265_image* img);
 
+  // whether the input pictures have to be analyzed in the lookahead
+  bool use_scene_cut_detection() const { return mParams.sceneCut > 0; }
+
  private:
   params mParams;
 
-  bool isIntra(int frame) const { return (frame % mParams.intraPeriod)==0; }
+  int mLastIntraFrame;
+
+  bool isIntra(int frame) const;
 };
 
 
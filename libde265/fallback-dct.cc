@@ -510,7 +510,7 @@ void transform_idst_4x4_fallback(int32_t *dst, const int16_t *coeffs, int bdShif
 
 
 
-static int8_t mat_dct[32][32] = {
+const int8_t mat_dct[32][32] = {
   { 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,      64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64},
   { 90, 90, 88, 85, 82, 78, 73, 67, 61, 54, 46, 38, 31, 22, 13,  4,      -4,-13,-22,-31,-38,-46,-54,-61,-67,-73,-78,-82,-85,-88,-90,-90},
   { 90, 87, 80, 70, 57, 43, 25,  9, -9,-25,-43,-57,-70,-80,-87,-90,     -90,-87,-80,-70,-57,-43,-25, -9,  9, 25, 43, 57, 70, 80, 87, 90},
@@ -904,6 +904,233 @@ void transform_32x32_add_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdi
 }
 
 
+/* Inverse DCT when all non-zero coefficients are within the top-left nzW x nzH
+   area. The vertical pass only has to be computed for the first nzW columns
+   and only over nzH coefficients. The horizontal pass then only sees nzW
+   non-zero inputs per row. The result is identical to the full transform. */
+
+template <class pixel_t>
+void transform_idct_add_partial(pixel_t *dst, ptrdiff_t stride,
+                                int nT, const int16_t *coeffs, int bit_depth,
+                                int nzW, int nzH)
+{
+  int postShift = 20-bit_depth;
+  int rnd1 = 1<<(7-1);
+  int rnd2 = 1<<(postShift-1);
+  int fact = (1<<(5-Log2(nT)));
+
+  int16_t g[32*32];  // [nT][nzW]
+
+  for (int c=0;c<nzW;c++) {
+    for (int i=0;i<nT;i++) {
+      int sum=0;
+      for (int j=0;j<nzH;j++) {
+        sum += mat_dct[fact*j][i] * coeffs[c+j*nT];
+      }
+
+      g[c+i*nzW] = Clip3(-32768,32767, (sum+rnd1)>>7);
+    }
+  }
+
+  for (int y=0;y<nT;y++) {
+    int sum[32];
+    for (int i=0;i<nT;i++) { sum[i]=rnd2; }
+
+    for (int j=0;j<nzW;j++) {
+      int v = g[y*nzW+j];
+      const int8_t* m = mat_dct[fact*j];
+      for (int i=0;i<nT;i++) {
+        sum[i] += m[i] * v;
+      }
+    }
+
+    for (int i=0;i<nT;i++) {
+      dst[y*stride+i] = Clip_BitDepth(dst[y*stride+i] + (sum[i]>>postShift), bit_depth);
+    }
+  }
+}
+
+
+void transform_idct_partial_fallback(int32_t *dst, int nT, const int16_t *coeffs,
+                                     int bdShift, int max_coeff_bits, int nzW, int nzH)
+{
+  int rnd1 = 1<<(7-1);
+  int rnd2 = 1<<(bdShift-1);
+  int fact = (1<<(5-Log2(nT)));
+
+  int CoeffMax = (1<<max_coeff_bits)-1;
+  int CoeffMin = -(1<<max_coeff_bits);
+
+  int16_t g[32*32];  // [nT][nzW]
+
+  for (int c=0;c<nzW;c++) {
+    for (int i=0;i<nT;i++) {
+      int sum=0;
+      for (int j=0;j<nzH;j++) {
+        sum += mat_dct[fact*j][i] * coeffs[c+j*nT];
+      }
+
+      g[c+i*nzW] = Clip3(CoeffMin,CoeffMax, (sum+rnd1)>>7);
+    }
+  }
+
+  for (int y=0;y<nT;y++) {
+    int32_t* out = &dst[y*nT];
+    for (int i=0;i<nT;i++) { out[i]=rnd2; }
+
+    for (int j=0;j<nzW;j++) {
+      int v = g[y*nzW+j];
+      const int8_t* m = mat_dct[fact*j];
+      for (int i=0;i<nT;i++) {
+        out[i] += m[i] * v;
+      }
+    }
+
+    for (int i=0;i<nT;i++) {
+      out[i] >>= bdShift;
+    }
+  }
+}
+
+
+void transform_idct_partial_4x4_fallback(int32_t *dst, const int16_t *coeffs, int bdShift,
+                                         int max_coeff_bits, int nzW, int nzH)
+{
+  transform_idct_partial_fallback(dst,4,coeffs,bdShift,max_coeff_bits,nzW,nzH);
+}
+
+void transform_idct_partial_8x8_fallback(int32_t *dst, const int16_t *coeffs, int bdShift,
+                                         int max_coeff_bits, int nzW, int nzH)
+{
+  transform_idct_partial_fallback(dst,8,coeffs,bdShift,max_coeff_bits,nzW,nzH);
+}
+
+void transform_idct_partial_16x16_fallback(int32_t *dst, const int16_t *coeffs, int bdShift,
+                                           int max_coeff_bits, int nzW, int nzH)
+{
+  transform_idct_partial_fallback(dst,16,coeffs,bdShift,max_coeff_bits,nzW,nzH);
+}
+
+void transform_idct_partial_32x32_fallback(int32_t *dst, const int16_t *coeffs, int bdShift,
+                                           int max_coeff_bits, int nzW, int nzH)
+{
+  transform_idct_partial_fallback(dst,32,coeffs,bdShift,max_coeff_bits,nzW,nzH);
+}
+
+
+void transform_4x4_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                          int nzW, int nzH)
+{
+  transform_idct_add_partial<uint8_t>(dst,stride,  4, coeffs, 8, nzW,nzH);
+}
+
+void transform_8x8_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                          int nzW, int nzH)
+{
+  transform_idct_add_partial<uint8_t>(dst,stride,  8, coeffs, 8, nzW,nzH);
+}
+
+void transform_16x16_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                            int nzW, int nzH)
+{
+  transform_idct_add_partial<uint8_t>(dst,stride,  16, coeffs, 8, nzW,nzH);
+}
+
+void transform_32x32_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                            int nzW, int nzH)
+{
+  transform_idct_add_partial<uint8_t>(dst,stride,  32, coeffs, 8, nzW,nzH);
+}
+
+
+void transform_4x4_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                           int bit_depth, int nzW, int nzH)
+{
+  transform_idct_add_partial<uint16_t>(dst,stride,  4, coeffs, bit_depth, nzW,nzH);
+}
+
+void transform_8x8_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                           int bit_depth, int nzW, int nzH)
+{
+  transform_idct_add_partial<uint16_t>(dst,stride,  8, coeffs, bit_depth, nzW,nzH);
+}
+
+void transform_16x16_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                             int bit_depth, int nzW, int nzH)
+{
+  transform_idct_add_partial<uint16_t>(dst,stride,  16, coeffs, bit_depth, nzW,nzH);
+}
+
+void transform_32x32_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                             int bit_depth, int nzW, int nzH)
+{
+  transform_idct_add_partial<uint16_t>(dst,stride,  32, coeffs, bit_depth, nzW,nzH);
+}
+
+
+/* DC-only inverse DCT: both passes reduce to a multiplication with 64,
+   hence all residual samples are equal. */
+
+template <class pixel_t>
+void transform_dc_add(pixel_t *dst, ptrdiff_t stride, int nT, int16_t dc, int bit_depth)
+{
+  int postShift = 20-bit_depth;
+
+  int g = Clip3(-32768,32767, (64*dc + (1<<6))>>7);
+  int r = (64*g + (1<<(postShift-1)))>>postShift;
+
+  for (int y=0;y<nT;y++)
+    for (int x=0;x<nT;x++) {
+      dst[y*stride+x] = Clip_BitDepth(dst[y*stride+x] + r, bit_depth);
+    }
+}
+
+
+void transform_dc_add_8_fallback(uint8_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride)
+{
+  transform_dc_add<uint8_t>(dst,stride, nT, coeffs[0], 8);
+}
+
+void transform_dc_add_16_fallback(uint16_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride,
+                                  int bit_depth)
+{
+  transform_dc_add<uint16_t>(dst,stride, nT, coeffs[0], bit_depth);
+}
+
+
+
+static inline int16_t dequant(int16_t coeff, int m_x_y, int levelScale, int qPper, int bdShift)
+{
+  int64_t fact = (int64_t)(m_x_y * levelScale) << qPper;
+
+  int64_t value = (coeff * fact + (1<<(bdShift-1))) >> bdShift;
+
+  return Clip3(-32768,32767, value);
+}
+
+void dequant_coefficients_fallback(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                                   int nCoeff, const uint8_t* sclist,
+                                   int levelScale, int qPper, int bdShift)
+{
+  for (int i=0;i<nCoeff;i++) {
+    int pos = coeffPos[i];
+    int m_x_y = (sclist ? sclist[pos] : 16);
+
+    coeffBuf[pos] = dequant(coeffList[i], m_x_y, levelScale, qPper, bdShift);
+  }
+}
+
+void dequant_block_fallback(int16_t* coeffs, int n, const uint8_t* sclist,
+                            int levelScale, int qPper, int bdShift)
+{
+  for (int i=0;i<n;i++) {
+    int m_x_y = (sclist ? sclist[i] : 16);
+
+    coeffs[i] = dequant(coeffs[i], m_x_y, levelScale, qPper, bdShift);
+  }
+}
+
+
 static void transform_fdct_8(int16_t* coeffs, int nT,
                              const int16_t *input, ptrdiff_t stride)
 {
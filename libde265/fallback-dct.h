@@ -27,6 +27,10 @@
 #include "util.h"
 
 
+// HEVC DCT matrix (8.6.4.2), row k holds the k-th basis function
+extern const int8_t mat_dct[32][32];
+
+
 // --- decoding ---
 
 void transform_skip_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
@@ -62,6 +66,33 @@ void transform_idct_8x8_fallback(int32_t *dst, const int16_t *coeffs, int bdShif
 void transform_idct_16x16_fallback(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits);
 void transform_idct_32x32_fallback(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits);
 
+// only the top-left nzW x nzH coefficients may be non-zero
+void transform_idct_partial_4x4_fallback(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits, int nzW, int nzH);
+void transform_idct_partial_8x8_fallback(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits, int nzW, int nzH);
+void transform_idct_partial_16x16_fallback(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits, int nzW, int nzH);
+void transform_idct_partial_32x32_fallback(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits, int nzW, int nzH);
+
+void transform_4x4_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int nzW, int nzH);
+void transform_8x8_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int nzW, int nzH);
+void transform_16x16_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int nzW, int nzH);
+void transform_32x32_add_partial_8_fallback(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int nzW, int nzH);
+
+void transform_4x4_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH);
+void transform_8x8_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH);
+void transform_16x16_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH);
+void transform_32x32_add_partial_16_fallback(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth, int nzW, int nzH);
+
+// only the DC coefficient is non-zero
+void transform_dc_add_8_fallback(uint8_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride);
+void transform_dc_add_16_fallback(uint16_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride, int bit_depth);
+
+// inverse quantization (8.6.3), m_x_y from the scaling list or 16 if 'sclist' is NULL
+void dequant_coefficients_fallback(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                                   int nCoeff, const uint8_t* sclist,
+                                   int levelScale, int qPper, int bdShift);
+void dequant_block_fallback(int16_t* coeffs, int n, const uint8_t* sclist,
+                            int levelScale, int qPper, int bdShift);
+
 template <class pixel_t>
 void add_residual_fallback(pixel_t *dst, ptrdiff_t stride,
                            const int32_t* r, int nT, int bit_depth)
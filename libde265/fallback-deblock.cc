@@ -0,0 +1,55 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "fallback-deblock.h"
+#include "image.h"
+
+
+uint32_t deblock_boundary_strength_fallback(uint8_t* q, const uint8_t* p, int n, uint32_t posMask,
+                                            uint8_t edgeMask, uint8_t transformEdgeMask)
+{
+  uint32_t motionMask = 0;
+
+  for (int i=0;i<n;i++) {
+    if ((posMask & (1<<i)) == 0) {
+      continue;
+    }
+
+    const uint8_t pq = p[i] | q[i];
+    uint8_t bS = 0;
+
+    if (q[i] & edgeMask) {
+      if (pq & DEBLOCK_FLAG_INTRA) {
+        bS = 2;
+      }
+      else if ((q[i] & transformEdgeMask) && (pq & DEBLOCK_FLAG_NONZERO_COEFF)) {
+        bS = 1;
+      }
+      else {
+        motionMask |= (1<<i);
+      }
+    }
+
+    q[i] = (q[i] & ~DEBLOCK_BS_MASK) | bS;
+  }
+
+  return motionMask;
+}
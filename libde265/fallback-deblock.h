@@ -0,0 +1,31 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FALLBACK_DEBLOCK_H
+#define FALLBACK_DEBLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+
+uint32_t deblock_boundary_strength_fallback(uint8_t* q, const uint8_t* p, int n, uint32_t posMask,
+                                            uint8_t edgeMask, uint8_t transformEdgeMask);
+
+#endif
@@ -0,0 +1,186 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "fallback-distortion.h"
+#include "fallback-dct.h"
+#include "util.h"
+
+
+template <class pixel_t>
+uint32_t sad_fallback(const pixel_t* img, ptrdiff_t imgStride,
+                      const pixel_t* ref, ptrdiff_t refStride,
+                      int width, int height)
+{
+  uint32_t sum=0;
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<width;x++) {
+      int diff = img[x] - ref[x];
+      sum += abs_value(diff);
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return sum;
+}
+
+
+template <class pixel_t>
+uint64_t ssd_fallback(const pixel_t* img, ptrdiff_t imgStride,
+                      const pixel_t* ref, ptrdiff_t refStride,
+                      int width, int height)
+{
+  uint64_t sum=0;
+
+  for (int y=0;y<height;y++) {
+    uint64_t lineSum=0;
+
+    for (int x=0;x<width;x++) {
+      int64_t diff = img[x] - ref[x];
+      lineSum += diff*diff;
+    }
+
+    sum += lineSum;
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return sum;
+}
+
+
+static uint32_t satd_8(int log2BlkSize,
+                        const uint8_t* img, ptrdiff_t imgStride,
+                        const uint8_t* ref, ptrdiff_t refStride)
+{
+  if (log2BlkSize==6) {
+    // 64x64 blocks are transformed as four 32x32 blocks
+
+    return (satd_8(5, img,    imgStride, ref,    refStride) +
+            satd_8(5, img+32, imgStride, ref+32, refStride) +
+            satd_8(5, img+32*imgStride,    imgStride, ref+32*refStride,    refStride) +
+            satd_8(5, img+32*imgStride+32, imgStride, ref+32*refStride+32, refStride));
+  }
+
+  const int blkSize = 1<<log2BlkSize;
+
+  int16_t diff[32*32];
+  int16_t coeffs[32*32];
+
+  for (int y=0;y<blkSize;y++)
+    for (int x=0;x<blkSize;x++) {
+      diff[y*blkSize+x] = img[y*imgStride+x] - ref[y*refStride+x];
+    }
+
+  switch (log2BlkSize) {
+  case 2: hadamard_4x4_8_fallback  (coeffs, diff, blkSize); break;
+  case 3: hadamard_8x8_8_fallback  (coeffs, diff, blkSize); break;
+  case 4: hadamard_16x16_8_fallback(coeffs, diff, blkSize); break;
+  case 5: hadamard_32x32_8_fallback(coeffs, diff, blkSize); break;
+  }
+
+  uint32_t sum=0;
+  for (int i=0;i<blkSize*blkSize;i++) {
+    sum += abs_value((int)coeffs[i]);
+  }
+
+  return sum;
+}
+
+
+static void hadamard_1d_32bit(int32_t* v, int n, int step)
+{
+  for (int h=n/2; h>=1; h>>=1)
+    for (int blk=0; blk<n; blk+=2*h)
+      for (int i=blk; i<blk+h; i++) {
+        int32_t a = v[ i   *step];
+        int32_t b = v[(i+h)*step];
+        v[ i   *step] = a+b;
+        v[(i+h)*step] = a-b;
+      }
+}
+
+
+static uint32_t satd_16(int log2BlkSize,
+                         const uint16_t* img, ptrdiff_t imgStride,
+                         const uint16_t* ref, ptrdiff_t refStride)
+{
+  if (log2BlkSize==6) {
+    return (satd_16(5, img,    imgStride, ref,    refStride) +
+            satd_16(5, img+32, imgStride, ref+32, refStride) +
+            satd_16(5, img+32*imgStride,    imgStride, ref+32*refStride,    refStride) +
+            satd_16(5, img+32*imgStride+32, imgStride, ref+32*refStride+32, refStride));
+  }
+
+  const int blkSize = 1<<log2BlkSize;
+
+  int32_t coeffs[32*32];
+
+  for (int y=0;y<blkSize;y++)
+    for (int x=0;x<blkSize;x++) {
+      coeffs[y*blkSize+x] = img[y*imgStride+x] - ref[y*refStride+x];
+    }
+
+  for (int y=0;y<blkSize;y++) { hadamard_1d_32bit(&coeffs[y*blkSize], blkSize, 1); }
+  for (int x=0;x<blkSize;x++) { hadamard_1d_32bit(&coeffs[x], blkSize, blkSize); }
+
+  uint32_t sum=0;
+  for (int i=0;i<blkSize*blkSize;i++) {
+    sum += abs_value(coeffs[i]);
+  }
+
+  return sum;
+}
+
+
+template <int log2BlkSize>
+uint32_t satd_8_fallback(const uint8_t* img, ptrdiff_t imgStride,
+                         const uint8_t* ref, ptrdiff_t refStride)
+{
+  return satd_8(log2BlkSize, img,imgStride, ref,refStride);
+}
+
+template <int log2BlkSize>
+uint32_t satd_16_fallback(const uint16_t* img, ptrdiff_t imgStride,
+                          const uint16_t* ref, ptrdiff_t refStride)
+{
+  return satd_16(log2BlkSize, img,imgStride, ref,refStride);
+}
+
+
+template uint32_t sad_fallback<uint8_t> (const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t, int, int);
+template uint32_t sad_fallback<uint16_t>(const uint16_t*,ptrdiff_t, const uint16_t*,ptrdiff_t, int, int);
+template uint64_t ssd_fallback<uint8_t> (const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t, int, int);
+template uint64_t ssd_fallback<uint16_t>(const uint16_t*,ptrdiff_t, const uint16_t*,ptrdiff_t, int, int);
+
+template uint32_t satd_8_fallback<2>(const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t);
+template uint32_t satd_8_fallback<3>(const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t);
+template uint32_t satd_8_fallback<4>(const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t);
+template uint32_t satd_8_fallback<5>(const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t);
+template uint32_t satd_8_fallback<6>(const uint8_t*, ptrdiff_t, const uint8_t*, ptrdiff_t);
+
+template uint32_t satd_16_fallback<2>(const uint16_t*, ptrdiff_t, const uint16_t*, ptrdiff_t);
+template uint32_t satd_16_fallback<3>(const uint16_t*, ptrdiff_t, const uint16_t*, ptrdiff_t);
+template uint32_t satd_16_fallback<4>(const uint16_t*, ptrdiff_t, const uint16_t*, ptrdiff_t);
+template uint32_t satd_16_fallback<5>(const uint16_t*, ptrdiff_t, const uint16_t*, ptrdiff_t);
+template uint32_t satd_16_fallback<6>(const uint16_t*, ptrdiff_t, const uint16_t*, ptrdiff_t);
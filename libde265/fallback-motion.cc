@@ -646,3 +646,207 @@ QPEL(3,0) QPEL(3,1) QPEL(3,2) QPEL(3,3)
 QPEL16(1,0) QPEL16(1,1) QPEL16(1,2) QPEL16(1,3)
 QPEL16(2,0) QPEL16(2,1) QPEL16(2,2) QPEL16(2,3)
 QPEL16(3,0) QPEL16(3,1) QPEL16(3,2) QPEL16(3,3)
+
+
+
+// --- bi-prediction with default weights ---
+
+#define MAX_PB_SIZE 64
+
+// Fractional sample interpolation filters (8.5.3.3.3.1 and 8.5.3.3.3.2).
+// Entry 0 is the full-sample position, the filter center is at tap 3 (qpel) or 1 (epel).
+
+static const int8_t qpel_filter_taps[4][8] = {
+  {  0, 0,  0, 64,  0,  0, 0,  0 },
+  { -1, 4,-10, 58, 17, -5, 1,  0 },
+  { -1, 4,-11, 40, 40,-11, 4, -1 },
+  {  0, 1, -5, 17, 58,-10, 4, -1 }
+};
+
+static const int8_t epel_filter_taps[8][4] = {
+  {  0, 64,  0,  0 },
+  { -2, 58, 10, -2 },
+  { -4, 54, 16, -2 },
+  { -6, 46, 28, -4 },
+  { -4, 36, 36, -4 },
+  { -4, 28, 46, -6 },
+  { -2, 16, 54, -4 },
+  { -2, 10, 58, -2 }
+};
+
+
+/* Interpolation of one prediction block, delivered row by row with the same
+   intermediate precision as put_qpel_fallback() / put_epel_hv_fallback().
+   Zero filter taps are skipped, so that no samples outside of the area required
+   by the standard are accessed.
+ */
+template <class pixel_t, int nTaps>
+class mc_row_interpolator
+{
+public:
+  mc_row_interpolator(const pixel_t* src, ptrdiff_t stride,
+                      const int8_t* hfilter, const int8_t* vfilter,
+                      int width, int height, int bit_depth)
+    : mSrc(src), mStride(stride), mH(hfilter), mV(vfilter), mWidth(width),
+      mShift1(bit_depth-8), mShift3(14-bit_depth)
+  {
+    const int center = nTaps/2-1;
+
+    mHFull = (hfilter[center]==64);
+    mVFull = (vfilter[center]==64);
+    taps_range(hfilter, mHFirst, mHEnd);
+    taps_range(vfilter, mVFirst, mVEnd);
+
+    // separable filtering: compute the horizontally filtered rows first
+
+    if (!mHFull && !mVFull) {
+      for (int r=mVFirst; r<height-1+mVEnd; r++) {
+        filter_h(&mTmp[r*MAX_PB_SIZE], mSrc + (r-center)*mStride);
+      }
+    }
+  }
+
+  void get_row(int16_t* out, int y) const
+  {
+    const int center = nTaps/2-1;
+
+    if (mHFull && mVFull) {
+      const pixel_t* p = mSrc + y*mStride;
+      for (int x=0;x<mWidth;x++) {
+        out[x] = p[x] << mShift3;
+      }
+    }
+    else if (mVFull) {
+      filter_h(out, mSrc + y*mStride);
+    }
+    else if (mHFull) {
+      const pixel_t* p = mSrc + (y-center)*mStride;
+      for (int x=0;x<mWidth;x++) {
+        int sum=0;
+        for (int k=mVFirst;k<mVEnd;k++) {
+          sum += mV[k] * p[x + k*mStride];
+        }
+        out[x] = sum >> mShift1;
+      }
+    }
+    else {
+      const int16_t* t = &mTmp[y*MAX_PB_SIZE];
+      for (int x=0;x<mWidth;x++) {
+        int sum=0;
+        for (int k=mVFirst;k<mVEnd;k++) {
+          sum += mV[k] * t[x + k*MAX_PB_SIZE];
+        }
+        out[x] = sum >> 6;
+      }
+    }
+  }
+
+private:
+  static void taps_range(const int8_t* filter, int& first, int& end)
+  {
+    first=0;     while (filter[first]==0) first++;
+    end  =nTaps; while (filter[end-1]==0) end--;
+  }
+
+  void filter_h(int16_t* out, const pixel_t* p) const
+  {
+    const int center = nTaps/2-1;
+
+    p -= center;
+    for (int x=0;x<mWidth;x++) {
+      int sum=0;
+      for (int k=mHFirst;k<mHEnd;k++) {
+        sum += mH[k] * p[x+k];
+      }
+      out[x] = sum >> mShift1;
+    }
+  }
+
+  const pixel_t* mSrc;
+  ptrdiff_t mStride;
+  const int8_t* mH;
+  const int8_t* mV;
+  int mWidth;
+  int mShift1, mShift3;
+  bool mHFull, mVFull;
+  int mHFirst, mHEnd;
+  int mVFirst, mVEnd;
+
+  int16_t mTmp[(MAX_PB_SIZE+nTaps-1)*MAX_PB_SIZE];
+};
+
+
+template <class pixel_t, int nTaps>
+static void put_bi_fallback(pixel_t *dst, ptrdiff_t dststride,
+                            const pixel_t *src0, ptrdiff_t src0stride,
+                            const int8_t* hfilter0, const int8_t* vfilter0,
+                            const pixel_t *src1, ptrdiff_t src1stride,
+                            const int8_t* hfilter1, const int8_t* vfilter1,
+                            int width, int height, int bit_depth)
+{
+  assert(width <= MAX_PB_SIZE && height <= MAX_PB_SIZE);
+
+  const int shift2  = 15-bit_depth;
+  const int offset2 = 1<<(shift2-1);
+
+  mc_row_interpolator<pixel_t,nTaps> pred0(src0,src0stride, hfilter0,vfilter0, width,height, bit_depth);
+  mc_row_interpolator<pixel_t,nTaps> pred1(src1,src1stride, hfilter1,vfilter1, width,height, bit_depth);
+
+  int16_t row0[MAX_PB_SIZE];
+  int16_t row1[MAX_PB_SIZE];
+
+  for (int y=0;y<height;y++) {
+    pred0.get_row(row0, y);
+    pred1.get_row(row1, y);
+
+    pixel_t* out = &dst[y*dststride];
+    for (int x=0;x<width;x++) {
+      out[x] = Clip_BitDepth((row0[x] + row1[x] + offset2)>>shift2, bit_depth);
+    }
+  }
+}
+
+
+void put_qpel_bi_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                            const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                            const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                            int width, int height)
+{
+  put_bi_fallback<uint8_t,8>(dst,dststride,
+                             src0,src0stride, qpel_filter_taps[mx0], qpel_filter_taps[my0],
+                             src1,src1stride, qpel_filter_taps[mx1], qpel_filter_taps[my1],
+                             width,height, 8);
+}
+
+void put_epel_bi_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                            const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                            const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                            int width, int height)
+{
+  put_bi_fallback<uint8_t,4>(dst,dststride,
+                             src0,src0stride, epel_filter_taps[mx0], epel_filter_taps[my0],
+                             src1,src1stride, epel_filter_taps[mx1], epel_filter_taps[my1],
+                             width,height, 8);
+}
+
+void put_qpel_bi_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                             const uint16_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                             int width, int height, int bit_depth)
+{
+  put_bi_fallback<uint16_t,8>(dst,dststride,
+                              src0,src0stride, qpel_filter_taps[mx0], qpel_filter_taps[my0],
+                              src1,src1stride, qpel_filter_taps[mx1], qpel_filter_taps[my1],
+                              width,height, bit_depth);
+}
+
+void put_epel_bi_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                             const uint16_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                             int width, int height, int bit_depth)
+{
+  put_bi_fallback<uint16_t,4>(dst,dststride,
+                              src0,src0stride, epel_filter_taps[mx0], epel_filter_taps[my0],
+                              src1,src1stride, epel_filter_taps[mx1], epel_filter_taps[my1],
+                              width,height, bit_depth);
+}
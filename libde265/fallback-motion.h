@@ -80,6 +80,25 @@ void put_epel_hv_fallback(int16_t *dst, ptrdiff_t dststride,
                           int mx, int my, int16_t* mcbuffer, int bit_depth);
 
 
+void put_qpel_bi_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                            const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                            const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                            int width, int height);
+void put_epel_bi_8_fallback(uint8_t *dst, ptrdiff_t dststride,
+                            const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                            const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                            int width, int height);
+
+void put_qpel_bi_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                             const uint16_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                             int width, int height, int bit_depth);
+void put_epel_bi_16_fallback(uint16_t *dst, ptrdiff_t dststride,
+                             const uint16_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                             const uint16_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                             int width, int height, int bit_depth);
+
+
 #define QPEL(x,y) void put_qpel_ ## x ## _ ## y ## _fallback(int16_t *out, ptrdiff_t out_stride, \
                            const uint8_t *src, ptrdiff_t srcstride, \
                            int nPbW, int nPbH, int16_t* mcbuffer)
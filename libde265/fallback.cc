@@ -21,6 +21,8 @@
 #include "fallback.h"
 #include "fallback-motion.h"
 #include "fallback-dct.h"
+#include "fallback-distortion.h"
+#include "fallback-deblock.h"
 
 
 void init_acceleration_functions_fallback(struct acceleration_functions* accel)
@@ -80,8 +82,15 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->put_hevc_qpel_16[3][2] = put_qpel_3_2_fallback_16;
   accel->put_hevc_qpel_16[3][3] = put_qpel_3_3_fallback_16;
 
+  accel->put_hevc_qpel_bi_8  = put_qpel_bi_8_fallback;
+  accel->put_hevc_epel_bi_8  = put_epel_bi_8_fallback;
+  accel->put_hevc_qpel_bi_16 = put_qpel_bi_16_fallback;
+  accel->put_hevc_epel_bi_16 = put_epel_bi_16_fallback;
 
 
+  accel->dequant_coefficients = dequant_coefficients_fallback;
+  accel->dequant_block        = dequant_block_fallback;
+
   accel->transform_skip_8 = transform_skip_8_fallback;
   accel->transform_skip_rdpcm_h_8 = transform_skip_rdpcm_h_8_fallback;
   accel->transform_skip_rdpcm_v_8 = transform_skip_rdpcm_v_8_fallback;
@@ -93,6 +102,11 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->transform_add_8[1] = transform_8x8_add_8_fallback;
   accel->transform_add_8[2] = transform_16x16_add_8_fallback;
   accel->transform_add_8[3] = transform_32x32_add_8_fallback;
+  accel->transform_add_partial_8[0] = transform_4x4_add_partial_8_fallback;
+  accel->transform_add_partial_8[1] = transform_8x8_add_partial_8_fallback;
+  accel->transform_add_partial_8[2] = transform_16x16_add_partial_8_fallback;
+  accel->transform_add_partial_8[3] = transform_32x32_add_partial_8_fallback;
+  accel->transform_dc_add_8 = transform_dc_add_8_fallback;
 
   accel->transform_skip_16 = transform_skip_16_fallback;
   accel->transform_4x4_dst_add_16 = transform_4x4_luma_add_16_fallback;
@@ -100,6 +114,11 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->transform_add_16[1] = transform_8x8_add_16_fallback;
   accel->transform_add_16[2] = transform_16x16_add_16_fallback;
   accel->transform_add_16[3] = transform_32x32_add_16_fallback;
+  accel->transform_add_partial_16[0] = transform_4x4_add_partial_16_fallback;
+  accel->transform_add_partial_16[1] = transform_8x8_add_partial_16_fallback;
+  accel->transform_add_partial_16[2] = transform_16x16_add_partial_16_fallback;
+  accel->transform_add_partial_16[3] = transform_32x32_add_partial_16_fallback;
+  accel->transform_dc_add_16 = transform_dc_add_16_fallback;
 
   accel->rotate_coefficients = rotate_coefficients_fallback;
   accel->add_residual_8  = add_residual_fallback<uint8_t>;
@@ -113,6 +132,10 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->transform_idct_8x8   = transform_idct_8x8_fallback;
   accel->transform_idct_16x16 = transform_idct_16x16_fallback;
   accel->transform_idct_32x32 = transform_idct_32x32_fallback;
+  accel->transform_idct_partial[0] = transform_idct_partial_4x4_fallback;
+  accel->transform_idct_partial[1] = transform_idct_partial_8x8_fallback;
+  accel->transform_idct_partial[2] = transform_idct_partial_16x16_fallback;
+  accel->transform_idct_partial[3] = transform_idct_partial_32x32_fallback;
 
   accel->fwd_transform_4x4_dst_8 = fdst_4x4_8_fallback;
   accel->fwd_transform_8[0] = fdct_4x4_8_fallback;
@@ -124,4 +147,23 @@ void init_acceleration_functions_fallback(struct acceleration_functions* accel)
   accel->hadamard_transform_8[1] = hadamard_8x8_8_fallback;
   accel->hadamard_transform_8[2] = hadamard_16x16_8_fallback;
   accel->hadamard_transform_8[3] = hadamard_32x32_8_fallback;
+
+  accel->sad_8  = sad_fallback<uint8_t>;
+  accel->ssd_8  = ssd_fallback<uint8_t>;
+  accel->sad_16 = sad_fallback<uint16_t>;
+  accel->ssd_16 = ssd_fallback<uint16_t>;
+
+  accel->satd_8[0] = satd_8_fallback<2>;
+  accel->satd_8[1] = satd_8_fallback<3>;
+  accel->satd_8[2] = satd_8_fallback<4>;
+  accel->satd_8[3] = satd_8_fallback<5>;
+  accel->satd_8[4] = satd_8_fallback<6>;
+
+  accel->satd_16[0] = satd_16_fallback<2>;
+  accel->satd_16[1] = satd_16_fallback<3>;
+  accel->satd_16[2] = satd_16_fallback<4>;
+  accel->satd_16[3] = satd_16_fallback<5>;
+  accel->satd_16[4] = satd_16_fallback<6>;
+
+  accel->deblock_boundary_strength = deblock_boundary_strength_fallback;
 }
@@ -23,9 +23,11 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 
 #include <limits>
+#include <algorithm>
 
 
 #ifdef HAVE_MALLOC_H
@@ -42,6 +44,11 @@
 
 #define STANDARD_ALIGNMENT 16
 
+/* Guard band (in luma samples) around decoder-allocated pictures. Motion vectors
+   pointing up to this far outside the picture can be interpolated directly from
+   the reference without building a clamped copy of the block. */
+#define PICTURE_BORDER 80
+
 #ifdef HAVE___MINGW_ALIGNED_MALLOC
 #define ALLOC_ALIGNED(alignment, size)         __mingw_aligned_malloc((size), (alignment))
 #define FREE_ALIGNED(mem)                      __mingw_aligned_free((mem))
@@ -110,8 +117,19 @@ static int  de265_image_get_buffer(de265_decoder_context* ctx,
   const int rawChromaWidth  = spec->width  / img->SubWidthC;
   const int rawChromaHeight = spec->height / img->SubHeightC;
 
-  int luma_stride   = (spec->width    + spec->alignment-1) / spec->alignment * spec->alignment;
-  int chroma_stride = (rawChromaWidth + spec->alignment-1) / spec->alignment * spec->alignment;
+  // Only pictures owned by the decoder get a border. The chroma border is rounded up
+  // to the alignment so that the plane origins stay aligned.
+
+  int luma_border   = 0;
+  int chroma_border = 0;
+
+  if (ctx) {
+    luma_border   = PICTURE_BORDER;
+    chroma_border = (PICTURE_BORDER/img->SubWidthC + spec->alignment-1) / spec->alignment * spec->alignment;
+  }
+
+  int luma_stride   = (spec->width    + 2*luma_border   + spec->alignment-1) / spec->alignment * spec->alignment;
+  int chroma_stride = (rawChromaWidth + 2*chroma_border + spec->alignment-1) / spec->alignment * spec->alignment;
 
   assert(img->BitDepth_Y >= 8 && img->BitDepth_Y <= 16);
   assert(img->BitDepth_C >= 8 && img->BitDepth_C <= 16);
@@ -119,8 +137,8 @@ static int  de265_image_get_buffer(de265_decoder_context* ctx,
   int luma_bpl   = luma_stride   * ((img->BitDepth_Y+7)/8);
   int chroma_bpl = chroma_stride * ((img->BitDepth_C+7)/8);
 
-  int luma_height   = spec->height;
-  int chroma_height = rawChromaHeight;
+  int luma_height   = spec->height   + 2*luma_border;
+  int chroma_height = rawChromaHeight + 2*chroma_border;
 
   bool alloc_failed = false;
 
@@ -149,9 +167,19 @@ static int  de265_image_get_buffer(de265_decoder_context* ctx,
     return 0;
   }
 
+  // move plane origins to the top-left picture sample inside the border
+
+  p[0] += (luma_border*luma_stride + luma_border) * ((img->BitDepth_Y+7)/8);
+
+  if (p[1]) {
+    p[1] += (chroma_border*chroma_stride + chroma_border) * ((img->BitDepth_C+7)/8);
+    p[2] += (chroma_border*chroma_stride + chroma_border) * ((img->BitDepth_C+7)/8);
+  }
+
   img->set_image_plane(0, p[0], luma_stride, NULL);
   img->set_image_plane(1, p[1], chroma_stride, NULL);
   img->set_image_plane(2, p[2], chroma_stride, NULL);
+  img->set_border(luma_border, chroma_border);
 
   return 1;
 }
@@ -162,6 +190,10 @@ static void de265_image_release_buffer(de265_decoder_context* ctx,
   for (int i=0;i<3;i++) {
     uint8_t* p = (uint8_t*)img->get_image_plane(i);
     if (p) {
+      int border = img->get_border(i);
+      int bpp    = ((i==0 ? img->BitDepth_Y : img->BitDepth_C)+7)/8;
+      p -= (border*img->get_image_stride(i) + border) * bpp;
+
       FREE_ALIGNED(p);
     }
   }
@@ -207,10 +239,14 @@ de265_image::de265_image()
 
   width=height=0;
 
+  border = chroma_border = 0;
+  borders_extended = false;
+
+  motion_field_compressed = false;
+
   pts = 0;
   user_data = NULL;
 
-  ctb_progress = NULL;
 
   integrity = INTEGRITY_NOT_DECODED;
 
@@ -380,6 +416,12 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
 
   bool mem_alloc_success = true;
 
+  // the default allocator sets a border, custom allocators provide bare planes
+  border = chroma_border = 0;
+  borders_extended = false;
+
+  motion_field_compressed = false;
+
   if (image_allocation_functions.get_buffer != NULL) {
     mem_alloc_success = image_allocation_functions.get_buffer(decctx, &spec, this,
                                                               alloc_userdata);
@@ -419,41 +461,48 @@ de265_error de265_image::alloc_image(int w,int h, enum de265_chroma c,
 
     // cb info
 
+    // CB, PB, TB and deblocking information is tiled in CTB units
+
     mem_alloc_success &= cb_info.alloc(sps->PicWidthInMinCbsY, sps->PicHeightInMinCbsY,
-                                       sps->Log2MinCbSizeY);
+                                       sps->Log2MinCbSizeY,
+                                       sps->Log2CtbSizeY - sps->Log2MinCbSizeY);
 
     // pb info
 
     int puWidth  = sps->PicWidthInMinCbsY  << (sps->Log2MinCbSizeY -2);
     int puHeight = sps->PicHeightInMinCbsY << (sps->Log2MinCbSizeY -2);
 
-    mem_alloc_success &= pb_info.alloc(puWidth,puHeight, 2);
+    mem_alloc_success &= pb_info.alloc(puWidth,puHeight, 2, sps->Log2CtbSizeY - 2);
+
+    // compressed motion field for TMVP, one entry per 16x16 block
+
+    mem_alloc_success &= colmv_info.alloc((sps->pic_width_in_luma_samples +15)/16,
+                                          (sps->pic_height_in_luma_samples+15)/16, 4);
 
 
     // tu info
 
     mem_alloc_success &= tu_info.alloc(sps->PicWidthInTbsY, sps->PicHeightInTbsY,
-                                       sps->Log2MinTrafoSize);
+                                       sps->Log2MinTrafoSize,
+                                       sps->Log2CtbSizeY - sps->Log2MinTrafoSize);
 
     // deblk info
 
     int deblk_w = (sps->pic_width_in_luma_samples +3)/4;
     int deblk_h = (sps->pic_height_in_luma_samples+3)/4;
 
-    mem_alloc_success &= deblk_info.alloc(deblk_w, deblk_h, 2);
+    mem_alloc_success &= deblk_info.alloc(deblk_w, deblk_h, 2, sps->Log2CtbSizeY - 2);
 
     // CTB info
 
     if (ctb_info.data_size != sps->PicSizeInCtbsY)
       {
-        delete[] ctb_progress;
-
         mem_alloc_success &= ctb_info.alloc(sps->PicWidthInCtbsY, sps->PicHeightInCtbsY,
                                             sps->Log2CtbSizeY);
-
-        ctb_progress = new de265_progress_lock[ ctb_info.data_size ];
       }
 
+    mem_alloc_success &= ctb_progress.alloc(sps->PicWidthInCtbsY, sps->PicHeightInCtbsY);
+
 
     // check for memory shortage
 
@@ -471,12 +520,6 @@ de265_image::~de265_image()
 {
   release();
 
-  // free progress locks
-
-  if (ctb_progress) {
-    delete[] ctb_progress;
-  }
-
   de265_cond_destroy(&finished_cond);
   de265_mutex_destroy(&mutex);
 }
@@ -505,6 +548,9 @@ void de265_image::release()
           pixels[i] = NULL;
           pixels_confwin[i] = NULL;
         }
+
+      border = chroma_border = 0;
+      borders_extended = false;
     }
 
   // free slices
@@ -563,7 +609,10 @@ void de265_image::copy_lines_from(const de265_image* src, int first, int end)
   int luma_bpp   = (sps->BitDepth_Y+7)/8;
   int chroma_bpp = (sps->BitDepth_C+7)/8;
 
-  if (src->stride == stride) {
+  // Copy whole blocks only if there is no border. Otherwise, the borders of other
+  // CTB rows may be filled concurrently.
+
+  if (src->stride == stride && border==0) {
     memcpy(pixels[0]      + first*stride * luma_bpp,
            src->pixels[0] + first*src->stride * luma_bpp,
            (end-first)*stride * luma_bpp);
@@ -580,7 +629,7 @@ void de265_image::copy_lines_from(const de265_image* src, int first, int end)
   int end_chroma   = end   / src->SubHeightC;
 
   if (src->chroma_format != de265_chroma_mono) {
-    if (src->chroma_stride == chroma_stride) {
+    if (src->chroma_stride == chroma_stride && chroma_border==0) {
       memcpy(pixels[1]      + first_chroma*chroma_stride * chroma_bpp,
              src->pixels[1] + first_chroma*chroma_stride * chroma_bpp,
              (end_chroma-first_chroma) * chroma_stride * chroma_bpp);
@@ -612,10 +661,69 @@ void de265_image::exchange_pixel_data_with(de265_image& b)
 
   std::swap(stride, b.stride);
   std::swap(chroma_stride, b.chroma_stride);
+  std::swap(border, b.border);
+  std::swap(chroma_border, b.chroma_border);
+  std::swap(borders_extended, b.borders_extended);
   std::swap(image_allocation_functions, b.image_allocation_functions);
 }
 
 
+template <class pixel_t>
+static void extend_plane_borders(pixel_t* plane, int stride, int width, int height,
+                                 int border, int first, int end)
+{
+  // left and right
+
+  for (int y=first;y<end;y++) {
+    pixel_t* row = plane + y*stride;
+
+    std::fill(row-border, row, row[0]);
+    std::fill(row+width, row+stride-border, row[width-1]);
+  }
+
+  // top and bottom (including the corners)
+
+  const size_t rowBytes = stride * sizeof(pixel_t);
+
+  if (first==0) {
+    for (int y=1;y<=border;y++) {
+      memcpy(plane - border - y*stride, plane - border, rowBytes);
+    }
+  }
+
+  if (end==height) {
+    for (int y=0;y<border;y++) {
+      memcpy(plane - border + (height+y)*stride, plane - border + (height-1)*stride, rowBytes);
+    }
+  }
+}
+
+
+void de265_image::extend_borders(int first, int end)
+{
+  if (end > height) end=height;
+
+  for (int c=0;c<3;c++) {
+    if (pixels[c]==NULL || get_border(c)==0) {
+      continue;
+    }
+
+    int subH = (c==0 ? 1 : SubHeightC);
+    int firstC = first / subH;
+    int endC   = (end==height ? get_height(c) : end / subH);
+
+    if (bpp_shift[c]) {
+      extend_plane_borders((uint16_t*)pixels[c], get_image_stride(c),
+                           get_width(c), get_height(c), get_border(c), firstC, endC);
+    }
+    else {
+      extend_plane_borders(pixels[c], get_image_stride(c),
+                           get_width(c), get_height(c), get_border(c), firstC, endC);
+    }
+  }
+}
+
+
 void de265_image::thread_start(int nThreads)
 {
   de265_mutex_lock(&mutex);
@@ -634,6 +742,12 @@ void de265_image::thread_run(const thread_task* task)
 {
   //printf("run thread %s\n", task->name().c_str());
 
+  // task->name() formats a string, only do this when tracing
+
+  if (decctx && decctx->trace_enabled()) {
+    decctx->get_trace()->begin(task->name(), "task");
+  }
+
   de265_mutex_lock(&mutex);
   nThreadsQueued--;
   nThreadsRunning++;
@@ -666,6 +780,12 @@ void de265_image::thread_finishes(const thread_task* task)
   nThreadsFinished++;
   assert(nThreadsRunning >= 0);
 
+  // end the trace event before the image may be released by the main thread
+
+  if (decctx && decctx->trace_enabled()) {
+    decctx->get_trace()->end(task->name(), "task");
+  }
+
   if (nThreadsFinished==nThreadsTotal) {
     de265_cond_broadcast(&finished_cond, &mutex);
   }
@@ -684,8 +804,11 @@ void de265_image::wait_for_progress(thread_task* task, int ctbAddrRS, int progre
 {
   if (task==NULL) { return; }
 
-  de265_progress_lock* progresslock = &ctb_progress[ctbAddrRS];
-  if (progresslock->get_progress() < progress) {
+  if (ctb_progress.get_progress(ctbAddrRS) < progress) {
+    STATISTICS_COUNT(decctx, tasks_blocked, 1);
+    STATISTICS_TIMER(decctx, StageWaitForProgress);
+    task_trace_scope traceScope(decctx ? decctx->get_trace() : NULL, "wait_for_progress", "wait");
+
     thread_blocks();
 
     assert(task!=NULL);
@@ -696,7 +819,7 @@ void de265_image::wait_for_progress(thread_task* task, int ctbAddrRS, int progre
        Simplest concealment: do not block.
     */
 
-    progresslock->wait_for_progress(progress);
+    ctb_progress.wait_for_progress(ctbAddrRS, progress);
     task->state = thread_task::Running;
     thread_unblocks();
   }
@@ -731,8 +854,76 @@ void de265_image::clear_metadata()
 
   // --- reset CTB progresses ---
 
-  for (int i=0;i<ctb_info.data_size;i++) {
-    ctb_progress[i].reset(CTB_PROGRESS_NONE);
+  ctb_progress.reset(CTB_PROGRESS_NONE);
+}
+
+
+// The public metadata structures are views on the internal arrays.
+static_assert(sizeof(de265_cb_info)     == sizeof(CB_ref_info), "de265_cb_info does not match CB_ref_info");
+static_assert(offsetof(de265_cb_info, PredMode) == offsetof(CB_ref_info, PredMode) &&
+              offsetof(de265_cb_info, QP_Y)     == offsetof(CB_ref_info, QP_Y),
+              "de265_cb_info field layout does not match CB_ref_info");
+static_assert(sizeof(de265_motion_info) == sizeof(PBMotion),    "de265_motion_info does not match PBMotion");
+
+template <class DataUnit>
+static bool get_metadata_array(const MetaDataArray<DataUnit>& array, de265_metadata_array* out_array)
+{
+  if (array.data == NULL) {
+    return false;
+  }
+
+  out_array->data            = array.data;
+  out_array->width_in_units  = array.width_in_units;
+  out_array->height_in_units = array.height_in_units;
+  out_array->log2_unit_size  = array.log2unitSize;
+  out_array->log2_tile_size  = array.log2TileSize;
+
+  return true;
+}
+
+bool de265_image::get_metadata(enum de265_metadata_type type, de265_metadata_array* out_array) const
+{
+  switch (type) {
+  case de265_metadata_coding_blocks:          return get_metadata_array(cb_info, out_array);
+  case de265_metadata_motion:                 return get_metadata_array(pb_info, out_array);
+  case de265_metadata_intra_pred_mode:        return get_metadata_array(intraPredMode, out_array);
+  case de265_metadata_intra_pred_mode_chroma: return get_metadata_array(intraPredModeC, out_array);
+  case de265_metadata_transform_tree:         return get_metadata_array(tu_info, out_array);
+  default:
+    return false;
+  }
+}
+
+
+void de265_image::compress_motion_field()
+{
+  PBMotion intra;
+  memset(&intra, 0, sizeof(PBMotion));
+
+  for (int y=0;y<colmv_info.height_in_units;y++) {
+    PBMotion* row = &colmv_info[ colmv_info.index(0,y) ];
+
+    for (int x=0;x<colmv_info.width_in_units;x++) {
+      int xPb = x<<4;
+      int yPb = y<<4;
+
+      if (get_pred_mode(xPb,yPb) == MODE_INTRA) {
+        row[x] = intra;
+      }
+      else {
+        row[x] = pb_info.get(xPb,yPb);
+      }
+    }
+  }
+
+  motion_field_compressed = true;
+}
+
+
+void de265_image::release_full_motion_field()
+{
+  if (motion_field_compressed) {
+    pb_info.release();
   }
 }
 
@@ -746,13 +937,14 @@ void de265_image::set_mv_info(int x,int y, int nPbW,int nPbH, const PBMotion& mv
   int wPu = nPbW >> log2PuSize;
   int hPu = nPbH >> log2PuSize;
 
-  int stride = pb_info.width_in_units;
+  for (int pby=0;pby<hPu;pby++) {
+    PBMotion* row = &pb_info[ pb_info.index(xPu,yPu+pby) ];
 
-  for (int pby=0;pby<hPu;pby++)
     for (int pbx=0;pbx<wPu;pbx++)
       {
-        pb_info[ xPu+pbx + (yPu+pby)*stride ] = mv;
+        row[pbx] = mv;
       }
+  }
 }
 
 
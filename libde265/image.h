@@ -68,6 +68,8 @@ enum PictureState {
 #define TU_FLAG_NONZERO_COEFF  (1<<7)
 #define TU_FLAG_SPLIT_TRANSFORM_MASK  0x1F
 
+#define DEBLOCK_FLAG_INTRA  (1<<2)   // 4x4 block is intra coded (set during parsing)
+#define DEBLOCK_FLAG_NONZERO_COEFF (1<<3) // luma TB has coded coefficients (set during parsing)
 #define DEBLOCK_FLAG_VERTI (1<<4)
 #define DEBLOCK_FLAG_HORIZ (1<<5)
 #define DEBLOCK_PB_EDGE_VERTI (1<<6)
@@ -83,14 +85,24 @@ enum PictureState {
 
 class decoder_context;
 
+/* Per-block metadata of a picture. The units can be stored in square tiles
+   (usually one CTB) that are laid out in raster order, with the units of
+   each tile stored contiguously. Blocks never cross a CTB boundary, so this
+   keeps all data of a CTB and its neighborhood close together, independent
+   of the picture width. With log2TileSize==0, this is a plain raster.
+ */
 template <class DataUnit> class MetaDataArray
 {
  public:
-  MetaDataArray() { data=NULL; data_size=0; log2unitSize=0; width_in_units=0; height_in_units=0; }
+  MetaDataArray() { data=NULL; data_size=0; log2unitSize=0; width_in_units=0; height_in_units=0;
+                    log2TileSize=0; width_in_tiles=0; }
   ~MetaDataArray() { free(data); }
 
-  LIBDE265_CHECK_RESULT bool alloc(int w,int h, int _log2unitSize) {
-    int size = w*h;
+  LIBDE265_CHECK_RESULT bool alloc(int w,int h, int _log2unitSize, int _log2TileSize=0) {
+    int tileSize = 1<<_log2TileSize;
+    int tilesW = (w+tileSize-1) >> _log2TileSize;
+    int tilesH = (h+tileSize-1) >> _log2TileSize;
+    int size = (tilesW*tilesH) << (2*_log2TileSize);
 
     if (size != data_size) {
       free(data);
@@ -106,6 +118,8 @@ template <class DataUnit> class MetaDataArray
     height_in_units = h;
 
     log2unitSize = _log2unitSize;
+    log2TileSize = _log2TileSize;
+    width_in_tiles = tilesW;
 
     return data != NULL;
   }
@@ -114,6 +128,21 @@ template <class DataUnit> class MetaDataArray
     if (data) memset(data, 0, sizeof(DataUnit) * data_size);
   }
 
+  // free the data, the next alloc() allocates it again
+  void release() {
+    free(data);
+    data = NULL;
+    data_size = 0;
+  }
+
+  // index of the unit at (unitX,unitY), in units
+  int index(int unitX,int unitY) const {
+    const int tileMask = (1<<log2TileSize)-1;
+
+    return ((((unitY>>log2TileSize)*width_in_tiles + (unitX>>log2TileSize)) << (2*log2TileSize)) +
+            ((unitY & tileMask) << log2TileSize) + (unitX & tileMask));
+  }
+
   const DataUnit& get(int x,int y) const {
     int unitX = x>>log2unitSize;
     int unitY = y>>log2unitSize;
@@ -121,7 +150,7 @@ template <class DataUnit> class MetaDataArray
     assert(unitX >= 0 && unitX < width_in_units);
     assert(unitY >= 0 && unitY < height_in_units);
 
-    return data[ unitX + unitY*width_in_units ];
+    return data[ index(unitX,unitY) ];
   }
 
   DataUnit& get(int x,int y) {
@@ -131,7 +160,7 @@ template <class DataUnit> class MetaDataArray
     assert(unitX >= 0 && unitX < width_in_units);
     assert(unitY >= 0 && unitY < height_in_units);
 
-    return data[ unitX + unitY*width_in_units ];
+    return data[ index(unitX,unitY) ];
   }
 
   void set(int x,int y, const DataUnit& d) {
@@ -141,7 +170,7 @@ template <class DataUnit> class MetaDataArray
     assert(unitX >= 0 && unitX < width_in_units);
     assert(unitY >= 0 && unitY < height_in_units);
 
-    data[ unitX + unitY*width_in_units ] = d;
+    data[ index(unitX,unitY) ] = d;
   }
 
   DataUnit& operator[](int idx) { return data[idx]; }
@@ -155,6 +184,8 @@ template <class DataUnit> class MetaDataArray
   int log2unitSize;
   int width_in_units;
   int height_in_units;
+  int log2TileSize;   // tiles of (1<<log2TileSize)^2 units
+  int width_in_tiles;
 };
 
 #define SET_CB_BLK(x,y,log2BlkWidth,  Field,value)              \
@@ -162,20 +193,22 @@ template <class DataUnit> class MetaDataArray
   int cbY = y >> cb_info.log2unitSize; \
   int width = 1 << (log2BlkWidth - cb_info.log2unitSize);           \
   for (int cby=cbY;cby<cbY+width;cby++)                             \
-    for (int cbx=cbX;cbx<cbX+width;cbx++)                           \
-      {                                                             \
-        cb_info[ cbx + cby*cb_info.width_in_units ].Field = value;  \
-      }
+    {                                                               \
+      CB_ref_info* cbrow = &cb_info[ cb_info.index(cbX,cby) ];      \
+      for (int cbx=0;cbx<width;cbx++)                               \
+        {                                                           \
+          cbrow[cbx].Field = value;                                 \
+        }                                                           \
+    }
 
 #define CLEAR_TB_BLK(x,y,log2BlkWidth)              \
   int tuX = x >> tu_info.log2unitSize; \
   int tuY = y >> tu_info.log2unitSize; \
   int width = 1 << (log2BlkWidth - tu_info.log2unitSize);           \
   for (int tuy=tuY;tuy<tuY+width;tuy++)                             \
-    for (int tux=tuX;tux<tuX+width;tux++)                           \
-      {                                                             \
-        tu_info[ tux + tuy*tu_info.width_in_units ] = 0;  \
-      }
+    {                                                               \
+      memset(&tu_info[ tu_info.index(tuX,tuy) ], 0, width);         \
+    }
 
 
 typedef struct {
@@ -192,26 +225,26 @@ typedef struct {
 
 
 typedef struct {
-  uint8_t log2CbSize : 3;   /* [0;6] (1<<log2CbSize) = 64
+  // Plain bytes without bitfields, such that the layout matches the public
+  // de265_cb_info, which is a view on this array.
+
+  uint8_t log2CbSize;       /* [0;6] (1<<log2CbSize) = 64
                                This is only set in the top-left corner of the CB.
                                The other values should be zero.
                                TODO: in the encoder, we have to clear to zero.
                                Used in deblocking and QP-scale decoding */
-  uint8_t PartMode : 3;     // (enum PartMode)  [0;7] set only in top-left of CB
+  uint8_t PartMode;         // (enum PartMode)  [0;7] set only in top-left of CB
                             // Used for spatial merging candidates in current frame
                             // and for deriving interSplitFlag in decoding.
 
-  uint8_t ctDepth : 2;      // [0:3]? (for CTB size 64: 0:64, 1:32, 2:16, 3:8)
+  uint8_t ctDepth;          // [0:3]? (for CTB size 64: 0:64, 1:32, 2:16, 3:8)
                             // Used for decoding/encoding split_cu flag.
 
-  // --- byte boundary ---
-  uint8_t PredMode : 2;     // (enum PredMode)  [0;2] must be saved for past images
+  uint8_t PredMode;         // (enum PredMode)  [0;2] must be saved for past images
                             // Used in motion decoding.
-  uint8_t pcm_flag : 1;     // Stored for intra-prediction / SAO
-  uint8_t cu_transquant_bypass : 1; // Stored for SAO
-  // note: 4 bits left
+  uint8_t pcm_flag;         // Stored for intra-prediction / SAO
+  uint8_t cu_transquant_bypass; // Stored for SAO
 
-  // --- byte boundary ---
   int8_t  QP_Y;  // Stored for QP prediction
 
 } CB_ref_info;
@@ -251,6 +284,11 @@ struct de265_image {
   void copy_lines_from(const de265_image* src, int first, int end);
   void exchange_pixel_data_with(de265_image&);
 
+  /* Replicate the picture edge samples into the border around the planes
+     for the luma lines [first;end). The first and last lines of the picture
+     additionally fill the border above/below the picture. */
+  void extend_borders(int first, int end);
+
   uint32_t get_ID() const { return ID; }
 
 
@@ -303,6 +341,15 @@ struct de265_image {
   int get_luma_stride() const { return stride; }
   int get_chroma_stride() const { return chroma_stride; }
 
+  /* Number of pixels allocated around each side of the plane. */
+  int  get_border(int cIdx) const { return cIdx==0 ? border : chroma_border; }
+  void set_border(int luma, int chroma) { border=luma; chroma_border=chroma; }
+
+  /* Border that motion compensation may read from. This is zero until the
+     border has been filled with extend_borders(). */
+  int  get_mc_border(int cIdx) const { return borders_extended ? get_border(cIdx) : 0; }
+  void set_borders_extended(bool flag) { borders_extended=flag; }
+
   int get_width (int cIdx=0) const { return cIdx==0 ? width  : chroma_width;  }
   int get_height(int cIdx=0) const { return cIdx==0 ? height : chroma_height; }
 
@@ -358,6 +405,9 @@ private:
   int chroma_width, chroma_height;
   int stride, chroma_stride;
 
+  int  border, chroma_border;
+  bool borders_extended;
+
 public:
   uint8_t BitDepth_Y, BitDepth_C;
   uint8_t SubWidthC, SubHeightC;
@@ -401,6 +451,9 @@ public:
 
   int number_of_ctbs() const { return ctb_info.size(); }
 
+  // zero-copy access to the metadata arrays for the public API, false if not allocated
+  bool get_metadata(enum de265_metadata_type, de265_metadata_array* out_array) const;
+
 private:
   // The image also keeps a reference to VPS/SPS/PPS, because when decoding is delayed,
   // the currently active parameter sets in the decctx might already have been replaced
@@ -412,6 +465,8 @@ private:
   MetaDataArray<CTB_info>    ctb_info;
   MetaDataArray<CB_ref_info> cb_info;
   MetaDataArray<PBMotion>    pb_info;
+  MetaDataArray<PBMotion>    colmv_info;  // pb_info compressed to 16x16 blocks (for TMVP)
+  bool motion_field_compressed;
   MetaDataArray<uint8_t>     intraPredMode;
   MetaDataArray<uint8_t>     intraPredModeC;
   MetaDataArray<uint8_t>     tu_info;
@@ -441,11 +496,11 @@ public:
 
   // --- multi core ---
 
-  de265_progress_lock* ctb_progress; // ctb_info_size
+  de265_CTB_progress ctb_progress; // ctb_info_size
 
   void mark_all_CTB_progress(int progress) {
     for (int i=0;i<ctb_info.data_size;i++) {
-      ctb_progress[i].set_progress(progress);
+      ctb_progress.set_progress(i, progress);
     }
   }
 
@@ -554,7 +609,7 @@ public:
   // coordinates in CB units
   int  get_log2CbSize_cbUnits(int xCb, int yCb) const
   {
-    return (enum PredMode)cb_info[ xCb + yCb*cb_info.width_in_units ].log2CbSize;
+    return (enum PredMode)cb_info[ cb_info.index(xCb,yCb) ].log2CbSize;
   }
 
   void set_PartMode(int x,int y, enum PartMode mode)
@@ -610,11 +665,13 @@ public:
     const int tuY = y >> tu_info.log2unitSize;
     const int width = 1 << (log2TrafoSize - tu_info.log2unitSize);
 
-    for (int tuy=tuY;tuy<tuY+width;tuy++)
-      for (int tux=tuX;tux<tuX+width;tux++)
+    for (int tuy=tuY;tuy<tuY+width;tuy++) {
+      uint8_t* turow = &tu_info[ tu_info.index(tuX,tuy) ];
+      for (int tux=0;tux<width;tux++)
         {
-          tu_info[ tux + tuy*tu_info.width_in_units ] |= TU_FLAG_NONZERO_COEFF;
+          turow[tux] |= TU_FLAG_NONZERO_COEFF;
         }
+    }
   }
 
   int  get_nonzero_coefficient(int x,int y) const
@@ -760,6 +817,13 @@ public:
     return slices[idx];
   }
 
+  const slice_segment_header* get_SliceHeader(int x, int y) const
+  {
+    int idx = get_SliceHeaderIndex(x,y);
+    if (idx >= slices.size()) { return NULL; }
+    return slices[idx];
+  }
+
   slice_segment_header* get_SliceHeaderCtb(int ctbX, int ctbY)
   {
     int idx = get_SliceHeaderIndexCtb(ctbX,ctbY);
@@ -821,7 +885,7 @@ public:
 
     if (xd<deblk_info.width_in_units &&
         yd<deblk_info.height_in_units) {
-      deblk_info[xd + yd*deblk_info.width_in_units] |= flags;
+      deblk_info[deblk_info.index(xd,yd)] |= flags;
     }
   }
 
@@ -830,21 +894,42 @@ public:
     const int xd = x0/4;
     const int yd = y0/4;
 
-    return deblk_info[xd + yd*deblk_info.width_in_units];
+    return deblk_info[deblk_info.index(xd,yd)];
   }
 
   void    set_deblk_bS(int x0,int y0, uint8_t bS)
   {
-    uint8_t* data = &deblk_info[x0/4 + y0/4*deblk_info.width_in_units];
+    uint8_t* data = &deblk_info[deblk_info.index(x0/4,y0/4)];
     *data &= ~DEBLOCK_BS_MASK;
     *data |= bS;
   }
 
   uint8_t get_deblk_bS(int x0,int y0) const
   {
-    return deblk_info[x0/4 + y0/4*deblk_info.width_in_units] & DEBLOCK_BS_MASK;
+    return deblk_info[deblk_info.index(x0/4,y0/4)] & DEBLOCK_BS_MASK;
+  }
+
+  // set flags in all 4x4 units of a square block (which does not cross a CTB boundary)
+  void    set_deblk_block_flags(int x0,int y0, int log2BlkSize, uint8_t flags)
+  {
+    const int xd = x0/4;
+    const int yd = y0/4;
+    const int w  = 1<<(log2BlkSize-2);
+
+    for (int y=0;y<w;y++) {
+      uint8_t* row = &deblk_info[deblk_info.index(xd,yd+y)];
+      for (int x=0;x<w;x++) {
+        row[x] |= flags;
+      }
+    }
   }
 
+  // Flags of the 4x4 unit (xd,yd). Within a CTB, the units of a row are stored
+  // contiguously and the rows follow with a stride of get_deblk_tile_size().
+  uint8_t* get_deblk_flags_ptr(int xd,int yd) { return &deblk_info[deblk_info.index(xd,yd)]; }
+
+  int  get_deblk_tile_size() const { return 1<<deblk_info.log2TileSize; } // in 4x4 units
+
 
   // --- PB metadata access ---
 
@@ -855,6 +940,24 @@ public:
 
   void set_mv_info(int x,int y, int nPbW,int nPbH, const PBMotion& mv);
 
+
+  // --- compressed motion field for temporal MV prediction ---
+
+  /* Store the motion of the top-left 4x4 block of each 16x16 block, as used for
+     the collocated MVs. Intra blocks get both predFlags cleared. */
+  void compress_motion_field();
+
+  bool has_compressed_motion_field() const { return motion_field_compressed; }
+
+  const PBMotion& get_col_mv_info(int x,int y) const
+  {
+    return colmv_info.get(x,y);
+  }
+
+  /* Free the full-resolution motion field once the compressed one has been built.
+     Only do this when the picture is not needed for output anymore. */
+  void release_full_motion_field();
+
   // --- value logging ---
 
   void printBlk(int x0,int y0, int cIdx, int log2BlkSize);
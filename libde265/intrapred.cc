@@ -320,6 +320,9 @@ void decode_intra_prediction(de265_image* img,
 {
   logtrace(LogIntraPred,"decode_intra_prediction xy0:%d/%d mode=%d nT=%d, cIdx=%d\n",
            xB0,yB0, intraPredMode, nT,cIdx);
+
+  STATISTICS_TIMER(img->decctx, StageIntraPrediction);
+
   /*
     printf("decode_intra_prediction xy0:%d/%d mode=%d nT=%d, cIdx=%d\n",
     xB0,yB0, intraPredMode, nT,cIdx);
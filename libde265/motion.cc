@@ -29,6 +29,7 @@
 #include <sys/types.h>
 #include <signal.h>
 #include <string.h>
+#include <algorithm>
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
 # include <malloc.h>
@@ -43,6 +44,44 @@
 static int extra_before[4] = { 0,3,3,2 };
 static int extra_after [4] = { 0,3,4,4 };
 
+#define PADBUF_STRIDE (MAX_CU_SIZE+16)
+
+
+/* Get the reference samples for interpolating a nPbW x nPbH block at integer position
+   (xInt,yInt), including the extra samples required around it by the filter taps.
+   If these do not lie within the reference picture and its usable border, the samples
+   are copied with clamped coordinates into 'padbuf' (PADBUF_STRIDE x (MAX_CU_SIZE+7)).
+ */
+template <class pixel_t>
+static const pixel_t* mc_reference_samples(const pixel_t* ref, int ref_stride, int ref_border,
+                                           int w, int h, int xInt, int yInt,
+                                           int nPbW, int nPbH,
+                                           int extra_left, int extra_top,
+                                           int extra_right, int extra_bottom,
+                                           pixel_t* padbuf, int* src_stride)
+{
+  if (-extra_left + xInt >= -ref_border &&
+      -extra_top  + yInt >= -ref_border &&
+      nPbW+extra_right  + xInt <= w+ref_border &&
+      nPbH+extra_bottom + yInt <= h+ref_border) {
+    *src_stride = ref_stride;
+    return &ref[xInt + yInt*ref_stride];
+  }
+
+  for (int y=-extra_top;y<nPbH+extra_bottom;y++) {
+    for (int x=-extra_left;x<nPbW+extra_right;x++) {
+
+      int xA = Clip3(0,w-1,x + xInt);
+      int yA = Clip3(0,h-1,y + yInt);
+
+      padbuf[x+extra_left + (y+extra_top)*PADBUF_STRIDE] = ref[ xA + yA*ref_stride ];
+    }
+  }
+
+  *src_stride = PADBUF_STRIDE;
+  return &padbuf[extra_left + extra_top*PADBUF_STRIDE];
+}
+
 
 
 template <class pixel_t>
@@ -50,7 +89,7 @@ void mc_luma(const base_context* ctx,
              const seq_parameter_set* sps, int mv_x, int mv_y,
              int xP,int yP,
              int16_t* out, int out_stride,
-             const pixel_t* ref, int ref_stride,
+             const pixel_t* ref, int ref_stride, int ref_border,
              int nPbW, int nPbH, int bitDepth_L)
 {
   int xFracL = mv_x & 3;
@@ -72,8 +111,10 @@ void mc_luma(const base_context* ctx,
 
   if (xFracL==0 && yFracL==0) {
 
-    if (xIntOffsL >= 0 && yIntOffsL >= 0 &&
-        nPbW+xIntOffsL <= w && nPbH+yIntOffsL <= h) {
+    // blocks reaching into the (extended) reference border are read directly
+
+    if (xIntOffsL >= -ref_border && yIntOffsL >= -ref_border &&
+        nPbW+xIntOffsL <= w+ref_border && nPbH+yIntOffsL <= h+ref_border) {
 
       ctx->acceleration.put_hevc_qpel(out, out_stride,
                                       &ref[yIntOffsL*ref_stride + xIntOffsL],
@@ -126,32 +167,13 @@ void mc_luma(const base_context* ctx,
     //int nPbH_extra = extra_top  + nPbH + extra_bottom;
 
 
-    pixel_t padbuf[(MAX_CU_SIZE+16)*(MAX_CU_SIZE+7)];
+    pixel_t padbuf[PADBUF_STRIDE*(MAX_CU_SIZE+7)];
 
-    const pixel_t* src_ptr;
     int src_stride;
-
-    if (-extra_left + xIntOffsL >= 0 &&
-        -extra_top  + yIntOffsL >= 0 &&
-        nPbW+extra_right  + xIntOffsL < w &&
-        nPbH+extra_bottom + yIntOffsL < h) {
-      src_ptr = &ref[xIntOffsL + yIntOffsL*ref_stride];
-      src_stride = ref_stride;
-    }
-    else {
-      for (int y=-extra_top;y<nPbH+extra_bottom;y++) {
-        for (int x=-extra_left;x<nPbW+extra_right;x++) {
-
-          int xA = Clip3(0,w-1,x + xIntOffsL);
-          int yA = Clip3(0,h-1,y + yIntOffsL);
-
-          padbuf[x+extra_left + (y+extra_top)*(MAX_CU_SIZE+16)] = ref[ xA + yA*ref_stride ];
-        }
-      }
-
-      src_ptr = &padbuf[extra_top*(MAX_CU_SIZE+16) + extra_left];
-      src_stride = MAX_CU_SIZE+16;
-    }
+    const pixel_t* src_ptr = mc_reference_samples(ref, ref_stride, ref_border, w,h,
+                                                  xIntOffsL,yIntOffsL, nPbW,nPbH,
+                                                  extra_left,extra_top, extra_right,extra_bottom,
+                                                  padbuf, &src_stride);
 
     ctx->acceleration.put_hevc_qpel(out, out_stride,
                                     src_ptr, src_stride /* sizeof(pixel_t) */,
@@ -176,7 +198,7 @@ void mc_chroma(const base_context* ctx,
                int mv_x, int mv_y,
                int xP,int yP,
                int16_t* out, int out_stride,
-               const pixel_t* ref, int ref_stride,
+               const pixel_t* ref, int ref_stride, int ref_border,
                int nPbWC, int nPbHC, int bit_depth_C)
 {
   // chroma sample interpolation process (8.5.3.2.2.2)
@@ -200,8 +222,8 @@ void mc_chroma(const base_context* ctx,
   ALIGNED_32(int16_t mcbuffer[MAX_CU_SIZE*(MAX_CU_SIZE+7)]);
 
   if (xFracC == 0 && yFracC == 0) {
-    if (xIntOffsC>=0 && nPbWC+xIntOffsC<=wC &&
-        yIntOffsC>=0 && nPbHC+yIntOffsC<=hC) {
+    if (xIntOffsC>=-ref_border && nPbWC+xIntOffsC<=wC+ref_border &&
+        yIntOffsC>=-ref_border && nPbHC+yIntOffsC<=hC+ref_border) {
       ctx->acceleration.put_hevc_epel(out, out_stride,
                                       &ref[xIntOffsC + yIntOffsC*ref_stride], ref_stride,
                                       nPbWC,nPbHC, 0,0, NULL, bit_depth_C);
@@ -219,35 +241,18 @@ void mc_chroma(const base_context* ctx,
       }
   }
   else {
-    pixel_t padbuf[(MAX_CU_SIZE+16)*(MAX_CU_SIZE+3)];
-
-    const pixel_t* src_ptr;
-    int src_stride;
+    pixel_t padbuf[PADBUF_STRIDE*(MAX_CU_SIZE+3)];
 
     int extra_top  = 1;
     int extra_left = 1;
     int extra_right  = 2;
     int extra_bottom = 2;
 
-    if (xIntOffsC>=1 && nPbWC+xIntOffsC<=wC-2 &&
-        yIntOffsC>=1 && nPbHC+yIntOffsC<=hC-2) {
-      src_ptr = &ref[xIntOffsC + yIntOffsC*ref_stride];
-      src_stride = ref_stride;
-    }
-    else {
-      for (int y=-extra_top;y<nPbHC+extra_bottom;y++) {
-        for (int x=-extra_left;x<nPbWC+extra_right;x++) {
-
-          int xA = Clip3(0,wC-1,x + xIntOffsC);
-          int yA = Clip3(0,hC-1,y + yIntOffsC);
-
-          padbuf[x+extra_left + (y+extra_top)*(MAX_CU_SIZE+16)] = ref[ xA + yA*ref_stride ];
-        }
-      }
-
-      src_ptr = &padbuf[extra_left + extra_top*(MAX_CU_SIZE+16)];
-      src_stride = MAX_CU_SIZE+16;
-    }
+    int src_stride;
+    const pixel_t* src_ptr = mc_reference_samples(ref, ref_stride, ref_border, wC,hC,
+                                                  xIntOffsC,yIntOffsC, nPbWC,nPbHC,
+                                                  extra_left,extra_top, extra_right,extra_bottom,
+                                                  padbuf, &src_stride);
 
 
     if (xFracC && yFracC) {
@@ -273,6 +278,91 @@ void mc_chroma(const base_context* ctx,
 
 
 
+/* Luma prediction of a bi-predicted block with default weighting (8.5.3.3.4.2).
+   Both lists are interpolated and averaged in a single pass, directly into 'dst'.
+ */
+template <class pixel_t>
+void mc_luma_bi(const base_context* ctx,
+                const seq_parameter_set* sps, const PBMotion* vi,
+                const de265_image* const refPic[2],
+                int xP,int yP,
+                pixel_t* dst, int dst_stride,
+                int nPbW, int nPbH)
+{
+  int w = sps->pic_width_in_luma_samples;
+  int h = sps->pic_height_in_luma_samples;
+
+  pixel_t padbuf[2][PADBUF_STRIDE*(MAX_CU_SIZE+7)];
+
+  const pixel_t* src[2];
+  int src_stride[2];
+  int xFracL[2], yFracL[2];
+
+  for (int l=0;l<2;l++) {
+    xFracL[l] = vi->mv[l].x & 3;
+    yFracL[l] = vi->mv[l].y & 3;
+
+    int xIntOffsL = xP + (vi->mv[l].x>>2);
+    int yIntOffsL = yP + (vi->mv[l].y>>2);
+
+    src[l] = mc_reference_samples((const pixel_t*)refPic[l]->get_image_plane(0),
+                                  refPic[l]->get_luma_stride(), refPic[l]->get_mc_border(0),
+                                  w,h, xIntOffsL,yIntOffsL, nPbW,nPbH,
+                                  extra_before[xFracL[l]], extra_before[yFracL[l]],
+                                  extra_after [xFracL[l]], extra_after [yFracL[l]],
+                                  padbuf[l], &src_stride[l]);
+  }
+
+  ctx->acceleration.put_hevc_qpel_bi(dst, dst_stride,
+                                     src[0], src_stride[0], xFracL[0], yFracL[0],
+                                     src[1], src_stride[1], xFracL[1], yFracL[1],
+                                     nPbW,nPbH, sps->BitDepth_Y);
+}
+
+
+template <class pixel_t>
+void mc_chroma_bi(const base_context* ctx,
+                  const seq_parameter_set* sps, const PBMotion* vi,
+                  const de265_image* const refPic[2], int cIdx,
+                  int xP,int yP,
+                  pixel_t* dst, int dst_stride,
+                  int nPbWC, int nPbHC)
+{
+  int wC = sps->pic_width_in_luma_samples /sps->SubWidthC;
+  int hC = sps->pic_height_in_luma_samples/sps->SubHeightC;
+
+  pixel_t padbuf[2][PADBUF_STRIDE*(MAX_CU_SIZE+3)];
+
+  const pixel_t* src[2];
+  int src_stride[2];
+  int xFracC[2], yFracC[2];
+
+  for (int l=0;l<2;l++) {
+    int mv_x = vi->mv[l].x * (2 / sps->SubWidthC);
+    int mv_y = vi->mv[l].y * (2 / sps->SubHeightC);
+
+    xFracC[l] = mv_x & 7;
+    yFracC[l] = mv_y & 7;
+
+    int xIntOffsC = xP/sps->SubWidthC  + (mv_x>>3);
+    int yIntOffsC = yP/sps->SubHeightC + (mv_y>>3);
+
+    src[l] = mc_reference_samples((const pixel_t*)refPic[l]->get_image_plane(cIdx),
+                                  refPic[l]->get_chroma_stride(), refPic[l]->get_mc_border(cIdx),
+                                  wC,hC, xIntOffsC,yIntOffsC, nPbWC,nPbHC,
+                                  xFracC[l] ? 1:0, yFracC[l] ? 1:0,
+                                  xFracC[l] ? 2:0, yFracC[l] ? 2:0,
+                                  padbuf[l], &src_stride[l]);
+  }
+
+  ctx->acceleration.put_hevc_epel_bi(dst, dst_stride,
+                                     src[0], src_stride[0], xFracC[0], yFracC[0],
+                                     src[1], src_stride[1], xFracC[1], yFracC[1],
+                                     nPbWC,nPbHC, sps->BitDepth_C);
+}
+
+
+
 // 8.5.3.2
 // NOTE: for full-pel shifts, we can introduce a fast path, simply copying without shifts
 void generate_inter_prediction_samples(base_context* ctx,
@@ -283,6 +373,8 @@ void generate_inter_prediction_samples(base_context* ctx,
                                        int nCS, int nPbW,int nPbH,
                                        const PBMotion* vi)
 {
+  STATISTICS_TIMER(img->decctx, StageInterPrediction);
+
   int xP = xC+xB;
   int yP = yC+yB;
 
@@ -334,6 +426,50 @@ void generate_inter_prediction_samples(base_context* ctx,
   }
 
 
+  // Bi-prediction with default weighting is done in a single pass over both
+  // reference blocks. Missing references are handled by the generic code below.
+
+  if (shdr->slice_type == SLICE_TYPE_B && pps->weighted_bipred_flag==0 &&
+      predFlag[0] && predFlag[1]) {
+    const de265_image* refPic[2] = { NULL, NULL };
+
+    for (int l=0;l<2;l++) {
+      if (vi->refIdx[l] < MAX_NUM_REF_PICS) {
+        refPic[l] = ctx->get_image(shdr->RefPicList[l][vi->refIdx[l]]);
+
+        if (refPic[l] && refPic[l]->PicState == UnusedForReference) {
+          refPic[l] = NULL;
+        }
+      }
+    }
+
+    if (refPic[0] && refPic[1]) {
+      int nPbWC = nPbW/SubWidthC;
+      int nPbHC = nPbH/SubHeightC;
+
+      if (img->high_bit_depth(0)) {
+        mc_luma_bi(ctx, sps, vi, refPic, xP,yP, (uint16_t*)pixels[0],stride[0], nPbW,nPbH);
+      }
+      else {
+        mc_luma_bi(ctx, sps, vi, refPic, xP,yP, (uint8_t*)pixels[0],stride[0], nPbW,nPbH);
+      }
+
+      for (int cIdx=1;cIdx<=2;cIdx++) {
+        if (img->high_bit_depth(cIdx)) {
+          mc_chroma_bi(ctx, sps, vi, refPic, cIdx, xP,yP,
+                       (uint16_t*)pixels[cIdx],stride[cIdx], nPbWC,nPbHC);
+        }
+        else {
+          mc_chroma_bi(ctx, sps, vi, refPic, cIdx, xP,yP,
+                       (uint8_t*)pixels[cIdx],stride[cIdx], nPbWC,nPbHC);
+        }
+      }
+
+      return;
+    }
+  }
+
+
   for (int l=0;l<2;l++) {
     if (predFlag[l]) {
       // 8.5.3.2.1
@@ -367,30 +503,36 @@ void generate_inter_prediction_samples(base_context* ctx,
           mc_luma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                   predSamplesL[l],nCS,
                   (const uint16_t*)refPic->get_image_plane(0),
-                  refPic->get_luma_stride(), nPbW,nPbH, bit_depth_L);
+                  refPic->get_luma_stride(), refPic->get_mc_border(0),
+                  nPbW,nPbH, bit_depth_L);
         }
         else {
           mc_luma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                   predSamplesL[l],nCS,
                   (const uint8_t*)refPic->get_image_plane(0),
-                  refPic->get_luma_stride(), nPbW,nPbH, bit_depth_L);
+                  refPic->get_luma_stride(), refPic->get_mc_border(0),
+                  nPbW,nPbH, bit_depth_L);
         }
 
         if (img->high_bit_depth(0)) {
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[0][l],nCS, (const uint16_t*)refPic->get_image_plane(1),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_mc_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[1][l],nCS, (const uint16_t*)refPic->get_image_plane(2),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_mc_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
         }
         else {
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[0][l],nCS, (const uint8_t*)refPic->get_image_plane(1),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_mc_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
           mc_chroma(ctx, sps, vi->mv[l].x, vi->mv[l].y, xP,yP,
                     predSamplesC[1][l],nCS, (const uint8_t*)refPic->get_image_plane(2),
-                    refPic->get_chroma_stride(), nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
+                    refPic->get_chroma_stride(), refPic->get_mc_border(1),
+                    nPbW/SubWidthC,nPbH/SubHeightC, bit_depth_C);
         }
       }
     }
@@ -1086,7 +1228,7 @@ void derive_collocated_motion_vectors(base_context* ctx,
   logtrace(LogMotion,"derive_collocated_motion_vectors %d;%d\n",xP,yP);
 
 
-  // get collocated image and the prediction mode at the collocated position
+  // get collocated image
 
   assert(ctx->has_image(colPic));
   const de265_image* colImg = ctx->get_image(colPic);
@@ -1100,12 +1242,9 @@ void derive_collocated_motion_vectors(base_context* ctx,
     return;
   }
 
-  enum PredMode predMode = colImg->get_pred_mode(xColPb,yColPb);
-
-
-  // collocated block is Intra -> no collocated MV
+  // collocated reference image is unavailable -> no collocated MV
 
-  if (predMode == MODE_INTRA) {
+  if (colImg->integrity == INTEGRITY_UNAVAILABLE_REFERENCE) {
     out_mvLXCol->x = 0;
     out_mvLXCol->y = 0;
     *out_availableFlagLXCol = 0;
@@ -1113,15 +1252,24 @@ void derive_collocated_motion_vectors(base_context* ctx,
   }
 
 
-  logtrace(LogMotion,"colPic:%d (POC=%d) X:%d refIdxLX:%d refpiclist:%d\n",
-           colPic,
-           colImg->PicOrderCntVal,
-           X,refIdxLX,shdr->RefPicList[X][refIdxLX]);
+  // get the collocated MV, preferably from the compressed motion field of the collocated image
 
+  const PBMotion* mviPtr;
+  bool colIsIntra;
 
-  // collocated reference image is unavailable -> no collocated MV
+  if (colImg->has_compressed_motion_field()) {
+    mviPtr = &colImg->get_col_mv_info(xColPb,yColPb);
+    colIsIntra = (mviPtr->predFlag[0]==0 && mviPtr->predFlag[1]==0);
+  }
+  else {
+    mviPtr = &colImg->get_mv_info(xColPb,yColPb);
+    colIsIntra = (colImg->get_pred_mode(xColPb,yColPb) == MODE_INTRA);
+  }
 
-  if (colImg->integrity == INTEGRITY_UNAVAILABLE_REFERENCE) {
+
+  // collocated block is Intra -> no collocated MV
+
+  if (colIsIntra) {
     out_mvLXCol->x = 0;
     out_mvLXCol->y = 0;
     *out_availableFlagLXCol = 0;
@@ -1129,9 +1277,13 @@ void derive_collocated_motion_vectors(base_context* ctx,
   }
 
 
-  // get the collocated MV
+  logtrace(LogMotion,"colPic:%d (POC=%d) X:%d refIdxLX:%d refpiclist:%d\n",
+           colPic,
+           colImg->PicOrderCntVal,
+           X,refIdxLX,shdr->RefPicList[X][refIdxLX]);
 
-  const PBMotion& mvi = colImg->get_mv_info(xColPb,yColPb);
+
+  const PBMotion& mvi = *mviPtr;
   int listCol;
   int refIdxCol;
   MotionVector mvCol;
@@ -2078,6 +2230,134 @@ void motion_vectors_and_ref_indices(base_context* ctx,
 }
 
 
+void inter_prediction_batch::add(const slice_segment_header* shdr,
+                                 int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH,
+                                 const PBMotion& vi)
+{
+  assert(nPBs < MAX_PBS);
+
+  pb& p = pbs[nPBs++];
+  p.shdr = shdr;
+  p.xC = xC;  p.yC = yC;
+  p.xB = xB;  p.yB = yB;
+  p.nCS = nCS;
+  p.nPbW = nPbW;
+  p.nPbH = nPbH;
+  p.motion = vi;
+}
+
+
+/* Prefetch the w x h area at (x0;y0) of a reference plane, clipped to the plane. */
+static void prefetch_reference_area(const de265_image* refPic, int cIdx,
+                                    int x0,int y0, int w,int h)
+{
+  const int width  = refPic->get_width(cIdx);
+  const int height = refPic->get_height(cIdx);
+
+  int xs = Clip3(0,width-1,  x0);
+  int xe = Clip3(0,width-1,  x0+w-1);
+  int ys = Clip3(0,height-1, y0);
+  int ye = Clip3(0,height-1, y0+h-1);
+
+  const int bpp = refPic->get_bytes_per_pixel(cIdx);
+  const int rowBytes = (xe-xs+1)*bpp;
+
+  for (int y=ys;y<=ye;y++) {
+    const uint8_t* row = (const uint8_t*)refPic->get_image_plane_at_pos_any_depth(cIdx,xs,y);
+
+    for (int x=0;x<rowBytes;x+=64) {
+      prefetch_for_read(row+x);
+    }
+
+    prefetch_for_read(row+rowBytes-1);
+  }
+}
+
+
+static void prefetch_reference_areas(base_context* ctx, const de265_image* img,
+                                     const slice_segment_header* shdr,
+                                     int xP,int yP, int nPbW,int nPbH, const PBMotion& vi)
+{
+  const seq_parameter_set& sps = img->get_sps();
+
+  const int SubWidthC  = sps.SubWidthC;
+  const int SubHeightC = sps.SubHeightC;
+
+  for (int l=0;l<2;l++) {
+    if (!vi.predFlag[l] || vi.refIdx[l] >= MAX_NUM_REF_PICS) {
+      continue;
+    }
+
+    const de265_image* refPic = ctx->get_image(shdr->RefPicList[l][vi.refIdx[l]]);
+    if (!refPic || refPic->PicState == UnusedForReference) {
+      continue;
+    }
+
+    const MotionVector& mv = vi.mv[l];
+
+    prefetch_reference_area(refPic, 0,
+                            xP + (mv.x>>2) - 3, yP + (mv.y>>2) - 3,
+                            nPbW+7, nPbH+7);
+
+    if (sps.ChromaArrayType != CHROMA_MONO) {
+      int xC = xP/SubWidthC  + (mv.x >> (1+SubWidthC));
+      int yC = yP/SubHeightC + (mv.y >> (1+SubHeightC));
+
+      for (int cIdx=1;cIdx<=2;cIdx++) {
+        prefetch_reference_area(refPic, cIdx, xC-1, yC-1,
+                                nPbW/SubWidthC+3, nPbH/SubHeightC+3);
+      }
+    }
+  }
+}
+
+
+void inter_prediction_batch::flush(base_context* ctx, de265_image* img)
+{
+  if (nPBs==0) {
+    return;
+  }
+
+  // sort by reference picture (of the first used list), then in raster order
+
+  uint64_t keys[MAX_PBS];
+  int order[MAX_PBS];
+
+  for (int i=0;i<nPBs;i++) {
+    const pb& p = pbs[i];
+    const int l = p.motion.predFlag[0] ? 0 : 1;
+    const int refIdx = p.motion.refIdx[l];
+
+    uint64_t ref = (refIdx >= 0 && refIdx < MAX_NUM_REF_PICS) ?
+      p.shdr->RefPicList[l][refIdx] : 0xFF;
+
+    keys[i] = (ref << 32) | ((uint64_t)(p.yC+p.yB) << 16) | (uint64_t)(p.xC+p.xB);
+    order[i] = i;
+  }
+
+  std::sort(order, order+nPBs, [&keys](int a,int b) { return keys[a] < keys[b]; });
+
+
+  // get the reference areas of all PBs into the cache
+
+  for (int i=0;i<nPBs;i++) {
+    const pb& p = pbs[order[i]];
+    prefetch_reference_areas(ctx, img, p.shdr, p.xC+p.xB,p.yC+p.yB, p.nPbW,p.nPbH, p.motion);
+  }
+
+
+  // motion compensation
+
+  for (int i=0;i<nPBs;i++) {
+    const pb& p = pbs[order[i]];
+    generate_inter_prediction_samples(ctx, p.shdr, img, p.xC,p.yC, p.xB,p.yB, p.nCS,
+                                      p.nPbW,p.nPbH, &p.motion);
+  }
+
+  nPBs = 0;
+}
+
+
 // 8.5.3
 
 /* xC/yC : CB position
@@ -2089,7 +2369,8 @@ void decode_prediction_unit(base_context* ctx,
                             const slice_segment_header* shdr,
                             de265_image* img,
                             const PBMotionCoding& motion,
-                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx)
+                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx,
+                            bool predictSamples, inter_prediction_batch* batch)
 {
   logtrace(LogMotion,"decode_prediction_unit POC=%d %d;%d %dx%d\n",
            img->PicOrderCntVal, xC+xB,yC+yB, nPbW,nPbH);
@@ -2104,7 +2385,18 @@ void decode_prediction_unit(base_context* ctx,
 
   // 2.
 
-  generate_inter_prediction_samples(ctx,shdr, img, xC,yC, xB,yB, nCS, nPbW,nPbH, &vi);
+  if (predictSamples) {
+    if (batch) {
+      if (batch->full()) {
+        batch->flush(ctx, img);
+      }
+
+      batch->add(shdr, xC,yC, xB,yB, nCS, nPbW,nPbH, vi);
+    }
+    else {
+      generate_inter_prediction_samples(ctx,shdr, img, xC,yC, xB,yB, nCS, nPbW,nPbH, &vi);
+    }
+  }
 
 
   img->set_mv_info(xC+xB,yC+yB,nPbW,nPbH, vi);
@@ -104,9 +104,49 @@ void fill_luma_motion_vector_predictors(base_context* ctx,
                                         MotionVector out_mvpList[2]);
 
 
+/* Collects the inter PBs of a CTB to generate their prediction samples in one go.
+   On flush(), the PBs are sorted by reference picture and position, and the
+   reference areas of all PBs are prefetched before the motion compensation.
+   The batch has to be flushed before anything reads or modifies the prediction
+   samples, i.e. before the residual is added and before intra prediction.
+ */
+class inter_prediction_batch
+{
+ public:
+  inter_prediction_batch() : nPBs(0) { }
+
+  bool empty() const { return nPBs==0; }
+  bool full() const { return nPBs==MAX_PBS; }
+
+  void add(const slice_segment_header* shdr,
+           int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH,
+           const PBMotion& vi);
+
+  void flush(base_context* ctx, de265_image* img);
+
+ private:
+  // a 64x64 CTB holds at most 128 PBs (8x4 or 4x8)
+  enum { MAX_PBS = 128 };
+
+  struct pb {
+    const slice_segment_header* shdr;
+    int xC,yC, xB,yB, nCS, nPbW,nPbH;
+    PBMotion motion;
+  };
+
+  pb  pbs[MAX_PBS];
+  int nPBs;
+};
+
+
+/* Derive the motion of the PB and store it in the image.
+   The prediction samples are only generated if 'predictSamples' is set.
+   If a 'batch' is given, the sample generation is deferred to batch->flush().
+ */
 void decode_prediction_unit(base_context* ctx,const slice_segment_header* shdr,
                             de265_image* img, const PBMotionCoding& motion,
-                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx);
+                            int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx,
+                            bool predictSamples, inter_prediction_batch* batch = NULL);
 
 
 
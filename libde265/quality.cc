@@ -19,29 +19,32 @@
  */
 
 #include "quality.h"
+#include "decctx.h"
 #include <math.h>
 
 
-uint32_t SSD(const uint8_t* img, int imgStride,
-             const uint8_t* ref, int refStride,
-             int width, int height)
+/* The public functions below have no decoder context. They use their own
+   function table, initialized to the best available implementation on first use.
+ */
+static acceleration_functions create_acceleration_functions()
 {
-  uint32_t sum=0;
-
-  const uint8_t* iPtr = img;
-  const uint8_t* rPtr = ref;
+  acceleration_functions accel;
+  init_acceleration_functions(&accel, de265_acceleration_AUTO);
+  return accel;
+}
 
-  for (int y=0;y<height;y++) {
-    for (int x=0;x<width;x++) {
-      int diff = iPtr[x] - rPtr[x];
-      sum += diff*diff;
-    }
+static const acceleration_functions& get_acceleration_functions()
+{
+  static const acceleration_functions accel = create_acceleration_functions();
+  return accel;
+}
 
-    iPtr += imgStride;
-    rPtr += refStride;
-  }
 
-  return sum;
+uint32_t SSD(const uint8_t* img, int imgStride,
+             const uint8_t* ref, int refStride,
+             int width, int height)
+{
+  return (uint32_t)get_acceleration_functions().ssd_8(img,imgStride, ref,refStride, width,height);
 }
 
 
@@ -49,22 +52,7 @@ uint32_t SAD(const uint8_t* img, int imgStride,
              const uint8_t* ref, int refStride,
              int width, int height)
 {
-  uint32_t sum=0;
-
-  const uint8_t* iPtr = img;
-  const uint8_t* rPtr = ref;
-
-  for (int y=0;y<height;y++) {
-    for (int x=0;x<width;x++) {
-      int diff = iPtr[x] - rPtr[x];
-      sum += abs_value(diff);
-    }
-
-    iPtr += imgStride;
-    rPtr += refStride;
-  }
-
-  return sum;
+  return get_acceleration_functions().sad_8(img,imgStride, ref,refStride, width,height);
 }
 
 
@@ -72,26 +60,9 @@ double MSE(const uint8_t* img, int imgStride,
            const uint8_t* ref, int refStride,
            int width, int height)
 {
-  double sum=0.0;
-
-  const uint8_t* iPtr = img;
-  const uint8_t* rPtr = ref;
-
-  for (int y=0;y<height;y++) {
-    uint32_t lineSum=0;
-
-    for (int x=0;x<width;x++) {
-      int diff = iPtr[x] - rPtr[x];
-      lineSum += diff*diff;
-    }
-
-    sum += ((double)lineSum)/width;
-
-    iPtr += imgStride;
-    rPtr += refStride;
-  }
+  uint64_t sum = get_acceleration_functions().ssd_8(img,imgStride, ref,refStride, width,height);
 
-  return sum/height;
+  return ((double)sum)/(width*(double)height);
 }
 
 
@@ -329,6 +329,8 @@ void apply_sample_adaptive_offset_sequential(de265_image* img)
     return;
   }
 
+  STATISTICS_TIMER(img->decctx, StageSAO);
+
   int lumaImageSize   = img->get_image_stride(0) * img->get_height(0) * img->get_bytes_per_pixel(0);
   int chromaImageSize = img->get_image_stride(1) * img->get_height(1) * img->get_bytes_per_pixel(1);
 
@@ -404,6 +406,8 @@ void thread_task_sao::work()
   state = Running;
   img->thread_run(this);
 
+  STATISTICS_COUNT(img->decctx, tasks_run, 1);
+
   const seq_parameter_set& sps = img->get_sps();
 
   const int rightCtb = sps.PicWidthInCtbsY-1;
@@ -423,6 +427,9 @@ void thread_task_sao::work()
   }
 
 
+  STATISTICS_TIMER(img->decctx, StageSAO);
+
+
   // copy input image to output for this CTB-row
 
   outputImg->copy_lines_from(inputImg, ctb_y * ctbSize, (ctb_y+1) * ctbSize);
@@ -462,7 +469,7 @@ void thread_task_sao::work()
 
   for (int x=0;x<=rightCtb;x++) {
     const int CtbWidth = sps.PicWidthInCtbsY;
-    img->ctb_progress[x+ctb_y*CtbWidth].set_progress(CTB_PROGRESS_SAO);
+    img->ctb_progress.set_progress(x+ctb_y*CtbWidth, CTB_PROGRESS_SAO);
   }
 
 
@@ -510,15 +517,12 @@ bool add_sao_tasks(image_unit* imgunit, int saoInputProgress)
       task->inputProgress = saoInputProgress;
 
       imgunit->tasks.push_back(task);
-      add_task(&ctx->thread_pool_, task);
+      ctx->add_task(task);
       n++;
     }
 
-  /* Currently need barrier here because when are finished, we have to swap the pixel
-     data back into the main image. */
-  img->wait_for_completion();
-
-  img->exchange_pixel_data_with(imgunit->sao_output);
+  /* The caller has to wait for completion and swap the pixel data from
+     imgunit->sao_output back into the main image. */
 
   return true;
 }
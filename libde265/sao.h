@@ -29,7 +29,7 @@ void apply_sample_adaptive_offset(de265_image* img);
 void apply_sample_adaptive_offset_sequential(de265_image* img);
 
 /* saoInputProgress - the CTB progress that SAO will wait for before beginning processing.
-   Returns 'true' if any tasks have been added.
+   Returns 'true' if any tasks have been added. The output is written to imgunit->sao_output.
  */
 bool add_sao_tasks(image_unit* imgunit, int saoInputProgress);
 
@@ -423,7 +423,8 @@ de265_error process_sei(const sei_message* sei, de265_image* img)
 
   switch (sei->payload_type) {
   case sei_payload_type_decoded_picture_hash:
-    if (img->decctx->param_sei_check_hash) {
+    if (img->decctx->param_sei_check_hash && !img->decctx->param_parse_only) {
+      STATISTICS_TIMER(img->decctx, StageHashCheck);
       err = process_sei_decoded_picture_hash(sei, img);
       if (err==DE265_OK) {
         //printf("SEI check ok\n");
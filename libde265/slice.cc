@@ -2859,6 +2859,10 @@ void read_coding_tree_unit(thread_context* tctx)
     }
 
   read_coding_quadtree(tctx, xCtbPixels, yCtbPixels, sps.Log2CtbSizeY, 0);
+
+  // prediction of the remaining PBs (only with param_batch_mc)
+
+  tctx->mc_batch.flush(tctx->decctx, img);
 }
 
 
@@ -2919,6 +2923,7 @@ int residual_coding(thread_context* tctx,
 
   if (cIdx==0) {
     img->set_nonzero_coefficient(x0,y0,log2TrafoSize);
+    img->set_deblk_block_flags(x0,y0,log2TrafoSize, DEBLOCK_FLAG_NONZERO_COEFF);
   }
 
 
@@ -3072,6 +3077,8 @@ int residual_coding(thread_context* tctx,
   // ----- decode coefficients -----
 
   tctx->nCoeff[cIdx] = 0;
+  tctx->coeffBoxW[cIdx] = 0;
+  tctx->coeffBoxH[cIdx] = 0;
 
 
   // i - subblock index
@@ -3409,6 +3416,9 @@ int residual_coding(thread_context* tctx,
         tctx->coeffPos [cIdx][ tctx->nCoeff[cIdx] ] = xC + yC*CoeffStride;
         tctx->nCoeff[cIdx]++;
 
+        if (xC >= tctx->coeffBoxW[cIdx]) { tctx->coeffBoxW[cIdx] = xC+1; }
+        if (yC >= tctx->coeffBoxH[cIdx]) { tctx->coeffBoxH[cIdx] = yC+1; }
+
         //printf("%d ",currCoeff);
       }  // iterate through coefficients in sub-block
 
@@ -3421,10 +3431,13 @@ int residual_coding(thread_context* tctx,
 }
 
 
-static void decode_TU(thread_context* tctx,
-                      int x0,int y0,
-                      int xCUBase,int yCUBase,
-                      int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
+/* Intra prediction and residual of a transform block. All required state
+   (QP, flags, coefficients) is taken from the thread context.
+ */
+static void reconstruct_TU(thread_context* tctx,
+                           int x0,int y0,
+                           int xCUBase,int yCUBase,
+                           int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
 {
   de265_image* img = tctx->img;
   const seq_parameter_set& sps = img->get_sps();
@@ -3480,6 +3493,8 @@ static void decode_TU(thread_context* tctx,
     // --- cross-component-prediction when CBF==0 ---
 
     tctx->nCoeff[cIdx] = 0;
+    tctx->coeffBoxW[cIdx] = 0;
+    tctx->coeffBoxH[cIdx] = 0;
     residualDpcm=0;
 
     scale_coefficients(tctx, x0,y0, xCUBase,yCUBase, nT, cIdx,
@@ -3488,6 +3503,26 @@ static void decode_TU(thread_context* tctx,
 }
 
 
+static void decode_TU(thread_context* tctx,
+                      int x0,int y0,
+                      int xCUBase,int yCUBase,
+                      int nT, int cIdx, enum PredMode cuPredMode, bool cbf)
+{
+  // Only the metadata is needed. The coefficients have already been parsed.
+
+  if (tctx->decctx->param_parse_only) {
+    return;
+  }
+
+  if (tctx->defer_reconstruction) {
+    tctx->recon_queue.add_transform_block(tctx, x0,y0, xCUBase,yCUBase, nT, cIdx, cuPredMode, cbf);
+    return;
+  }
+
+  reconstruct_TU(tctx, x0,y0, xCUBase,yCUBase, nT, cIdx, cuPredMode, cbf);
+}
+
+
 static int decode_log2_res_scale_abs_plus1(thread_context* tctx, int cIdxMinus1)
 {
   //const int context = (cIdx==0) ? 0 : 1;
@@ -4041,6 +4076,24 @@ void read_mvd_coding(thread_context* tctx,
 }
 
 
+/* Derive the motion of the PB and predict it, or queue it for deferred reconstruction. */
+static void decode_PB(thread_context* tctx,
+                      int xC,int yC, int xB,int yB, int nCS, int nPbW,int nPbH, int partIdx)
+{
+  decoder_context* ctx = tctx->decctx;
+
+  decode_prediction_unit(ctx, tctx->shdr, tctx->img, tctx->motion,
+                         xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx,
+                         !ctx->param_parse_only && !tctx->defer_reconstruction,
+                         ctx->param_batch_mc ? &tctx->mc_batch : NULL);
+
+  if (tctx->defer_reconstruction) {
+    tctx->recon_queue.add_prediction(tctx->shdr, xC,yC, xB,yB, nCS, nPbW,nPbH,
+                                     tctx->img->get_mv_info(xC+xB,yC+yB));
+  }
+}
+
+
 void read_prediction_unit_SKIP(thread_context* tctx,
                                int x0, int y0,
                                int nPbW, int nPbH)
@@ -4133,8 +4186,7 @@ void read_prediction_unit(thread_context* tctx,
 
 
 
-  decode_prediction_unit(tctx->decctx, tctx->shdr, tctx->img, tctx->motion,
-                         xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
+  decode_PB(tctx, xC,yC,xB,yB, nCS, nPbW,nPbH, partIdx);
 }
 
 
@@ -4306,8 +4358,7 @@ void read_coding_unit(thread_context* tctx,
     // DECODE
 
     int nCS_L = 1<<log2CbSize;
-    decode_prediction_unit(tctx->decctx,tctx->shdr,tctx->img,tctx->motion,
-                           x0,y0, 0,0, nCS_L, nCS_L,nCS_L, 0);
+    decode_PB(tctx, x0,y0, 0,0, nCS_L, nCS_L,nCS_L, 0);
   }
   else /* not skipped */ {
     if (shdr->slice_type != SLICE_TYPE_I) {
@@ -4320,6 +4371,10 @@ void read_coding_unit(thread_context* tctx,
 
     img->set_pred_mode(x0,y0,log2CbSize, cuPredMode);
 
+    if (cuPredMode == MODE_INTRA) {
+      img->set_deblk_block_flags(x0,y0,log2CbSize, DEBLOCK_FLAG_INTRA);
+    }
+
     logtrace(LogSlice,"CU pred mode: %s\n", cuPredMode==MODE_INTRA ? "INTRA" : "INTER");
 
 
@@ -4567,6 +4622,11 @@ void read_coding_unit(thread_context* tctx,
           initial_chroma_cbf = 0;
         }
 
+        // The residual is added to the prediction and intra prediction reads
+        // the neighboring samples. Hence, all deferred MC has to be done now.
+
+        tctx->mc_batch.flush(tctx->decctx, img);
+
         read_transform_tree(tctx, x0,y0, x0,y0, x0,y0, log2CbSize, 0,0,
                             MaxTrafoDepth, IntraSplitFlag, cuPredMode,
                             initial_chroma_cbf, initial_chroma_cbf);
@@ -4651,6 +4711,256 @@ void read_coding_quadtree(thread_context* tctx,
 }
 
 
+// ---------------------------------------------------------------------------
+
+void reconstruction_queue::clear()
+{
+  commands.clear();
+  coeffList.clear();
+  coeffPos.clear();
+}
+
+
+void reconstruction_queue::swap(reconstruction_queue& q)
+{
+  commands.swap(q.commands);
+  coeffList.swap(q.coeffList);
+  coeffPos.swap(q.coeffPos);
+}
+
+
+void reconstruction_queue::start_CTB(int ctbAddrRS)
+{
+  command cmd;
+  cmd.type = StartOfCTB;
+  cmd.ctbAddrRS = ctbAddrRS;
+
+  commands.push_back(cmd);
+}
+
+
+void reconstruction_queue::add_prediction(const slice_segment_header* shdr,
+                                          int xC,int yC, int xB,int yB, int nCS,
+                                          int nPbW,int nPbH, const PBMotion& vi)
+{
+  command cmd;
+  cmd.type = PredictPB;
+  cmd.pb.shdr = shdr;
+  cmd.pb.xC = xC;
+  cmd.pb.yC = yC;
+  cmd.pb.xB = xB;
+  cmd.pb.yB = yB;
+  cmd.pb.nCS = nCS;
+  cmd.pb.nPbW = nPbW;
+  cmd.pb.nPbH = nPbH;
+  cmd.pb.motion = vi;
+
+  commands.push_back(cmd);
+}
+
+
+void reconstruction_queue::add_transform_block(const thread_context* tctx,
+                                               int x0,int y0, int xCUBase,int yCUBase,
+                                               int nT, int cIdx, enum PredMode cuPredMode,
+                                               bool cbf)
+{
+  // inter blocks without residual need no reconstruction (see reconstruct_TU())
+
+  if (cuPredMode != MODE_INTRA && !cbf &&
+      (cIdx==0 || tctx->ResScaleVal==0)) {
+    return;
+  }
+
+  command cmd;
+  cmd.type = TransformBlock;
+
+  tb_command& tb = cmd.tb;
+  tb.x0 = x0;
+  tb.y0 = y0;
+  tb.xCUBase = xCUBase;
+  tb.yCUBase = yCUBase;
+  tb.nT = nT;
+  tb.cIdx = cIdx;
+  tb.cuPredMode = cuPredMode;
+  tb.cbf = cbf;
+  tb.transform_skip_flag = tctx->transform_skip_flag[cIdx];
+  tb.cu_transquant_bypass_flag = tctx->cu_transquant_bypass_flag;
+  tb.explicit_rdpcm_flag = tctx->explicit_rdpcm_flag;
+  tb.explicit_rdpcm_dir  = tctx->explicit_rdpcm_dir;
+
+  switch (cIdx) {
+  case 0:  tb.qP = tctx->qPYPrime;  break;
+  case 1:  tb.qP = tctx->qPCbPrime; break;
+  default: tb.qP = tctx->qPCrPrime; break;
+  }
+
+  tb.ResScaleVal = tctx->ResScaleVal;
+
+  if (cbf) {
+    tb.nCoeff = tctx->nCoeff[cIdx];
+    tb.coeffBoxW = tctx->coeffBoxW[cIdx];
+    tb.coeffBoxH = tctx->coeffBoxH[cIdx];
+    tb.firstCoeff = coeffList.size();
+
+    coeffList.insert(coeffList.end(), tctx->coeffList[cIdx], tctx->coeffList[cIdx] + tb.nCoeff);
+    coeffPos .insert(coeffPos .end(), tctx->coeffPos [cIdx], tctx->coeffPos [cIdx] + tb.nCoeff);
+  }
+  else {
+    tb.nCoeff = 0;
+    tb.coeffBoxW = 0;
+    tb.coeffBoxH = 0;
+    tb.firstCoeff = 0;
+  }
+
+  commands.push_back(cmd);
+}
+
+
+void reconstruction_queue::reconstruct(thread_context* rtctx, thread_task* task)
+{
+  de265_image* img = rtctx->img;
+  decoder_context* ctx = rtctx->decctx;
+
+  const int ctbW = img->get_sps().PicWidthInCtbsY;
+
+  inter_prediction_batch* batch = (ctx->param_batch_mc ? &rtctx->mc_batch : NULL);
+
+  int currentCtb = -1;
+
+  for (size_t i=0;i<=commands.size();i++) {
+
+    // finish the previous CTB
+
+    if (i==commands.size() || commands[i].type == StartOfCTB) {
+      if (batch) {
+        batch->flush(ctx, img);
+      }
+
+      if (task && currentCtb >= 0) {
+        img->ctb_progress.set_progress(currentCtb, CTB_PROGRESS_PREFILTER);
+      }
+
+      if (i==commands.size()) {
+        break;
+      }
+    }
+
+    const command& cmd = commands[i];
+
+    switch (cmd.type) {
+    case StartOfCTB:
+      {
+        currentCtb = cmd.ctbAddrRS;
+
+        // intra prediction reads from the CTBs left, above, and above-right
+
+        if (task) {
+          int ctbx = currentCtb % ctbW;
+          int ctby = currentCtb / ctbW;
+
+          if (ctby>0) {
+            img->wait_for_progress(task, libde265_min(ctbx+1,ctbW-1),ctby-1, CTB_PROGRESS_PREFILTER);
+          }
+
+          if (ctbx>0) {
+            img->wait_for_progress(task, ctbx-1,ctby, CTB_PROGRESS_PREFILTER);
+          }
+        }
+      }
+      break;
+
+    case PredictPB:
+      {
+        const pb_command& pb = cmd.pb;
+
+        if (batch) {
+          if (batch->full()) {
+            batch->flush(ctx, img);
+          }
+
+          batch->add(pb.shdr, pb.xC,pb.yC, pb.xB,pb.yB, pb.nCS, pb.nPbW,pb.nPbH, pb.motion);
+        }
+        else {
+          generate_inter_prediction_samples(ctx, pb.shdr, img, pb.xC,pb.yC, pb.xB,pb.yB,
+                                            pb.nCS, pb.nPbW,pb.nPbH, &pb.motion);
+        }
+      }
+      break;
+
+    case TransformBlock:
+      {
+        const tb_command& tb = cmd.tb;
+        const int cIdx = tb.cIdx;
+
+        if (batch) {
+          batch->flush(ctx, img);
+        }
+
+        rtctx->cu_transquant_bypass_flag = tb.cu_transquant_bypass_flag;
+        rtctx->transform_skip_flag[cIdx] = tb.transform_skip_flag;
+        rtctx->explicit_rdpcm_flag = tb.explicit_rdpcm_flag;
+        rtctx->explicit_rdpcm_dir  = tb.explicit_rdpcm_dir;
+
+        switch (cIdx) {
+        case 0:  rtctx->qPYPrime  = tb.qP; break;
+        case 1:  rtctx->qPCbPrime = tb.qP; break;
+        default: rtctx->qPCrPrime = tb.qP; break;
+        }
+
+        rtctx->ResScaleVal = tb.ResScaleVal;
+
+        rtctx->nCoeff[cIdx] = tb.nCoeff;
+        rtctx->coeffBoxW[cIdx] = tb.coeffBoxW;
+        rtctx->coeffBoxH[cIdx] = tb.coeffBoxH;
+
+        if (tb.nCoeff) {
+          memcpy(rtctx->coeffList[cIdx], &coeffList[tb.firstCoeff], tb.nCoeff*sizeof(int16_t));
+          memcpy(rtctx->coeffPos [cIdx], &coeffPos [tb.firstCoeff], tb.nCoeff*sizeof(int16_t));
+        }
+
+        reconstruct_TU(rtctx, tb.x0,tb.y0, tb.xCUBase,tb.yCUBase, tb.nT, cIdx,
+                       (enum PredMode)tb.cuPredMode, tb.cbf);
+      }
+      break;
+    }
+  }
+}
+
+
+/* Reconstruct the queued CTBs with the scratch thread context 'rtctx' and empty the queue.
+   The coefficient buffer of 'rtctx' is zero after each TB, hence it can be reused.
+ */
+static void reconstruct_queued_CTBs(thread_context* rtctx, de265_image* img,
+                                    reconstruction_queue& queue, thread_task* task)
+{
+  rtctx->img = img;
+  rtctx->decctx = img->decctx;
+
+  queue.reconstruct(rtctx, task);
+  queue.clear();
+}
+
+
+std::string thread_task_reconstruct_CTBs::name() const {
+  char buf[100];
+  sprintf(buf,"reconstruct-%d",debug_ctbRow);
+  return buf;
+}
+
+
+void thread_task_reconstruct_CTBs::work()
+{
+  state = Running;
+  img->thread_run(this);
+
+  thread_context rtctx;
+  reconstruct_queued_CTBs(&rtctx, img, queue, this);
+
+  state = Finished;
+  img->thread_finishes(this);
+}
+
+
 // ---------------------------------------------------------------------------
 
 enum DecodeResult {
@@ -4670,6 +4980,8 @@ enum DecodeResult decode_substream(thread_context* tctx,
 
   const int ctbW = sps.PicWidthInCtbsY;
 
+  STATISTICS_TIMER(tctx->decctx, StageSliceDecoding);
+
 
   const int startCtbY = tctx->CtbY;
 
@@ -4733,6 +5045,10 @@ enum DecodeResult decode_substream(thread_context* tctx,
       return Decode_Error;
     }
 
+    if (tctx->defer_reconstruction) {
+      tctx->recon_queue.start_CTB(ctbx+ctby*ctbW);
+    }
+
     read_coding_tree_unit(tctx);
 
 
@@ -4757,6 +5073,12 @@ enum DecodeResult decode_substream(thread_context* tctx,
     int end_of_slice_segment_flag = decode_CABAC_term_bit(&tctx->cabac_decoder);
     //printf("end-of-slice flag: %d\n", end_of_slice_segment_flag);
 
+#ifdef DE265_STATISTICS
+    STATISTICS_COUNT(tctx->decctx, ctbs, 1);
+    STATISTICS_COUNT(tctx->decctx, bins, tctx->cabac_decoder.num_bins);
+    tctx->cabac_decoder.num_bins = 0;
+#endif
+
     if (end_of_slice_segment_flag) {
       // at the end of the slice segment, we store the CABAC model if we need it
       // because a dependent slice may follow
@@ -4769,7 +5091,24 @@ enum DecodeResult decode_substream(thread_context* tctx,
       }
     }
 
-    tctx->img->ctb_progress[ctbx+ctby*ctbW].set_progress(CTB_PROGRESS_PREFILTER);
+    // reconstruct the parsed CTB, or hand over the CTB row to a background task
+
+    if (tctx->reconstruct_in_background) {
+      if (ctbx == ctbW-1 || end_of_slice_segment_flag) {
+        tctx->decctx->add_task_reconstruct_CTBs(tctx, ctby);
+      }
+    }
+    else {
+      if (tctx->defer_reconstruction) {
+        if (tctx->recon_tctx == NULL) {
+          tctx->recon_tctx = new thread_context;
+        }
+
+        reconstruct_queued_CTBs(tctx->recon_tctx, tctx->img, tctx->recon_queue, NULL);
+      }
+
+      tctx->img->ctb_progress.set_progress(ctbx+ctby*ctbW, CTB_PROGRESS_PREFILTER);
+    }
 
     //printf("%p: decoded %d|%d\n",tctx, ctby,ctbx);
 
@@ -4798,7 +5137,7 @@ enum DecodeResult decode_substream(thread_context* tctx,
       /*
       for (int x = ctbx+1 ; x<sps->PicWidthInCtbsY; x++) {
         printf("mark skipped %d;%d\n",ctbx,ctby);
-        tctx->img->ctb_progress[ctbx+ctby*ctbW].set_progress(CTB_PROGRESS_PREFILTER);
+        tctx->img->ctb_progress.set_progress(ctbx+ctby*ctbW, CTB_PROGRESS_PREFILTER);
       }
       */
 
@@ -4913,6 +5252,8 @@ void thread_task_slice_segment::work()
   state = Running;
   img->thread_run(this);
 
+  STATISTICS_COUNT(tctx->decctx, tasks_run, 1);
+
   setCtbAddrFromTS(tctx);
 
   //printf("%p: A start decoding at %d/%d\n", tctx, tctx->CtbX,tctx->CtbY);
@@ -4954,6 +5295,8 @@ void thread_task_ctb_row::work()
   state = Running;
   img->thread_run(this);
 
+  STATISTICS_COUNT(tctx->decctx, tasks_run, 1);
+
   setCtbAddrFromTS(tctx);
 
   int ctby = tctx->CtbAddrInRS / ctbW;
@@ -4966,7 +5309,7 @@ void thread_task_ctb_row::work()
     if (!success) {
       // could not decode this row, mark whole row as finished
       for (int x=0;x<ctbW;x++) {
-        img->ctb_progress[myCtbRow*ctbW + x].set_progress(CTB_PROGRESS_PREFILTER);
+        img->ctb_progress.set_progress(myCtbRow*ctbW + x, CTB_PROGRESS_PREFILTER);
       }
 
       state = Finished;
@@ -4995,7 +5338,7 @@ void thread_task_ctb_row::work()
 
       if (x        < sps.PicWidthInCtbsY &&
           myCtbRow < sps.PicHeightInCtbsY) {
-        img->ctb_progress[myCtbRow*ctbW + x].set_progress(CTB_PROGRESS_PREFILTER);
+        img->ctb_progress.set_progress(myCtbRow*ctbW + x, CTB_PROGRESS_PREFILTER);
       }
     }
   }
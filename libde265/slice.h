@@ -283,6 +283,9 @@ de265_error read_slice_segment_data(thread_context* tctx);
 bool alloc_and_init_significant_coeff_ctxIdx_lookupTable();
 void free_significant_coeff_ctxIdx_lookupTable();
 
+// context index maps for significant_coeff_flag, set up by the function above
+extern uint8_t* ctxIdxLookup[4 /* 4-log2-32 */][2 /* !!cIdx */][2 /* !!scanIdx */][4 /* prevCsbf */];
+
 
 class thread_task_ctb_row : public thread_task
 {
@@ -0,0 +1,68 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "statistics.h"
+
+
+#ifdef DE265_STATISTICS
+
+void decoder_statistics::reset()
+{
+  for (int i=0;i<NumDecoderStages;i++) {
+    cycles[i] = 0;
+  }
+
+  bins = 0;
+  ctbs = 0;
+  pictures = 0;
+  tasks_run = 0;
+  tasks_blocked = 0;
+}
+
+
+void decoder_statistics::get(de265_statistics* out) const
+{
+  uint64_t slice = cycles[StageSliceDecoding];
+  uint64_t inter = cycles[StageInterPrediction];
+  uint64_t resi  = cycles[StageResidual];
+  uint64_t intra = cycles[StageIntraPrediction];
+
+  // The prediction and residual stages are nested in the slice decoding.
+
+  uint64_t nested = inter + resi + intra;
+
+  out->parsing_cycles          = (slice > nested ? slice - nested : 0);
+  out->inter_prediction_cycles = inter;
+  out->residual_cycles         = resi;
+  out->intra_prediction_cycles = intra;
+  out->deblocking_cycles       = cycles[StageDeblocking];
+  out->sao_cycles              = cycles[StageSAO];
+  out->hash_check_cycles       = cycles[StageHashCheck];
+  out->wait_cycles             = cycles[StageWaitForProgress];
+
+  out->bins          = bins;
+  out->ctbs          = ctbs;
+  out->pictures      = pictures;
+  out->tasks_run     = tasks_run;
+  out->tasks_blocked = tasks_blocked;
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DE265_STATISTICS_H
+#define DE265_STATISTICS_H
+
+#include "libde265/de265.h"
+
+#include <stdint.h>
+
+
+/* Performance counters of the decoder.
+
+   These are only collected when libde265 is compiled with DE265_STATISTICS.
+   Otherwise, all statistics macros expand to nothing.
+   Times are measured with the CPU time-stamp counter on x86 and in nanoseconds
+   on other platforms. All counters are summed over all threads.
+ */
+
+enum decoder_stage {
+  StageSliceDecoding,   // decode_substream(), includes the nested stages below
+  StageInterPrediction,
+  StageResidual,
+  StageIntraPrediction,
+  StageDeblocking,
+  StageSAO,
+  StageHashCheck,
+  StageWaitForProgress,
+  NumDecoderStages
+};
+
+
+#ifdef DE265_STATISTICS
+
+#include <atomic>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <x86intrin.h>
+#  endif
+inline uint64_t statistics_clock() { return __rdtsc(); }
+#else
+#  include <chrono>
+inline uint64_t statistics_clock()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+
+class decoder_statistics
+{
+ public:
+  decoder_statistics() { reset(); }
+
+  void reset();
+  void get(de265_statistics* out) const;
+
+  void add_time(enum decoder_stage stage, uint64_t t) {
+    cycles[stage].fetch_add(t, std::memory_order_relaxed);
+  }
+
+  std::atomic<uint64_t> cycles[NumDecoderStages];
+
+  std::atomic<uint64_t> bins;
+  std::atomic<uint64_t> ctbs;
+  std::atomic<uint64_t> pictures;
+  std::atomic<uint64_t> tasks_run;
+  std::atomic<uint64_t> tasks_blocked;
+};
+
+
+// Adds the time until the end of the scope to the stage. 'stats' may be NULL.
+class statistics_timer
+{
+ public:
+  statistics_timer(decoder_statistics* stats, enum decoder_stage stage)
+    : mStats(stats), mStage(stage), mStart(statistics_clock()) { }
+
+  ~statistics_timer() {
+    if (mStats) { mStats->add_time(mStage, statistics_clock() - mStart); }
+  }
+
+ private:
+  decoder_statistics* mStats;
+  enum decoder_stage  mStage;
+  uint64_t            mStart;
+};
+
+
+#define STATISTICS_CONCAT2(a,b) a##b
+#define STATISTICS_CONCAT(a,b)  STATISTICS_CONCAT2(a,b)
+
+// 'decctx' is a (possibly NULL) decoder_context pointer
+#define STATISTICS_TIMER(decctx, stage) \
+  statistics_timer STATISTICS_CONCAT(statistics_timer_, __LINE__) \
+    ((decctx) ? &(decctx)->statistics : NULL, stage)
+
+#define STATISTICS_COUNT(decctx, counter, n) \
+  do { \
+    if (decctx) { (decctx)->statistics.counter.fetch_add(n, std::memory_order_relaxed); } \
+  } while(0)
+
+#else
+
+#define STATISTICS_TIMER(decctx, stage)
+#define STATISTICS_COUNT(decctx, counter, n) do { } while(0)
+
+#endif
+
+#endif
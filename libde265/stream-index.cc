@@ -0,0 +1,376 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stream-index.h"
+#include "nal.h"
+#include "sps.h"
+#include "decctx.h"
+#include "bitstream.h"
+
+#include <string.h>
+#include <algorithm>
+
+
+// Of slice NALs, we only keep this many bytes. This is enough for the slice header
+// fields up to slice_pic_order_cnt_lsb.
+#define SLICE_HEADER_PREFIX_SIZE 64
+
+
+static bool is_parameter_set(int nal_unit_type)
+{
+  return (nal_unit_type == NAL_UNIT_VPS_NUT ||
+          nal_unit_type == NAL_UNIT_SPS_NUT ||
+          nal_unit_type == NAL_UNIT_PPS_NUT);
+}
+
+
+// NALs that belong to the next access unit (7.4.2.4.4)
+static bool starts_access_unit(int nal_unit_type)
+{
+  return ((nal_unit_type >= NAL_UNIT_VPS_NUT && nal_unit_type <= NAL_UNIT_AUD_NUT) ||
+          nal_unit_type == NAL_UNIT_PREFIX_SEI_NUT ||
+          (nal_unit_type >= 41 && nal_unit_type <= 44) ||
+          (nal_unit_type >= 48 && nal_unit_type <= 55));
+}
+
+
+static void remove_stuffing_bytes(const std::vector<unsigned char>& nal,
+                                  std::vector<unsigned char>& rbsp)
+{
+  rbsp.clear();
+  rbsp.reserve(nal.size());
+
+  int nZeros=0;
+  for (size_t i=0;i<nal.size();i++) {
+    unsigned char b = nal[i];
+
+    if (nZeros>=2 && b==3) {
+      nZeros=0;
+      continue;
+    }
+
+    rbsp.push_back(b);
+    nZeros = (b==0) ? nZeros+1 : 0;
+  }
+}
+
+
+stream_index::stream_index()
+{
+  for (int i=0;i<MaxVPS;i++) { mVPS[i]=-1; }
+  for (int i=0;i<MaxSPS;i++) { mSPS[i]=-1; mSPSInfo[i].valid=false; }
+  for (int i=0;i<MaxPPS;i++) { mPPS[i]=-1; mPPSInfo[i].valid=false; }
+
+  mStreamPos = 0;
+  mTrailingZeros = 0;
+
+  mInNAL = false;
+  mNALStart = 0;
+  mNALPTS = 0;
+
+  mAccessUnitStart = -1;
+  mPictureCnt = 0;
+}
+
+
+void stream_index::append_to_NAL(const unsigned char* data, int len)
+{
+  if (!mInNAL || len<=0) {
+    return;
+  }
+
+  // Only parameter sets are stored completely. Of all other NALs, we only need
+  // the NAL header and the beginning of the slice header.
+
+  int nal_unit_type = ((mNAL.empty() ? data[0] : mNAL[0]) >> 1) & 0x3f;
+
+  if (!is_parameter_set(nal_unit_type)) {
+    len = std::min(len, SLICE_HEADER_PREFIX_SIZE - (int)mNAL.size());
+  }
+
+  if (len>0) {
+    mNAL.insert(mNAL.end(), data, data+len);
+  }
+}
+
+
+void stream_index::push_data(const unsigned char* data, int len, de265_PTS pts)
+{
+  const unsigned char* p   = data;   // start of the data not yet appended to the current NAL
+  const unsigned char* end = data+len;
+
+  for (;;) {
+    // find the next start code: '1' byte preceded by at least two zero bytes
+
+    const unsigned char* one = (const unsigned char*)memchr(p, 1, end-p);
+    if (one==NULL) {
+      append_to_NAL(p, end-p);
+      break;
+    }
+
+    int nZeros=0;
+    const unsigned char* z = one;
+    while (z>data && z[-1]==0 && nZeros<3) { z--; nZeros++; }
+    if (z==data && nZeros<3) { nZeros = std::min(3, nZeros + mTrailingZeros); }
+
+    if (nZeros<2) {
+      append_to_NAL(p, one+1-p);
+      p = one+1;
+      continue;
+    }
+
+    // end the current NAL before the zero bytes of the start code
+
+    if (z>p) { append_to_NAL(p, z-p); }
+    end_of_NAL();
+
+    mInNAL    = true;
+    mNALStart = mStreamPos + (one-data) - nZeros;
+    mNALPTS   = pts;
+
+    p = one+1;
+  }
+
+
+  // count the zero bytes at the end for start codes crossing the data boundary
+
+  int nZeros=0;
+  while (nZeros<len && nZeros<3 && data[len-1-nZeros]==0) { nZeros++; }
+  if (nZeros==len) { mTrailingZeros = std::min(3, mTrailingZeros+nZeros); }
+  else             { mTrailingZeros = nZeros; }
+
+  mStreamPos += len;
+}
+
+
+void stream_index::flush_data()
+{
+  end_of_NAL();
+}
+
+
+void stream_index::end_of_NAL()
+{
+  if (!mInNAL) {
+    return;
+  }
+
+  mInNAL = false;
+
+  // trailing_zero_8bits (and the zeros of a following start code that were appended)
+
+  while (!mNAL.empty() && mNAL.back()==0) {
+    mNAL.pop_back();
+  }
+
+  if (mNAL.size()<2) {
+    mNAL.clear();
+    return;
+  }
+
+  int nal_unit_type = (mNAL[0]>>1) & 0x3f;
+  int nuh_layer_id  = ((mNAL[0]&1)<<5) | (mNAL[1]>>3);
+
+  if (nuh_layer_id > 0) {
+    mNAL.clear();
+    return;
+  }
+
+  if (starts_access_unit(nal_unit_type) && mAccessUnitStart<0) {
+    mAccessUnitStart = mNALStart;
+  }
+
+  std::vector<unsigned char> rbsp;
+  remove_stuffing_bytes(mNAL, rbsp);
+
+  switch (nal_unit_type) {
+  case NAL_UNIT_VPS_NUT: read_VPS(rbsp); break;
+  case NAL_UNIT_SPS_NUT: read_SPS(rbsp); break;
+  case NAL_UNIT_PPS_NUT: read_PPS(rbsp); break;
+
+  default:
+    if (nal_unit_type < 32) {
+      read_slice_header(rbsp, nal_unit_type);
+    }
+    break;
+  }
+
+  mNAL.clear();
+}
+
+
+void stream_index::store_parameter_set(int* psTable, int id)
+{
+  // the same parameter set is usually repeated at each IRAP
+
+  if (psTable[id]>=0 && mParameterSetNALs[psTable[id]] == mNAL) {
+    return;
+  }
+
+  psTable[id] = mParameterSetNALs.size();
+  mParameterSetNALs.push_back(mNAL);
+}
+
+
+void stream_index::read_VPS(std::vector<unsigned char>& rbsp)
+{
+  bitreader reader;
+  bitreader_init(&reader, rbsp.data()+2, rbsp.size()-2);
+
+  int vps_id = get_bits(&reader,4);
+  store_parameter_set(mVPS, vps_id);
+}
+
+
+void stream_index::read_SPS(std::vector<unsigned char>& rbsp)
+{
+  bitreader reader;
+  bitreader_init(&reader, rbsp.data()+2, rbsp.size()-2);
+
+  error_queue errqueue;
+  seq_parameter_set sps;
+  if (sps.read(&errqueue, &reader) != DE265_OK ||
+      sps.seq_parameter_set_id < 0 || sps.seq_parameter_set_id >= MaxSPS) {
+    return;
+  }
+
+  int id = sps.seq_parameter_set_id;
+  mSPSInfo[id].valid = true;
+  mSPSInfo[id].log2_max_pic_order_cnt_lsb = sps.log2_max_pic_order_cnt_lsb;
+  mSPSInfo[id].separate_colour_plane_flag = sps.separate_colour_plane_flag;
+
+  store_parameter_set(mSPS, id);
+}
+
+
+void stream_index::read_PPS(std::vector<unsigned char>& rbsp)
+{
+  bitreader reader;
+  bitreader_init(&reader, rbsp.data()+2, rbsp.size()-2);
+
+  int pps_id = get_uvlc(&reader);
+  int sps_id = get_uvlc(&reader);
+  if (pps_id<0 || pps_id>=MaxPPS ||
+      sps_id<0 || sps_id>=MaxSPS) {
+    return;
+  }
+
+  skip_bits(&reader,1); // dependent_slice_segments_enabled_flag
+
+  mPPSInfo[pps_id].valid = true;
+  mPPSInfo[pps_id].seq_parameter_set_id = sps_id;
+  mPPSInfo[pps_id].output_flag_present_flag = get_bits(&reader,1);
+  mPPSInfo[pps_id].num_extra_slice_header_bits = get_bits(&reader,3);
+
+  store_parameter_set(mPPS, pps_id);
+}
+
+
+void stream_index::read_slice_header(std::vector<unsigned char>& rbsp, int nal_unit_type)
+{
+  int64_t accessUnitStart = (mAccessUnitStart>=0 ? mAccessUnitStart : mNALStart);
+  mAccessUnitStart = -1;
+
+  bitreader reader;
+  bitreader_init(&reader, rbsp.data()+2, rbsp.size()-2);
+
+  int first_slice_segment_in_pic_flag = get_bits(&reader,1);
+  if (!first_slice_segment_in_pic_flag) {
+    return;
+  }
+
+  int pictureNumber = mPictureCnt++;
+
+  if (!isIRAP(nal_unit_type)) {
+    return;
+  }
+
+  skip_bits(&reader,1); // no_output_of_prior_pics_flag
+
+  int pps_id = get_uvlc(&reader);
+  if (pps_id<0 || pps_id>=MaxPPS || !mPPSInfo[pps_id].valid) {
+    return;
+  }
+
+  const pps_info& pps = mPPSInfo[pps_id];
+  const sps_info& sps = mSPSInfo[pps.seq_parameter_set_id];
+  if (!sps.valid) {
+    return;
+  }
+
+  // POC of the IRAP picture. When decoding starts at the IRAP, PicOrderCntMsb is zero.
+
+  int poc = 0;
+  if (!isIDR(nal_unit_type)) {
+    skip_bits(&reader, pps.num_extra_slice_header_bits);
+    get_uvlc(&reader); // slice_type
+    if (pps.output_flag_present_flag)   { skip_bits(&reader,1); }
+    if (sps.separate_colour_plane_flag) { skip_bits(&reader,2); }
+
+    poc = get_bits(&reader, sps.log2_max_pic_order_cnt_lsb);
+  }
+
+  de265_random_access_point rap;
+  rap.byte_offset    = accessUnitStart;
+  rap.pts            = mNALPTS;
+  rap.poc            = poc;
+  rap.nal_unit_type  = nal_unit_type;
+  rap.picture_number = pictureNumber;
+
+  mRAPs.push_back(rap);
+
+
+  // parameter sets that have been received so far
+
+  std::vector<int> ps;
+  for (int i=0;i<MaxVPS;i++) { if (mVPS[i]>=0) ps.push_back(mVPS[i]); }
+  for (int i=0;i<MaxSPS;i++) { if (mSPS[i]>=0) ps.push_back(mSPS[i]); }
+  for (int i=0;i<MaxPPS;i++) { if (mPPS[i]>=0) ps.push_back(mPPS[i]); }
+
+  mRAPParameterSets.push_back(ps);
+}
+
+
+int stream_index::find_random_access_point(de265_PTS pts) const
+{
+  // binary search for the last RAP with rap.pts <= pts (PTS increase in decoding order at RAPs)
+
+  int lo=0, hi=mRAPs.size();
+  while (lo<hi) {
+    int mid = (lo+hi)/2;
+    if (mRAPs[mid].pts <= pts) { lo=mid+1; }
+    else                       { hi=mid; }
+  }
+
+  return lo-1;
+}
+
+
+std::vector<const std::vector<unsigned char>*> stream_index::get_parameter_sets(int rapIdx) const
+{
+  std::vector<const std::vector<unsigned char>*> nals;
+
+  const std::vector<int>& ps = mRAPParameterSets[rapIdx];
+  for (size_t i=0;i<ps.size();i++) {
+    nals.push_back(&mParameterSetNALs[ps[i]]);
+  }
+
+  return nals;
+}
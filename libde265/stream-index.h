@@ -0,0 +1,106 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DE265_STREAM_INDEX_H
+#define DE265_STREAM_INDEX_H
+
+#include "libde265/de265.h"
+
+#include <vector>
+
+
+/* Index of the random access points (IRAP pictures) in an Annex-B byte stream.
+
+   The byte stream is only scanned for start codes. Parameter sets are read
+   completely and of the slice NALs, only the first bytes of the slice header
+   are parsed. All other data is skipped.
+ */
+class stream_index
+{
+ public:
+  stream_index();
+
+  void push_data(const unsigned char* data, int len, de265_PTS pts);
+  void flush_data(); // end of stream, process the last NAL
+
+  int  num_random_access_points() const { return mRAPs.size(); }
+  const de265_random_access_point& get_random_access_point(int idx) const { return mRAPs[idx]; }
+
+  // index of the last random access point with a PTS <= 'pts', -1 if there is none
+  int  find_random_access_point(de265_PTS pts) const;
+
+  // parameter set NALs (with stuffing bytes, without start code) that are active at the RAP
+  std::vector<const std::vector<unsigned char>*> get_parameter_sets(int rapIdx) const;
+
+ private:
+  std::vector<de265_random_access_point> mRAPs;
+  std::vector<std::vector<int> > mRAPParameterSets; // indices into mParameterSetNALs
+
+
+  // --- parameter sets ---
+
+  enum { MaxVPS=16, MaxSPS=16, MaxPPS=64 };
+
+  std::vector<std::vector<unsigned char> > mParameterSetNALs;
+
+  int mVPS[MaxVPS];  // current parameter set NALs (index into mParameterSetNALs)
+  int mSPS[MaxSPS];
+  int mPPS[MaxPPS];
+
+  // header fields that are needed for parsing the slice header
+
+  struct sps_info {
+    bool valid;
+    int  log2_max_pic_order_cnt_lsb;
+    bool separate_colour_plane_flag;
+  } mSPSInfo[MaxSPS];
+
+  struct pps_info {
+    bool valid;
+    int  seq_parameter_set_id;
+    bool output_flag_present_flag;
+    int  num_extra_slice_header_bits;
+  } mPPSInfo[MaxPPS];
+
+
+  // --- byte-stream scanner ---
+
+  int64_t mStreamPos;     // number of bytes pushed so far
+  int     mTrailingZeros; // number of zero bytes at the end of the last pushed data
+
+  bool      mInNAL;
+  int64_t   mNALStart;    // byte position of the start code
+  de265_PTS mNALPTS;
+  std::vector<unsigned char> mNAL; // (beginning of) the current NAL
+
+  int64_t mAccessUnitStart; // start of the non-VCL NALs preceding the next picture, -1 if none
+  int     mPictureCnt;
+
+  void append_to_NAL(const unsigned char* data, int len);
+  void end_of_NAL();
+
+  void store_parameter_set(int* psTable, int id);
+  void read_VPS(std::vector<unsigned char>& rbsp);
+  void read_SPS(std::vector<unsigned char>& rbsp);
+  void read_PPS(std::vector<unsigned char>& rbsp);
+  void read_slice_header(std::vector<unsigned char>& rbsp, int nal_unit_type);
+};
+
+#endif
@@ -21,6 +21,7 @@
 #include "threads.h"
 #include <assert.h>
 #include <string.h>
+#include <new>
 
 #if defined(_MSC_VER) || defined(__MINGW32__)
 # include <malloc.h>
@@ -141,6 +142,147 @@ int  de265_progress_lock::get_progress() const
 
 
 
+
+#define CTB_PROGRESS_SPIN_COUNT 200
+
+static inline void cpu_relax()
+{
+#if defined(_WIN32)
+  YieldProcessor();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+  __builtin_ia32_pause();
+#endif
+}
+
+
+de265_CTB_progress::de265_CTB_progress()
+  : mWidthInCtbs(0),
+    mHeightInCtbs(0),
+    mProgress(NULL),
+    mRows(NULL)
+{
+}
+
+
+de265_CTB_progress::~de265_CTB_progress()
+{
+  release();
+}
+
+
+bool de265_CTB_progress::alloc(int widthInCtbs, int heightInCtbs)
+{
+  if (mProgress && widthInCtbs==mWidthInCtbs && heightInCtbs==mHeightInCtbs) {
+    return true;
+  }
+
+  release();
+
+  mProgress = new (std::nothrow) std::atomic<uint8_t>[widthInCtbs*heightInCtbs];
+  mRows     = new (std::nothrow) row_wait_queue[heightInCtbs];
+
+  if (mProgress==NULL || mRows==NULL) {
+    delete[] mProgress;
+    delete[] mRows;
+    mProgress = NULL;
+    mRows = NULL;
+    return false;
+  }
+
+  mWidthInCtbs  = widthInCtbs;
+  mHeightInCtbs = heightInCtbs;
+
+  for (int y=0;y<heightInCtbs;y++) {
+    de265_mutex_init(&mRows[y].mutex);
+    de265_cond_init(&mRows[y].cond);
+    mRows[y].numWaiters = 0;
+  }
+
+  reset();
+
+  return true;
+}
+
+
+void de265_CTB_progress::release()
+{
+  if (mRows) {
+    for (int y=0;y<mHeightInCtbs;y++) {
+      de265_mutex_destroy(&mRows[y].mutex);
+      de265_cond_destroy(&mRows[y].cond);
+    }
+  }
+
+  delete[] mProgress;
+  delete[] mRows;
+
+  mProgress = NULL;
+  mRows = NULL;
+  mWidthInCtbs = mHeightInCtbs = 0;
+}
+
+
+void de265_CTB_progress::reset(int value)
+{
+  int n = size();
+  for (int i=0;i<n;i++) {
+    mProgress[i].store(value, std::memory_order_relaxed);
+  }
+}
+
+
+void de265_CTB_progress::set_progress(int ctbAddrRS, int progress)
+{
+  std::atomic<uint8_t>& ctb = mProgress[ctbAddrRS];
+
+  uint8_t current = ctb.load(std::memory_order_relaxed);
+  do {
+    if (current >= progress) {
+      return;
+    }
+  } while (!ctb.compare_exchange_weak(current, progress));
+
+  // Wake up the threads sleeping on this row. Both, the store above and the
+  // load of numWaiters are sequentially consistent, hence either we see the
+  // waiter, or the waiter sees the new progress before going to sleep.
+
+  row_wait_queue& row = mRows[ctbAddrRS / mWidthInCtbs];
+
+  if (row.numWaiters.load() > 0) {
+    de265_mutex_lock(&row.mutex);
+    de265_cond_broadcast(&row.cond, &row.mutex);
+    de265_mutex_unlock(&row.mutex);
+  }
+}
+
+
+void de265_CTB_progress::wait_for_progress(int ctbAddrRS, int progress)
+{
+  std::atomic<uint8_t>& ctb = mProgress[ctbAddrRS];
+
+  for (int i=0;i<CTB_PROGRESS_SPIN_COUNT;i++) {
+    if (ctb.load(std::memory_order_acquire) >= progress) {
+      return;
+    }
+
+    cpu_relax();
+  }
+
+  row_wait_queue& row = mRows[ctbAddrRS / mWidthInCtbs];
+
+  de265_mutex_lock(&row.mutex);
+  row.numWaiters++;
+
+  while (ctb.load() < progress) {
+    de265_cond_wait(&row.cond, &row.mutex);
+  }
+
+  row.numWaiters--;
+  de265_mutex_unlock(&row.mutex);
+}
+
+
+
 #include "libde265/decctx.h"
 
 #if 0
@@ -184,6 +326,28 @@ void printblks(const thread_pool* pool)
 #endif
 
 
+/* Find the next queue that has a task that may be started, beginning with the
+   queue after the one that was served last (round-robin).
+   The pool mutex must be held.
+ */
+static thread_task_queue* next_queue_with_startable_task(thread_pool* pool)
+{
+  int nQueues = pool->queues.size();
+
+  for (int i=0;i<nQueues;i++) {
+    int idx = (pool->next_queue + i) % nQueues;
+    thread_task_queue* queue = pool->queues[idx];
+
+    if (queue->can_start_task()) {
+      pool->next_queue = (idx+1) % nQueues;
+      return queue;
+    }
+  }
+
+  return NULL;
+}
+
+
 static THREAD_RESULT worker_thread(THREAD_PARAM pool_ptr)
 {
   thread_pool* pool = (thread_pool*)pool_ptr;
@@ -193,12 +357,19 @@ static THREAD_RESULT worker_thread(THREAD_PARAM pool_ptr)
 
   while(true) {
 
+    thread_task_queue* queue = NULL;
+
     // wait until we can pick a task or until the pool has been stopped
 
     for (;;) {
       // end waiting if thread-pool has been stopped or we have a task to execute
 
-      if (pool->stopped || pool->tasks.size()>0) {
+      if (pool->stopped) {
+        break;
+      }
+
+      queue = next_queue_with_startable_task(pool);
+      if (queue) {
         break;
       }
 
@@ -216,8 +387,9 @@ static THREAD_RESULT worker_thread(THREAD_PARAM pool_ptr)
 
     // get a task
 
-    thread_task* task = pool->tasks.front();
-    pool->tasks.pop_front();
+    thread_task* task = queue->tasks.front();
+    queue->tasks.pop_front();
+    queue->num_running_tasks++;
 
     pool->num_threads_working++;
 
@@ -235,6 +407,17 @@ static THREAD_RESULT worker_thread(THREAD_PARAM pool_ptr)
     de265_mutex_lock(&pool->mutex);
 
     pool->num_threads_working--;
+    queue->num_running_tasks--;
+
+    if (queue->num_running_tasks==0) {
+      de265_cond_broadcast(&pool->cond_task_finished, &pool->mutex);
+    }
+
+    // a task of this queue that was held back by its limit may be started now
+
+    if (queue->can_start_task()) {
+      de265_cond_signal(&pool->cond_var);
+    }
   }
   de265_mutex_unlock(&pool->mutex);
 
@@ -257,9 +440,11 @@ de265_error start_thread_pool(thread_pool* pool, int num_threads)
 
   de265_mutex_init(&pool->mutex);
   de265_cond_init(&pool->cond_var);
+  de265_cond_init(&pool->cond_task_finished);
 
   de265_mutex_lock(&pool->mutex);
   pool->num_threads_working = 0;
+  pool->next_queue = 0;
   pool->stopped = false;
   de265_mutex_unlock(&pool->mutex);
 
@@ -292,21 +477,83 @@ void stop_thread_pool(thread_pool* pool)
     de265_thread_destroy(&pool->thread[i]);
   }
 
+  // queues that are still attached lose their pending tasks
+
+  for (size_t i=0;i<pool->queues.size();i++) {
+    pool->queues[i]->tasks.clear();
+    pool->queues[i]->num_running_tasks = 0;
+    pool->queues[i]->pool = NULL;
+  }
+  pool->queues.clear();
+
   de265_mutex_destroy(&pool->mutex);
   de265_cond_destroy(&pool->cond_var);
+  de265_cond_destroy(&pool->cond_task_finished);
+}
+
+
+de265_error attach_task_queue(thread_pool* pool, thread_task_queue* queue, int max_running_tasks)
+{
+  if (queue->pool != NULL) {
+    return DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED;
+  }
+
+  de265_mutex_lock(&pool->mutex);
+
+  queue->pool = pool;
+  queue->max_running_tasks = max_running_tasks;
+  queue->num_running_tasks = 0;
+  pool->queues.push_back(queue);
+
+  de265_mutex_unlock(&pool->mutex);
+
+  return DE265_OK;
 }
 
 
-void   add_task(thread_pool* pool, thread_task* task)
+void detach_task_queue(thread_task_queue* queue)
 {
+  thread_pool* pool = queue->pool;
+  if (pool == NULL) {
+    return;
+  }
+
   de265_mutex_lock(&pool->mutex);
-  if (!pool->stopped) {
 
-    pool->tasks.push_back(task);
+  queue->tasks.clear();
+
+  while (queue->num_running_tasks > 0) {
+    de265_cond_wait(&pool->cond_task_finished, &pool->mutex);
+  }
+
+  for (size_t i=0;i<pool->queues.size();i++) {
+    if (pool->queues[i] == queue) {
+      pool->queues.erase(pool->queues.begin()+i);
+      break;
+    }
+  }
+
+  pool->next_queue = 0;
+  queue->pool = NULL;
+
+  de265_mutex_unlock(&pool->mutex);
+}
+
+
+void   add_task(thread_task_queue* queue, thread_task* task)
+{
+  thread_pool* pool = queue->pool;
+  assert(pool);
+
+  de265_mutex_lock(&pool->mutex);
+  if (!pool->stopped) {
+    queue->tasks.push_back(task);
 
     // wake up one thread
 
-    de265_cond_signal(&pool->cond_var);
+    if (queue->can_start_task()) {
+      de265_cond_signal(&pool->cond_var);
+    }
   }
   de265_mutex_unlock(&pool->mutex);
 }
@@ -32,6 +32,7 @@
 #endif
 
 #include <deque>
+#include <vector>
 #include <string>
 #include <atomic>
 
@@ -98,6 +99,53 @@ private:
 
 
 
+/* Decoding progress of all CTBs in a picture.
+
+   The progress of each CTB is a single atomic byte. A thread waiting for a CTB
+   first spins for a short while and then sleeps on the wait queue of that CTB's
+   row. Setting the progress only takes the row lock when a thread is sleeping on
+   that row.
+ */
+class de265_CTB_progress
+{
+public:
+  de265_CTB_progress();
+  ~de265_CTB_progress();
+
+  bool alloc(int widthInCtbs, int heightInCtbs); // false if out of memory
+  void release();
+
+  void reset(int value=0); // not thread-safe
+
+  void set_progress(int ctbAddrRS, int progress); // progress never decreases
+  int  get_progress(int ctbAddrRS) const {
+    return mProgress[ctbAddrRS].load(std::memory_order_acquire);
+  }
+
+  void wait_for_progress(int ctbAddrRS, int progress);
+
+  int size() const { return mWidthInCtbs * mHeightInCtbs; }
+
+private:
+  int mWidthInCtbs;
+  int mHeightInCtbs;
+
+  std::atomic<uint8_t>* mProgress;
+
+  struct row_wait_queue {
+    de265_mutex mutex;
+    de265_cond  cond;
+    std::atomic<int> numWaiters;
+  };
+
+  row_wait_queue* mRows;
+
+  de265_CTB_progress(const de265_CTB_progress&); // no copy
+  de265_CTB_progress& operator=(const de265_CTB_progress&);
+};
+
+
+
 class thread_task
 {
 public:
@@ -120,12 +168,39 @@ public:
    of the just unblocked task.
  */
 
+class thread_pool;
+
+/* The tasks of one client (decoder context) of a thread pool.
+   A thread pool can serve several task queues. The queues are served round-robin,
+   one task at a time, such that each client gets a fair share of the threads.
+   Tasks within a queue are started in FIFO order.
+ */
+class thread_task_queue
+{
+ public:
+  thread_task_queue() : pool(NULL), max_running_tasks(0), num_running_tasks(0) { }
+
+  thread_pool* pool;  // NULL if not attached
+
+  std::deque<thread_task*> tasks;  // we are not the owner
+
+  int max_running_tasks;  // 0 = no limit
+  int num_running_tasks;
+
+  bool can_start_task() const {
+    return !tasks.empty() &&
+      (max_running_tasks==0 || num_running_tasks < max_running_tasks);
+  }
+};
+
+
 class thread_pool
 {
  public:
   bool stopped;
 
-  std::deque<thread_task*> tasks;  // we are not the owner
+  std::vector<thread_task_queue*> queues;  // we are not the owner
+  int next_queue;  // round-robin position
 
   de265_thread thread[MAX_THREADS];
   int num_threads;
@@ -137,12 +212,22 @@ class thread_pool
 
   de265_mutex  mutex;
   de265_cond   cond_var;
+  de265_cond   cond_task_finished;
 };
 
 
 de265_error start_thread_pool(thread_pool* pool, int num_threads);
 void        stop_thread_pool(thread_pool* pool); // do not process remaining tasks
 
-void        add_task(thread_pool* pool, thread_task* task); // TOCO: can make thread_task const
+/* Attach a task queue to the pool. At most 'max_running_tasks' tasks of this queue
+   are processed concurrently (0 = no limit).
+   Returns DE265_ERROR_THREAD_POOL_ALREADY_ATTACHED if the queue is already attached. */
+de265_error attach_task_queue(thread_pool* pool, thread_task_queue* queue, int max_running_tasks);
+
+/* Remove the queue from its pool. Pending tasks are dropped and the function waits
+   until all running tasks of this queue have finished. */
+void        detach_task_queue(thread_task_queue* queue);
+
+void        add_task(thread_task_queue* queue, thread_task* task); // TOCO: can make thread_task const
 
 #endif
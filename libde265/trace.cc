@@ -0,0 +1,187 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "trace.h"
+
+#include <stdio.h>
+
+
+task_trace::task_trace()
+{
+  mStart = std::chrono::steady_clock::now();
+  mDroppedEvents = 0;
+  de265_mutex_init(&mMutex);
+}
+
+
+task_trace::~task_trace()
+{
+  de265_mutex_destroy(&mMutex);
+}
+
+
+void task_trace::add_event(char phase, const std::string& name, const char* category, int id)
+{
+  int64_t timestamp = std::chrono::duration_cast<std::chrono::microseconds>
+    (std::chrono::steady_clock::now() - mStart).count();
+
+  de265_mutex_lock(&mMutex);
+
+  // number the threads in the order in which they appear
+
+  std::thread::id threadID = std::this_thread::get_id();
+  std::map<std::thread::id, int>::const_iterator iter = mThreadIDs.find(threadID);
+
+  int tid;
+  if (iter == mThreadIDs.end()) {
+    tid = mThreadIDs.size();
+    mThreadIDs[threadID] = tid;
+
+    open_durations open = { 0,0 };
+    mOpenDurations.push_back(open);
+  }
+  else {
+    tid = iter->second;
+  }
+
+  // When the buffer is full, begin events are dropped, but end events that close
+  // a recorded begin event are still recorded. Duration events nest within a thread.
+
+  const bool full = (mEvents.size() >= max_events);
+  open_durations& open = mOpenDurations[tid];
+
+  bool keep;
+  switch (phase) {
+  case 'B':
+    keep = !full;
+    if (keep) { open.recorded++; }
+    else      { open.dropped++;  }
+    break;
+
+  case 'E':
+    if (open.dropped > 0) {
+      open.dropped--;
+      keep = false;
+    }
+    else if (open.recorded > 0) {
+      open.recorded--;
+      keep = true;
+    }
+    else {
+      keep = !full;
+    }
+    break;
+
+  case 'b':
+    keep = !full;
+    if (keep) { mOpenAsync.insert(std::make_pair(name,id)); }
+    break;
+
+  default: // 'e'
+    keep = (mOpenAsync.erase(std::make_pair(name,id)) > 0 || !full);
+    break;
+  }
+
+  if (!keep) {
+    mDroppedEvents++;
+    de265_mutex_unlock(&mMutex);
+    return;
+  }
+
+  event e;
+  e.phase = phase;
+  e.category = category;
+  e.name = name;
+  e.timestamp = timestamp;
+  e.tid = tid;
+  e.id = id;
+
+  mEvents.push_back(e);
+
+  de265_mutex_unlock(&mMutex);
+}
+
+
+void task_trace::begin(const std::string& name, const char* category)
+{
+  add_event('B', name, category, 0);
+}
+
+
+void task_trace::end(const std::string& name, const char* category)
+{
+  add_event('E', name, category, 0);
+}
+
+
+void task_trace::async_begin(const std::string& name, const char* category, int id)
+{
+  add_event('b', name, category, id);
+}
+
+
+void task_trace::async_end(const std::string& name, const char* category, int id)
+{
+  add_event('e', name, category, id);
+}
+
+
+bool task_trace::write(const char* filename) const
+{
+  FILE* fh = fopen(filename, "wb");
+  if (fh==NULL) {
+    return false;
+  }
+
+  de265_mutex_lock(&mMutex);
+
+  fprintf(fh,"{\"traceEvents\":[\n");
+
+  // thread names
+
+  for (std::map<std::thread::id, int>::const_iterator iter = mThreadIDs.begin();
+       iter != mThreadIDs.end(); ++iter) {
+    fprintf(fh,"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+            "\"args\":{\"name\":\"thread %d\"}},\n", iter->second, iter->second);
+  }
+
+  for (size_t i=0;i<mEvents.size();i++) {
+    const event& e = mEvents[i];
+
+    // the names are generated internally and do not need JSON escaping
+
+    fprintf(fh,"{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,\"pid\":1,\"tid\":%d",
+            e.name.c_str(), e.category, e.phase, (long long)e.timestamp, e.tid);
+
+    if (e.phase=='b' || e.phase=='e') {
+      fprintf(fh,",\"id\":%d", e.id);
+    }
+
+    fprintf(fh,"}%s\n", i+1<mEvents.size() ? "," : "");
+  }
+
+  fprintf(fh,"],\n\"otherData\":{\"dropped_events\":%lld}}\n", (long long)mDroppedEvents);
+
+  de265_mutex_unlock(&mMutex);
+
+  fclose(fh);
+  return true;
+}
@@ -0,0 +1,115 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DE265_TRACE_H
+#define DE265_TRACE_H
+
+#include "libde265/de265.h"
+#include "libde265/threads.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <chrono>
+
+
+/* Timeline of the decoder in the Chrome trace_event format
+   (viewable with chrome://tracing or Perfetto).
+
+   The events are collected in memory and written as JSON at the end.
+   Duration events (begin/end) are recorded per thread, the decoding of
+   each picture is an async event from its first slice until its output.
+   At most 'max_events' are kept, later events are dropped and only counted,
+   such that tracing a long stream does not use up all memory. Only begin
+   events are dropped; the end events of recorded begin events are always
+   recorded, such that every recorded duration is closed.
+ */
+class task_trace
+{
+ public:
+  task_trace();
+  ~task_trace();
+
+  void begin(const std::string& name, const char* category);
+  void end(const std::string& name, const char* category);
+
+  // async events, spanning several threads
+  void async_begin(const std::string& name, const char* category, int id);
+  void async_end(const std::string& name, const char* category, int id);
+
+  bool write(const char* filename) const;
+
+  static const size_t max_events = 1000000;
+
+ private:
+  struct event {
+    char        phase;  // 'B', 'E', 'b', 'e'
+    const char* category;
+    std::string name;
+    int64_t     timestamp; // microseconds since the start of the trace
+    int         tid;
+    int         id;
+  };
+
+  std::vector<event> mEvents;
+  size_t mDroppedEvents;
+  std::map<std::thread::id, int> mThreadIDs;
+
+  // begin events without an end event yet
+
+  struct open_durations {
+    int recorded; // recorded 'B' events (the outermost ones, since the buffer never shrinks)
+    int dropped;  // dropped 'B' events, nested inside the recorded ones
+  };
+
+  std::vector<open_durations> mOpenDurations; // indexed by tid
+  std::set<std::pair<std::string,int> > mOpenAsync; // recorded 'b' events (name, id)
+
+  std::chrono::steady_clock::time_point mStart;
+
+  mutable de265_mutex mMutex;
+
+  void add_event(char phase, const std::string& name, const char* category, int id);
+};
+
+
+/* Scoped duration event. 'trace' may be NULL.
+   The name is a constant string, no std::string is built when tracing is off. */
+class task_trace_scope
+{
+ public:
+  task_trace_scope(task_trace* trace, const char* name, const char* category)
+    : mTrace(trace), mName(name), mCategory(category)
+  {
+    if (mTrace) { mTrace->begin(mName, mCategory); }
+  }
+
+  ~task_trace_scope() { if (mTrace) { mTrace->end(mName, mCategory); } }
+
+ private:
+  task_trace* mTrace;
+  const char* mName;
+  const char* mCategory;
+};
+
+#endif
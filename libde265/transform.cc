@@ -214,7 +214,8 @@ void decode_quantization_parameters(thread_context* tctx, int xC,int yC,
 template <class pixel_t>
 void transform_coefficients(acceleration_functions* acceleration,
                             int16_t* coeff, int coeffStride, int nT, int trType,
-                            pixel_t* dst, int dstStride, int bit_depth)
+                            pixel_t* dst, int dstStride, int bit_depth,
+                            int nzW, int nzH) // non-zero coefficients within top-left nzW x nzH
 {
   logtrace(LogTransform,"transform --- trType: %d nT: %d\n",trType,nT);
 
@@ -223,6 +224,16 @@ void transform_coefficients(acceleration_functions* acceleration,
 
     acceleration->transform_4x4_dst_add<pixel_t>(dst, coeff, dstStride, bit_depth);
 
+  } else if (nzW==1 && nzH==1) {
+
+    acceleration->transform_dc_add<pixel_t>(dst, coeff, nT, dstStride, bit_depth);
+
+  } else if (nT>=16 && nzW<=nT/4 && nzH<=nT/4) {
+
+    // only low-frequency coefficients (typical for larger TBs)
+
+    acceleration->transform_add_partial<pixel_t>(Log2(nT)-2, dst,coeff,dstStride, bit_depth, nzW,nzH);
+
   } else {
 
     /**/ if (nT==4)  { acceleration->transform_add<pixel_t>(0,dst,coeff,dstStride, bit_depth); }
@@ -264,7 +275,8 @@ void cross_comp_pred(const thread_context* tctx, int32_t* residual, int nT)
 template <class pixel_t>
 void transform_coefficients_explicit(thread_context* tctx,
                                      int16_t* coeff, int coeffStride, int nT, int trType,
-                                     pixel_t* dst, int dstStride, int bit_depth, int cIdx)
+                                     pixel_t* dst, int dstStride, int bit_depth, int cIdx,
+                                     int nzW, int nzH)
 {
   logtrace(LogTransform,"transform --- trType: %d nT: %d\n",trType,nT);
 
@@ -288,6 +300,10 @@ void transform_coefficients_explicit(thread_context* tctx,
 
     acceleration->transform_idst_4x4(residual, coeff, bdShift, max_coeff_bits);
 
+  } else if (nzW<nT || nzH<nT) {
+
+    acceleration->transform_idct_partial[Log2(nT)-2](residual,coeff,bdShift,max_coeff_bits, nzW,nzH);
+
   } else {
 
     /**/ if (nT==4)  { acceleration->transform_idct_4x4(residual,coeff,bdShift,max_coeff_bits); }
@@ -459,35 +475,9 @@ void scale_coefficients_internal(thread_context* tctx,
 
     // --- inverse quantization ---
 
-    if (sps.scaling_list_enable_flag==0) {
-
-      //const int m_x_y = 16;
-      const int m_x_y = 1;
-      bdShift -= 4;  // this is equivalent to having a m_x_y of 16 and we can use 32bit integers
-
-      const int offset = (1<<(bdShift-1));
-      const int fact = m_x_y * levelScale[qP%6] << (qP/6);
-
-      for (int i=0;i<tctx->nCoeff[cIdx];i++) {
-
-        // usually, this needs to be 64bit, but because we modify the shift above, we can use 16 bit
-        int32_t currCoeff  = tctx->coeffList[cIdx][i];
-
-        //logtrace(LogTransform,"coefficient[%d] = %d\n",tctx->coeffPos[cIdx][i],
-        //tctx->coeffList[cIdx][i]);
-
-        currCoeff = Clip3(-32768,32767,
-                          ( (currCoeff * fact + offset ) >> bdShift));
+    const uint8_t* sclist = NULL; // flat scaling (m_x_y = 16)
 
-        //logtrace(LogTransform," -> %d\n",currCoeff);
-
-        tctx->coeffBuf[ tctx->coeffPos[cIdx][i] ] = currCoeff;
-      }
-    }
-    else {
-      const int offset = (1<<(bdShift-1));
-
-      const uint8_t* sclist;
+    if (sps.scaling_list_enable_flag) {
       int matrixID = cIdx;
       if (!intra) {
         if (nT<32) { matrixID += 3; }
@@ -501,22 +491,27 @@ void scale_coefficients_internal(thread_context* tctx,
       case 32: sclist = &pps.scaling_list.ScalingFactor_Size3[matrixID][0][0]; break;
       default: assert(0);
       }
+    }
 
-      for (int i=0;i<tctx->nCoeff[cIdx];i++) {
-        int pos = tctx->coeffPos[cIdx][i];
-        int x = pos%nT;
-        int y = pos/nT;
-
-        const int m_x_y = sclist[x+y*nT];
-        const int fact = m_x_y * levelScale[qP%6] << (qP/6);
-
-        int64_t currCoeff  = tctx->coeffList[cIdx][i];
+    const int nCoeff = tctx->nCoeff[cIdx];
 
-        currCoeff = Clip3(-32768,32767,
-                          ( (currCoeff * fact + offset ) >> bdShift));
+    if (sclist && 4*nCoeff >= 3*nT*nT) {
+      // Dense block with scaling list: place the coefficients first and dequantize
+      // the whole block in one sweep, reading the scaling list linearly instead of
+      // gathering the factors for each coefficient. Without scaling list, the
+      // coefficient list is always faster.
 
-        tctx->coeffBuf[ tctx->coeffPos[cIdx][i] ] = currCoeff;
+      for (int i=0;i<nCoeff;i++) {
+        coeff[ tctx->coeffPos[cIdx][i] ] = tctx->coeffList[cIdx][i];
       }
+
+      tctx->decctx->acceleration.dequant_block(coeff, nT*nT, sclist,
+                                               levelScale[qP%6], qP/6, bdShift);
+    }
+    else {
+      tctx->decctx->acceleration.dequant_coefficients(coeff, tctx->coeffList[cIdx],
+                                                      tctx->coeffPos[cIdx], nCoeff, sclist,
+                                                      levelScale[qP%6], qP/6, bdShift);
     }
 
 
@@ -605,11 +600,13 @@ void scale_coefficients_internal(thread_context* tctx,
         // cross-component-prediction: transform to residual buffer and add in a separate step
 
         transform_coefficients_explicit(tctx, coeff, coeffStride, nT, trType,
-                                        pred, stride, bit_depth, cIdx);
+                                        pred, stride, bit_depth, cIdx,
+                                        tctx->coeffBoxW[cIdx], tctx->coeffBoxH[cIdx]);
       }
       else {
         transform_coefficients(&tctx->decctx->acceleration, coeff, coeffStride, nT, trType,
-                               pred, stride, bit_depth);
+                               pred, stride, bit_depth,
+                               tctx->coeffBoxW[cIdx], tctx->coeffBoxH[cIdx]);
       }
     }
   }
@@ -643,6 +640,8 @@ void scale_coefficients(thread_context* tctx,
                         int rdpcmMode // 0 - off, 1 - Horizontal, 2 - Vertical
                         )
 {
+  STATISTICS_TIMER(tctx->decctx, StageResidual);
+
   if (tctx->img->high_bit_depth(cIdx)) {
     scale_coefficients_internal<uint16_t>(tctx, xT,yT, x0,y0, nT,cIdx, transform_skip_flag, intra,
                                           rdpcmMode);
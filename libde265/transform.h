@@ -33,6 +33,14 @@ LIBDE265_INLINE static int table8_22(int qPi)
   return tab8_22[qPi-30];
 }
 
+// chroma QP for a luma QP when no chroma QP offsets are used (8.6.1)
+LIBDE265_INLINE static int chroma_qp_from_luma_qp(int QPY, int ChromaArrayType)
+{
+  int qPi = Clip3(0,57, QPY);
+  if (ChromaArrayType == CHROMA_420) return table8_22(qPi);
+  return qPi;
+}
+
 // (8.6.1)
 void decode_quantization_parameters(thread_context* tctx, int xC,int yC,
                                     int xCUBase, int yCUBase);
@@ -42,10 +42,12 @@
 #define LIBDE265_DECLARE_ALIGNED( var, n ) __declspec(align(n)) var
 #define likely(x)      (x)
 #define unlikely(x)    (x)
+#define prefetch_for_read(addr) ((void)(addr))
 #else
 #define LIBDE265_DECLARE_ALIGNED( var, n ) var __attribute__((aligned(n)))
 #define likely(x)      __builtin_expect(!!(x), 1)
 #define unlikely(x)    __builtin_expect(!!(x), 0)
+#define prefetch_for_read(addr) __builtin_prefetch((addr), 0, 3)
 #endif
 
 #if defined(__GNUC__) && (__GNUC__ >= 4)
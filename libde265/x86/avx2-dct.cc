@@ -0,0 +1,545 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "x86/avx2-dct.h"
+#include "libde265/fallback-dct.h"
+#include "libde265/util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <immintrin.h>
+
+
+/* Both passes of the 2D transforms work on 8 columns in parallel (one int32 lane
+   per column). Two input rows are interleaved such that _mm256_madd_epi16
+   multiplies-and-adds two basis functions at once. The intermediate result of
+   the vertical pass is stored transposed, so the horizontal pass can use the
+   same code.
+
+   The 1D inverse DCT uses the even/odd decomposition: the odd basis functions
+   are (anti-)symmetric, and the even basis functions form the DCT of half the
+   size.
+ */
+
+#define PAIR(a,b) ((int32_t)(((uint32_t)(uint16_t)(int16_t)(b) << 16) | (uint16_t)(int16_t)(a)))
+
+
+template <int N> struct log2_of { enum { value = 1 + log2_of<N/2>::value }; };
+template <> struct log2_of<1> { enum { value = 0 }; };
+
+
+struct dct_pair_tables
+{
+  // [log2 N][p][i] : basis functions 4p+1 and 4p+3 of the N-point DCT at position i
+  int32_t odd[6][8][16];
+
+  dct_pair_tables()
+  {
+    for (int log2N=2; log2N<=5; log2N++) {
+      int N = 1<<log2N;
+      int fact = 32/N;
+
+      for (int p=0;p<N/4;p++)
+        for (int i=0;i<N/2;i++) {
+          odd[log2N][p][i] = PAIR(mat_dct[(4*p+1)*fact][i], mat_dct[(4*p+3)*fact][i]);
+        }
+    }
+  }
+};
+
+static const dct_pair_tables dct_pairs;
+
+
+static const int32_t dst_pairs[2][4] = {
+  { PAIR(29,74), PAIR(55,74), PAIR(74,  0), PAIR(84,-74) },
+  { PAIR(84,55), PAIR(-29,-84), PAIR(-74,74), PAIR(55,-29) }
+};
+
+
+static inline __m256i interleave_epi16(__m128i a, __m128i b)
+{
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(a,b)),
+                                 _mm_unpackhi_epi16(a,b), 1);
+}
+
+static inline __m128i packs_epi32(__m256i v)
+{
+  return _mm_packs_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v,1));
+}
+
+static inline void transpose_8x8_epi32(__m256i* r)
+{
+  __m256i t0 = _mm256_unpacklo_epi32(r[0],r[1]);
+  __m256i t1 = _mm256_unpackhi_epi32(r[0],r[1]);
+  __m256i t2 = _mm256_unpacklo_epi32(r[2],r[3]);
+  __m256i t3 = _mm256_unpackhi_epi32(r[2],r[3]);
+  __m256i t4 = _mm256_unpacklo_epi32(r[4],r[5]);
+  __m256i t5 = _mm256_unpackhi_epi32(r[4],r[5]);
+  __m256i t6 = _mm256_unpacklo_epi32(r[6],r[7]);
+  __m256i t7 = _mm256_unpackhi_epi32(r[6],r[7]);
+
+  __m256i u0 = _mm256_unpacklo_epi64(t0,t2);
+  __m256i u1 = _mm256_unpackhi_epi64(t0,t2);
+  __m256i u2 = _mm256_unpacklo_epi64(t1,t3);
+  __m256i u3 = _mm256_unpackhi_epi64(t1,t3);
+  __m256i u4 = _mm256_unpacklo_epi64(t4,t6);
+  __m256i u5 = _mm256_unpackhi_epi64(t4,t6);
+  __m256i u6 = _mm256_unpacklo_epi64(t5,t7);
+  __m256i u7 = _mm256_unpackhi_epi64(t5,t7);
+
+  r[0] = _mm256_permute2x128_si256(u0,u4,0x20);
+  r[1] = _mm256_permute2x128_si256(u1,u5,0x20);
+  r[2] = _mm256_permute2x128_si256(u2,u6,0x20);
+  r[3] = _mm256_permute2x128_si256(u3,u7,0x20);
+  r[4] = _mm256_permute2x128_si256(u0,u4,0x31);
+  r[5] = _mm256_permute2x128_si256(u1,u5,0x31);
+  r[6] = _mm256_permute2x128_si256(u2,u6,0x31);
+  r[7] = _mm256_permute2x128_si256(u3,u7,0x31);
+}
+
+
+// --- 1D transforms, input rows[j*step] (int16), output out[i] (int32) ---
+
+template <int N>
+static inline void idct_1d(const __m128i* rows, int step, __m256i* out)
+{
+  __m256i E[N/2];
+  idct_1d<N/2>(rows, 2*step, E);
+
+  const int32_t (*tab)[16] = dct_pairs.odd[log2_of<N>::value];
+
+  __m256i O[N/2];
+  for (int i=0;i<N/2;i++) { O[i] = _mm256_setzero_si256(); }
+
+  for (int p=0;p<N/4;p++) {
+    __m256i pr = interleave_epi16(rows[(4*p+1)*step], rows[(4*p+3)*step]);
+
+    for (int i=0;i<N/2;i++) {
+      O[i] = _mm256_add_epi32(O[i], _mm256_madd_epi16(pr, _mm256_set1_epi32(tab[p][i])));
+    }
+  }
+
+  for (int i=0;i<N/2;i++) {
+    out[i]     = _mm256_add_epi32(E[i],O[i]);
+    out[N-1-i] = _mm256_sub_epi32(E[i],O[i]);
+  }
+}
+
+template <>
+inline void idct_1d<2>(const __m128i* rows, int step, __m256i* out)
+{
+  __m256i pr = interleave_epi16(rows[0], rows[step]);
+
+  out[0] = _mm256_madd_epi16(pr, _mm256_set1_epi32(PAIR(64, 64)));
+  out[1] = _mm256_madd_epi16(pr, _mm256_set1_epi32(PAIR(64,-64)));
+}
+
+
+static inline void idst_1d(const __m128i* rows, __m256i* out)
+{
+  __m256i p01 = interleave_epi16(rows[0], rows[1]);
+  __m256i p23 = interleave_epi16(rows[2], rows[3]);
+
+  for (int i=0;i<4;i++) {
+    out[i] = _mm256_add_epi32(_mm256_madd_epi16(p01, _mm256_set1_epi32(dst_pairs[0][i])),
+                              _mm256_madd_epi16(p23, _mm256_set1_epi32(dst_pairs[1][i])));
+  }
+}
+
+
+// --- output of the residual rows ---
+
+struct residual_sink
+{
+  int32_t* dst;
+  int nT;
+
+  template <int W> void put(int y,int x0, __m256i r) {
+    if (W==4) _mm_storeu_si128((__m128i*)(dst + y*nT + x0), _mm256_castsi256_si128(r));
+    else      _mm256_storeu_si256((__m256i*)(dst + y*nT + x0), r);
+  }
+};
+
+struct add_8_sink
+{
+  uint8_t* dst;
+  ptrdiff_t stride;
+
+  template <int W> void put(int y,int x0, __m256i r) {
+    uint8_t* p = dst + y*stride + x0;
+
+    if (W==4) {
+      __m128i pix = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int32_t*)p));
+      pix = _mm_add_epi32(pix, _mm256_castsi256_si128(r));
+      pix = _mm_packs_epi32(pix,pix);
+      *(int32_t*)p = _mm_cvtsi128_si32(_mm_packus_epi16(pix,pix));
+    }
+    else {
+      __m256i pix = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)p));
+      __m128i v = packs_epi32(_mm256_add_epi32(pix, r));
+      _mm_storel_epi64((__m128i*)p, _mm_packus_epi16(v,v));
+    }
+  }
+};
+
+struct add_16_sink
+{
+  uint16_t* dst;
+  ptrdiff_t stride;
+  __m256i maxval;
+
+  add_16_sink(uint16_t* d, ptrdiff_t s, int bit_depth)
+    : dst(d), stride(s), maxval(_mm256_set1_epi32((1<<bit_depth)-1)) { }
+
+  template <int W> void put(int y,int x0, __m256i r) {
+    uint16_t* p = dst + y*stride + x0;
+
+    if (W==4) {
+      __m128i pix = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)p));
+      pix = _mm_add_epi32(pix, _mm256_castsi256_si128(r));
+      pix = _mm_min_epi32(_mm_max_epi32(pix, _mm_setzero_si128()), _mm256_castsi256_si128(maxval));
+      _mm_storel_epi64((__m128i*)p, _mm_packus_epi32(pix,pix));
+    }
+    else {
+      __m256i pix = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p));
+      pix = _mm256_add_epi32(pix, r);
+      pix = _mm256_min_epi32(_mm256_max_epi32(pix, _mm256_setzero_si256()), maxval);
+      _mm_storeu_si128((__m128i*)p, _mm_packus_epi32(_mm256_castsi256_si128(pix),
+                                                     _mm256_extracti128_si256(pix,1)));
+    }
+  }
+};
+
+
+// --- 2D transform ---
+
+template <int N, bool DST, class Sink>
+static inline void transform_2d(const int16_t* coeffs, int bdShift, int max_coeff_bits, Sink& sink)
+{
+  const int W = (N<8 ? N : 8);   // valid lanes per vector
+  const int S = (N<8 ? 8 : N);   // row stride of the transposed intermediate
+
+  ALIGNED_32(int16_t) gt[S*N];
+
+  const __m256i coeffMin = _mm256_set1_epi32(-(1<<max_coeff_bits));
+  const __m256i coeffMax = _mm256_set1_epi32((1<<max_coeff_bits)-1);
+  const __m256i rnd1 = _mm256_set1_epi32(1<<6);
+  const __m256i rnd2 = _mm256_set1_epi32(1<<(bdShift-1));
+  const __m128i shift2 = _mm_cvtsi32_si128(bdShift);
+
+  __m128i rows[N];
+  __m256i out[N];
+  __m256i t[8];
+
+
+  // --- V ---
+
+  for (int c0=0;c0<N;c0+=8) {
+    for (int j=0;j<N;j++) {
+      rows[j] = (N<8 ? _mm_loadl_epi64((const __m128i*)(coeffs + j*N)) :
+                       _mm_loadu_si128((const __m128i*)(coeffs + j*N + c0)));
+    }
+
+    if (DST) idst_1d(rows, out);
+    else     idct_1d<N>(rows, 1, out);
+
+    for (int i0=0;i0<N;i0+=8) {
+      for (int k=0;k<8;k++) {
+        if (k<W) {
+          __m256i v = _mm256_srai_epi32(_mm256_add_epi32(out[i0+k], rnd1), 7);
+          t[k] = _mm256_min_epi32(_mm256_max_epi32(v, coeffMin), coeffMax);
+        }
+        else {
+          t[k] = _mm256_setzero_si256();
+        }
+      }
+
+      transpose_8x8_epi32(t);
+
+      for (int k=0;k<W;k++) {
+        _mm_store_si128((__m128i*)&gt[(c0+k)*S + i0], packs_epi32(t[k]));
+      }
+    }
+  }
+
+
+  // --- H ---
+
+  for (int y0=0;y0<N;y0+=8) {
+    for (int j=0;j<N;j++) {
+      rows[j] = _mm_load_si128((const __m128i*)&gt[j*S + y0]);
+    }
+
+    if (DST) idst_1d(rows, out);
+    else     idct_1d<N>(rows, 1, out);
+
+    for (int x0=0;x0<N;x0+=8) {
+      for (int k=0;k<8;k++) {
+        t[k] = (k<W ? _mm256_sra_epi32(_mm256_add_epi32(out[x0+k], rnd2), shift2) :
+                      _mm256_setzero_si256());
+      }
+
+      transpose_8x8_epi32(t);
+
+      for (int k=0;k<W;k++) {
+        sink.template put<W>(y0+k, x0, t[k]);
+      }
+    }
+  }
+}
+
+
+// --- add to prediction, 8 bit ---
+
+void transform_4x4_luma_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  add_8_sink sink = { dst, stride };
+  transform_2d<4,true>(coeffs, 12, 15, sink);
+}
+
+void transform_4x4_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  add_8_sink sink = { dst, stride };
+  transform_2d<4,false>(coeffs, 12, 15, sink);
+}
+
+void transform_8x8_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  add_8_sink sink = { dst, stride };
+  transform_2d<8,false>(coeffs, 12, 15, sink);
+}
+
+void transform_16x16_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  add_8_sink sink = { dst, stride };
+  transform_2d<16,false>(coeffs, 12, 15, sink);
+}
+
+void transform_32x32_add_8_avx2(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride)
+{
+  add_8_sink sink = { dst, stride };
+  transform_2d<32,false>(coeffs, 12, 15, sink);
+}
+
+
+// --- add to prediction, 9-16 bit ---
+
+void transform_4x4_luma_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  add_16_sink sink(dst, stride, bit_depth);
+  transform_2d<4,true>(coeffs, 20-bit_depth, 15, sink);
+}
+
+void transform_4x4_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  add_16_sink sink(dst, stride, bit_depth);
+  transform_2d<4,false>(coeffs, 20-bit_depth, 15, sink);
+}
+
+void transform_8x8_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  add_16_sink sink(dst, stride, bit_depth);
+  transform_2d<8,false>(coeffs, 20-bit_depth, 15, sink);
+}
+
+void transform_16x16_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  add_16_sink sink(dst, stride, bit_depth);
+  transform_2d<16,false>(coeffs, 20-bit_depth, 15, sink);
+}
+
+void transform_32x32_add_16_avx2(uint16_t *dst, const int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+  add_16_sink sink(dst, stride, bit_depth);
+  transform_2d<32,false>(coeffs, 20-bit_depth, 15, sink);
+}
+
+
+// --- residual output ---
+
+void transform_idst_4x4_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  residual_sink sink = { dst, 4 };
+  transform_2d<4,true>(coeffs, bdShift, max_coeff_bits, sink);
+}
+
+void transform_idct_4x4_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  residual_sink sink = { dst, 4 };
+  transform_2d<4,false>(coeffs, bdShift, max_coeff_bits, sink);
+}
+
+void transform_idct_8x8_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  residual_sink sink = { dst, 8 };
+  transform_2d<8,false>(coeffs, bdShift, max_coeff_bits, sink);
+}
+
+void transform_idct_16x16_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  residual_sink sink = { dst, 16 };
+  transform_2d<16,false>(coeffs, bdShift, max_coeff_bits, sink);
+}
+
+void transform_idct_32x32_avx2(int32_t *dst, const int16_t *coeffs, int bdShift, int max_coeff_bits)
+{
+  residual_sink sink = { dst, 32 };
+  transform_2d<32,false>(coeffs, bdShift, max_coeff_bits, sink);
+}
+
+
+void transform_bypass_avx2(int32_t *residual, const int16_t *coeffs, int nT)
+{
+  for (int i=0;i<nT*nT;i+=8) {
+    __m128i c = _mm_loadu_si128((const __m128i*)(coeffs+i));
+    _mm256_storeu_si256((__m256i*)(residual+i), _mm256_cvtepi16_epi32(c));
+  }
+}
+
+
+void add_residual_8_avx2(uint8_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  add_8_sink sink = { dst, stride };
+
+  if (nT==4) {
+    for (int y=0;y<4;y++) {
+      sink.put<4>(y,0, _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(r+y*4))));
+    }
+  }
+  else {
+    for (int y=0;y<nT;y++)
+      for (int x=0;x<nT;x+=8) {
+        sink.put<8>(y,x, _mm256_loadu_si256((const __m256i*)(r+y*nT+x)));
+      }
+  }
+}
+
+
+void add_residual_16_avx2(uint16_t *dst, ptrdiff_t stride, const int32_t* r, int nT, int bit_depth)
+{
+  add_16_sink sink(dst, stride, bit_depth);
+
+  if (nT==4) {
+    for (int y=0;y<4;y++) {
+      sink.put<4>(y,0, _mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(r+y*4))));
+    }
+  }
+  else {
+    for (int y=0;y<nT;y++)
+      for (int x=0;x<nT;x+=8) {
+        sink.put<8>(y,x, _mm256_loadu_si256((const __m256i*)(r+y*nT+x)));
+      }
+  }
+}
+
+
+// --- dequantization, see dequant_sse4 for the computation ---
+
+struct dequant_avx2
+{
+  bool    right;
+  __m256i rnd;
+  __m128i shift;
+
+  dequant_avx2(int qPper, int bdShift) {
+    right = (qPper < bdShift);
+    int s = (right ? bdShift-qPper : qPper-bdShift);
+    rnd   = _mm256_set1_epi32(right ? 1<<(s-1) : 0);
+    shift = _mm_cvtsi32_si128(s);
+  }
+
+  __m256i operator()(__m256i coeff, __m256i fact) const {
+    __m256i x = _mm256_mullo_epi32(coeff, fact);
+
+    if (right) {
+      return _mm256_sra_epi32(_mm256_add_epi32(x, rnd), shift);
+    }
+    else {
+      x = _mm256_min_epi32(_mm256_max_epi32(x, _mm256_set1_epi32(-65536)), _mm256_set1_epi32(65535));
+      return _mm256_sll_epi32(x, shift);
+    }
+  }
+};
+
+
+void dequant_coefficients_avx2(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                               int nCoeff, const uint8_t* sclist,
+                               int levelScale, int qPper, int bdShift)
+{
+  const dequant_avx2 dequant(qPper, bdShift);
+  const __m256i flat = _mm256_set1_epi32(16*levelScale);
+  const __m256i scale = _mm256_set1_epi32(levelScale);
+
+  ALIGNED_16(int16_t) out[8];
+
+  int i;
+  for (i=0; i+8<=nCoeff; i+=8) {
+    const int16_t* pos = coeffPos+i;
+
+    __m256i c = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(coeffList+i)));
+
+    __m256i fact = flat;
+    if (sclist) {
+      fact = _mm256_mullo_epi32(scale, _mm256_setr_epi32(sclist[pos[0]],sclist[pos[1]],
+                                                         sclist[pos[2]],sclist[pos[3]],
+                                                         sclist[pos[4]],sclist[pos[5]],
+                                                         sclist[pos[6]],sclist[pos[7]]));
+    }
+
+    _mm_store_si128((__m128i*)out, packs_epi32(dequant(c,fact)));
+
+    for (int k=0;k<8;k++) {
+      coeffBuf[pos[k]] = out[k];
+    }
+  }
+
+  dequant_coefficients_fallback(coeffBuf, coeffList+i, coeffPos+i, nCoeff-i, sclist,
+                                levelScale, qPper, bdShift);
+}
+
+
+void dequant_block_avx2(int16_t* coeffs, int n, const uint8_t* sclist,
+                        int levelScale, int qPper, int bdShift)
+{
+  const dequant_avx2 dequant(qPper, bdShift);
+  const __m256i flat = _mm256_set1_epi32(16*levelScale);
+  const __m256i scale = _mm256_set1_epi32(levelScale);
+
+  // n is a multiple of 16
+
+  for (int i=0;i<n;i+=16) {
+    __m256i c = _mm256_loadu_si256((const __m256i*)(coeffs+i));
+    __m256i lo = _mm256_cvtepi16_epi32(_mm256_castsi256_si128(c));
+    __m256i hi = _mm256_cvtepi16_epi32(_mm256_extracti128_si256(c,1));
+
+    __m256i fact_lo = flat, fact_hi = flat;
+    if (sclist) {
+      __m128i m = _mm_loadu_si128((const __m128i*)(sclist+i));
+      fact_lo = _mm256_mullo_epi32(scale, _mm256_cvtepu8_epi32(m));
+      fact_hi = _mm256_mullo_epi32(scale, _mm256_cvtepu8_epi32(_mm_srli_si128(m,8)));
+    }
+
+    // packs works within the 128 bit lanes, restore the order afterwards
+    __m256i r = _mm256_packs_epi32(dequant(lo,fact_lo), dequant(hi,fact_hi));
+    _mm256_storeu_si256((__m256i*)(coeffs+i), _mm256_permute4x64_epi64(r, 0xD8));
+  }
+}
@@ -0,0 +1,278 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "x86/avx2-distortion.h"
+#include "x86/sse-distortion.h"
+#include "libde265/util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <immintrin.h>
+
+
+static inline uint64_t hsum_epi64(__m256i v)
+{
+  __m128i s = _mm_add_epi64(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v,1));
+
+  uint64_t sum;
+  _mm_storel_epi64((__m128i*)&sum, _mm_add_epi64(s, _mm_unpackhi_epi64(s,s)));
+  return sum;
+}
+
+static inline uint32_t hsum_epi32(__m256i v)
+{
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v,1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2)));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2,3,0,1)));
+  return _mm_cvtsi128_si32(s);
+}
+
+
+uint32_t sad_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                    const uint8_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  if (width < 32) {
+    return sad_8_sse4(img,imgStride,ref,refStride,width,height);
+  }
+
+  __m256i sum = _mm256_setzero_si256();
+  int w32 = width & ~31;
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<w32;x+=32) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(img+x));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(ref+x));
+      sum = _mm256_add_epi64(sum, _mm256_sad_epu8(a,b));
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  uint32_t result = (uint32_t)hsum_epi64(sum);
+
+  if (w32 < width) {
+    result += sad_8_sse4(img - height*imgStride + w32, imgStride,
+                         ref - height*refStride + w32, refStride,
+                         width-w32, height);
+  }
+
+  return result;
+}
+
+
+uint64_t ssd_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                    const uint8_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  if (width < 16) {
+    return ssd_8_sse4(img,imgStride,ref,refStride,width,height);
+  }
+
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sum = _mm256_setzero_si256();
+  int w16 = width & ~15;
+
+  for (int y=0;y<height;y++) {
+    // a line sum of up to 2^15 pixels cannot overflow 32 bit
+    __m256i lineSum = _mm256_setzero_si256();
+
+    for (int x=0;x<w16;x+=16) {
+      __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(img+x)));
+      __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(ref+x)));
+      __m256i d = _mm256_sub_epi16(a,b);
+      lineSum = _mm256_add_epi32(lineSum, _mm256_madd_epi16(d,d));
+    }
+
+    sum = _mm256_add_epi64(sum, _mm256_unpacklo_epi32(lineSum,zero));
+    sum = _mm256_add_epi64(sum, _mm256_unpackhi_epi32(lineSum,zero));
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  uint64_t result = hsum_epi64(sum);
+
+  if (w16 < width) {
+    result += ssd_8_sse4(img - height*imgStride + w16, imgStride,
+                         ref - height*refStride + w16, refStride,
+                         width-w16, height);
+  }
+
+  return result;
+}
+
+
+uint32_t sad_16_avx2(const uint16_t* img, ptrdiff_t imgStride,
+                     const uint16_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  if (width < 16) {
+    return sad_16_sse4(img,imgStride,ref,refStride,width,height);
+  }
+
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sum = _mm256_setzero_si256();
+  int w16 = width & ~15;
+
+  for (int y=0;y<height;y++) {
+    for (int x=0;x<w16;x+=16) {
+      __m256i a = _mm256_loadu_si256((const __m256i*)(img+x));
+      __m256i b = _mm256_loadu_si256((const __m256i*)(ref+x));
+      __m256i d = _mm256_sub_epi16(_mm256_max_epu16(a,b), _mm256_min_epu16(a,b));
+      sum = _mm256_add_epi32(sum, _mm256_unpacklo_epi16(d,zero));
+      sum = _mm256_add_epi32(sum, _mm256_unpackhi_epi16(d,zero));
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  uint32_t result = hsum_epi32(sum);
+
+  if (w16 < width) {
+    result += sad_16_sse4(img - height*imgStride + w16, imgStride,
+                          ref - height*refStride + w16, refStride,
+                          width-w16, height);
+  }
+
+  return result;
+}
+
+
+// --- SATD ---
+
+/* Same 16 bit wrap-around computation as in sse-distortion.cc, but with
+   strips of 16 columns. Transposition is done in 8x8 tiles on the two
+   128 bit halves.
+ */
+
+static inline void transpose_8x8_epi16(__m128i* r)
+{
+  __m128i a0 = _mm_unpacklo_epi16(r[0],r[1]);
+  __m128i a1 = _mm_unpackhi_epi16(r[0],r[1]);
+  __m128i a2 = _mm_unpacklo_epi16(r[2],r[3]);
+  __m128i a3 = _mm_unpackhi_epi16(r[2],r[3]);
+  __m128i a4 = _mm_unpacklo_epi16(r[4],r[5]);
+  __m128i a5 = _mm_unpackhi_epi16(r[4],r[5]);
+  __m128i a6 = _mm_unpacklo_epi16(r[6],r[7]);
+  __m128i a7 = _mm_unpackhi_epi16(r[6],r[7]);
+
+  __m128i b0 = _mm_unpacklo_epi32(a0,a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0,a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1,a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1,a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4,a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4,a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5,a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5,a7);
+
+  r[0] = _mm_unpacklo_epi64(b0,b4);
+  r[1] = _mm_unpackhi_epi64(b0,b4);
+  r[2] = _mm_unpacklo_epi64(b1,b5);
+  r[3] = _mm_unpackhi_epi64(b1,b5);
+  r[4] = _mm_unpacklo_epi64(b2,b6);
+  r[5] = _mm_unpackhi_epi64(b2,b6);
+  r[6] = _mm_unpacklo_epi64(b3,b7);
+  r[7] = _mm_unpackhi_epi64(b3,b7);
+}
+
+
+static inline void hadamard_columns_epi16(__m256i* r, int n)
+{
+  for (int h=n/2; h>=1; h>>=1)
+    for (int blk=0; blk<n; blk+=2*h)
+      for (int i=blk; i<blk+h; i++) {
+        __m256i a = r[i];
+        __m256i b = r[i+h];
+        r[i]   = _mm256_add_epi16(a,b);
+        r[i+h] = _mm256_sub_epi16(a,b);
+      }
+}
+
+
+template <int N>
+static uint32_t satd_NxN_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                                const uint8_t* ref, ptrdiff_t refStride)
+{
+  __m256i strip[N/16][N];
+  __m256i tstrip[N/16][N];
+
+  for (int s=0;s<N/16;s++) {
+    for (int y=0;y<N;y++) {
+      __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(img+y*imgStride+16*s)));
+      __m256i b = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(ref+y*refStride+16*s)));
+      strip[s][y] = _mm256_sub_epi16(a,b);
+    }
+
+    hadamard_columns_epi16(strip[s],N);
+  }
+
+  // transpose in 8x8 tiles: input tile (row block t, column block c)
+  // is written to output tile (row block c, column block t)
+
+  const __m128i* in  = (const __m128i*)strip;   // [N/16][N][2]
+  __m128i*       out = (__m128i*)tstrip;
+
+  for (int c=0;c<N/8;c++)
+    for (int t=0;t<N/8;t++) {
+      __m128i tile[8];
+      for (int i=0;i<8;i++) { tile[i] = in[((c>>1)*N + 8*t+i)*2 + (c&1)]; }
+      transpose_8x8_epi16(tile);
+      for (int i=0;i<8;i++) { out[((t>>1)*N + 8*c+i)*2 + (t&1)] = tile[i]; }
+    }
+
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sum = _mm256_setzero_si256();
+
+  for (int s=0;s<N/16;s++) {
+    hadamard_columns_epi16(tstrip[s],N);
+
+    for (int y=0;y<N;y++) {
+      __m256i v = _mm256_abs_epi16(tstrip[s][y]);
+      sum = _mm256_add_epi32(sum, _mm256_unpacklo_epi16(v,zero));
+      sum = _mm256_add_epi32(sum, _mm256_unpackhi_epi16(v,zero));
+    }
+  }
+
+  return hsum_epi32(sum);
+}
+
+
+uint32_t satd_16x16_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                           const uint8_t* ref, ptrdiff_t refStride)
+{
+  return satd_NxN_8_avx2<16>(img,imgStride,ref,refStride);
+}
+
+uint32_t satd_32x32_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                           const uint8_t* ref, ptrdiff_t refStride)
+{
+  return satd_NxN_8_avx2<32>(img,imgStride,ref,refStride);
+}
+
+uint32_t satd_64x64_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                           const uint8_t* ref, ptrdiff_t refStride)
+{
+  return (satd_NxN_8_avx2<32>(img,    imgStride, ref,    refStride) +
+          satd_NxN_8_avx2<32>(img+32, imgStride, ref+32, refStride) +
+          satd_NxN_8_avx2<32>(img+32*imgStride,    imgStride, ref+32*refStride,    refStride) +
+          satd_NxN_8_avx2<32>(img+32*imgStride+32, imgStride, ref+32*refStride+32, refStride));
+}
@@ -0,0 +1,38 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef AVX2_DISTORTION_H
+#define AVX2_DISTORTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint32_t sad_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                    const uint8_t* ref, ptrdiff_t refStride, int width, int height);
+uint64_t ssd_8_avx2(const uint8_t* img, ptrdiff_t imgStride,
+                    const uint8_t* ref, ptrdiff_t refStride, int width, int height);
+uint32_t sad_16_avx2(const uint16_t* img, ptrdiff_t imgStride,
+                     const uint16_t* ref, ptrdiff_t refStride, int width, int height);
+
+uint32_t satd_16x16_8_avx2(const uint8_t* img, ptrdiff_t imgStride, const uint8_t* ref, ptrdiff_t refStride);
+uint32_t satd_32x32_8_avx2(const uint8_t* img, ptrdiff_t imgStride, const uint8_t* ref, ptrdiff_t refStride);
+uint32_t satd_64x64_8_avx2(const uint8_t* img, ptrdiff_t imgStride, const uint8_t* ref, ptrdiff_t refStride);
+
+#endif
@@ -0,0 +1,127 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "x86/avx2.h"
+#include "x86/avx2-distortion.h"
+#include "x86/avx2-dct.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef __GNUC__
+#include <cpuid.h>
+#endif
+
+
+#if HAVE_AVX2
+static bool have_AVX2()
+{
+  uint32_t ebx7=0,ecx1=0;
+
+#ifdef _MSC_VER
+  int regs[4];
+
+  __cpuid(regs, 0);
+  if (regs[0] < 7) { return false; }
+
+  __cpuid(regs, 1);
+  ecx1 = regs[2];
+
+  __cpuidex(regs, 7, 0);
+  ebx7 = regs[1];
+#else
+  uint32_t eax,ebx,ecx,edx;
+
+  if (__get_cpuid_max(0, NULL) < 7) { return false; }
+
+  if (!__get_cpuid(1, &eax,&ebx,&ecx,&edx)) { return false; }
+  ecx1 = ecx;
+
+  __cpuid_count(7, 0, eax,ebx,ecx,edx);
+  ebx7 = ebx;
+#endif
+
+  bool have_OSXSAVE = !!(ecx1 & (1<<27));
+  bool have_AVX     = !!(ecx1 & (1<<28));
+  bool have_AVX2    = !!(ebx7 & (1<<5));
+
+  if (!have_OSXSAVE || !have_AVX || !have_AVX2) {
+    return false;
+  }
+
+  // check that the OS saves the YMM registers on context switches
+
+#ifdef _MSC_VER
+  uint64_t xcr0 = _xgetbv(0);
+#else
+  uint32_t xcr0_lo, xcr0_hi;
+  __asm__ ("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+  uint64_t xcr0 = xcr0_lo;
+#endif
+
+  return (xcr0 & 6) == 6;
+}
+#endif
+
+
+void init_acceleration_functions_avx2(struct acceleration_functions* accel)
+{
+#if HAVE_AVX2
+  if (have_AVX2()) {
+    accel->sad_8  = sad_8_avx2;
+    accel->ssd_8  = ssd_8_avx2;
+    accel->sad_16 = sad_16_avx2;
+
+    accel->satd_8[2] = satd_16x16_8_avx2;
+    accel->satd_8[3] = satd_32x32_8_avx2;
+    accel->satd_8[4] = satd_64x64_8_avx2;
+
+    accel->transform_4x4_dst_add_8 = transform_4x4_luma_add_8_avx2;
+    accel->transform_add_8[0] = transform_4x4_add_8_avx2;
+    accel->transform_add_8[1] = transform_8x8_add_8_avx2;
+    accel->transform_add_8[2] = transform_16x16_add_8_avx2;
+    accel->transform_add_8[3] = transform_32x32_add_8_avx2;
+
+    accel->transform_4x4_dst_add_16 = transform_4x4_luma_add_16_avx2;
+    accel->transform_add_16[0] = transform_4x4_add_16_avx2;
+    accel->transform_add_16[1] = transform_8x8_add_16_avx2;
+    accel->transform_add_16[2] = transform_16x16_add_16_avx2;
+    accel->transform_add_16[3] = transform_32x32_add_16_avx2;
+
+    accel->transform_idst_4x4   = transform_idst_4x4_avx2;
+    accel->transform_idct_4x4   = transform_idct_4x4_avx2;
+    accel->transform_idct_8x8   = transform_idct_8x8_avx2;
+    accel->transform_idct_16x16 = transform_idct_16x16_avx2;
+    accel->transform_idct_32x32 = transform_idct_32x32_avx2;
+
+    accel->transform_bypass = transform_bypass_avx2;
+    accel->add_residual_8   = add_residual_8_avx2;
+    accel->add_residual_16  = add_residual_16_avx2;
+
+    accel->dequant_coefficients = dequant_coefficients_avx2;
+    accel->dequant_block        = dequant_block_avx2;
+  }
+#endif
+}
@@ -0,0 +1,326 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "x86/sse-bipred.h"
+#include "libde265/util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <emmintrin.h> // SSE2
+#include <tmmintrin.h> // SSSE3
+
+#if HAVE_SSE4_1
+#include <smmintrin.h> // SSE4.1
+#endif
+
+
+#define MAX_PB_SIZE 64
+#define TMP_STRIDE  MAX_PB_SIZE
+
+
+// filters as in fallback-motion.cc, entry 0 is the full-sample position
+
+static const int8_t qpel_taps[4][8] = {
+  {  0, 0,  0, 64,  0,  0, 0,  0 },
+  { -1, 4,-10, 58, 17, -5, 1,  0 },
+  { -1, 4,-11, 40, 40,-11, 4, -1 },
+  {  0, 1, -5, 17, 58,-10, 4, -1 }
+};
+
+static const int8_t epel_taps[8][4] = {
+  {  0, 64,  0,  0 },
+  { -2, 58, 10, -2 },
+  { -4, 54, 16, -2 },
+  { -6, 46, 28, -4 },
+  { -4, 36, 36, -4 },
+  { -4, 28, 46, -6 },
+  { -2, 16, 54, -4 },
+  { -2, 10, 58, -2 }
+};
+
+// pairs of neighboring samples for pmaddubsw, pair i starts at byte 2*i
+
+ALIGNED_16(static const int8_t pair_shuffle[4][16]) = {
+  { 0,1, 1,2, 2,3, 3,4, 4,5, 5,6, 6,7, 7,8 },
+  { 2,3, 3,4, 4,5, 5,6, 6,7, 7,8, 8,9, 9,10 },
+  { 4,5, 5,6, 6,7, 7,8, 8,9, 9,10, 10,11, 11,12 },
+  { 6,7, 7,8, 8,9, 9,10, 10,11, 11,12, 12,13, 13,14 }
+};
+
+
+enum {
+  MC_FULL = 0,
+  MC_H    = 1,
+  MC_V    = 2,
+  MC_HV   = 3
+};
+
+
+/* Move the filter taps so that the first tap is non-zero (only the qpel filter
+   for position 3 starts with a zero tap). Returns the number of non-zero taps.
+ */
+template <int nTaps>
+static inline int normalize_taps(const int8_t* filter, int8_t* taps, int* first)
+{
+  *first = 0;
+  while (filter[*first]==0) (*first)++;
+
+  int n=0;
+  for (int k=0;k<nTaps;k++) {
+    taps[k] = (*first+k < nTaps) ? filter[*first+k] : 0;
+    if (taps[k]) n=k+1;
+  }
+
+  return n;
+}
+
+
+/* Interpolation of one prediction list, delivering 8 samples (14 bit) at a time.
+   For the separable case, the horizontally filtered rows are computed in init().
+ */
+template <int nTaps, int type>
+class sse_mc_prediction
+{
+public:
+  void init(const uint8_t* src, ptrdiff_t stride,
+            const int8_t* hfilter, const int8_t* vfilter,
+            int width, int height, int16_t* tmp)
+  {
+    const int center = nTaps/2-1;
+
+    mSrc = src;
+    mStride = stride;
+    mTmp = tmp;
+
+    if (type & MC_H) {
+      int8_t taps[nTaps];
+      int first;
+      normalize_taps<nTaps>(hfilter, taps, &first);
+
+      mHOffset = first - center;
+      for (int i=0;i<nTaps/2;i++) {
+        mHCoeff[i] = _mm_set1_epi16((int16_t)((uint8_t)taps[2*i] | ((uint8_t)taps[2*i+1] << 8)));
+      }
+    }
+
+    if (type & MC_V) {
+      int8_t taps[nTaps];
+      int first;
+      int n = normalize_taps<nTaps>(vfilter, taps, &first);
+
+      // rows of trailing zero taps are redirected to the last used row
+
+      for (int k=0;k<nTaps;k++) {
+        int row = first + (k<n ? k : n-1);
+
+        if (type==MC_V) { mRowOffset[k] = (row-center)*stride; }
+        else            { mRowOffset[k] = row*TMP_STRIDE; }
+      }
+
+      for (int i=0;i<nTaps/2;i++) {
+        if (type==MC_V) {
+          mVCoeff[i] = _mm_set1_epi16((int16_t)((uint8_t)taps[2*i] | ((uint8_t)taps[2*i+1] << 8)));
+        }
+        else {
+          mVCoeff[i] = _mm_set1_epi32((uint16_t)taps[2*i] | ((uint32_t)(uint16_t)taps[2*i+1] << 16));
+        }
+      }
+
+      if (type==MC_HV) {
+        // tmp row r holds the filtered source row r-center
+
+        for (int r=first; r<height+first+n-1; r++) {
+          const uint8_t* p = src + (r-center)*stride;
+          for (int x=0;x<width;x+=8) {
+            _mm_store_si128((__m128i*)&tmp[r*TMP_STRIDE+x], filter_h(p+x));
+          }
+        }
+      }
+    }
+  }
+
+  inline __m128i get(int x, int y) const
+  {
+    if (type==MC_FULL) {
+      __m128i p = _mm_loadl_epi64((const __m128i*)(mSrc + y*mStride + x));
+      return _mm_slli_epi16(_mm_cvtepu8_epi16(p), 6);
+    }
+    else if (type==MC_H) {
+      return filter_h(mSrc + y*mStride + x);
+    }
+    else if (type==MC_V) {
+      const uint8_t* p = mSrc + y*mStride + x;
+      __m128i sum = _mm_setzero_si128();
+
+      for (int i=0;i<nTaps/2;i++) {
+        __m128i r0 = _mm_loadl_epi64((const __m128i*)(p + mRowOffset[2*i  ]));
+        __m128i r1 = _mm_loadl_epi64((const __m128i*)(p + mRowOffset[2*i+1]));
+        sum = _mm_add_epi16(sum, _mm_maddubs_epi16(_mm_unpacklo_epi8(r0,r1), mVCoeff[i]));
+      }
+
+      return sum;
+    }
+    else {
+      const int16_t* t = mTmp + y*TMP_STRIDE + x;
+      __m128i lo = _mm_setzero_si128();
+      __m128i hi = _mm_setzero_si128();
+
+      for (int i=0;i<nTaps/2;i++) {
+        __m128i r0 = _mm_load_si128((const __m128i*)(t + mRowOffset[2*i  ]));
+        __m128i r1 = _mm_load_si128((const __m128i*)(t + mRowOffset[2*i+1]));
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(r0,r1), mVCoeff[i]));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(r0,r1), mVCoeff[i]));
+      }
+
+      return _mm_packs_epi32(_mm_srai_epi32(lo,6), _mm_srai_epi32(hi,6));
+    }
+  }
+
+private:
+  inline __m128i filter_h(const uint8_t* p) const
+  {
+    __m128i s = _mm_loadu_si128((const __m128i*)(p + mHOffset));
+    __m128i sum = _mm_maddubs_epi16(_mm_shuffle_epi8(s, *(const __m128i*)pair_shuffle[0]), mHCoeff[0]);
+
+    for (int i=1;i<nTaps/2;i++) {
+      sum = _mm_add_epi16(sum, _mm_maddubs_epi16(_mm_shuffle_epi8(s, *(const __m128i*)pair_shuffle[i]),
+                                                 mHCoeff[i]));
+    }
+
+    return sum;
+  }
+
+  const uint8_t* mSrc;
+  ptrdiff_t mStride;
+  int16_t* mTmp;
+
+  int mHOffset;
+  __m128i mHCoeff[nTaps/2];
+  __m128i mVCoeff[nTaps/2];
+  ptrdiff_t mRowOffset[nTaps];
+};
+
+
+// store the lower 'n' of 8 packed pixels, n is a multiple of 2
+
+static inline void store_pixels(uint8_t* dst, __m128i v, int n)
+{
+  if (n>=8) {
+    _mm_storel_epi64((__m128i*)dst, v);
+    return;
+  }
+
+  if (n&4) {
+    *((uint32_t*)dst) = _mm_cvtsi128_si32(v);
+    dst += 4;
+    v = _mm_srli_si128(v,4);
+  }
+
+  if (n&2) {
+    *((uint16_t*)dst) = (uint16_t)_mm_cvtsi128_si32(v);
+  }
+}
+
+
+template <int nTaps, int type0, int type1>
+static void put_bi_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                          const uint8_t *src0, ptrdiff_t src0stride,
+                          const int8_t* hfilter0, const int8_t* vfilter0,
+                          const uint8_t *src1, ptrdiff_t src1stride,
+                          const int8_t* hfilter1, const int8_t* vfilter1,
+                          int width, int height)
+{
+  ALIGNED_16(int16_t tmp[2][(MAX_PB_SIZE+nTaps-1)*TMP_STRIDE]);
+
+  sse_mc_prediction<nTaps,type0> pred0;
+  sse_mc_prediction<nTaps,type1> pred1;
+  pred0.init(src0,src0stride, hfilter0,vfilter0, width,height, tmp[0]);
+  pred1.init(src1,src1stride, hfilter1,vfilter1, width,height, tmp[1]);
+
+  // (p0 + p1 + 64) >> 7, saturation in the additions does not change the clipped result
+
+  const __m128i offset = _mm_set1_epi16(64);
+
+  for (int y=0;y<height;y++) {
+    uint8_t* out = dst + y*dststride;
+
+    for (int x=0;x<width;x+=8) {
+      __m128i sum = _mm_adds_epi16(_mm_adds_epi16(pred0.get(x,y), pred1.get(x,y)), offset);
+      sum = _mm_srai_epi16(sum, 7);
+
+      store_pixels(out+x, _mm_packus_epi16(sum,sum), width-x);
+    }
+  }
+}
+
+
+typedef void (*put_bi_8_func)(uint8_t *dst, ptrdiff_t dststride,
+                              const uint8_t *src0, ptrdiff_t src0stride,
+                              const int8_t* hfilter0, const int8_t* vfilter0,
+                              const uint8_t *src1, ptrdiff_t src1stride,
+                              const int8_t* hfilter1, const int8_t* vfilter1,
+                              int width, int height);
+
+#define BI_FUNCS(nTaps, t0) { put_bi_8_sse4<nTaps,t0,MC_FULL>, put_bi_8_sse4<nTaps,t0,MC_H>, \
+                              put_bi_8_sse4<nTaps,t0,MC_V>,    put_bi_8_sse4<nTaps,t0,MC_HV> }
+
+static const put_bi_8_func put_qpel_bi_funcs[4][4] = {
+  BI_FUNCS(8, MC_FULL), BI_FUNCS(8, MC_H), BI_FUNCS(8, MC_V), BI_FUNCS(8, MC_HV)
+};
+
+static const put_bi_8_func put_epel_bi_funcs[4][4] = {
+  BI_FUNCS(4, MC_FULL), BI_FUNCS(4, MC_H), BI_FUNCS(4, MC_V), BI_FUNCS(4, MC_HV)
+};
+
+#undef BI_FUNCS
+
+
+static inline int mc_type(int mx, int my)
+{
+  return (mx ? MC_H : 0) | (my ? MC_V : 0);
+}
+
+
+void put_qpel_bi_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                        const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                        const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                        int width, int height)
+{
+  put_qpel_bi_funcs[mc_type(mx0,my0)][mc_type(mx1,my1)]
+    (dst,dststride,
+     src0,src0stride, qpel_taps[mx0], qpel_taps[my0],
+     src1,src1stride, qpel_taps[mx1], qpel_taps[my1],
+     width,height);
+}
+
+
+void put_epel_bi_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                        const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                        const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                        int width, int height)
+{
+  put_epel_bi_funcs[mc_type(mx0,my0)][mc_type(mx1,my1)]
+    (dst,dststride,
+     src0,src0stride, epel_taps[mx0], epel_taps[my0],
+     src1,src1stride, epel_taps[mx1], epel_taps[my1],
+     width,height);
+}
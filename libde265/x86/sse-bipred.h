@@ -0,0 +1,39 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SSE_BIPRED_H
+#define SSE_BIPRED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Interpolation of both prediction lists and default weighted averaging in one pass.
+
+void put_qpel_bi_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                        const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                        const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                        int width, int height);
+
+void put_epel_bi_8_sse4(uint8_t *dst, ptrdiff_t dststride,
+                        const uint8_t *src0, ptrdiff_t src0stride, int mx0, int my0,
+                        const uint8_t *src1, ptrdiff_t src1stride, int mx1, int my1,
+                        int width, int height);
+
+#endif
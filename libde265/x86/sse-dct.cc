@@ -21,6 +21,7 @@
 
 #include "x86/sse-dct.h"
 #include "libde265/util.h"
+#include "libde265/fallback-dct.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -7092,3 +7093,251 @@ void ff_hevc_transform_32x32_add_10_sse4(uint8_t *_dst, const int16_t *coeffs,
 }
 #endif
 
+
+
+/* DC-only inverse transform: all residual samples are equal (see transform_dc_add in
+   fallback-dct.cc), so the residual can be added with saturating 8-bit arithmetic. */
+void ff_hevc_transform_dc_add_8_sse4(uint8_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride)
+{
+    int g = (64*coeffs[0] + add_1st) >> shift_1st;
+    if (g < -32768) g = -32768;
+    if (g >  32767) g =  32767;
+
+    int r = (64*g + (1<<11)) >> 12;
+    if (r < -255) r = -255;
+    if (r >  255) r =  255;
+
+    __m128i add = _mm_set1_epi8((char)(r>0 ?  r : 0));
+    __m128i sub = _mm_set1_epi8((char)(r<0 ? -r : 0));
+
+    switch (nT) {
+    case 4:
+        for (int y=0;y<4;y++) {
+            __m128i p = _mm_cvtsi32_si128(*(const int32_t*)(dst + y*stride));
+            p = _mm_subs_epu8(_mm_adds_epu8(p, add), sub);
+            *(int32_t*)(dst + y*stride) = _mm_cvtsi128_si32(p);
+        }
+        break;
+
+    case 8:
+        for (int y=0;y<8;y++) {
+            __m128i p = _mm_loadl_epi64((const __m128i*)(dst + y*stride));
+            p = _mm_subs_epu8(_mm_adds_epu8(p, add), sub);
+            _mm_storel_epi64((__m128i*)(dst + y*stride), p);
+        }
+        break;
+
+    default:
+        for (int y=0;y<nT;y++)
+            for (int x=0;x<nT;x+=16) {
+                __m128i p = _mm_loadu_si128((const __m128i*)(dst + y*stride + x));
+                p = _mm_subs_epu8(_mm_adds_epu8(p, add), sub);
+                _mm_storeu_si128((__m128i*)(dst + y*stride + x), p);
+            }
+        break;
+    }
+}
+
+
+#if HAVE_SSE4_1
+/* Inverse DCT when all non-zero coefficients are within the top-left nzW x nzH
+   area (at most 8x8). Each output vector is computed as the sum of only the
+   basis functions with non-zero coefficients, two at a time with madd.
+   Coefficients just outside the area are zero, hence nzW and nzH can be rounded
+   up to an even number. */
+template <int nT>
+static void transform_add_partial_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                         int nzW, int nzH)
+{
+    const int fact = 32/nT;
+
+    nzW = (nzW+1) & ~1;
+    nzH = (nzH+1) & ~1;
+
+    // interleaved pairs of basis functions: [j/2][i/8][lo/hi]
+    __m128i m[4][nT/8][2];
+
+    const int nPairs = (nzW>nzH ? nzW : nzH)/2;
+    for (int p=0;p<nPairs;p++)
+        for (int i=0;i<nT;i+=8) {
+            __m128i m0 = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)&mat_dct[fact*(2*p  )][i]));
+            __m128i m1 = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i*)&mat_dct[fact*(2*p+1)][i]));
+            m[p][i/8][0] = _mm_unpacklo_epi16(m0,m1);
+            m[p][i/8][1] = _mm_unpackhi_epi16(m0,m1);
+        }
+
+
+    // vertical pass, g[c][i] is the transposed intermediate
+
+    ALIGNED_16(int16_t) g[8][nT];
+
+    for (int c=0;c<nzW;c++)
+        for (int i=0;i<nT;i+=8) {
+            __m128i lo = _mm_set1_epi32(add_1st);
+            __m128i hi = lo;
+
+            for (int p=0;p<nzH/2;p++) {
+                __m128i cc = _mm_set1_epi32((uint16_t)coeffs[c+(2*p)*nT] |
+                                            ((uint32_t)(uint16_t)coeffs[c+(2*p+1)*nT] << 16));
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(m[p][i/8][0], cc));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(m[p][i/8][1], cc));
+            }
+
+            _mm_store_si128((__m128i*)&g[c][i],
+                            _mm_packs_epi32(_mm_srai_epi32(lo,shift_1st), _mm_srai_epi32(hi,shift_1st)));
+        }
+
+
+    // horizontal pass and reconstruction
+
+    const __m128i zero = _mm_setzero_si128();
+
+    for (int y=0;y<nT;y++) {
+        __m128i gg[4];
+        for (int p=0;p<nzW/2;p++) {
+            gg[p] = _mm_set1_epi32((uint16_t)g[2*p][y] | ((uint32_t)(uint16_t)g[2*p+1][y] << 16));
+        }
+
+        for (int i=0;i<nT;i+=8) {
+            __m128i lo = _mm_set1_epi32(1<<11);
+            __m128i hi = lo;
+
+            for (int p=0;p<nzW/2;p++) {
+                lo = _mm_add_epi32(lo, _mm_madd_epi16(m[p][i/8][0], gg[p]));
+                hi = _mm_add_epi32(hi, _mm_madd_epi16(m[p][i/8][1], gg[p]));
+            }
+
+            __m128i r = _mm_packs_epi32(_mm_srai_epi32(lo,12), _mm_srai_epi32(hi,12));
+
+            __m128i pix = _mm_loadl_epi64((const __m128i*)(dst + y*stride + i));
+            pix = _mm_adds_epi16(_mm_unpacklo_epi8(pix, zero), r);
+            _mm_storel_epi64((__m128i*)(dst + y*stride + i), _mm_packus_epi16(pix, pix));
+        }
+    }
+}
+
+
+void ff_hevc_transform_16x16_add_partial_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                                int nzW, int nzH)
+{
+    if (nzW>8 || nzH>8) {
+        ff_hevc_transform_16x16_add_8_sse4(dst, coeffs, stride);
+    }
+    else {
+        transform_add_partial_8_sse4<16>(dst, coeffs, stride, nzW, nzH);
+    }
+}
+
+
+void ff_hevc_transform_32x32_add_partial_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride,
+                                                int nzW, int nzH)
+{
+    if (nzW>8 || nzH>8) {
+        ff_hevc_transform_32x32_add_8_sse4(dst, coeffs, stride);
+    }
+    else {
+        transform_add_partial_8_sse4<32>(dst, coeffs, stride, nzW, nzH);
+    }
+}
+#endif
+
+
+#if HAVE_SSE4_1
+
+/* Dequantization (8.6.3) in 32 bit. With X = coeff * m_x_y * levelScale (which fits
+   into 32 bit), the result is (X<<qPper + rnd) >> bdShift. This is a single
+   rounding right shift of X by (bdShift-qPper), or, for large QPs, a left shift
+   by (qPper-bdShift) where X is limited to 17 bits first (this does not change
+   the clipped result).
+ */
+struct dequant_sse4
+{
+  bool    right;
+  __m128i rnd;
+  __m128i shift;
+
+  dequant_sse4(int qPper, int bdShift) {
+    right = (qPper < bdShift);
+    int s = (right ? bdShift-qPper : qPper-bdShift);
+    rnd   = _mm_set1_epi32(right ? 1<<(s-1) : 0);
+    shift = _mm_cvtsi32_si128(s);
+  }
+
+  __m128i operator()(__m128i coeff, __m128i fact) const {
+    __m128i x = _mm_mullo_epi32(coeff, fact);
+
+    if (right) {
+      return _mm_sra_epi32(_mm_add_epi32(x, rnd), shift);
+    }
+    else {
+      x = _mm_min_epi32(_mm_max_epi32(x, _mm_set1_epi32(-65536)), _mm_set1_epi32(65535));
+      return _mm_sll_epi32(x, shift);
+    }
+  }
+};
+
+
+void dequant_coefficients_sse4(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                               int nCoeff, const uint8_t* sclist,
+                               int levelScale, int qPper, int bdShift)
+{
+  const dequant_sse4 dequant(qPper, bdShift);
+  const __m128i flat = _mm_set1_epi32(16*levelScale);
+  const __m128i scale = _mm_set1_epi32(levelScale);
+
+  ALIGNED_16(int16_t) out[8];
+
+  int i;
+  for (i=0; i+8<=nCoeff; i+=8) {
+    const int16_t* pos = coeffPos+i;
+
+    __m128i c  = _mm_loadu_si128((const __m128i*)(coeffList+i));
+    __m128i lo = _mm_cvtepi16_epi32(c);
+    __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(c,8));
+
+    __m128i fact_lo = flat, fact_hi = flat;
+    if (sclist) {
+      fact_lo = _mm_mullo_epi32(scale, _mm_setr_epi32(sclist[pos[0]],sclist[pos[1]],
+                                                      sclist[pos[2]],sclist[pos[3]]));
+      fact_hi = _mm_mullo_epi32(scale, _mm_setr_epi32(sclist[pos[4]],sclist[pos[5]],
+                                                      sclist[pos[6]],sclist[pos[7]]));
+    }
+
+    _mm_store_si128((__m128i*)out, _mm_packs_epi32(dequant(lo,fact_lo), dequant(hi,fact_hi)));
+
+    for (int k=0;k<8;k++) {
+      coeffBuf[pos[k]] = out[k];
+    }
+  }
+
+  dequant_coefficients_fallback(coeffBuf, coeffList+i, coeffPos+i, nCoeff-i, sclist,
+                                levelScale, qPper, bdShift);
+}
+
+
+void dequant_block_sse4(int16_t* coeffs, int n, const uint8_t* sclist,
+                        int levelScale, int qPper, int bdShift)
+{
+  const dequant_sse4 dequant(qPper, bdShift);
+  const __m128i flat = _mm_set1_epi32(16*levelScale);
+  const __m128i scale = _mm_set1_epi32(levelScale);
+
+  // n is a multiple of 16
+
+  for (int i=0;i<n;i+=8) {
+    __m128i c  = _mm_loadu_si128((const __m128i*)(coeffs+i));
+    __m128i lo = _mm_cvtepi16_epi32(c);
+    __m128i hi = _mm_cvtepi16_epi32(_mm_srli_si128(c,8));
+
+    __m128i fact_lo = flat, fact_hi = flat;
+    if (sclist) {
+      __m128i m = _mm_loadl_epi64((const __m128i*)(sclist+i));
+      fact_lo = _mm_mullo_epi32(scale, _mm_cvtepu8_epi32(m));
+      fact_hi = _mm_mullo_epi32(scale, _mm_cvtepu8_epi32(_mm_srli_si128(m,4)));
+    }
+
+    _mm_storeu_si128((__m128i*)(coeffs+i), _mm_packs_epi32(dequant(lo,fact_lo), dequant(hi,fact_hi)));
+  }
+}
+
+#endif
@@ -31,5 +31,14 @@ void ff_hevc_transform_4x4_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdi
 void ff_hevc_transform_8x8_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
 void ff_hevc_transform_16x16_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
 void ff_hevc_transform_32x32_add_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride);
+void ff_hevc_transform_dc_add_8_sse4(uint8_t *dst, const int16_t *coeffs, int nT, ptrdiff_t stride);
+void ff_hevc_transform_16x16_add_partial_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int nzW, int nzH);
+void ff_hevc_transform_32x32_add_partial_8_sse4(uint8_t *dst, const int16_t *coeffs, ptrdiff_t stride, int nzW, int nzH);
+
+void dequant_coefficients_sse4(int16_t* coeffBuf, const int16_t* coeffList, const int16_t* coeffPos,
+                               int nCoeff, const uint8_t* sclist,
+                               int levelScale, int qPper, int bdShift);
+void dequant_block_sse4(int16_t* coeffs, int n, const uint8_t* sclist,
+                        int levelScale, int qPper, int bdShift);
 
 #endif
@@ -0,0 +1,123 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "x86/sse-deblock.h"
+#include "libde265/image.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <emmintrin.h> // SSE2
+#include <tmmintrin.h> // SSSE3
+
+#if HAVE_SSE4_1
+#include <smmintrin.h> // SSE4.1
+#endif
+
+
+uint32_t deblock_boundary_strength_sse4(uint8_t* q, const uint8_t* p, int n, uint32_t posMask,
+                                        uint8_t edgeMask, uint8_t transformEdgeMask)
+{
+  assert(n<=16);
+
+  // runs are usually a full CTB row (4, 8 or 16 units)
+
+  __m128i vq,vp;
+
+  switch (n) {
+  case 16:
+    vq = _mm_loadu_si128((const __m128i*)q);
+    vp = _mm_loadu_si128((const __m128i*)p);
+    break;
+  case 8:
+    vq = _mm_loadl_epi64((const __m128i*)q);
+    vp = _mm_loadl_epi64((const __m128i*)p);
+    break;
+  case 4:
+    vq = _mm_cvtsi32_si128(*(const uint32_t*)q);
+    vp = _mm_cvtsi32_si128(*(const uint32_t*)p);
+    break;
+  default:
+    {
+      uint8_t qbuf[16] = { 0 };
+      uint8_t pbuf[16] = { 0 };
+      memcpy(qbuf,q,n);
+      memcpy(pbuf,p,n);
+
+      vq = _mm_loadu_si128((const __m128i*)qbuf);
+      vp = _mm_loadu_si128((const __m128i*)pbuf);
+    }
+    break;
+  }
+
+  posMask &= (1<<n)-1;
+
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i pq = _mm_or_si128(vp,vq);
+
+  // 0xFF in all positions where the flag is NOT set
+
+  __m128i noEdge    = _mm_cmpeq_epi8(_mm_and_si128(vq, _mm_set1_epi8(edgeMask)), zero);
+  __m128i noTrafo   = _mm_cmpeq_epi8(_mm_and_si128(vq, _mm_set1_epi8(transformEdgeMask)), zero);
+  __m128i noIntra   = _mm_cmpeq_epi8(_mm_and_si128(pq, _mm_set1_epi8(DEBLOCK_FLAG_INTRA)), zero);
+  __m128i noCoeffs  = _mm_cmpeq_epi8(_mm_and_si128(pq, _mm_set1_epi8(DEBLOCK_FLAG_NONZERO_COEFF)), zero);
+  __m128i noResidual = _mm_or_si128(noTrafo, noCoeffs);
+
+  // bS=2 for intra, bS=1 for transform edges with coefficients, motion check otherwise
+
+  __m128i bS2 = _mm_andnot_si128(noIntra, _mm_set1_epi8(2));
+  __m128i bS1 = _mm_and_si128(noIntra, _mm_andnot_si128(noResidual, _mm_set1_epi8(1)));
+  __m128i bS  = _mm_andnot_si128(noEdge, _mm_or_si128(bS2,bS1));
+
+  __m128i motion = _mm_andnot_si128(noEdge, _mm_and_si128(noIntra, noResidual));
+
+  // expand posMask to one byte per position
+
+  const __m128i bits = _mm_set_epi8(-128,64,32,16,8,4,2,1, -128,64,32,16,8,4,2,1);
+  __m128i sel = _mm_shuffle_epi8(_mm_cvtsi32_si128(posMask),
+                                 _mm_set_epi8(1,1,1,1,1,1,1,1, 0,0,0,0,0,0,0,0));
+  sel = _mm_cmpeq_epi8(_mm_and_si128(sel,bits), bits);
+
+  __m128i out = _mm_or_si128(_mm_andnot_si128(_mm_set1_epi8(DEBLOCK_BS_MASK), vq), bS);
+  out = _mm_blendv_epi8(vq, out, sel);
+
+  switch (n) {
+  case 16:
+    _mm_storeu_si128((__m128i*)q, out);
+    break;
+  case 8:
+    _mm_storel_epi64((__m128i*)q, out);
+    break;
+  case 4:
+    *(uint32_t*)q = _mm_cvtsi128_si32(out);
+    break;
+  default:
+    {
+      uint8_t qbuf[16];
+      _mm_storeu_si128((__m128i*)qbuf, out);
+      memcpy(q,qbuf,n);
+    }
+    break;
+  }
+
+  return _mm_movemask_epi8(_mm_and_si128(motion, sel));
+}
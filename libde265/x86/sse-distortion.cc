@@ -0,0 +1,406 @@
+/*
+ * H.265 video codec.
+ * Copyright (c) 2013-2014 struktur AG, Dirk Farin <farin@struktur.de>
+ *
+ * This file is part of libde265.
+ *
+ * libde265 is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * libde265 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "x86/sse-distortion.h"
+#include "libde265/util.h"
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <emmintrin.h> // SSE2
+#include <tmmintrin.h> // SSSE3
+
+#if HAVE_SSE4_1
+#include <smmintrin.h> // SSE4.1
+#endif
+
+
+// _mm_cvtsi128_si64() is only available on x86-64, store the low half instead
+static inline uint64_t hsum_epi64(__m128i v)
+{
+  uint64_t sum;
+  _mm_storel_epi64((__m128i*)&sum, _mm_add_epi64(v, _mm_unpackhi_epi64(v,v)));
+  return sum;
+}
+
+static inline uint32_t hsum_epi32(__m128i v)
+{
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1,0,3,2)));
+  v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2,3,0,1)));
+  return _mm_cvtsi128_si32(v);
+}
+
+
+uint32_t sad_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                    const uint8_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  __m128i sum = _mm_setzero_si128();
+  uint32_t tail = 0;
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+16<=width;x+=16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(img+x));
+      __m128i b = _mm_loadu_si128((const __m128i*)(ref+x));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(a,b));
+    }
+
+    for (;x+8<=width;x+=8) {
+      __m128i a = _mm_loadl_epi64((const __m128i*)(img+x));
+      __m128i b = _mm_loadl_epi64((const __m128i*)(ref+x));
+      sum = _mm_add_epi64(sum, _mm_sad_epu8(a,b));
+    }
+
+    for (;x<width;x++) {
+      tail += abs_value(img[x] - ref[x]);
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return (uint32_t)hsum_epi64(sum) + tail;
+}
+
+
+uint64_t ssd_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                    const uint8_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = _mm_setzero_si128();
+  uint64_t tail = 0;
+
+  for (int y=0;y<height;y++) {
+    // a line sum of up to 2^15 pixels cannot overflow 32 bit
+    __m128i lineSum = _mm_setzero_si128();
+    int x=0;
+
+    for (;x+16<=width;x+=16) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(img+x));
+      __m128i b = _mm_loadu_si128((const __m128i*)(ref+x));
+      __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(a,zero), _mm_unpacklo_epi8(b,zero));
+      __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(a,zero), _mm_unpackhi_epi8(b,zero));
+      lineSum = _mm_add_epi32(lineSum, _mm_madd_epi16(dlo,dlo));
+      lineSum = _mm_add_epi32(lineSum, _mm_madd_epi16(dhi,dhi));
+    }
+
+    for (;x+8<=width;x+=8) {
+      __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(img+x)));
+      __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(ref+x)));
+      __m128i d = _mm_sub_epi16(a,b);
+      lineSum = _mm_add_epi32(lineSum, _mm_madd_epi16(d,d));
+    }
+
+    for (;x<width;x++) {
+      int diff = img[x] - ref[x];
+      tail += diff*diff;
+    }
+
+    sum = _mm_add_epi64(sum, _mm_unpacklo_epi32(lineSum,zero));
+    sum = _mm_add_epi64(sum, _mm_unpackhi_epi32(lineSum,zero));
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return hsum_epi64(sum) + tail;
+}
+
+
+uint32_t sad_16_sse4(const uint16_t* img, ptrdiff_t imgStride,
+                     const uint16_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sum = _mm_setzero_si128();
+  uint32_t tail = 0;
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+8<=width;x+=8) {
+      __m128i a = _mm_loadu_si128((const __m128i*)(img+x));
+      __m128i b = _mm_loadu_si128((const __m128i*)(ref+x));
+      __m128i d = _mm_sub_epi16(_mm_max_epu16(a,b), _mm_min_epu16(a,b));
+      sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(d,zero));
+      sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(d,zero));
+    }
+
+    for (;x<width;x++) {
+      tail += abs_value(img[x] - ref[x]);
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return hsum_epi32(sum) + tail;
+}
+
+
+uint64_t ssd_16_sse4(const uint16_t* img, ptrdiff_t imgStride,
+                     const uint16_t* ref, ptrdiff_t refStride, int width, int height)
+{
+  __m128i sum = _mm_setzero_si128();
+  uint64_t tail = 0;
+
+  for (int y=0;y<height;y++) {
+    int x=0;
+
+    for (;x+4<=width;x+=4) {
+      __m128i a = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(img+x)));
+      __m128i b = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(ref+x)));
+      __m128i d = _mm_sub_epi32(a,b);
+
+      // squares of the even and odd 32 bit lanes as 64 bit values
+      sum = _mm_add_epi64(sum, _mm_mul_epi32(d,d));
+      d = _mm_srli_epi64(d,32);
+      sum = _mm_add_epi64(sum, _mm_mul_epi32(d,d));
+    }
+
+    for (;x<width;x++) {
+      int64_t diff = img[x] - ref[x];
+      tail += diff*diff;
+    }
+
+    img += imgStride;
+    ref += refStride;
+  }
+
+  return hsum_epi64(sum) + tail;
+}
+
+
+// --- SATD ---
+
+/* All computations are carried out with 16 bit wrap-around arithmetic.
+   Since this is a linear transform, the result is identical to the
+   scalar hadamard_*_8_fallback() functions, independent of the order of
+   the butterfly stages.
+ */
+
+static inline void transpose_8x8_epi16(__m128i* r)
+{
+  __m128i a0 = _mm_unpacklo_epi16(r[0],r[1]);
+  __m128i a1 = _mm_unpackhi_epi16(r[0],r[1]);
+  __m128i a2 = _mm_unpacklo_epi16(r[2],r[3]);
+  __m128i a3 = _mm_unpackhi_epi16(r[2],r[3]);
+  __m128i a4 = _mm_unpacklo_epi16(r[4],r[5]);
+  __m128i a5 = _mm_unpackhi_epi16(r[4],r[5]);
+  __m128i a6 = _mm_unpacklo_epi16(r[6],r[7]);
+  __m128i a7 = _mm_unpackhi_epi16(r[6],r[7]);
+
+  __m128i b0 = _mm_unpacklo_epi32(a0,a2);
+  __m128i b1 = _mm_unpackhi_epi32(a0,a2);
+  __m128i b2 = _mm_unpacklo_epi32(a1,a3);
+  __m128i b3 = _mm_unpackhi_epi32(a1,a3);
+  __m128i b4 = _mm_unpacklo_epi32(a4,a6);
+  __m128i b5 = _mm_unpackhi_epi32(a4,a6);
+  __m128i b6 = _mm_unpacklo_epi32(a5,a7);
+  __m128i b7 = _mm_unpackhi_epi32(a5,a7);
+
+  r[0] = _mm_unpacklo_epi64(b0,b4);
+  r[1] = _mm_unpackhi_epi64(b0,b4);
+  r[2] = _mm_unpacklo_epi64(b1,b5);
+  r[3] = _mm_unpackhi_epi64(b1,b5);
+  r[4] = _mm_unpacklo_epi64(b2,b6);
+  r[5] = _mm_unpackhi_epi64(b2,b6);
+  r[6] = _mm_unpacklo_epi64(b3,b7);
+  r[7] = _mm_unpackhi_epi64(b3,b7);
+}
+
+
+// Hadamard transform along the rows of an 8-column strip (vertical butterflies)
+static inline void hadamard_columns_epi16(__m128i* r, int n)
+{
+  for (int h=n/2; h>=1; h>>=1)
+    for (int blk=0; blk<n; blk+=2*h)
+      for (int i=blk; i<blk+h; i++) {
+        __m128i a = r[i];
+        __m128i b = r[i+h];
+        r[i]   = _mm_add_epi16(a,b);
+        r[i+h] = _mm_sub_epi16(a,b);
+      }
+}
+
+
+static inline __m128i abs_sum_epi16(__m128i sum, __m128i v)
+{
+  const __m128i zero = _mm_setzero_si128();
+
+  // abs(-32768) is 0x8000, which we have to interpret as unsigned
+  v = _mm_abs_epi16(v);
+  sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(v,zero));
+  sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(v,zero));
+  return sum;
+}
+
+
+static inline __m128i load_diff_8(const uint8_t* img, const uint8_t* ref)
+{
+  __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)img));
+  __m128i b = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)ref));
+  return _mm_sub_epi16(a,b);
+}
+
+
+static inline __m128i load_diff_4(const uint8_t* img, const uint8_t* ref)
+{
+  __m128i a = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(*(const int32_t*)img));
+  __m128i b = _mm_cvtepu8_epi16(_mm_cvtsi32_si128(*(const int32_t*)ref));
+  return _mm_sub_epi16(a,b);
+}
+
+
+uint32_t satd_4x4_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                         const uint8_t* ref, ptrdiff_t refStride)
+{
+  // two rows per register: r01 = rows 0|1, r23 = rows 2|3
+
+  __m128i r0 = load_diff_4(img,            ref);
+  __m128i r1 = load_diff_4(img+  imgStride, ref+  refStride);
+  __m128i r2 = load_diff_4(img+2*imgStride, ref+2*refStride);
+  __m128i r3 = load_diff_4(img+3*imgStride, ref+3*refStride);
+
+  __m128i r01 = _mm_unpacklo_epi64(r0,r1);
+  __m128i r23 = _mm_unpacklo_epi64(r2,r3);
+
+  // vertical butterflies
+
+  __m128i s = _mm_add_epi16(r01,r23);  // 0+2 | 1+3
+  __m128i d = _mm_sub_epi16(r01,r23);  // 0-2 | 1-3
+
+  __m128i s_sw = _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2));
+  __m128i d_sw = _mm_shuffle_epi32(d, _MM_SHUFFLE(1,0,3,2));
+
+  __m128i v0 = _mm_unpacklo_epi64(_mm_add_epi16(s,s_sw), _mm_sub_epi16(s,s_sw)); // c0 | c1
+  __m128i v1 = _mm_unpacklo_epi64(_mm_add_epi16(d,d_sw), _mm_sub_epi16(d,d_sw)); // c2 | c3
+
+  // transpose 4x4 (rows c0..c3 in v0.lo, v0.hi, v1.lo, v1.hi)
+
+  __m128i t0 = _mm_unpacklo_epi16(v0, _mm_srli_si128(v0,8)); // c0[0] c1[0] c0[1] c1[1] ...
+  __m128i t1 = _mm_unpacklo_epi16(v1, _mm_srli_si128(v1,8)); // c2[0] c3[0] ...
+  __m128i u0 = _mm_unpacklo_epi32(t0,t1); // column 0 | column 1
+  __m128i u1 = _mm_unpackhi_epi32(t0,t1); // column 2 | column 3
+
+  // horizontal butterflies
+
+  s = _mm_add_epi16(u0,u1);
+  d = _mm_sub_epi16(u0,u1);
+
+  s_sw = _mm_shuffle_epi32(s, _MM_SHUFFLE(1,0,3,2));
+  d_sw = _mm_shuffle_epi32(d, _MM_SHUFFLE(1,0,3,2));
+
+  __m128i sum = _mm_setzero_si128();
+  sum = abs_sum_epi16(sum, _mm_unpacklo_epi64(_mm_add_epi16(s,s_sw), _mm_sub_epi16(s,s_sw)));
+  sum = abs_sum_epi16(sum, _mm_unpacklo_epi64(_mm_add_epi16(d,d_sw), _mm_sub_epi16(d,d_sw)));
+
+  return hsum_epi32(sum);
+}
+
+
+uint32_t satd_8x8_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                         const uint8_t* ref, ptrdiff_t refStride)
+{
+  __m128i r[8];
+
+  for (int y=0;y<8;y++) {
+    r[y] = load_diff_8(img+y*imgStride, ref+y*refStride);
+  }
+
+  hadamard_columns_epi16(r,8);
+  transpose_8x8_epi16(r);
+  hadamard_columns_epi16(r,8);
+
+  __m128i sum = _mm_setzero_si128();
+  for (int y=0;y<8;y++) {
+    sum = abs_sum_epi16(sum, r[y]);
+  }
+
+  return hsum_epi32(sum);
+}
+
+
+/* NxN blocks (N=16,32) are stored as N/8 strips of 8 columns.
+   The vertical transform is applied to each strip, then the strips are
+   transposed in 8x8 tiles and the vertical transform is applied again.
+ */
+template <int N>
+static uint32_t satd_NxN_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                                const uint8_t* ref, ptrdiff_t refStride)
+{
+  __m128i strip[N/8][N];
+  __m128i tstrip[N/8][N];
+
+  for (int s=0;s<N/8;s++) {
+    for (int y=0;y<N;y++) {
+      strip[s][y] = load_diff_8(img+y*imgStride+8*s, ref+y*refStride+8*s);
+    }
+
+    hadamard_columns_epi16(strip[s],N);
+  }
+
+  // transpose: tile (s,t) of the input becomes tile (t,s) of the output
+
+  for (int s=0;s<N/8;s++)
+    for (int t=0;t<N/8;t++) {
+      __m128i tile[8];
+      for (int i=0;i<8;i++) { tile[i] = strip[s][8*t+i]; }
+      transpose_8x8_epi16(tile);
+      for (int i=0;i<8;i++) { tstrip[t][8*s+i] = tile[i]; }
+    }
+
+  __m128i sum = _mm_setzero_si128();
+
+  for (int s=0;s<N/8;s++) {
+    hadamard_columns_epi16(tstrip[s],N);
+
+    for (int y=0;y<N;y++) {
+      sum = abs_sum_epi16(sum, tstrip[s][y]);
+    }
+  }
+
+  return hsum_epi32(sum);
+}
+
+
+uint32_t satd_16x16_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                           const uint8_t* ref, ptrdiff_t refStride)
+{
+  return satd_NxN_8_sse4<16>(img,imgStride,ref,refStride);
+}
+
+uint32_t satd_32x32_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                           const uint8_t* ref, ptrdiff_t refStride)
+{
+  return satd_NxN_8_sse4<32>(img,imgStride,ref,refStride);
+}
+
+uint32_t satd_64x64_8_sse4(const uint8_t* img, ptrdiff_t imgStride,
+                           const uint8_t* ref, ptrdiff_t refStride)
+{
+  // computed as four 32x32 blocks, like hadamard_transform_8[] is used in the encoder
+
+  return (satd_NxN_8_sse4<32>(img,    imgStride, ref,    refStride) +
+          satd_NxN_8_sse4<32>(img+32, imgStride, ref+32, refStride) +
+          satd_NxN_8_sse4<32>(img+32*imgStride,    imgStride, ref+32*refStride,    refStride) +
+          satd_NxN_8_sse4<32>(img+32*imgStride+32, imgStride, ref+32*refStride+32, refStride));
+}
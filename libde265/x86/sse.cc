@@ -24,7 +24,10 @@
 
 #include "x86/sse.h"
 #include "x86/sse-motion.h"
+#include "x86/sse-bipred.h"
 #include "x86/sse-dct.h"
+#include "x86/sse-distortion.h"
+#include "x86/sse-deblock.h"
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -89,6 +92,9 @@ void init_acceleration_functions_sse(struct acceleration_functions* accel)
     accel->put_hevc_qpel_8[3][2] = ff_hevc_put_hevc_qpel_h_3_v_2_sse;
     accel->put_hevc_qpel_8[3][3] = ff_hevc_put_hevc_qpel_h_3_v_3_sse;
 
+    accel->put_hevc_qpel_bi_8 = put_qpel_bi_8_sse4;
+    accel->put_hevc_epel_bi_8 = put_epel_bi_8_sse4;
+
     accel->transform_skip_8 = ff_hevc_transform_skip_8_sse;
 
     // actually, for these two functions, the scalar fallback seems to be faster than the SSE code
@@ -98,6 +104,25 @@ void init_acceleration_functions_sse(struct acceleration_functions* accel)
     accel->transform_add_8[1] = ff_hevc_transform_8x8_add_8_sse4;
     accel->transform_add_8[2] = ff_hevc_transform_16x16_add_8_sse4;
     accel->transform_add_8[3] = ff_hevc_transform_32x32_add_8_sse4;
+    accel->transform_add_partial_8[2] = ff_hevc_transform_16x16_add_partial_8_sse4;
+    accel->transform_add_partial_8[3] = ff_hevc_transform_32x32_add_partial_8_sse4;
+    accel->transform_dc_add_8 = ff_hevc_transform_dc_add_8_sse4;
+
+    accel->dequant_coefficients = dequant_coefficients_sse4;
+    accel->dequant_block        = dequant_block_sse4;
+
+    accel->sad_8  = sad_8_sse4;
+    accel->ssd_8  = ssd_8_sse4;
+    accel->sad_16 = sad_16_sse4;
+    accel->ssd_16 = ssd_16_sse4;
+
+    accel->satd_8[0] = satd_4x4_8_sse4;
+    accel->satd_8[1] = satd_8x8_8_sse4;
+    accel->satd_8[2] = satd_16x16_8_sse4;
+    accel->satd_8[3] = satd_32x32_8_sse4;
+    accel->satd_8[4] = satd_64x64_8_sse4;
+
+    accel->deblock_boundary_strength = deblock_boundary_strength_sse4;
   }
 #endif
 }
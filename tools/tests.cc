@@ -18,9 +18,19 @@
  * along with libde265.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "libde265/de265.h"
+#include "libde265/en265.h"
+#include "libde265/image.h"
+#include "libde265/encoder/encoder-context.h"
+#include "libde265/encoder/encoder-syntax.h"
+#include "libde265/encoder/algo/tb-rateestim.h"
+
 #include <stdio.h>
 #include <iostream>
 #include <string.h>
+#include <vector>
+#include <algorithm>
+#include <thread>
 
 
 class Test
@@ -33,24 +43,29 @@ public:
   virtual const char* getDescription() const { return "no description"; }
   virtual bool work(bool quiet=false) = 0;
 
-  static void runTest(const char* name) {
+  static bool runTest(const char* name) {
     Test* t = s_firstTest;
     while (t) {
       if (strcmp(t->getName(), name)==0) {
-        t->work();
-        break;
+        return t->work();
       }
       t=t->next;
     }
+
+    printf("unknown test: %s\n",name);
+    return false;
   }
 
-  static void runAllTests() {
+  static bool runAllTests() {
+    bool allPassed = true;
+
     Test* t = s_firstTest;
     while (t) {
       printf("%s ... ",t->getName());
       fflush(stdout);
       if (t->work(true) == false) {
         printf("*** FAILED ***\n");
+        allPassed = false;
       }
       else {
         printf("passed\n");
@@ -58,6 +73,8 @@ public:
 
       t=t->next;
     }
+
+    return allPassed;
   }
 
 public:
@@ -87,14 +104,490 @@ public:
 
 
 
+// Encode a few frames of a moving synthetic pattern into an in-memory bitstream.
+// With 'intraPeriod' > 0, an IDR picture is inserted every 'intraPeriod' frames.
+static std::vector<uint8_t> encode_test_stream(int width,int height, int nFrames,
+                                               int intraPeriod=0)
+{
+  std::vector<uint8_t> stream;
+
+  en265_encoder_context* ectx = en265_new_encoder();
+  if (intraPeriod>0) {
+    en265_set_parameter_int(ectx, "sop-lowDelay-intraPeriod", intraPeriod);
+  }
+  en265_start_encoder(ectx, 0);
+
+  for (int poc=0; poc<=nFrames; poc++) {
+    if (poc==nFrames) {
+      en265_push_eof(ectx);
+    }
+    else {
+      de265_image* img = en265_allocate_image(ectx, width,height, de265_chroma_420, poc, NULL);
+
+      for (int c=0;c<3;c++) {
+        uint8_t* p = img->get_image_plane(c);
+        int stride = img->get_image_stride(c);
+        int w = img->get_width(c);
+        int h = img->get_height(c);
+
+        for (int y=0;y<h;y++)
+          for (int x=0;x<w;x++) {
+            p[y*stride+x] = (uint8_t)((x+2*poc)*(c+1) ^ (y+poc)*3);
+          }
+      }
+
+      en265_push_image(ectx, img);
+    }
+
+    en265_encode(ectx);
+
+    en265_packet* pck;
+    while ((pck = en265_get_packet(ectx,0)) != NULL) {
+      static const uint8_t startcode[4] = { 0,0,0,1 };
+      stream.insert(stream.end(), startcode, startcode+4);
+      stream.insert(stream.end(), pck->data, pck->data + pck->length);
+      en265_free_packet(ectx,pck);
+    }
+  }
+
+  en265_free_encoder(ectx);
+
+  return stream;
+}
+
+
+static void append_picture(std::vector<uint8_t>* out, const de265_image* img)
+{
+  for (int c=0;c<3;c++) {
+    int stride;
+    const uint8_t* p = de265_get_image_plane(img, c, &stride);
+    int w = de265_get_image_width(img, c);
+    int h = de265_get_image_height(img, c);
+
+    for (int y=0;y<h;y++) {
+      out->insert(out->end(), p+y*stride, p+y*stride+w);
+    }
+  }
+}
+
+
+// Decode with 'nThreads' own worker threads, or with the threads of a shared pool.
+static std::vector<uint8_t> decode_sync(const std::vector<uint8_t>& stream, int nThreads,
+                                        de265_thread_pool* pool=NULL, int maxParallelTasks=0)
+{
+  std::vector<uint8_t> output;
+
+  de265_decoder_context* ctx = de265_new_decoder();
+  if (pool) {
+    de265_attach_thread_pool(ctx, pool, maxParallelTasks);
+  }
+  else {
+    de265_start_worker_threads(ctx, nThreads);
+  }
+
+  de265_push_data(ctx, stream.data(), stream.size(), 0, NULL);
+  de265_flush_data(ctx);
+
+  int more=1;
+  while (more) {
+    more=0;
+    de265_error err = de265_decode(ctx, &more);
+    if (!de265_isOK(err) && err != DE265_ERROR_WAITING_FOR_INPUT_DATA) {
+      break;
+    }
+
+    const de265_image* img;
+    while ((img = de265_get_next_picture(ctx)) != NULL) {
+      append_picture(&output, img);
+    }
+  }
+
+  de265_free_decoder(ctx);
+
+  return output;
+}
+
+
+static void async_picture_ready(void* callback_data, const de265_image* img)
+{
+  append_picture((std::vector<uint8_t>*)callback_data, img);
+}
+
+
+static std::vector<uint8_t> decode_async(const std::vector<uint8_t>& stream, int nThreads,
+                                         bool* out_startTwiceFails)
+{
+  std::vector<uint8_t> output;
+
+  de265_decoder_context* ctx = de265_new_decoder();
+  de265_start_worker_threads(ctx, nThreads);
+
+  // use a small queue, such that pushing the data has to wait for the decoder
+  de265_start_async_decoding(ctx, 1000, async_picture_ready, &output);
+
+  *out_startTwiceFails = (de265_start_async_decoding(ctx, 1000, async_picture_ready, &output)
+                          == DE265_ERROR_ASYNC_DECODING_ALREADY_ACTIVE);
+
+  for (size_t i=0; i<stream.size(); i+=500) {
+    size_t len = std::min(stream.size()-i, (size_t)500);
+    de265_async_push_data(ctx, stream.data()+i, len, 0, NULL);
+  }
+
+  de265_async_flush_data(ctx);
+  de265_async_wait(ctx);
+  de265_stop_async_decoding(ctx);
+
+  de265_free_decoder(ctx);
+
+  return output;
+}
+
+
+class AsyncDecodingTest : public Test
+{
+public:
+  const char* getName() const { return "async-decoding"; }
+  const char* getDescription() const { return "asynchronous decoding gives the same pictures as de265_decode()"; }
+  bool work(bool quiet) {
+    const int nFrames = 8;
+    std::vector<uint8_t> stream = encode_test_stream(128,96, nFrames);
+
+    std::vector<uint8_t> reference = decode_sync(stream, 0);
+    if (reference.size() != nFrames*128*96*3/2) {
+      if (!quiet) printf("synchronous decoding returned %d bytes\n", (int)reference.size());
+      return false;
+    }
+
+    const int threads[] = { 0, 4 };
+    for (int nThreads : threads) {
+      bool startTwiceFails = false;
+      std::vector<uint8_t> output = decode_async(stream, nThreads, &startTwiceFails);
+
+      if (output != reference) {
+        if (!quiet) printf("output differs with %d threads\n", nThreads);
+        return false;
+      }
+
+      if (!startTwiceFails) {
+        if (!quiet) printf("starting asynchronous decoding twice did not fail\n");
+        return false;
+      }
+    }
+
+    return true;
+  }
+} asyncdecodingtest;
+
+
+class SharedThreadPoolTest : public Test
+{
+public:
+  const char* getName() const { return "shared-thread-pool"; }
+  const char* getDescription() const { return "two decoders on a shared thread pool give the same pictures as single decoding"; }
+  bool work(bool quiet) {
+    const int nFrames = 6;
+    std::vector<uint8_t> stream[2] = { encode_test_stream(128,96, nFrames),
+                                       encode_test_stream(192,64, nFrames) };
+
+    std::vector<uint8_t> reference[2];
+    for (int s=0;s<2;s++) {
+      reference[s] = decode_sync(stream[s], 0);
+    }
+
+    if (reference[0].size() != nFrames*128*96*3/2 ||
+        reference[1].size() != nFrames*192*64*3/2) {
+      if (!quiet) printf("single decoding returned %d and %d bytes\n",
+                         (int)reference[0].size(), (int)reference[1].size());
+      return false;
+    }
+
+    de265_thread_pool* pool = de265_new_thread_pool(4);
+    if (pool==NULL) {
+      if (!quiet) printf("cannot create thread pool\n");
+      return false;
+    }
+
+    bool success = true;
+
+    // decode both streams at the same time, with and without limiting the tasks of one decoder
+
+    for (int run=0; run<4 && success; run++) {
+      std::vector<uint8_t> output[2];
+
+      std::thread decoder0([&]() { output[0] = decode_sync(stream[0], 0, pool, 0); });
+      std::thread decoder1([&]() { output[1] = decode_sync(stream[1], 0, pool, run%2 ? 1 : 0); });
+      decoder0.join();
+      decoder1.join();
+
+      for (int s=0;s<2;s++) {
+        if (output[s] != reference[s]) {
+          if (!quiet) printf("output of stream %d differs in run %d\n", s, run);
+          success = false;
+        }
+      }
+    }
+
+    de265_free_thread_pool(pool);
+
+    return success;
+  }
+} sharedthreadpooltest;
+
+
+class StreamIndexTest : public Test
+{
+public:
+  const char* getName() const { return "stream-index"; }
+  const char* getDescription() const { return "stream index is independent of the push sizes, seeking gives the same pictures as linear decoding"; }
+
+  // The PTS of each chunk is its byte offset. Hence, the PTS of the entries depends on
+  // the push size. With push size 1, it is the offset of the last start-code byte of
+  // the IRAP slice.
+  static de265_stream_index* index_stream(const std::vector<uint8_t>& stream, size_t pushSize) {
+    de265_stream_index* index = de265_new_stream_index();
+
+    for (size_t i=0; i<stream.size(); i+=pushSize) {
+      size_t len = std::min(stream.size()-i, pushSize);
+      de265_index_data(index, stream.data()+i, len, i);
+    }
+
+    de265_index_end_of_stream(index);
+
+    return index;
+  }
+
+  bool work(bool quiet) {
+    const int width=128, height=96;
+    const int nFrames = 10;
+    const size_t frameSize = width*height*3/2;
+
+    std::vector<uint8_t> stream = encode_test_stream(width,height, nFrames, 3);
+
+    std::vector<uint8_t> reference = decode_sync(stream, 0);
+    if (reference.size() != nFrames*frameSize) {
+      if (!quiet) printf("linear decoding returned %d bytes\n", (int)reference.size());
+      return false;
+    }
+
+    de265_stream_index* index = index_stream(stream, 1);
+    const int nRAPs = de265_get_number_of_random_access_points(index);
+
+    if (nRAPs != (nFrames+2)/3) {
+      if (!quiet) printf("%d random access points in the index, expected %d\n", nRAPs, (nFrames+2)/3);
+      de265_free_stream_index(index);
+      return false;
+    }
+
+    bool success = true;
+
+
+    // --- the entries do not depend on how the data is pushed ---
+
+    const size_t pushSizes[] = { 7, 500, stream.size() };
+    for (size_t pushSize : pushSizes) {
+      de265_stream_index* index2 = index_stream(stream, pushSize);
+
+      if (de265_get_number_of_random_access_points(index2) != nRAPs) {
+        if (!quiet) printf("different number of random access points with push size %d\n", (int)pushSize);
+        success = false;
+      }
+      else {
+        for (int r=0;r<nRAPs;r++) {
+          const de265_random_access_point* a = de265_get_random_access_point(index,  r);
+          const de265_random_access_point* b = de265_get_random_access_point(index2, r);
+
+          if (a->byte_offset    != b->byte_offset ||
+              a->poc            != b->poc ||
+              a->nal_unit_type  != b->nal_unit_type ||
+              a->picture_number != b->picture_number ||
+              b->pts > a->pts || b->pts + (de265_PTS)pushSize <= a->pts) {
+            if (!quiet) printf("random access point %d differs with push size %d\n", r, (int)pushSize);
+            success = false;
+          }
+        }
+      }
+
+      de265_free_stream_index(index2);
+    }
+
+
+    // --- seek to each random access point (backwards) and decode to the end ---
+
+    de265_decoder_context* ctx = de265_new_decoder();
+
+    for (int r=nRAPs-1; r>=0 && success; r--) {
+      const de265_random_access_point* rap = de265_get_random_access_point(index, r);
+
+      int64_t offset;
+      de265_error err = de265_seek(ctx, index, rap->pts, &offset);
+      if (err != DE265_OK || offset != rap->byte_offset) {
+        if (!quiet) printf("seeking to random access point %d failed\n", r);
+        success = false;
+        break;
+      }
+
+      de265_push_data(ctx, stream.data()+offset, stream.size()-offset, 0, NULL);
+      de265_flush_data(ctx);
+
+      std::vector<uint8_t> output;
+
+      int more=1;
+      while (more) {
+        more=0;
+        err = de265_decode(ctx, &more);
+        if (!de265_isOK(err) && err != DE265_ERROR_WAITING_FOR_INPUT_DATA) {
+          break;
+        }
+
+        const de265_image* img;
+        while ((img = de265_get_next_picture(ctx)) != NULL) {
+          append_picture(&output, img);
+        }
+      }
+
+      std::vector<uint8_t> expected(reference.begin() + rap->picture_number*frameSize,
+                                    reference.end());
+      if (output != expected) {
+        if (!quiet) printf("pictures after seeking to random access point %d (picture %d) differ\n",
+                           r, rap->picture_number);
+        success = false;
+      }
+    }
+
+    de265_free_decoder(ctx);
+    de265_free_stream_index(index);
+
+    return success;
+  }
+} streamindextest;
+
+
+/* The fast TB rate estimation does not adapt the context states, so it has to give
+   exactly the same number of bits as running the TU through CABAC_encoder_estim_constant.
+ */
+class TBRateEstimationTest : public Test
+{
+public:
+  const char* getName() const { return "tb-rate-estimation"; }
+  const char* getDescription() const { return "fast TB rate estimation matches the constant-context CABAC estimate"; }
+  bool work(bool quiet) {
+    de265_init();
+
+    std::shared_ptr<video_parameter_set> vps = std::make_shared<video_parameter_set>();
+    std::shared_ptr<seq_parameter_set>   sps = std::make_shared<seq_parameter_set>();
+    std::shared_ptr<pic_parameter_set>   pps = std::make_shared<pic_parameter_set>();
+
+    sps->set_defaults();
+    sps->set_CB_log2size_range(3,5);
+    sps->set_TB_log2size_range(2,5);
+    sps->set_resolution(64,64);
+    sps->compute_derived_values(true);
+
+    pps->set_defaults();
+    pps->sps = sps;
+    pps->set_derived_values(sps.get());
+
+    de265_image img;
+    img.set_headers(vps,sps,pps);
+
+    encoder_context ectx;
+    ectx.img = &img;
+    ectx.get_shared_vps() = vps;
+    ectx.get_shared_sps() = sps;
+    ectx.get_shared_pps() = pps;
+
+    Algo_TB_RateEstimation_Fast fast;
+    context_model_table ctxModel;
+    ctxModel.init(0, 30);
+
+    uint32_t random = 12345;
+    bool success = true;
+
+    const int nTUs = 50000;
+    for (int i=0; i<nTUs && success; i++) {
+      auto rnd = [&random](int n) { random = random*1103515245+12345; return (int)((random>>8) % n); };
+
+      // random context states, so that all entries of the fractional-bit table are used
+      if (i%64==0) {
+        for (int m=0;m<CONTEXT_MODEL_TABLE_LENGTH;m++) {
+          ctxModel[m].state  = rnd(63);
+          ctxModel[m].MPSbit = rnd(2);
+        }
+      }
+
+      // with sign data hiding, the encoder expects the hidden signs to be positive
+      pps->sign_data_hiding_flag = (i%2);
+
+      const int log2TrafoSize = 2 + rnd(4);
+
+      enc_cb cb;
+      cb.PredMode = (rnd(2) ? MODE_INTRA : MODE_INTER);
+      cb.cu_transquant_bypass_flag = (rnd(8)==0);
+
+      enc_tb tb(0,0, log2TrafoSize, &cb);
+      tb.intra_mode        = (enum IntraPredMode)rnd(35);
+      tb.intra_mode_chroma = (enum IntraPredMode)rnd(35);
+
+      // sparse blocks with occasional large levels, up to the int16 limit
+      const int density = 1+rnd(64);
+      for (int c=0;c<3;c++) {
+        int log2Size = (c>0 && log2TrafoSize>2 ? log2TrafoSize-1 : log2TrafoSize);
+        int n = 1<<(2*log2Size);
+
+        tb.alloc_coeff_memory(c, 1<<log2Size);
+        tb.cbf[c] = 0;
+
+        for (int k=0;k<n;k++) {
+          int v = 0;
+          if (rnd(64) < density) {
+            switch (rnd(8)) {
+            case 0:  v = rnd(32768); break;
+            case 1:
+            case 2:  v = 1+rnd(64); break;
+            default: v = 1+rnd(3); break;
+            }
+            if (!pps->sign_data_hiding_flag && rnd(2)) v = -v;
+          }
+
+          tb.coeff[c][k] = v;
+          if (v) tb.cbf[c] = 1;
+        }
+      }
+
+      // blkIdx 3, so that chroma is also coded for 4x4 luma blocks
+
+      float fastBits = fast.encode_transform_unit(&ectx, ctxModel, &tb,&cb,
+                                                  0,0, 0,0, log2TrafoSize, 1, 3);
+
+      CABAC_encoder_estim_constant estim;
+      estim.set_context_models(&ctxModel);
+      encode_transform_unit(&ectx, &estim, &tb,&cb, 0,0, 0,0, log2TrafoSize, 1, 3);
+
+      if (fastBits != estim.getRDBits()) {
+        if (!quiet) printf("TU %d (%dx%d): fast estimate %f, CABAC estimate %f\n", i,
+                           1<<log2TrafoSize, 1<<log2TrafoSize, fastBits, estim.getRDBits());
+        success = false;
+      }
+    }
+
+    de265_free();
+
+    return success;
+  }
+} tbrateestimationtest;
+
+
+
 int main(int argc,char** argv)
 {
+  bool success;
+
   if (argc>=2) {
-    Test::runTest(argv[1]);
+    success = Test::runTest(argv[1]);
   }
   else {
-    Test::runAllTests();
+    success = Test::runAllTests();
   }
 
-  return 0;
+  return success ? 0 : 1;
 }